@@ -0,0 +1,561 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HugeCTR/include/common.hpp"
+#include "HugeCTR/include/host_allocator.hpp"
+
+#ifdef ENABLE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace HugeCTR {
+
+const int ASYNC_READ_DEFAULT_QUEUE_DEPTH = 8;
+const size_t ASYNC_READ_DEFAULT_BLOCK_SIZE = 1 << 20;
+const size_t ASYNC_READ_ALIGNMENT = 4096; /**< alignment of the offsets and buffers of O_DIRECT */
+
+/**
+ * @brief Asynchronous positional reads of a file.
+ *
+ * A read is submitted with a tag and its completion is reaped later, in any order.
+ * An object is used by one thread.
+ */
+class AsyncReadBackend {
+ public:
+  virtual ~AsyncReadBackend() {}
+  /**
+   * Submit a read of length bytes at offset of fd into buffer.
+   * @param tag returned by wait() when the read completes, in [0, queue depth).
+   */
+  virtual void submit(int fd, void* buffer, size_t length, long long offset, int tag) = 0;
+  /**
+   * Block until a submitted read completes.
+   * @param tag the tag of the read is passed out.
+   * @return the number of bytes read, or -errno.
+   */
+  virtual long long wait(int* tag) = 0;
+  virtual const char* get_name() const = 0;
+};
+
+/**
+ * The reads are done with pread() by a thread in the order they are submitted.
+ */
+class PreadBackend : public AsyncReadBackend {
+ private:
+  struct Request {
+    int fd;
+    void* buffer;
+    size_t length;
+    long long offset;
+    int tag;
+  };
+  std::mutex mtx_;
+  std::condition_variable request_cv_;
+  std::condition_variable completion_cv_;
+  std::deque<Request> requests_;
+  std::deque<std::pair<int, long long>> completions_; /**< tag, result */
+  bool stop_{false};
+  std::thread thread_;
+
+  void run_() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+      request_cv_.wait(lock, [this]() { return stop_ || !requests_.empty(); });
+      if (stop_) {
+        return;
+      }
+      Request request = requests_.front();
+      requests_.pop_front();
+      lock.unlock();
+      long long result;
+      do {
+        result = pread(request.fd, request.buffer, request.length, request.offset);
+      } while (result < 0 && errno == EINTR);
+      if (result < 0) {
+        result = -errno;
+      }
+      lock.lock();
+      completions_.emplace_back(request.tag, result);
+      completion_cv_.notify_one();
+    }
+  }
+
+ public:
+  PreadBackend() : thread_(&PreadBackend::run_, this) {}
+  PreadBackend(const PreadBackend&) = delete;
+  PreadBackend& operator=(const PreadBackend&) = delete;
+
+  void submit(int fd, void* buffer, size_t length, long long offset, int tag) override {
+    std::lock_guard<std::mutex> lock(mtx_);
+    requests_.push_back({fd, buffer, length, offset, tag});
+    request_cv_.notify_one();
+  }
+
+  long long wait(int* tag) override {
+    std::unique_lock<std::mutex> lock(mtx_);
+    completion_cv_.wait(lock, [this]() { return !completions_.empty(); });
+    *tag = completions_.front().first;
+    long long result = completions_.front().second;
+    completions_.pop_front();
+    return result;
+  }
+
+  const char* get_name() const override { return "pread"; }
+
+  ~PreadBackend() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      stop_ = true;
+      request_cv_.notify_one();
+    }
+    thread_.join();
+  }
+};
+
+#ifdef ENABLE_IO_URING
+/**
+ * The reads are submitted to an io_uring (IORING_OP_READV, Linux 5.1+) with the raw
+ * system calls, so that liburing is not needed.
+ */
+class IoUringBackend : public AsyncReadBackend {
+ private:
+  int ring_fd_{-1};
+  void* sq_ring_{MAP_FAILED};
+  size_t sq_ring_size_{0};
+  void* cq_ring_{MAP_FAILED};
+  size_t cq_ring_size_{0};
+  io_uring_sqe* sqes_{static_cast<io_uring_sqe*>(MAP_FAILED)};
+  size_t sqes_size_{0};
+  unsigned* sq_tail_{nullptr};
+  unsigned* sq_mask_{nullptr};
+  unsigned* sq_array_{nullptr};
+  unsigned* cq_head_{nullptr};
+  unsigned* cq_tail_{nullptr};
+  unsigned* cq_mask_{nullptr};
+  io_uring_cqe* cqes_{nullptr};
+  std::vector<iovec> iovecs_; /**< the iovec of each tag, alive until the read completes */
+
+  void release_() {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+      close(ring_fd_);
+    }
+  }
+
+ public:
+  /**
+   * Ctor.
+   * @param queue_depth the max number of reads in flight.
+   * An exception is thrown if io_uring is not available, e.g. disabled by seccomp.
+   */
+  explicit IoUringBackend(int queue_depth) : iovecs_(queue_depth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+    if (ring_fd_ < 0) {
+      CK_THROW_(Error_t::InvalidEnv,
+                std::string("io_uring_setup() failed: ") + std::strerror(errno));
+    }
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_
+                           : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                            IORING_OFF_SQES));
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+      release_();
+      CK_THROW_(Error_t::InvalidEnv, "mmap() of io_uring failed");
+    }
+    char* sq = static_cast<char*>(sq_ring_);
+    char* cq = static_cast<char*>(cq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+  IoUringBackend(const IoUringBackend&) = delete;
+  IoUringBackend& operator=(const IoUringBackend&) = delete;
+
+  void submit(int fd, void* buffer, size_t length, long long offset, int tag) override {
+    iovecs_[tag].iov_base = buffer;
+    iovecs_[tag].iov_len = length;
+    // the submission queue is only written by this thread
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<unsigned long long>(&iovecs_[tag]);
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = tag;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    int ret;
+    do {
+      ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0));
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+      CK_THROW_(Error_t::UnspecificError,
+                std::string("io_uring_enter() failed: ") + std::strerror(errno));
+    }
+  }
+
+  long long wait(int* tag) override {
+    while (true) {
+      unsigned head = *cq_head_;
+      if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        *tag = static_cast<int>(cqe.user_data);
+        long long result = cqe.res;
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        return result;
+      }
+      int ret = static_cast<int>(
+          syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+      if (ret < 0 && errno != EINTR) {
+        CK_THROW_(Error_t::UnspecificError,
+                  std::string("io_uring_enter() failed: ") + std::strerror(errno));
+      }
+    }
+  }
+
+  const char* get_name() const override { return "io_uring"; }
+
+  ~IoUringBackend() { release_(); }
+};
+#endif
+
+/**
+ * Create the backend of AsyncFileReader: io_uring if HugeCTR is built with it
+ * (ENABLE_IO_URING) and the kernel allows it, otherwise a pread thread.
+ * @param use_io_uring false to use the pread thread anyway.
+ */
+inline std::unique_ptr<AsyncReadBackend> create_async_read_backend(int queue_depth,
+                                                                   bool use_io_uring = true) {
+#ifdef ENABLE_IO_URING
+  if (use_io_uring) {
+    try {
+      return std::unique_ptr<AsyncReadBackend>(new IoUringBackend(queue_depth));
+    } catch (const internal_runtime_error&) {
+      // fall back to pread
+    }
+  }
+#endif
+  return std::unique_ptr<AsyncReadBackend>(new PreadBackend());
+}
+
+/**
+ * @brief Sequential reader of a file with asynchronous read-ahead.
+ *
+ * Used by DataReaderMultiThreads in ReaderMode_t::Direct. The file is opened with O_DIRECT
+ * (bypassing the page cache, so a cold data set isn't buffered twice) when the file system
+ * supports it, and read in blocks of block_size bytes into page aligned buffers.
+ * queue_depth blocks are kept in flight ahead of the block being decoded: once a block is
+ * consumed its buffer is submitted for the next block of the file.
+ * read() returns a pointer into the current block when the bytes are in one block,
+ * which is valid until the next call, otherwise the bytes are copied into scratch.
+ */
+class AsyncFileReader {
+ private:
+  struct Block {
+    char* buffer;
+    long long offset;  // offset of the block in the file
+    long long size;    // valid bytes in buffer
+    bool in_flight;
+  };
+  const int queue_depth_;
+  const size_t block_size_;
+  AlignedHostAllocator allocator_;
+  std::unique_ptr<AsyncReadBackend> backend_;
+  std::vector<Block> blocks_;
+  int num_in_flight_{0};
+  int fd_{-1};
+  bool direct_{false};
+  long long file_size_{0};
+  std::string file_name_;
+  int head_{0};               /**< the block being read */
+  long long head_pos_{0};     /**< position in the head block */
+  long long next_offset_{0};  /**< offset of the next block to submit */
+
+  void submit_(int i) {
+    Block& block = blocks_[i];
+    block.offset = next_offset_;
+    block.size = 0;
+    if (next_offset_ >= file_size_) {
+      return;
+    }
+    // whole blocks are read even at the end of file, as O_DIRECT needs aligned lengths
+    backend_->submit(fd_, block.buffer, block_size_, block.offset, i);
+    block.in_flight = true;
+    num_in_flight_++;
+    next_offset_ += block_size_;
+  }
+
+  /**
+   * Reap the completions until block i is read.
+   */
+  void wait_for_(int i) {
+    while (blocks_[i].in_flight) {
+      int tag = 0;
+      long long result = backend_->wait(&tag);
+      Block& block = blocks_[tag];
+      block.in_flight = false;
+      num_in_flight_--;
+      if (result < 0) {
+        CK_THROW_(Error_t::FileCannotOpen, "read failed: " + file_name_ + ": " +
+                                               std::strerror(static_cast<int>(-result)));
+      }
+      block.size = result;
+      const long long expected =
+          std::min(static_cast<long long>(block_size_), file_size_ - block.offset);
+      // complete a short read, it's aligned except at the end of file
+      while (block.size < expected) {
+        long long ret = pread(fd_, block.buffer + block.size, block_size_ - block.size,
+                              block.offset + block.size);
+        if (ret < 0 && errno == EINTR) {
+          continue;
+        }
+        if (ret <= 0) {
+          CK_THROW_(Error_t::FileCannotOpen, "read failed: " + file_name_);
+        }
+        block.size += ret;
+      }
+      block.size = std::min(block.size, expected);
+    }
+  }
+
+  void drain_() {
+    for (int i = 0; i < queue_depth_; i++) {
+      wait_for_(i);
+    }
+  }
+
+  /**
+   * Start the read-ahead at offset.
+   */
+  void start_(long long offset) {
+    drain_();
+    next_offset_ = offset / ASYNC_READ_ALIGNMENT * ASYNC_READ_ALIGNMENT;
+    head_ = 0;
+    head_pos_ = offset - next_offset_;
+    for (int i = 0; i < queue_depth_; i++) {
+      submit_(i);
+    }
+    wait_for_(head_);
+  }
+
+  /**
+   * Recycle the head block and move to the next one.
+   * @return false at the end of file.
+   */
+  bool advance_() {
+    const long long head_end = blocks_[head_].offset + blocks_[head_].size;
+    if (head_end >= file_size_) {
+      return false;
+    }
+    submit_(head_);
+    head_ = (head_ + 1) % queue_depth_;
+    head_pos_ = 0;
+    wait_for_(head_);
+    return blocks_[head_].size > 0;
+  }
+
+ public:
+  /**
+   * Ctor.
+   * @param queue_depth the number of blocks in flight.
+   * @param block_size size of a read, a multiple of ASYNC_READ_ALIGNMENT.
+   * @param use_io_uring false to use the pread thread even if io_uring is available.
+   */
+  AsyncFileReader(int queue_depth = ASYNC_READ_DEFAULT_QUEUE_DEPTH,
+                  size_t block_size = ASYNC_READ_DEFAULT_BLOCK_SIZE, bool use_io_uring = true)
+      : queue_depth_(queue_depth), block_size_(block_size) {
+    if (queue_depth <= 0 || block_size == 0 || block_size % ASYNC_READ_ALIGNMENT != 0) {
+      CK_THROW_(Error_t::WrongInput,
+                "queue_depth <= 0 || block_size is not a multiple of ASYNC_READ_ALIGNMENT");
+    }
+    backend_ = create_async_read_backend(queue_depth, use_io_uring);
+    for (int i = 0; i < queue_depth; i++) {
+      blocks_.push_back(
+          {static_cast<char*>(allocator_.allocate(block_size)), 0, 0, false});
+    }
+  }
+  AsyncFileReader(const AsyncFileReader&) = delete;
+  AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+  /**
+   * Open a file and start reading ahead from its beginning.
+   */
+  void open(const std::string& file_name) {
+    close();
+    direct_ = true;
+    fd_ = ::open(file_name.c_str(), O_RDONLY | O_DIRECT);
+    if (fd_ < 0 && errno == EINVAL) {
+      // the file system doesn't support O_DIRECT, e.g. tmpfs
+      direct_ = false;
+      fd_ = ::open(file_name.c_str(), O_RDONLY);
+    }
+    if (fd_ < 0) {
+      CK_THROW_(Error_t::FileCannotOpen, "open() failed: " + file_name);
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      close();
+      CK_THROW_(Error_t::FileCannotOpen, "fstat() failed: " + file_name);
+    }
+    file_size_ = st.st_size;
+    file_name_ = file_name;
+    if (!direct_) {
+      posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    start_(0);
+  }
+
+  /**
+   * Wait for the reads in flight and close the file. It's safe to call it on a closed object.
+   */
+  void close() {
+    if (fd_ >= 0) {
+      try {
+        drain_();
+      } catch (const std::runtime_error& rt_err) {
+        std::cerr << rt_err.what() << std::endl;
+      }
+      ::close(fd_);
+      fd_ = -1;
+    }
+    file_size_ = 0;
+    file_name_.clear();
+  }
+
+  /**
+   * Get the next length bytes of the file.
+   * @param scratch a buffer of length bytes, used if the bytes span two blocks.
+   * @return a pointer to the bytes, valid until the next call.
+   */
+  const char* read(size_t length, void* scratch) {
+    const Block& head = blocks_[head_];
+    if (head_pos_ + static_cast<long long>(length) <= head.size) {
+      const char* ptr = head.buffer + head_pos_;
+      head_pos_ += length;
+      return ptr;
+    }
+    char* dst = static_cast<char*>(scratch);
+    while (length > 0) {
+      const Block& block = blocks_[head_];
+      size_t available = static_cast<size_t>(std::max(block.size - head_pos_, 0LL));
+      if (available == 0) {
+        if (!advance_()) {
+          CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name_);
+        }
+        continue;
+      }
+      size_t n = std::min(available, length);
+      memcpy(dst, block.buffer + head_pos_, n);
+      dst += n;
+      head_pos_ += n;
+      length -= n;
+    }
+    return static_cast<const char*>(scratch);
+  }
+
+  /**
+   * Move to an offset of the file. The read-ahead is restarted unless it's in the current
+   * block.
+   */
+  void seek(long long offset) {
+    if (offset < 0 || offset > file_size_) {
+      CK_THROW_(Error_t::WrongInput, "seek out of file: " + file_name_);
+    }
+    const Block& head = blocks_[head_];
+    if (offset >= head.offset && offset <= head.offset + head.size) {
+      head_pos_ = offset - head.offset;
+      return;
+    }
+    start_(offset);
+  }
+
+  /**
+   * Skip the next length bytes.
+   */
+  void skip(size_t length) {
+    long long offset = tell() + static_cast<long long>(length);
+    if (offset > file_size_) {
+      CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name_);
+    }
+    seek(offset);
+  }
+
+  long long tell() const { return blocks_[head_].offset + head_pos_; }
+  bool is_open() const { return fd_ >= 0; }
+  /**
+   * Whether the file is read with O_DIRECT.
+   */
+  bool is_direct() const { return direct_; }
+  long long get_file_size() const { return file_size_; }
+  const char* get_backend_name() const { return backend_->get_name(); }
+
+  /**
+   * Dtor
+   */
+  ~AsyncFileReader() {
+    close();
+    for (auto& block : blocks_) {
+      allocator_.deallocate(block.buffer, block_size_);
+    }
+  }
+};
+
+}  // namespace HugeCTR
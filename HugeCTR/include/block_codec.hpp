@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "HugeCTR/include/common.hpp"
+
+#ifdef ENABLE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace HugeCTR {
+
+/**
+ * Codecs of the blocks of a compressed data file, the values are kept in the files.
+ * The libraries are optional (ENABLE_LZ4, ENABLE_ZSTD), see is_codec_available().
+ */
+const int DATA_SET_CODEC_NONE = 0;
+const int DATA_SET_CODEC_LZ4 = 1;  /**< level 1: LZ4 fast, 2-12: LZ4 HC */
+const int DATA_SET_CODEC_ZSTD = 2; /**< level 1-22 */
+
+inline const char* get_codec_name(int codec) {
+  switch (codec) {
+    case DATA_SET_CODEC_NONE:
+      return "none";
+    case DATA_SET_CODEC_LZ4:
+      return "lz4";
+    case DATA_SET_CODEC_ZSTD:
+      return "zstd";
+  }
+  return "unknown";
+}
+
+/**
+ * Get a codec by its name, "none", "lz4" or "zstd".
+ * @return the codec, or -1 if the name is unknown.
+ */
+inline int find_codec(const std::string& name) {
+  for (int codec : {DATA_SET_CODEC_NONE, DATA_SET_CODEC_LZ4, DATA_SET_CODEC_ZSTD}) {
+    if (name == get_codec_name(codec)) {
+      return codec;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Whether HugeCTR is built with the library of a codec.
+ */
+inline bool is_codec_available(int codec) {
+  switch (codec) {
+    case DATA_SET_CODEC_NONE:
+      return true;
+#ifdef ENABLE_LZ4
+    case DATA_SET_CODEC_LZ4:
+      return true;
+#endif
+#ifdef ENABLE_ZSTD
+    case DATA_SET_CODEC_ZSTD:
+      return true;
+#endif
+  }
+  return false;
+}
+
+/**
+ * Compress a block.
+ * @param codec DATA_SET_CODEC_LZ4 or DATA_SET_CODEC_ZSTD.
+ * @param level compression level of the codec.
+ * @param src the bytes to compress.
+ * @param size the number of bytes, less than 2GB.
+ * @param dst the compressed bytes are written to it, resized to their size.
+ */
+inline void compress_block(int codec, int level, const char* src, size_t size,
+                           std::vector<char>* dst) {
+  if (size > INT_MAX) {
+    CK_THROW_(Error_t::WrongInput, "block size > INT_MAX");
+  }
+  switch (codec) {
+#ifdef ENABLE_LZ4
+    case DATA_SET_CODEC_LZ4: {
+      dst->resize(LZ4_compressBound(static_cast<int>(size)));
+      int compressed_size =
+          level <= 1 ? LZ4_compress_default(src, dst->data(), static_cast<int>(size),
+                                            static_cast<int>(dst->size()))
+                     : LZ4_compress_HC(src, dst->data(), static_cast<int>(size),
+                                       static_cast<int>(dst->size()), level);
+      if (compressed_size <= 0) {
+        CK_THROW_(Error_t::UnspecificError, "LZ4 compression failed");
+      }
+      dst->resize(compressed_size);
+      return;
+    }
+#endif
+#ifdef ENABLE_ZSTD
+    case DATA_SET_CODEC_ZSTD: {
+      dst->resize(ZSTD_compressBound(size));
+      size_t compressed_size = ZSTD_compress(dst->data(), dst->size(), src, size, level);
+      if (ZSTD_isError(compressed_size)) {
+        CK_THROW_(Error_t::UnspecificError,
+                  std::string("ZSTD compression failed: ") + ZSTD_getErrorName(compressed_size));
+      }
+      dst->resize(compressed_size);
+      return;
+    }
+#endif
+  }
+  CK_THROW_(Error_t::WrongInput,
+            std::string("codec is not available: ") + get_codec_name(codec));
+}
+
+/**
+ * Decompress a block.
+ * @param codec the codec the block is compressed with.
+ * @param src the compressed bytes.
+ * @param size the number of compressed bytes.
+ * @param dst a buffer of dst_size bytes.
+ * @param dst_size the size of the block before compression.
+ */
+inline void decompress_block(int codec, const char* src, size_t size, char* dst,
+                             size_t dst_size) {
+  switch (codec) {
+#ifdef ENABLE_LZ4
+    case DATA_SET_CODEC_LZ4: {
+      int decompressed_size = LZ4_decompress_safe(src, dst, static_cast<int>(size),
+                                                  static_cast<int>(dst_size));
+      if (decompressed_size < 0 || static_cast<size_t>(decompressed_size) != dst_size) {
+        CK_THROW_(Error_t::WrongInput, "broken LZ4 block");
+      }
+      return;
+    }
+#endif
+#ifdef ENABLE_ZSTD
+    case DATA_SET_CODEC_ZSTD: {
+      size_t decompressed_size = ZSTD_decompress(dst, dst_size, src, size);
+      if (ZSTD_isError(decompressed_size) || decompressed_size != dst_size) {
+        CK_THROW_(Error_t::WrongInput, "broken ZSTD block");
+      }
+      return;
+    }
+#endif
+  }
+  CK_THROW_(Error_t::WrongInput,
+            std::string("codec is not available: ") + get_codec_name(codec));
+}
+
+}  // namespace HugeCTR
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "HugeCTR/include/common.hpp"
+
+namespace HugeCTR {
+
+/**
+ * @brief A bounded lock-free FIFO of chunk ids.
+ *
+ * Multi-producer / multi-consumer array queue: each cell carries a sequence
+ * number telling whether it's ready to be written or read in the current lap,
+ * so push and pop only need one CAS on the shared position.
+ */
+class ChunkIdQueue {
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    unsigned int id;
+  };
+  static const size_t CACHE_LINE_SIZE = 64;
+
+  std::unique_ptr<Cell[]> cells_; /**< ring buffer, its size is a power of 2 */
+  size_t mask_;                   /**< size of cells_ - 1 */
+  // keep the two positions on different cache lines, they are written by different threads
+  char pad0_[CACHE_LINE_SIZE];
+  std::atomic<size_t> enqueue_pos_{0};
+  char pad1_[CACHE_LINE_SIZE];
+  std::atomic<size_t> dequeue_pos_{0};
+  char pad2_[CACHE_LINE_SIZE];
+
+ public:
+  /**
+   * Ctor.
+   * @param capacity max number of ids in the queue.
+   */
+  explicit ChunkIdQueue(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    cells_.reset(new Cell[size]);
+    mask_ = size - 1;
+    for (size_t i = 0; i < size; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  ChunkIdQueue(const ChunkIdQueue&) = delete;
+  ChunkIdQueue& operator=(const ChunkIdQueue&) = delete;
+
+  /**
+   * @return false if the queue is full.
+   */
+  bool push(unsigned int id) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->id = id;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @return false if the queue is empty.
+   */
+  bool pop(unsigned int* id) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *id = cell->id;
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Approximate number of ids in the queue.
+   */
+  size_t size() const {
+    size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+};
+
+/**
+ * @brief Blocking wait for a ChunkIdQueue.
+ *
+ * The fast path (queue not empty) never touches the mutex: a popper only
+ * registers itself as a waiter and sleeps on the condition variable after
+ * spinning a while on an empty queue, and a pusher only takes the mutex
+ * when someone is registered.
+ */
+class ChunkIdQueueWaiter {
+ private:
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::atomic<int> num_waiters_{0};
+  static const int SPIN_COUNT = 128;
+
+ public:
+  /**
+   * Pop an id from queue, block while it's empty.
+   * @param loop_flag the waiting is broken and false is returned when it's cleared.
+   */
+  bool pop(ChunkIdQueue& queue, unsigned int* id, const std::atomic<bool>& loop_flag) {
+    for (int i = 0; i < SPIN_COUNT; i++) {
+      if (queue.pop(id)) {
+        return true;
+      }
+    }
+    std::unique_lock<std::mutex> lock(mtx_);
+    num_waiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ret = false;
+    while (loop_flag.load()) {
+      if (queue.pop(id)) {
+        ret = true;
+        break;
+      }
+      cv_.wait(lock);
+    }
+    num_waiters_.fetch_sub(1);
+    return ret;
+  }
+
+  /**
+   * Wake up one of the waiters (if any) after a push.
+   * One push makes one id available, so waking more than one thread would
+   * only make them contend for it.
+   */
+  void notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (num_waiters_.load() > 0) {
+      std::lock_guard<std::mutex> lock(mtx_);
+      cv_.notify_one();
+    }
+  }
+
+  /**
+   * Wake up all the waiters unconditionally, e.g. to break the waiting.
+   */
+  void notify_all() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    cv_.notify_all();
+  }
+};
+
+/**
+ * @brief A lock-free chunk ring for multiple writers and a single reader.
+ *
+ * ChunkRing has the same checkout / checkin API as Heap, so DataReaderMultiThreads
+ * (writers) and DataCollector (reader) can use either of them. Compared with Heap:
+ * 1. No mutex is taken on checkout / checkin, the ids of free and ready chunks are
+ *    kept in two lock-free queues.
+ * 2. Threads block on a condition variable instead of polling with usleep when there's
+ *    no chunk available.
+ * 3. Any number of chunks.
+ * 4. Ready chunks are checked out in the order they are checked in (FIFO).
+ * Keys returned by the checkout methods are chunk ids instead of bit masks.
+ */
+template <typename T>
+class ChunkRing {
+ private:
+  std::vector<T> chunks_;
+  ChunkIdQueue free_ids_;   /**< ids of the chunks that can be written */
+  ChunkIdQueue ready_ids_;  /**< ids of the chunks that are written and can be read */
+  ChunkIdQueueWaiter free_waiter_;
+  ChunkIdQueueWaiter ready_waiter_;
+  std::atomic<bool> loop_flag_{true};
+
+ public:
+  /**
+   * The key returned when the checkout is broken by break_and_return().
+   * It's ignored by checkin.
+   */
+  static const unsigned int INVALID_KEY = ~0u;
+
+  /**
+   * Get a chunk without modification to the flags.
+   * @param id the id of target chunck.
+   * @param chunk the pointer of the chunk under id will be passed out.
+   */
+  void get_chunk(const T** chunk, int id) const { *chunk = &chunks_[id]; }
+
+  /**
+   * Writer's free chunk checkout.
+   * Get a freed or idle chunk from ring. Users can write data into it then.
+   * Block while no avaliable chunk.
+   * @param chunk the pointer of the chunk passed out.
+   * @param key the id of the chunk, which will be used when checkin.
+   */
+  void free_chunk_checkout(T** chunk, unsigned int* key) {
+    if (key == nullptr) {
+      CK_THROW_(Error_t::WrongInput, "key == nullptr");
+    }
+    unsigned int id = INVALID_KEY;
+    if (free_waiter_.pop(free_ids_, &id, loop_flag_)) {
+      *chunk = &chunks_[id];
+    }
+    *key = id;
+    return;
+  }
+
+  /**
+   * Writer's chunk checkin.
+   * After user write data into this chunk. User (writer) should call this function to
+   * Checkin the chunk so that the reader can get the prepared chunk and read.
+   * @param key the id of the chunk, returned by free_chunk_checkout().
+   */
+  void chunk_write_and_checkin(unsigned int key) {
+    if (key == INVALID_KEY) {
+      return;
+    }
+    if (!ready_ids_.push(key)) {
+      CK_THROW_(Error_t::OutOfBound, "ready_ids_ is full");
+    }
+    ready_waiter_.notify();
+    return;
+  }
+
+  /**
+   * Readers's chunk checkout.
+   * Readers checkout a ready chunk, which is checkin by writer.
+   * Block while no ready chunk availiable.
+   * @param chunk chunk of data ready to read.
+   * @param key the id of the chunk, which will be used when checkin.
+   */
+  void data_chunk_checkout(T** chunk, unsigned int* key) {
+    if (key == nullptr) {
+      CK_THROW_(Error_t::WrongInput, "key == nullptr");
+    }
+    unsigned int id = INVALID_KEY;
+    if (ready_waiter_.pop(ready_ids_, &id, loop_flag_)) {
+      *chunk = &chunks_[id];
+    }
+    *key = id;
+    return;
+  }
+
+  /**
+   * Reader's free chunk and checkin.
+   * After consuming the data and ensure no use in the future, reader can
+   * call this methord to free the chunk and checkin to tell the writer that
+   * the chunk can be used by writer again.
+   * @param key the id of the chunk.
+   */
+  void chunk_free_and_checkin(unsigned int key) {
+    if (key == INVALID_KEY) {
+      return;
+    }
+    if (!free_ids_.push(key)) {
+      CK_THROW_(Error_t::OutOfBound, "free_ids_ is full");
+    }
+    free_waiter_.notify();
+    return;
+  }
+
+  /**
+   * break the waiting.
+   */
+  void break_and_return() {
+    loop_flag_ = false;
+    free_waiter_.notify_all();
+    ready_waiter_.notify_all();
+    return;
+  }
+
+  /**
+   * Number of the chunks.
+   */
+  int get_num_chunks() const { return static_cast<int>(chunks_.size()); }
+
+  /**
+   * Approximate number of the chunks written and not checked out by the reader yet.
+   */
+  int get_num_ready_chunks() const { return static_cast<int>(ready_ids_.size()); }
+
+  /**
+   * Ctor.
+   * Make "num" copy of the chunks.
+   */
+  ChunkRing(int num, const T& chunk)
+      : chunks_(num > 0 ? num : 0, chunk),
+        free_ids_(num > 0 ? num : 1),
+        ready_ids_(num > 0 ? num : 1) {
+    try {
+      if (num <= 0) {
+        CK_THROW_(Error_t::WrongInput, "num <= 0");
+      }
+      for (int i = 0; i < num; i++) {
+        free_ids_.push(i);
+      }
+    } catch (const std::runtime_error& rt_err) {
+      std::cerr << rt_err.what() << std::endl;
+      throw;
+    }
+  }
+};
+
+template <typename T>
+const unsigned int ChunkRing<T>::INVALID_KEY;
+
+}  // namespace HugeCTR
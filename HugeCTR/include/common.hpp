@@ -47,6 +47,7 @@ enum class Error_t {
   CudnnError,
   CudaError,
   NcclError,
+  EndOfFile,
   UnspecificError
 };
 
@@ -89,6 +90,7 @@ enum class Layer_t {
   BinaryCrossEntropyLoss,
   Concat,
   CrossEntropyLoss,
+  DenseConcat,
   ELU,
   InnerProduct,
   MultiCrossEntropyLoss,
@@ -97,11 +99,36 @@ enum class Layer_t {
 
 enum class Embedding_t { SparseEmbedding, SparseEmbeddingHash };
 
+enum class ReaderMode_t {
+  Stream,  // std::ifstream reads per field
+  Mmap,    // decode in place from a memory mapped file
+  Direct   // O_DIRECT blocks read ahead asynchronously (io_uring or a pread thread)
+};
+
+enum class KeyType_t {
+  LongLong,    // long long keys
+  UnsignedInt  // unsigned int keys, e.g. compacted from long long ones by tools/key_compactor
+};
+
+enum class KeyPartitioner_t {
+  Modulo,     // key % number of devices
+  Hash,       // multiplicative hash of the key
+  SlotAware,  // the keys of each slot striped over the devices, for slot = key % slot_num
+  Frequency   // frequent keys balanced by a table from a profiling pass, the others hashed
+};
+
+enum class HostAllocator_t {
+  Pinned,    // page-locked with cudaHostRegister, for asynchronous copies to GPU
+  Aligned,   // page aligned memory, no CUDA call
+  HugePage,  // backed by 2MB pages, no CUDA call
+  Numa       // backed by 2MB pages on a NUMA node, no CUDA call
+};
+
 typedef struct DataSetHeader_ {
   long long number_of_records;  // the number of samples in this data file
   long long label_dim;          // dimension of label
   long long slot_num;
-  long long reserved;  // reserved for future use
+  long long reserved;  // version and flags, see data_set_format.hpp
 } DataSetHeader;
 
 #ifdef ENABLE_MPI
@@ -16,9 +16,12 @@
 
 #pragma once
 #include <cuda_runtime_api.h>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include "HugeCTR/include/common.hpp"
+#include "HugeCTR/include/host_allocator.hpp"
 
 namespace HugeCTR {
 
@@ -40,6 +43,7 @@ namespace HugeCTR {
 template <typename T>
 class CSR {
  private:
+  std::shared_ptr<HostAllocator> allocator_; /**< allocator of row_offset_value_buffer_ */
   T* row_offset_value_buffer_; /**< a unified buffer for row offset and value. */
   T* row_offset_; /**< just offset on the buffer, note that the length of it is slot*batchsize+1. */
   T* value_;      /**< pointer of value buffer. */
@@ -47,24 +51,30 @@ class CSR {
   int size_of_value_{0};      /**< num of values in this CSR buffer */
   int size_of_row_offset_{0}; /**< num of rows in this CSR buffer */
   int max_value_size_{0};  // number of element of value the CSR matrix will have for num_rows rows.
+
+  size_t buffer_size_in_bytes_() const { return (num_rows_ + 1 + max_value_size_) * sizeof(T); }
+
  public:
   /**
    * Ctor
    * @param num_rows num of rows is expected
    * @param max_value_size max size of value buffer.
+   * @param allocator allocator of the buffer. The default one (pinned) makes sure the
+   *        buffer can be copied to GPU without synchronization.
    */
-  CSR(int num_rows, int max_value_size)
-      : row_offset_value_buffer_(new T[num_rows + 1 + max_value_size]),
-        row_offset_(row_offset_value_buffer_),
-        value_(row_offset_value_buffer_ + num_rows + 1),
+  CSR(int num_rows, int max_value_size,
+      const std::shared_ptr<HostAllocator>& allocator = default_host_allocator())
+      : allocator_(allocator),
         num_rows_(num_rows),
         max_value_size_(max_value_size) {
     static_assert(std::is_same<T, long long>::value || std::is_same<T, unsigned int>::value,
                   "type not support");
-    CK_CUDA_THROW_(
-        cudaHostRegister(row_offset_value_buffer_, (num_rows + 1 + max_value_size) * sizeof(T),
-                         cudaHostRegisterDefault));  // make sure these memory can be copy to GPU
-                                                     // without synchronization
+    if (allocator_ == nullptr) {
+      CK_THROW_(Error_t::WrongInput, "allocator == nullptr");
+    }
+    row_offset_value_buffer_ = static_cast<T*>(allocator_->allocate(buffer_size_in_bytes_()));
+    row_offset_ = row_offset_value_buffer_;
+    value_ = row_offset_value_buffer_ + num_rows + 1;
   }
   CSR(const CSR& C) = delete;
   CSR& operator=(const CSR& C) = delete;
@@ -74,8 +84,7 @@ class CSR {
    */
   ~CSR() {
     try {
-      CK_CUDA_THROW_(cudaHostUnregister(row_offset_value_buffer_));
-      delete[] row_offset_value_buffer_;
+      allocator_->deallocate(row_offset_value_buffer_, buffer_size_in_bytes_());
     } catch (const std::runtime_error& rt_err) {
       std::cerr << rt_err.what() << std::endl;
     }
@@ -91,6 +100,18 @@ class CSR {
     size_of_value_++;
   }
 
+  /**
+   * push back n values to this object with a single copy.
+   * @param values source of the values, which doesn't have to be aligned to T
+   *        (e.g. a pointer into a memory mapped data file).
+   * @param n number of values.
+   */
+  void push_back_n(const void* values, int n) {
+    if (size_of_value_ + n > max_value_size_) CK_THROW_(Error_t::OutOfBound, "CSR out of bound");
+    memcpy(value_ + size_of_value_, values, n * sizeof(T));
+    size_of_value_ += n;
+  }
+
   /**
    * Insert a new row to CSR
    * Whenever you want to add a new row, you need to call this.
@@ -117,6 +138,7 @@ class CSR {
   int get_sizeof_value() const { return size_of_value_; }
   int get_num_rows() const { return num_rows_; }
   int get_max_value_size() const { return max_value_size_; }
+  const std::shared_ptr<HostAllocator>& get_allocator() const { return allocator_; }
   T* get_buffer() { return row_offset_value_buffer_; }
 };
 
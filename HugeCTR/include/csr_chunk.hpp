@@ -19,6 +19,8 @@
 
 #include <vector>
 #include "HugeCTR/include/csr.hpp"
+#include "HugeCTR/include/key_dedup.hpp"
+#include "HugeCTR/include/reader_position.hpp"
 
 namespace HugeCTR {
 
@@ -28,6 +30,12 @@ namespace HugeCTR {
  * For each iteration DataReader will get one chunk of CSR objects from Heap
  * Such a chunk contains the training input data (sample + label) required by
  * this iteration
+ * The dense features of the samples (if any) are kept in a row-major buffer of
+ * batchsize_per_buffer x dense_dim floats per CSR object, like the labels.
+ * The batch size doesn't have to be a multiple of num_csr_buffers: each label buffer has
+ * batchsize_per_buffer = ceil(batchsize / num_csr_buffers) rows and each CSR object
+ * batchsize_per_buffer * num_csr_buffers samples, the rows after the batch size are always
+ * empty like the rows after the valid samples of a short batch.
  */
 template <typename CSR_Type>
 class CSRChunk {
@@ -35,43 +43,92 @@ class CSRChunk {
   std::vector<CSR<CSR_Type>*>
       csr_buffers_; /**< A vector of CSR objects, should be same number as devices. */
   std::vector<float*> label_buffers_; /**< A vector of label buffers */
+  std::vector<float*> dense_buffers_; /**< A vector of dense feature buffers */
   int label_dim_;                     /**< dimension of label (for one sample) */
+  int dense_dim_;                     /**< the number of dense features of a sample */
   int slot_num_;                      /**< slot num */
   int batchsize_;                     /**< batch size of training */
+  int batchsize_per_buffer_;          /**< rows of a label buffer, batchsize_ rounded up */
+  int num_samples_;                   /**< the number of valid samples, <= batchsize_ */
+  std::shared_ptr<HostAllocator> allocator_; /**< allocator of the CSR and label buffers */
+  bool unique_keys_enabled_;          /**< whether the keys of each CSR are deduplicated */
+  std::vector<std::vector<CSR_Type>> unique_keys_; /**< distinct keys of each CSR object */
+  std::vector<std::vector<int>> inverse_index_;    /**< index in unique_keys_ of each value */
+  std::vector<FileProgress> progress_; /**< progress in the data files after reading this chunk */
+
+  void alloc_buffers_(int num_csr_buffers, int max_value_size) {
+    assert(csr_buffers_.empty() && label_buffers_.empty() && dense_buffers_.empty());
+    if (allocator_ == nullptr) {
+      CK_THROW_(Error_t::WrongInput, "allocator == nullptr");
+    }
+    if (unique_keys_enabled_) {
+      unique_keys_.resize(num_csr_buffers);
+      inverse_index_.resize(num_csr_buffers);
+    }
+    for (int i = 0; i < num_csr_buffers; i++) {
+      if (unique_keys_enabled_) {
+        unique_keys_[i].reserve(max_value_size);
+        inverse_index_[i].reserve(max_value_size);
+      }
+      csr_buffers_.push_back(
+          new CSR<CSR_Type>(batchsize_per_buffer_ * num_csr_buffers * slot_num_, max_value_size,
+                            allocator_));
+      const size_t label_buffer_size = label_buffer_size_in_bytes_();
+      float* tmp_label_buffer = static_cast<float*>(allocator_->allocate(label_buffer_size));
+      memset(tmp_label_buffer, 0, label_buffer_size);
+      label_buffers_.push_back(tmp_label_buffer);
+      if (dense_dim_ > 0) {
+        const size_t dense_buffer_size = dense_buffer_size_in_bytes_();
+        float* tmp_dense_buffer = static_cast<float*>(allocator_->allocate(dense_buffer_size));
+        memset(tmp_dense_buffer, 0, dense_buffer_size);
+        dense_buffers_.push_back(tmp_dense_buffer);
+      }
+    }
+  }
+
+  size_t label_buffer_size_in_bytes_() const {
+    return batchsize_per_buffer_ * label_dim_ * sizeof(float);
+  }
+
+  size_t dense_buffer_size_in_bytes_() const {
+    return batchsize_per_buffer_ * dense_dim_ * sizeof(float);
+  }
+
  public:
   /**
    * Ctor of CSRChunk.
    * Create and initialize the CSRChunk
    * @param num_csr_buffers the number of CSR object it will have.
    *        the number usually equal to num devices will be used.
-   * @param batchsize batch size.
+   * @param batchsize batch size, the max number of samples in the chunk.
    * @param label_dim dimension of label (for one sample).
    * @param slot_num slot num.
    * @param max_value_size the number of element of values the CSR matrix will have
    *        for num_rows rows (See csr.hpp).
+   * @param allocator allocator of the buffers, the default one (pinned) makes sure they
+   *        can be copied to GPU without synchronization.
+   * @param unique_keys keep the unique keys and inverse index of each CSR object, which
+   *        are computed by compute_unique_keys().
+   * @param dense_dim the number of dense features of a sample, 0 if there's none.
    */
-  CSRChunk(int num_csr_buffers, int batchsize, int label_dim, int slot_num, int max_value_size) {
-    if (num_csr_buffers <= 0 || batchsize % num_csr_buffers != 0 || label_dim <= 0 ||
-        slot_num <= 0 || max_value_size <= batchsize) {
+  CSRChunk(int num_csr_buffers, int batchsize, int label_dim, int slot_num, int max_value_size,
+           const std::shared_ptr<HostAllocator>& allocator = default_host_allocator(),
+           bool unique_keys = false, int dense_dim = 0)
+      : allocator_(allocator) {
+    if (num_csr_buffers <= 0 || batchsize <= 0 || label_dim <= 0 || slot_num <= 0 ||
+        max_value_size <= batchsize || dense_dim < 0) {
       CK_THROW_(Error_t::WrongInput,
-                "num_src_buffers <= 0 || batchsize%num_csr_buffers != 0 || label_dim <= 0 ||  "
-                "slot_num <=0 || max_value_size <= batchsize");
+                "num_src_buffers <= 0 || batchsize <= 0 || label_dim <= 0 ||  "
+                "slot_num <=0 || max_value_size <= batchsize || dense_dim < 0");
     }
-    if (batchsize % num_csr_buffers != 0)
-      CK_THROW_(Error_t::WrongInput, "batchsize%num_csr_buffers");
     label_dim_ = label_dim;
+    dense_dim_ = dense_dim;
     batchsize_ = batchsize;
+    batchsize_per_buffer_ = (batchsize + num_csr_buffers - 1) / num_csr_buffers;
+    num_samples_ = batchsize;
     slot_num_ = slot_num;
-    assert(csr_buffers_.empty() && label_buffers_.empty());
-    for (int i = 0; i < num_csr_buffers; i++) {
-      csr_buffers_.push_back(new CSR<CSR_Type>(batchsize * slot_num, max_value_size));
-      float* tmp_label_buffer = new float[batchsize / num_csr_buffers * label_dim]();
-      CK_CUDA_THROW_(cudaHostRegister(
-          tmp_label_buffer, batchsize / num_csr_buffers * label_dim * sizeof(float),
-          cudaHostRegisterDefault));  // make sure these memory can be copy to GPU without
-                                      // synchronization
-      label_buffers_.push_back(tmp_label_buffer);
-    }
+    unique_keys_enabled_ = unique_keys;
+    alloc_buffers_(num_csr_buffers, max_value_size);
   }
 
   /**
@@ -84,9 +141,72 @@ class CSRChunk {
    * This methord is used in collector (consumer) and data_reader (provider).
    */
   const std::vector<float*>& get_label_buffers() { return label_buffers_; }
+  /**
+   * Get dense features, empty if dense_dim is 0.
+   * This methord is used in collector (consumer) and data_reader (provider).
+   */
+  const std::vector<float*>& get_dense_buffers() { return dense_buffers_; }
   int get_label_dim() const { return label_dim_; }
+  int get_dense_dim() const { return dense_dim_; }
   int get_batchsize() const { return batchsize_; }
+  /**
+   * The rows of a label (and dense) buffer, the samples of a device.
+   */
+  int get_batchsize_per_buffer() const { return batchsize_per_buffer_; }
   int get_slot_num() const { return slot_num_; }
+  const std::shared_ptr<HostAllocator>& get_allocator() const { return allocator_; }
+
+  /**
+   * Whether the unique keys are kept, see compute_unique_keys().
+   */
+  bool has_unique_keys() const { return unique_keys_enabled_; }
+
+  /**
+   * Deduplicate the values of each CSR object.
+   * It's called by data_reader (provider) after the CSR objects are filled.
+   * Nothing is done if the unique keys are not enabled.
+   * @param dedup the deduplication table of the calling thread.
+   */
+  void compute_unique_keys(KeyDedup<CSR_Type>* dedup) {
+    if (!unique_keys_enabled_) {
+      return;
+    }
+    for (size_t i = 0; i < csr_buffers_.size(); i++) {
+      dedup->dedup(csr_buffers_[i]->get_value(), csr_buffers_[i]->get_sizeof_value(),
+                   &unique_keys_[i], &inverse_index_[i]);
+    }
+  }
+
+  /**
+   * The distinct values of the i-th CSR object in the order of first appearance.
+   */
+  const std::vector<CSR_Type>& get_unique_keys(int i) const { return unique_keys_[i]; }
+
+  /**
+   * The index in get_unique_keys(i) of each value of the i-th CSR object:
+   * get_csr_buffers()[i]->get_value()[j] == get_unique_keys(i)[get_inverse_index(i)[j]].
+   */
+  const std::vector<int>& get_inverse_index(int i) const { return inverse_index_[i]; }
+
+  /**
+   * The number of valid samples in this chunk.
+   * It's less than the batch size for the last batch of an epoch, whose rows after
+   * the valid samples are empty (and labels are 0). A chunk of 0 sample is the mark of
+   * a reading thread reaching the end of an epoch. Sample i is in the label buffer
+   * i / get_batchsize_per_buffer(), so the valid samples of each device are given by
+   * get_device_num_samples().
+   */
+  int get_num_samples() const { return num_samples_; }
+  void set_num_samples(int num_samples) { num_samples_ = num_samples; }
+
+  /**
+   * The progress of the reading thread in the files it read this chunk from,
+   * which is applied to the reader position once the chunk is consumed.
+   */
+  const std::vector<FileProgress>& get_progress() const { return progress_; }
+  void set_progress(const std::vector<FileProgress>& progress) {
+    progress_.assign(progress.begin(), progress.end());
+  }
 
   /**
    * A copy Ctor but allocating new resources.
@@ -99,30 +219,24 @@ class CSRChunk {
     const int num_csr_buffers = csr_buffers.size();
     const int batchsize = C.get_batchsize();
     const int label_dim = C.get_label_dim();
+    const int dense_dim = C.get_dense_dim();
     const int slot_num = C.get_slot_num();
     const int max_value_size = csr_buffers[0]->get_max_value_size();
-    if (num_csr_buffers <= 0 || batchsize % num_csr_buffers != 0 || label_dim <= 0 ||
+    if (num_csr_buffers <= 0 || batchsize <= 0 || label_dim <= 0 ||
         max_value_size <= batchsize) {
       CK_THROW_(Error_t::WrongInput,
-                "num_src_buffers <= 0 || batchsize%num_csr_buffers != 0 || label_dim <= 0 || "
+                "num_src_buffers <= 0 || batchsize <= 0 || label_dim <= 0 || "
                 "max_value_size <= batchsize");
     }
-    if (batchsize % num_csr_buffers != 0)
-      CK_THROW_(Error_t::WrongInput, "batchsize%num_csr_buffers");
     label_dim_ = label_dim;
+    dense_dim_ = dense_dim;
     batchsize_ = batchsize;
+    batchsize_per_buffer_ = (batchsize + num_csr_buffers - 1) / num_csr_buffers;
+    num_samples_ = batchsize;
     slot_num_ = slot_num;
-    assert(csr_buffers_.empty());
-    assert(label_buffers_.empty());
-    for (int i = 0; i < num_csr_buffers; i++) {
-      csr_buffers_.push_back(new CSR<CSR_Type>(batchsize * slot_num, max_value_size));
-      float* tmp_label_buffer = new float[batchsize / num_csr_buffers * label_dim]();
-      CK_CUDA_THROW_(cudaHostRegister(
-          tmp_label_buffer, batchsize / num_csr_buffers * label_dim * sizeof(float),
-          cudaHostRegisterDefault));  // make sure these memory can be copy to GPU without
-                                      // synchronization
-      label_buffers_.push_back(tmp_label_buffer);
-    }
+    allocator_ = C.get_allocator();
+    unique_keys_enabled_ = C.has_unique_keys();
+    alloc_buffers_(num_csr_buffers, max_value_size);
   }
 
   /**
@@ -134,8 +248,10 @@ class CSRChunk {
         delete buffer;
       }
       for (auto label_buffer : label_buffers_) {
-        CK_CUDA_THROW_(cudaHostUnregister(label_buffer));
-        delete label_buffer;
+        allocator_->deallocate(label_buffer, label_buffer_size_in_bytes_());
+      }
+      for (auto dense_buffer : dense_buffers_) {
+        allocator_->deallocate(dense_buffer, dense_buffer_size_in_bytes_());
       }
     } catch (const std::runtime_error& rt_err) {
       std::cerr << rt_err.what() << std::endl;
@@ -21,7 +21,9 @@
 #include "HugeCTR/include/csr_chunk.hpp"
 #include "HugeCTR/include/general_buffer.hpp"
 #include "HugeCTR/include/gpu_resource.hpp"
-#include "HugeCTR/include/heap.hpp"
+#include "HugeCTR/include/chunk_ring.hpp"
+#include "HugeCTR/include/reader_position.hpp"
+#include "HugeCTR/include/reader_stats.hpp"
 
 #ifdef ENABLE_MPI
 #include <mpi.h>
@@ -55,6 +57,11 @@ struct ToMpiType<float> {
  * This class implement asynchronized data collecting from heap
  * to output of data reader, thus data collection and training
  * can work in a pipeline.
+ * Chunks of 0 sample are the end-of-epoch marks of the reading threads. They are not
+ * passed to the output, but once all the producers have marked the end, a batch of
+ * 0 sample is collected to tell the end of data.
+ * The progress in the data files carried by the chunks is applied to the reader position
+ * when the batch is read to device, i.e. consumed by training.
  */
 template <typename TypeKey>
 class DataCollector {
@@ -63,28 +70,44 @@ class DataCollector {
   enum JOB { TRAIN, EVAL_MASTER, EVAL_SLAVE };
   volatile STATUS stat_{READY_TO_WRITE};
   JOB job_{TRAIN};
-  Heap<CSRChunk<TypeKey>>* csr_heap_{nullptr};
+  ChunkRing<CSRChunk<TypeKey>>* csr_heap_{nullptr};
   std::vector<GeneralBuffer<float>*>& label_buffers_;
+  std::vector<GeneralBuffer<float>*>& dense_buffers_; /**< empty if there's no dense feature */
   std::vector<GeneralBuffer<TypeKey>*>& csr_buffers_;
   const GPUResourceGroup& device_resources_;
   std::vector<GeneralBuffer<float>*> label_buffers_internal_;
+  std::vector<GeneralBuffer<float>*> dense_buffers_internal_;
   std::vector<GeneralBuffer<TypeKey>*> csr_buffers_internal_;
   long long counter_{0};
   int pid_{0}, num_procs_{1};
+  const int num_producers_;     /**< the number of threads writing to csr_heap_ */
+  int finished_producers_{0};   /**< producers which have marked the end of current epoch */
+  int num_samples_{0};          /**< the number of samples in the collected batch */
+  std::vector<FileProgress> progress_; /**< progress in the data files of the collected batch */
+  ReaderPosition position_;            /**< position after the batches read to device */
+  std::atomic<long long> batches_copied_{0}; /**< batches copied to the devices by collect() */
+  LatencyHistogram ready_chunk_wait_; /**< collect() waiting for a chunk to be read */
+  LatencyHistogram collector_spin_;   /**< collect() waiting for the last batch to be taken */
+  LatencyHistogram copy_;             /**< H2D copies of a batch in collect() */
+  LatencyHistogram device_wait_;      /**< read_a_batch_to_device() waiting for collect() */
 
  public:
   /**
    * Ctor.
    * @param label_buffers label buffers (GPU) of data reader.
+   * @param dense_buffers dense feature buffers (GPU) of data reader, empty if there's none.
    * @param csr_buffers csr buffers (GPU) of data reader.
    * @param device_resources gpu resources.
-   * @param csr_heap heap of data reader.
+   * @param csr_heap chunk ring of data reader.
    * @param is_eval whether it's evaluation.
+   * @param num_producers the number of threads writing to csr_heap.
    */
   DataCollector(std::vector<GeneralBuffer<float>*>& label_buffers,
+                std::vector<GeneralBuffer<float>*>& dense_buffers,
                 std::vector<GeneralBuffer<TypeKey>*>& csr_buffers,
                 const GPUResourceGroup& device_resources,
-                Heap<CSRChunk<TypeKey>>* csr_heap = nullptr, bool is_eval = true);
+                ChunkRing<CSRChunk<TypeKey>>* csr_heap = nullptr, bool is_eval = true,
+                int num_producers = 1);
 
   /**
    * Collect data from heap to each GPU (node).
@@ -93,8 +116,30 @@ class DataCollector {
 
   /**
    * Read a batch to device.
+   * @return the number of samples in the batch, 0 if it's the end of data.
    */
-  void read_a_batch_to_device();
+  int read_a_batch_to_device();
+
+  /**
+   * The position in the file list after the batches read to device.
+   */
+  const ReaderPosition& get_position() const { return position_; }
+
+  /**
+   * Set the position to start from, before any batch is read to device.
+   */
+  void set_position(const ReaderPosition& position) { position_ = position; }
+
+  /**
+   * Add the counters and latencies of the collecting to stats.
+   */
+  void add_stats_to(DataReaderStats* stats) const {
+    stats->batches_copied += batches_copied_;
+    ready_chunk_wait_.add_to(&stats->ready_chunk_wait);
+    collector_spin_.add_to(&stats->collector_spin);
+    copy_.add_to(&stats->copy);
+    device_wait_.add_to(&stats->device_wait);
+  }
 
   /**
    * Break the collecting and stop. Only used in destruction.
@@ -114,13 +159,17 @@ class DataCollector {
 
 template <typename TypeKey>
 DataCollector<TypeKey>::DataCollector(std::vector<GeneralBuffer<float>*>& label_buffers,
+                                      std::vector<GeneralBuffer<float>*>& dense_buffers,
                                       std::vector<GeneralBuffer<TypeKey>*>& csr_buffers,
                                       const GPUResourceGroup& device_resources,
-                                      Heap<CSRChunk<TypeKey>>* csr_heap, bool is_eval)
+                                      ChunkRing<CSRChunk<TypeKey>>* csr_heap, bool is_eval,
+                                      int num_producers)
     : csr_heap_(csr_heap),
       label_buffers_(label_buffers),
+      dense_buffers_(dense_buffers),
       csr_buffers_(csr_buffers),
-      device_resources_(device_resources) {
+      device_resources_(device_resources),
+      num_producers_(num_producers) {
   try {
     if (is_eval && csr_heap_ != nullptr) {
       job_ = EVAL_MASTER;
@@ -140,6 +189,10 @@ DataCollector<TypeKey>::DataCollector(std::vector<GeneralBuffer<float>*>& label_
       label_buffers_internal_.push_back(
           new GeneralBuffer<float>(lb->get_num_elements(), lb->get_device_id()));
     }
+    for (auto db : dense_buffers_) {
+      dense_buffers_internal_.push_back(
+          new GeneralBuffer<float>(db->get_num_elements(), db->get_device_id()));
+    }
     for (auto cb : csr_buffers_) {
       csr_buffers_internal_.push_back(
           new GeneralBuffer<TypeKey>(cb->get_num_elements(), cb->get_device_id()));
@@ -163,11 +216,13 @@ template <typename TypeKey>
 void DataCollector<TypeKey>::collect() {
   const int LABEL_TAG_OFFSET = 100;
 
+  auto spin_start_time = LatencyHistogram::Clock::now();
   while (stat_ != READY_TO_WRITE) {
     if (stat_ == STOP) {
       return;
     }
   }
+  collector_spin_.record_since(spin_start_time);
 
   if ((job_ == TRAIN && pid_ == counter_ % num_procs_) || job_ == EVAL_MASTER) {
     // my turn
@@ -178,13 +233,39 @@ void DataCollector<TypeKey>::collect() {
 
 #ifdef ENABLE_MPI
     std::vector<MPI_Request> req;
-    req.reserve(2 * total_device_count);  // to prevent the reallocation
+    req.reserve(4 * total_device_count);  // to prevent the reallocation
 #endif
+    progress_.clear();
+    auto wait_start_time = LatencyHistogram::Clock::now();
     csr_heap_->data_chunk_checkout(&chunk_tmp, &key);
+    // skip the end marks until all the producers have reached the end
+    while (chunk_tmp != nullptr && chunk_tmp->get_num_samples() == 0 &&
+           ++finished_producers_ < num_producers_) {
+      progress_.insert(progress_.end(), chunk_tmp->get_progress().begin(),
+                       chunk_tmp->get_progress().end());
+      csr_heap_->chunk_free_and_checkin(key);
+      chunk_tmp = nullptr;
+      csr_heap_->data_chunk_checkout(&chunk_tmp, &key);
+    }
+    if (chunk_tmp == nullptr) {
+      // the waiting is broken, only happens in destruction
+      return;
+    }
+    ready_chunk_wait_.record_since(wait_start_time);
+    auto copy_start_time = LatencyHistogram::Clock::now();
+    num_samples_ = chunk_tmp->get_num_samples();
+    progress_.insert(progress_.end(), chunk_tmp->get_progress().begin(),
+                     chunk_tmp->get_progress().end());
+    if (num_samples_ == 0) {
+      finished_producers_ = 0;
+    }
     const std::vector<CSR<TypeKey>*>& csr_cpu_buffers = chunk_tmp->get_csr_buffers();
     const std::vector<float*>& label_buffers = chunk_tmp->get_label_buffers();
+    const std::vector<float*>& dense_cpu_buffers = chunk_tmp->get_dense_buffers();
+    const int dense_copy_num = dense_buffers_.empty() ? 0 : dense_buffers_[0]->get_num_elements();
     assert(csr_cpu_buffers.size() == total_device_count);
     assert(label_buffers.size() == total_device_count);
+    assert(dense_cpu_buffers.size() == (dense_copy_num > 0 ? total_device_count : 0));
 
     for (int i = 0; i < total_device_count; i++) {
       int pid = device_resources_.get_pid(i);
@@ -192,6 +273,9 @@ void DataCollector<TypeKey>::collect() {
           (csr_cpu_buffers[i]->get_num_rows() + csr_cpu_buffers[i]->get_sizeof_value() + 1);
       int label_copy_num = label_buffers_[0]->get_num_elements();
       if (pid_ == pid) {
+        if (num_samples_ == 0) {
+          continue;
+        }
         int o_device = -1;
         int local_id = device_resources_.get_local_id(i);
         CK_CUDA_THROW_(get_set_device(device_resources_.get_local_device_id(i), &o_device));
@@ -203,18 +287,36 @@ void DataCollector<TypeKey>::collect() {
                                        label_buffers[i], label_copy_num * sizeof(float),
                                        cudaMemcpyHostToDevice,
                                        *device_resources_[local_id]->get_data_copy_stream_ptr()));
+        if (dense_copy_num > 0) {
+          CK_CUDA_THROW_(cudaMemcpyAsync(
+              dense_buffers_internal_[local_id]->get_ptr_with_offset(0), dense_cpu_buffers[i],
+              dense_copy_num * sizeof(float), cudaMemcpyHostToDevice,
+              *device_resources_[local_id]->get_data_copy_stream_ptr()));
+        }
         CK_CUDA_THROW_(get_set_device(o_device));
       } else {
 #ifdef ENABLE_MPI
         int base_tag = (job_ == TRAIN) ? 1 : 3;
         int csr_tag = i << 2 | base_tag;
         int l_tag = (i + LABEL_TAG_OFFSET) << 2 | base_tag;
+        int n_tag = (i + 2 * LABEL_TAG_OFFSET) << 2 | base_tag;
+        int d_tag = (i + 3 * LABEL_TAG_OFFSET) << 2 | base_tag;
+        req.resize(req.size() + 1);
+        CK_MPI_THROW_(MPI_Isend(&num_samples_, 1, MPI_INT, pid, n_tag, MPI_COMM_WORLD, &req.back()));
+        if (num_samples_ == 0) {
+          continue;
+        }
         req.resize(req.size() + 2);
         CK_MPI_THROW_(MPI_Isend(csr_cpu_buffers[i]->get_buffer(), csr_copy_num,
                                 ToMpiType<TypeKey>::T(), pid, csr_tag, MPI_COMM_WORLD,
                                 (&req.back()) - 1));
         CK_MPI_THROW_(MPI_Isend(label_buffers[i], label_copy_num, ToMpiType<float>::T(), pid, l_tag,
                                 MPI_COMM_WORLD, &req.back()));
+        if (dense_copy_num > 0) {
+          req.resize(req.size() + 1);
+          CK_MPI_THROW_(MPI_Isend(dense_cpu_buffers[i], dense_copy_num, ToMpiType<float>::T(), pid,
+                                  d_tag, MPI_COMM_WORLD, &req.back()));
+        }
 
 #else
         assert(!"No MPI support");
@@ -223,7 +325,7 @@ void DataCollector<TypeKey>::collect() {
     }
 
     // sync
-    for (int i = 0; i < total_device_count; i++) {
+    for (int i = 0; i < total_device_count && num_samples_ > 0; i++) {
       int pid = device_resources_.get_pid(i);
       if (pid_ == pid) {
         int o_device = -1;
@@ -237,12 +339,17 @@ void DataCollector<TypeKey>::collect() {
 #ifdef ENABLE_MPI
     CK_MPI_THROW_(MPI_Waitall(req.size(), &req.front(), MPI_STATUSES_IGNORE));
 #endif
+    if (num_samples_ > 0) {
+      copy_.record_since(copy_start_time);
+      batches_copied_++;
+    }
     csr_heap_->chunk_free_and_checkin(key);
   } else {
 #ifdef ENABLE_MPI
+    progress_.clear();
     const auto& device_list = device_resources_.get_device_list();
     std::vector<MPI_Request> req;
-    req.reserve(2 * device_list.size());                     // to prevent the reallocation
+    req.reserve(3 * device_list.size());                     // to prevent the reallocation
     for (unsigned int i = 0; i < device_list.size(); i++) {  // local_id
       int o_device = -1;
       CK_CUDA_THROW_(get_set_device(device_list[i], &o_device));
@@ -250,6 +357,16 @@ void DataCollector<TypeKey>::collect() {
       int csr_tag = (device_resources_.get_global_id(device_list[i]) << 2) | base_tag;
       int l_tag =
           (device_resources_.get_global_id(device_list[i]) + LABEL_TAG_OFFSET) << 2 | base_tag;
+      int n_tag =
+          (device_resources_.get_global_id(device_list[i]) + 2 * LABEL_TAG_OFFSET) << 2 | base_tag;
+      int d_tag =
+          (device_resources_.get_global_id(device_list[i]) + 3 * LABEL_TAG_OFFSET) << 2 | base_tag;
+      CK_MPI_THROW_(MPI_Recv(&num_samples_, 1, MPI_INT, counter_ % num_procs_, n_tag,
+                             MPI_COMM_WORLD, MPI_STATUS_IGNORE));
+      if (num_samples_ == 0) {
+        CK_CUDA_THROW_(get_set_device(o_device));
+        continue;
+      }
       req.resize(req.size() + 2);
       CK_MPI_THROW_(MPI_Irecv(csr_buffers_internal_[i]->get_ptr_with_offset(0),
                               csr_buffers_internal_[i]->get_num_elements(), ToMpiType<TypeKey>::T(),
@@ -257,11 +374,20 @@ void DataCollector<TypeKey>::collect() {
       CK_MPI_THROW_(MPI_Irecv(label_buffers_internal_[i]->get_ptr_with_offset(0),
                               label_buffers_internal_[i]->get_num_elements(), ToMpiType<float>::T(),
                               counter_ % num_procs_, l_tag, MPI_COMM_WORLD, &req.back()));
+      if (!dense_buffers_internal_.empty()) {
+        req.resize(req.size() + 1);
+        CK_MPI_THROW_(MPI_Irecv(dense_buffers_internal_[i]->get_ptr_with_offset(0),
+                                dense_buffers_internal_[i]->get_num_elements(),
+                                ToMpiType<float>::T(), counter_ % num_procs_, d_tag,
+                                MPI_COMM_WORLD, &req.back()));
+      }
 
       CK_CUDA_THROW_(get_set_device(o_device));
     }
 
-    CK_MPI_THROW_(MPI_Waitall(req.size(), &req.front(), MPI_STATUSES_IGNORE));
+    if (!req.empty()) {
+      CK_MPI_THROW_(MPI_Waitall(req.size(), &req.front(), MPI_STATUSES_IGNORE));
+    }
 
 #else
     assert(!"No MPI support");
@@ -272,12 +398,21 @@ void DataCollector<TypeKey>::collect() {
 }
 
 template <typename TypeKey>
-void DataCollector<TypeKey>::read_a_batch_to_device() {
+int DataCollector<TypeKey>::read_a_batch_to_device() {
+  auto wait_start_time = LatencyHistogram::Clock::now();
   while (stat_ != READY_TO_READ) {
     if (stat_ == STOP) {
-      return;
+      return 0;
     }
   }
+  device_wait_.record_since(wait_start_time);
+  for (auto& progress : progress_) {
+    position_.update(progress);
+  }
+  if (num_samples_ == 0) {
+    stat_ = READY_TO_WRITE;
+    return 0;
+  }
   for (unsigned int i = 0; i < device_resources_.size(); i++) {
     int o_device = -1;
     CK_CUDA_THROW_(get_set_device(device_resources_[i]->get_device_id(), &o_device));
@@ -290,6 +425,12 @@ void DataCollector<TypeKey>::read_a_batch_to_device() {
                                    label_buffers_internal_[i]->get_ptr_with_offset(0),
                                    label_buffers_[i]->get_size(), cudaMemcpyDeviceToDevice,
                                    *device_resources_[i]->get_stream_ptr()));
+    if (!dense_buffers_.empty()) {
+      CK_CUDA_THROW_(cudaMemcpyAsync(dense_buffers_[i]->get_ptr_with_offset(0),
+                                     dense_buffers_internal_[i]->get_ptr_with_offset(0),
+                                     dense_buffers_[i]->get_size(), cudaMemcpyDeviceToDevice,
+                                     *device_resources_[i]->get_stream_ptr()));
+    }
     CK_CUDA_THROW_(get_set_device(o_device));
   }
   for (unsigned int i = 0; i < device_resources_.size(); i++) {
@@ -298,7 +439,9 @@ void DataCollector<TypeKey>::read_a_batch_to_device() {
     CK_CUDA_THROW_(cudaStreamSynchronize(*device_resources_[i]->get_stream_ptr()));
     CK_CUDA_THROW_(get_set_device(o_device));
   }
+  int num_samples = num_samples_;
   stat_ = READY_TO_WRITE;
+  return num_samples;
 }
 
 }  // namespace HugeCTR
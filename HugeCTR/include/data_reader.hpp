@@ -29,7 +29,7 @@
 #include "HugeCTR/include/file_list.hpp"
 #include "HugeCTR/include/general_buffer.hpp"
 #include "HugeCTR/include/gpu_resource.hpp"
-#include "HugeCTR/include/heap.hpp"
+#include "HugeCTR/include/chunk_ring.hpp"
 #include "HugeCTR/include/tensor.hpp"
 #include "HugeCTR/include/utils.hpp"
 
@@ -73,6 +73,48 @@ static void data_collector_thread_func_(DataCollector<TypeKey>* data_collector,
   }
 }
 
+/**
+ * Options of data reading.
+ */
+typedef struct DataReaderParams_ {
+  ReaderMode_t reader_mode{ReaderMode_t::Stream};  // how the data files are read
+  bool shuffle_files{false};    // permute the files in each epoch
+  int shuffle_buffer_size{0};   // samples cached for shuffling in all the threads, 0: disabled
+  unsigned int seed{0};         // seed of the file permutation and the sample shuffling
+  bool repeat{true};            // false: epoch mode, the end of each epoch is reported
+  bool unique_keys{false};      // deduplicate the keys of each batch in the reading threads
+  HostAllocator_t host_allocator{HostAllocator_t::Pinned};  // memory of the chunks
+  int numa_node{-1};  // node of HostAllocator_t::Numa, -1: first touch (see NumaHostAllocator)
+  ReaderPosition start_position;  // position to resume from (see get_position()), empty: start
+  int io_queue_depth{ASYNC_READ_DEFAULT_QUEUE_DEPTH};  // blocks read ahead in ReaderMode_t::Direct
+  long long records_per_range{0};  // split the files to ranges read in parallel, 0: no split
+  int dense_dim{0};  // dense features of a sample, must match the data files (0: none)
+  KeyPartitioner_t key_partitioner{KeyPartitioner_t::Modulo};  // which device a key goes to
+  std::string partition_table;  // table of KeyPartitioner_t::Frequency
+} DataReaderParams;
+
+/**
+ * @brief The part of DataReader which doesn't depend on the key type.
+ *
+ * Session holds the data readers by it, as the key type is chosen by the configure file.
+ */
+class IDataReader {
+ public:
+  virtual ~IDataReader() {}
+  /**
+   * Reading a batch from cpu to gpu, see DataReader::read_a_batch_to_device().
+   */
+  virtual int read_a_batch_to_device() = 0;
+  /**
+   * The position in the file list after the batches read to device.
+   */
+  virtual const ReaderPosition& get_position() const = 0;
+  /**
+   * Counters and latencies of each stage since the reader is created.
+   */
+  virtual DataReaderStats get_stats() const = 0;
+};
+
 /**
  * @brief Data reading controller.
  *
@@ -84,23 +126,26 @@ static void data_collector_thread_func_(DataCollector<TypeKey>* data_collector,
  * and copy the data to GPU buffer.
  */
 template <typename TypeKey>
-class DataReader {
+class DataReader : public IDataReader {
  private:
   FileList* file_list_{nullptr}; /**< file list of data set */
-  const int NumChunks{31};       /**< NumChunks will be used in Heap*/
+  const int NumChunks{31};       /**< NumChunks will be used in ChunkRing*/
   const int NumThreads{20};      /**< number of threads for data reading */
 
-  Heap<CSRChunk<TypeKey>>* csr_heap_{nullptr}; /**< heap to cache the data set */
+  ChunkRing<CSRChunk<TypeKey>>* csr_heap_{nullptr}; /**< ring to cache the data set */
   std::vector<DataReaderMultiThreads<TypeKey>*>
       data_readers_; /**< A vector of DataReaderMultiThreads' pointer.*/
   std::vector<std::thread*> data_reader_threads_; /**< A vector of the pointers of data reader .*/
   std::thread* data_collector_thread_{nullptr};   /**< A data_collector_thread. */
   std::vector<GeneralBuffer<float>*> label_buffers_; /**< A gpu general buffer for label_buffer */
   std::vector<Tensor<float>*> label_tensors_;        /**< Label tensors for the usage of loss */
+  std::vector<GeneralBuffer<float>*> dense_buffers_; /**< gpu buffers of the dense features */
+  std::vector<Tensor<float>*> dense_tensors_; /**< dense features, batch x dense_dim (HW) */
   std::vector<GeneralBuffer<TypeKey>*>
       csr_buffers_; /**< csr_buffers contains row_offset_tensor and value_tensors */
   std::vector<Tensor<TypeKey>*> row_offsets_tensors_; /**< row offset tensors*/
   std::vector<Tensor<TypeKey>*> value_tensors_;       /**< value tensors */
+  std::shared_ptr<const KeyPartitioner<TypeKey>> key_partitioner_; /**< device of a key */
   bool shared_output_flag_{false}; /**< whether this is a data reader for eval. It's only mark the
                                       output data, which is sharing output tensor with train. */
 
@@ -109,6 +154,7 @@ class DataReader {
   const int label_dim_;                    /**< dimention of label e.g. 1 for BinaryCrossEntropy */
   const int slot_num_;                     /**< num of slots for reduce */
   const int max_feature_num_per_sample_;   /**< max possible nnz in a slot (to allocate buffer) */
+  const DataReaderParams params_;          /**< options of data reading */
   int data_reader_loop_flag_;              /**< p_loop_flag a flag to control the loop */
   DataCollector<TypeKey>* data_collector_; /**< pointer of DataCollector */
 
@@ -120,6 +166,8 @@ class DataReader {
    * @params prototype an instant of crated DataReader for output reuse.
    * @params num_chunks number of chunks in heap.
    * @params number of threads for data reading.
+   * The reader_mode of prototype is used, but the data is not shuffled, and it's always
+   * in epoch mode so that an evaluation can go through the data set exactly once.
    */
   DataReader(const std::string& file_list_name, const DataReader& prototype, int num_chunks = 31,
              int num_threads = 20);
@@ -134,15 +182,22 @@ class DataReader {
  public:
   /**
    * Reading a batch from cpu to gpu (embedding)
+   * @return the number of samples in the batch. It's less than the batch size for the
+   *         last batch of an epoch, whose rest rows are empty (and labels are 0).
+   *         0 means the end of an epoch (epoch mode), and there's no data in the batch.
+   *         The next epoch starts with the next call.
+   *         The label (and dense) tensors of a device have ceil(batchsize / total_gpu_count)
+   *         rows, the valid ones of a device are given by get_device_num_samples().
    */
-  void read_a_batch_to_device();  // read data from csr to tensors
+  int read_a_batch_to_device() override;  // read data from csr to tensors
 
   /**
    * Ctor
    */
   DataReader(const std::string& file_list_name, int batchsize, int label_dim, int slot_num,
              int max_feature_num_per_sample, const GPUResourceGroup& gpu_resource_group,
-             int num_chunks = 31, int num_threads = 20);
+             int num_chunks = 31, int num_threads = 20,
+             const DataReaderParams& params = DataReaderParams());
 
   /**
    * Slave process of evaluation will call this to create a new object of DataReader
@@ -161,10 +216,54 @@ class DataReader {
   }
 
   const std::vector<Tensor<float>*>& get_label_tensors() const { return label_tensors_; }
+  /**
+   * The dense features of each device, empty if DataReaderParams::dense_dim is 0.
+   */
+  const std::vector<Tensor<float>*>& get_dense_tensors() const { return dense_tensors_; }
   const std::vector<Tensor<TypeKey>*>& get_row_offsets_tensors() const {
     return row_offsets_tensors_;
   }
   const std::vector<Tensor<TypeKey>*>& get_value_tensors() const { return value_tensors_; }
+  /**
+   * Which device a key is routed to, the embedding must place the keys the same way.
+   */
+  const std::shared_ptr<const KeyPartitioner<TypeKey>>& get_key_partitioner() const {
+    return key_partitioner_;
+  }
+
+  /**
+   * The position in the file list after the batches read to device, which can be saved with
+   * a snapshot and passed as DataReaderParams::start_position to resume the reading.
+   */
+  const ReaderPosition& get_position() const override {
+    return data_collector_->get_position();
+  }
+
+  /**
+   * Sustained read throughput of all the reading threads in MB/s.
+   * It's the sum of the throughput of each thread, which doesn't include
+   * the time threads are waiting for a free chunk.
+   */
+  double get_read_throughput_mbps() const {
+    double throughput = 0.0;
+    for (auto data_reader : data_readers_) {
+      throughput += data_reader->get_throughput_mbps();
+    }
+    return throughput;
+  }
+
+  /**
+   * Counters and latencies of each stage since the reader is created. It can be called
+   * while reading, call DataReaderStats::since() on two of them to get the stats in between.
+   */
+  DataReaderStats get_stats() const override {
+    DataReaderStats stats;
+    for (auto data_reader : data_readers_) {
+      data_reader->add_stats_to(&stats);
+    }
+    data_collector_->add_stats_to(&stats);
+    return stats;
+  }
   ~DataReader();
 };
 
@@ -172,42 +271,51 @@ template <typename TypeKey>
 DataReader<TypeKey>::DataReader(const std::string& file_list_name,
                                 const DataReader<TypeKey>& prototype, int num_chunks,
                                 int num_threads)
-    : file_list_(new FileList(file_list_name)),
+    : file_list_(new FileList(file_list_name, false, 0, false,
+                              prototype.params_.records_per_range)),
       NumChunks(num_chunks),
       NumThreads(num_threads),
       label_buffers_(prototype.label_buffers_),
       label_tensors_(prototype.label_tensors_),
+      dense_buffers_(prototype.dense_buffers_),
+      dense_tensors_(prototype.dense_tensors_),
       csr_buffers_(prototype.csr_buffers_),
       row_offsets_tensors_(prototype.row_offsets_tensors_),
       value_tensors_(prototype.value_tensors_),
+      key_partitioner_(prototype.key_partitioner_),
       device_resources_(prototype.device_resources_),
       batchsize_(prototype.batchsize_),
       label_dim_(prototype.label_dim_),
       slot_num_(prototype.slot_num_),
-      max_feature_num_per_sample_(prototype.max_feature_num_per_sample_) {
+      max_feature_num_per_sample_(prototype.max_feature_num_per_sample_),
+      params_(prototype.params_) {
   shared_output_flag_ = true;
   data_reader_loop_flag_ = 1;
   int total_gpu_count = device_resources_.get_total_gpu_count();
   if (total_gpu_count == 0 || batchsize_ <= 0 || label_dim_ <= 0 || slot_num_ <= 0 ||
-      max_feature_num_per_sample_ <= 0 || 0 != batchsize_ % total_gpu_count) {
+      max_feature_num_per_sample_ <= 0) {
     CK_THROW_(Error_t::WrongInput,
               "total_gpu_count = 0 || batchsize <=0 || label_dim <= 0  || slot_num <= 0 || "
-              "max_feature_num_per_sample <= 0|| batchsize_ % total_gpu_count != 0");
+              "max_feature_num_per_sample <= 0");
   }
   CSRChunk<TypeKey> tmp_chunk(total_gpu_count, batchsize_, label_dim_, slot_num_,
-                              max_feature_num_per_sample_ * batchsize_);
-  csr_heap_ = new Heap<CSRChunk<TypeKey>>(NumChunks, tmp_chunk);
+                              max_feature_num_per_sample_ * batchsize_,
+                              create_host_allocator(params_.host_allocator, params_.numa_node),
+                              params_.unique_keys, params_.dense_dim);
+  csr_heap_ = new ChunkRing<CSRChunk<TypeKey>>(NumChunks, tmp_chunk);
   assert(data_readers_.empty() && data_reader_threads_.empty());
   for (int i = 0; i < NumThreads; i++) {
     DataReaderMultiThreads<TypeKey>* data_reader =
-        new DataReaderMultiThreads<TypeKey>(*csr_heap_, *file_list_, max_feature_num_per_sample_);
+        new DataReaderMultiThreads<TypeKey>(*csr_heap_, *file_list_, max_feature_num_per_sample_,
+                                            params_.reader_mode, 0, 0, params_.io_queue_depth,
+                                            key_partitioner_);
     data_readers_.push_back(data_reader);
     data_reader_threads_.push_back(
         new std::thread(data_reader_thread_func_<TypeKey>, data_reader, &data_reader_loop_flag_));
   }
 
-  data_collector_ =
-      new DataCollector<TypeKey>(label_buffers_, csr_buffers_, device_resources_, csr_heap_);
+  data_collector_ = new DataCollector<TypeKey>(label_buffers_, dense_buffers_, csr_buffers_,
+                                               device_resources_, csr_heap_, true, NumThreads);
 
   data_collector_thread_ = new std::thread(data_collector_thread_func_<TypeKey>, data_collector_,
                                            &data_reader_loop_flag_);
@@ -217,25 +325,30 @@ template <typename TypeKey>
 DataReader<TypeKey>::DataReader(const DataReader<TypeKey>& prototype)
     : label_buffers_(prototype.label_buffers_),
       label_tensors_(prototype.label_tensors_),
+      dense_buffers_(prototype.dense_buffers_),
+      dense_tensors_(prototype.dense_tensors_),
       csr_buffers_(prototype.csr_buffers_),
       row_offsets_tensors_(prototype.row_offsets_tensors_),
       value_tensors_(prototype.value_tensors_),
+      key_partitioner_(prototype.key_partitioner_),
       device_resources_(prototype.device_resources_),
       batchsize_(prototype.batchsize_),
       label_dim_(prototype.label_dim_),
       slot_num_(prototype.slot_num_),
-      max_feature_num_per_sample_(prototype.max_feature_num_per_sample_) {
+      max_feature_num_per_sample_(prototype.max_feature_num_per_sample_),
+      params_(prototype.params_) {
   shared_output_flag_ = true;
   data_reader_loop_flag_ = 1;
   int total_gpu_count = device_resources_.get_total_gpu_count();
   if (total_gpu_count == 0 || batchsize_ <= 0 || label_dim_ <= 0 || slot_num_ <= 0 ||
-      max_feature_num_per_sample_ <= 0 || 0 != batchsize_ % total_gpu_count) {
+      max_feature_num_per_sample_ <= 0) {
     CK_THROW_(Error_t::WrongInput,
               "total_gpu_count = 0 || batchsize <=0 || label_dim <= 0  || slot_num <= 0 || "
-              "max_feature_num_per_sample <= 0|| batchsize_ % total_gpu_count != 0");
+              "max_feature_num_per_sample <= 0");
   }
 
-  data_collector_ = new DataCollector<TypeKey>(label_buffers_, csr_buffers_, device_resources_);
+  data_collector_ =
+      new DataCollector<TypeKey>(label_buffers_, dense_buffers_, csr_buffers_, device_resources_);
 
   data_collector_thread_ = new std::thread(data_collector_thread_func_<TypeKey>, data_collector_,
                                            &data_reader_loop_flag_);
@@ -245,30 +358,54 @@ template <typename TypeKey>
 DataReader<TypeKey>::DataReader(const std::string& file_list_name, int batchsize, int label_dim,
                                 int slot_num, int max_feature_num_per_sample,
                                 const GPUResourceGroup& gpu_resource_group, int num_chunks,
-                                int num_threads)
-    : file_list_(new FileList(file_list_name)),
+                                int num_threads, const DataReaderParams& params)
+    : file_list_(new FileList(file_list_name, params.shuffle_files, params.seed, params.repeat,
+                              params.records_per_range)),
       NumChunks(num_chunks),
       NumThreads(num_threads),
       device_resources_(gpu_resource_group),
       batchsize_(batchsize),
       label_dim_(label_dim),
       slot_num_(slot_num),
-      max_feature_num_per_sample_(max_feature_num_per_sample) {
+      max_feature_num_per_sample_(max_feature_num_per_sample),
+      params_(params) {
   data_reader_loop_flag_ = 1;
   int total_gpu_count = device_resources_.get_total_gpu_count();
   if (total_gpu_count == 0 || batchsize <= 0 || label_dim <= 0 || slot_num <= 0 ||
-      max_feature_num_per_sample <= 0 || 0 != batchsize_ % total_gpu_count) {
+      max_feature_num_per_sample <= 0) {
     CK_THROW_(Error_t::WrongInput,
               "total_gpu_count == 0 || batchsize <=0 || label_dim <= 0  || slot_num <= 0 || "
-              "max_feature_num_per_sample <= 0|| batchsize_ % total_gpu_count != 0");
+              "max_feature_num_per_sample <= 0");
+  }
+  if (params_.shuffle_buffer_size < 0) {
+    CK_THROW_(Error_t::WrongInput, "shuffle_buffer_size < 0");
+  }
+  if (params_.io_queue_depth <= 0) {
+    CK_THROW_(Error_t::WrongInput, "io_queue_depth <= 0");
+  }
+  if (params_.dense_dim < 0) {
+    CK_THROW_(Error_t::WrongInput, "dense_dim < 0");
   }
+  key_partitioner_ = create_key_partitioner<TypeKey>(params_.key_partitioner, total_gpu_count,
+                                                     slot_num_, params_.partition_table);
+  ReaderPosition start_position = params_.start_position;
+  if (start_position.get_num_files() == 0) {
+    start_position = ReaderPosition(file_list_->get_num_files());
+  }
+  file_list_->set_position(start_position);
   CSRChunk<TypeKey> tmp_chunk(total_gpu_count, batchsize_, label_dim_, slot_num_,
-                              max_feature_num_per_sample_ * batchsize_);
-  csr_heap_ = new Heap<CSRChunk<TypeKey>>(NumChunks, tmp_chunk);
+                              max_feature_num_per_sample_ * batchsize_,
+                              create_host_allocator(params_.host_allocator, params_.numa_node),
+                              params_.unique_keys, params_.dense_dim);
+  csr_heap_ = new ChunkRing<CSRChunk<TypeKey>>(NumChunks, tmp_chunk);
   assert(data_readers_.empty() && data_reader_threads_.empty());
+  // the shuffle buffer is split evenly among the threads, each of them has its own seed
+  int shuffle_buffer_size_per_thread = (params_.shuffle_buffer_size + NumThreads - 1) / NumThreads;
   for (int i = 0; i < NumThreads; i++) {
-    DataReaderMultiThreads<TypeKey>* data_reader =
-        new DataReaderMultiThreads<TypeKey>(*csr_heap_, *file_list_, max_feature_num_per_sample_);
+    DataReaderMultiThreads<TypeKey>* data_reader = new DataReaderMultiThreads<TypeKey>(
+        *csr_heap_, *file_list_, max_feature_num_per_sample_, params_.reader_mode,
+        shuffle_buffer_size_per_thread, params_.seed + i, params_.io_queue_depth,
+        key_partitioner_);
     data_readers_.push_back(data_reader);
     data_reader_threads_.push_back(
         new std::thread(data_reader_thread_func_<TypeKey>, data_reader, &data_reader_loop_flag_));
@@ -276,8 +413,8 @@ DataReader<TypeKey>::DataReader(const std::string& file_list_name, int batchsize
 
   auto& device_list = device_resources_.get_device_list();
 
-  // create label tensor
-  int batch_size_per_device = batchsize_ / total_gpu_count;
+  // create label tensor, the batch size is rounded up to a multiple of the devices
+  int batch_size_per_device = (batchsize_ + total_gpu_count - 1) / total_gpu_count;
   std::vector<int> tmp_dim = {batch_size_per_device, label_dim_};
   assert(label_tensors_.empty() && label_buffers_.empty());
   for (auto device_id : device_list) {
@@ -286,8 +423,18 @@ DataReader<TypeKey>::DataReader(const std::string& file_list_name, int batchsize
     tmp_label_buff->init(device_id);
     label_buffers_.push_back(tmp_label_buff);
   }
+  // create dense tensor
+  if (params_.dense_dim > 0) {
+    std::vector<int> dense_dim = {batch_size_per_device, params_.dense_dim};
+    for (auto device_id : device_list) {
+      GeneralBuffer<float>* tmp_dense_buff = new GeneralBuffer<float>();
+      dense_tensors_.push_back(new Tensor<float>(dense_dim, *tmp_dense_buff, TensorFormat_t::HW));
+      tmp_dense_buff->init(device_id);
+      dense_buffers_.push_back(tmp_dense_buff);
+    }
+  }
   // create value and row offset tensor
-  std::vector<int> num_rows_dim = {1, batchsize_ * slot_num_ + 1};
+  std::vector<int> num_rows_dim = {1, batch_size_per_device * total_gpu_count * slot_num_ + 1};
   std::vector<int> num_max_value_dim = {1, max_feature_num_per_sample_ * batchsize_};
   for (auto device_id : device_list) {
     GeneralBuffer<TypeKey>* tmp_buffer = new GeneralBuffer<TypeKey>();
@@ -301,8 +448,9 @@ DataReader<TypeKey>::DataReader(const std::string& file_list_name, int batchsize
     csr_buffers_.push_back(tmp_buffer);
   }
 
-  data_collector_ =
-      new DataCollector<TypeKey>(label_buffers_, csr_buffers_, device_resources_, csr_heap_, false);
+  data_collector_ = new DataCollector<TypeKey>(label_buffers_, dense_buffers_, csr_buffers_,
+                                               device_resources_, csr_heap_, false, NumThreads);
+  data_collector_->set_position(start_position);
 
   data_collector_thread_ = new std::thread(data_collector_thread_func_<TypeKey>, data_collector_,
                                            &data_reader_loop_flag_);
@@ -310,9 +458,13 @@ DataReader<TypeKey>::DataReader(const std::string& file_list_name, int batchsize
 }
 
 template <typename TypeKey>
-void DataReader<TypeKey>::read_a_batch_to_device() {
-  data_collector_->read_a_batch_to_device();
-  return;
+int DataReader<TypeKey>::read_a_batch_to_device() {
+  int num_samples = data_collector_->read_a_batch_to_device();
+  if (num_samples == 0 && file_list_ != nullptr) {
+    // all the reading threads are waiting, start the next epoch
+    file_list_->next_epoch();
+  }
+  return num_samples;
 }
 
 template <typename TypeKey>
@@ -326,6 +478,9 @@ DataReader<TypeKey>::~DataReader() {
     if (csr_heap_ != nullptr) {
       csr_heap_->break_and_return();
     }
+    if (file_list_ != nullptr) {
+      file_list_->break_waiting();
+    }
     data_reader_loop_flag_ = 0;
     data_collector_->stop();
     // delete threads
@@ -335,6 +490,23 @@ DataReader<TypeKey>::~DataReader() {
     }
 
     data_collector_thread_->join();
+
+    if (!data_readers_.empty()) {
+      DataReaderStats stats = get_stats();
+      const char* reader_mode_name =
+          params_.reader_mode == ReaderMode_t::Mmap
+              ? "mmap"
+              : (params_.reader_mode == ReaderMode_t::Direct ? "direct" : "stream");
+      MESSAGE_(std::string("Data reader (") + reader_mode_name +
+               "): " + std::to_string(get_read_throughput_mbps()) + " MB/s sustained, " +
+               std::to_string(stats.bytes_read / 1000000) + " MB read, " +
+               std::to_string(stats.records_decoded) + " records decoded");
+      auto latency = DataReaderStats::format_latency;
+      MESSAGE_("Data reader waits: free chunk " + latency(stats.free_chunk_wait) +
+               ", ready chunk " + latency(stats.ready_chunk_wait) + ", collector spin " +
+               latency(stats.collector_spin) + ", copy " + latency(stats.copy) + ", device " +
+               latency(stats.device_wait));
+    }
     delete data_collector_thread_;
     delete data_collector_;
 
@@ -354,6 +526,12 @@ DataReader<TypeKey>::~DataReader() {
       for (auto label_buffer : label_buffers_) {
         delete label_buffer;
       }
+      for (auto dense_tensor : dense_tensors_) {
+        delete dense_tensor;
+      }
+      for (auto dense_buffer : dense_buffers_) {
+        delete dense_buffer;
+      }
     }
     // delete heap
     if (file_list_ != nullptr) {
@@ -15,13 +15,26 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
 #include <fstream>
+#include <random>
+#include <memory>
 #include <vector>
+#include "HugeCTR/include/async_file_reader.hpp"
 #include "HugeCTR/include/common.hpp"
 #include "HugeCTR/include/csr.hpp"
 #include "HugeCTR/include/csr_chunk.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
 #include "HugeCTR/include/file_list.hpp"
-#include "HugeCTR/include/heap.hpp"
+#include "HugeCTR/include/key_partitioner.hpp"
+#include "HugeCTR/include/chunk_ring.hpp"
+#include "HugeCTR/include/mmap_file.hpp"
+#include "HugeCTR/include/reader_stats.hpp"
+#include "HugeCTR/include/record_range.hpp"
 
 namespace HugeCTR {
 
@@ -30,34 +43,140 @@ namespace HugeCTR {
  *
  * This is the data readers which will be initilized within multiple
  * threads in class DataReader.
- * It reads data from files in file_list to CSR heap.
+ * It reads data from files in file_list to CSR ring.
+ * In ReaderMode_t::Stream a sample is read field by field with std::ifstream.
+ * In ReaderMode_t::Mmap the data file is mapped and the samples are decoded in place,
+ * the keys are copied from the mapping into the CSR buffers directly.
+ * In ReaderMode_t::Direct the data file is read with an AsyncFileReader, which keeps
+ * io_queue_depth blocks read ahead (O_DIRECT, io_uring or a pread thread) while the
+ * samples are decoded in place from the blocks.
+ * Both v1 and v2 data files are read sequentially, the block index of v2 is not needed here.
+ * The blocks of a compressed v2 file are decompressed one at a time into a buffer, and the
+ * samples are decoded from it as from an uncompressed file.
+ * With a shuffle buffer, the samples read from files are cached (undecoded) in the buffer,
+ * and each sample of a batch is a random one picked from the buffer, whose slot is then
+ * refilled by the next sample in the file.
+ * When the file list is in epoch mode, a thread writes a short batch (if any samples are left)
+ * and then a chunk of 0 sample at the end of an epoch, and waits until the next epoch starts.
+ * If the chunks keep unique keys (CSRChunk::has_unique_keys()), they are computed by the
+ * reading thread once a batch is filled.
+ * The work of a thread is a range of records (RecordRange) from the file list, the whole
+ * file unless the file list splits the files. The reader seeks to the first record of a
+ * range with the index of the data file (see find_record_offset()), and claims the records
+ * a few at a time so that the rest of the range can be stolen by an idle thread.
+ * Each chunk carries the progress of the thread in the ranges it's read from
+ * (CSRChunk::get_progress()). With a shuffle buffer, it's the records of the samples taken out
+ * of the buffer into the chunk, so that a resume reads the samples left in the buffer again.
  */
 template <class T>
 class DataReaderMultiThreads {
  private:
   FileList& file_list_;         /**< file list of data set */
-  Heap<CSRChunk<T>>& csr_heap_; /**< heap to cache the data set */
+  ChunkRing<CSRChunk<T>>& csr_heap_; /**< ring to cache the data set */
   DataSetHeader
       data_set_header_; /**< the header of data set, which has main informations of a data file */
   long long current_record_index_{0}; /**< the index of current reading record in a data file */
   std::ifstream in_file_stream_;      /**< file stream of data set file */
   std::string file_name_;             /**< file name of current file */
-  T* feature_ids_;                    /**< a buffer to cache the readed feature from data set */
+  std::vector<T> feature_ids_;        /**< a buffer to cache the readed feature from data set */
   size_t buffer_length_;              /**< max possible nnz in a slot */
   bool skip_read_{false};             /**< set to true when you want to stop the data reading */
+  const ReaderMode_t reader_mode_;    /**< how the data files are read */
+  MmapFile mmap_file_;                /**< mapping of current file (ReaderMode_t::Mmap) */
+  const char* mmap_cursor_{nullptr};  /**< next byte to decode in mmap_file_ */
+  std::unique_ptr<AsyncFileReader> async_file_; /**< reader of ReaderMode_t::Direct */
+  int codec_{DATA_SET_CODEC_NONE};    /**< codec of the blocks of current file */
+  std::vector<char> block_;           /**< current block decompressed */
+  size_t block_pos_{0};               /**< next byte to decode in block_ */
+  std::vector<char> compressed_block_; /**< current block read into memory (Stream, Direct) */
+  long long pending_bytes_{0};        /**< bytes read in the current batch */
+  std::atomic<long long> bytes_read_{0};   /**< total bytes read by this reader */
+  std::atomic<long long> busy_time_us_{0}; /**< time spent on reading, excluding ring waiting */
+  std::atomic<long long> records_decoded_{0}; /**< total samples written to chunks */
+  LatencyHistogram free_chunk_wait_;          /**< waiting for a free chunk of the ring */
+  const int shuffle_buffer_size_;          /**< max samples in shuffle_buffer_, 0: no shuffling */
+  std::vector<std::vector<char>> shuffle_buffer_; /**< raw samples to be picked randomly */
+  std::mt19937 shuffle_generator_;                /**< generator of the picking */
+  std::vector<FileProgress> shuffle_records_; /**< the record of each sample of shuffle_buffer_ */
+  std::vector<FileProgress> taken_records_;   /**< the records taken out of the buffer */
+  KeyDedup<T> key_dedup_;     /**< table to compute the unique keys of a chunk */
+  std::shared_ptr<const KeyPartitioner<T>> key_partitioner_; /**< device of a key, or modulo */
+  bool end_of_epoch_{false};  /**< whether the end of epoch is marked for file_list_ */
+  long long next_epoch_{0};   /**< the epoch to wait for after end_of_epoch_ */
+  long long current_sequence_{0};      /**< sequence number of the current file in file_list_ */
+  std::shared_ptr<RecordRange> range_; /**< the range being read */
+  long long claimed_end_{0};           /**< the records of range_ before it are claimed */
+  std::vector<FileProgress> progress_; /**< progress in the files of the current batch */
+
+  bool is_file_open_() const {
+    switch (reader_mode_) {
+      case ReaderMode_t::Mmap:
+        return mmap_file_.is_open();
+      case ReaderMode_t::Direct:
+        return async_file_->is_open();
+      default:
+        return in_file_stream_.is_open();
+    }
+  }
+  bool open_next_file_();
+  void open_file_();
+  void seek_to_record_(long long record_id);
+  void skip_(size_t length);
+  void skip_file_(size_t length);
+  void next_record_();
+  bool read_a_sample_(int i, CSRChunk<T>* chunk, int* label);
+  const char* read_(size_t length, void* scratch);
+  const char* read_file_(size_t length, void* scratch);
+  void load_block_();
+  void read_raw_sample_(std::vector<char>* sample, FileProgress* record);
+  void add_taken_records_();
+  template <typename Read>
+  void parse_sample_(Read read, int i, CSRChunk<T>* chunk, int* label);
+  void read_to_(void* dst, size_t length) {
+    const char* src = read_(length, dst);
+    if (src != dst) {
+      memcpy(dst, src, length);
+    }
+  }
+
  public:
   /**
    * Ctor
+   * @param csr_heap ring the batches are written to.
+   * @param file_list file list of data set.
+   * @param buffer_length max possible nnz in a slot.
+   * @param reader_mode how the data files are read.
+   * @param shuffle_buffer_size the number of samples cached for shuffling, 0 to disable it.
+   * @param seed seed of the shuffling.
+   * @param io_queue_depth the number of blocks read ahead in ReaderMode_t::Direct.
+   * @param key_partitioner which CSR buffer (device) a key goes to, key % the number of
+   *        buffers if it's nullptr.
    */
-  DataReaderMultiThreads(Heap<CSRChunk<T>>& csr_heap, FileList& file_list, size_t buffer_length)
+  DataReaderMultiThreads(ChunkRing<CSRChunk<T>>& csr_heap, FileList& file_list, size_t buffer_length,
+                         ReaderMode_t reader_mode = ReaderMode_t::Stream,
+                         int shuffle_buffer_size = 0, unsigned int seed = 0,
+                         int io_queue_depth = ASYNC_READ_DEFAULT_QUEUE_DEPTH,
+                         std::shared_ptr<const KeyPartitioner<T>> key_partitioner = nullptr)
       : file_list_(file_list),
         csr_heap_(csr_heap),
-        feature_ids_(new T[buffer_length]()),
-        buffer_length_(buffer_length){};
-  ~DataReaderMultiThreads() { delete[] feature_ids_; }
+        feature_ids_(buffer_length),
+        buffer_length_(buffer_length),
+        reader_mode_(reader_mode),
+        shuffle_buffer_size_(shuffle_buffer_size),
+        shuffle_generator_(seed),
+        key_partitioner_(key_partitioner) {
+    if (shuffle_buffer_size < 0) {
+      CK_THROW_(Error_t::WrongInput, "shuffle_buffer_size < 0");
+    }
+    shuffle_buffer_.reserve(shuffle_buffer_size);
+    shuffle_records_.reserve(shuffle_buffer_size);
+    if (reader_mode == ReaderMode_t::Direct) {
+      async_file_.reset(new AsyncFileReader(io_queue_depth));
+    }
+  }
 
   /**
-   * read a batch of data from data set to heap.
+   * read a batch of data from data set to ring.
    */
   void read_a_batch();
 
@@ -65,114 +184,543 @@ class DataReaderMultiThreads {
    * skip data reading in read_a_batch()
    */
   void skip_read() { skip_read_ = true; }
+
+  /**
+   * Total bytes read from data files by this reader, the compressed bytes of compressed files.
+   */
+  long long get_bytes_read() const { return bytes_read_; }
+
+  /**
+   * Time (in seconds) spent on reading and decoding, the waiting for a free chunk is excluded.
+   */
+  double get_busy_seconds() const { return busy_time_us_ / 1000000.0; }
+
+  /**
+   * Sustained read throughput of this reader in MB/s (10^6 bytes per second).
+   */
+  double get_throughput_mbps() const {
+    long long busy_time_us = busy_time_us_;
+    return busy_time_us > 0 ? static_cast<double>(bytes_read_) / busy_time_us : 0.0;
+  }
+
+  /**
+   * Add the counters and the free chunk waiting of this reader to stats.
+   */
+  void add_stats_to(DataReaderStats* stats) const {
+    stats->bytes_read += bytes_read_;
+    stats->records_decoded += records_decoded_;
+    free_chunk_wait_.add_to(&stats->free_chunk_wait);
+  }
 };
 
+/**
+ * Get the next range from file_list_, and open its file unless it's the current file.
+ * @return false if there's no range left in the epoch (epoch mode).
+ */
 template <class T>
-void DataReaderMultiThreads<T>::read_a_batch() {
-  try {
+bool DataReaderMultiThreads<T>::open_next_file_() {
+  std::shared_ptr<RecordRange> range;
+  if (!file_list_.get_a_range(&range)) {
+    range_.reset();
+    mmap_file_.close();
+    if (async_file_) {
+      async_file_->close();
+    }
+    if (in_file_stream_.is_open()) {
+      in_file_stream_.close();
+    }
+    return false;
+  }
+  const bool same_file = is_file_open_() && range->get_sequence() == current_sequence_;
+  range_ = range;
+  current_sequence_ = range->get_sequence();
+  if (!same_file) {
+    file_name_ = range->get_file_name();
+    open_file_();
+  }
+  const long long start_record = range->get_begin();
+  const long long number_of_records = data_set_header_.number_of_records;
+  if (start_record >= number_of_records) {
+    // nothing left in the file
+    progress_.push_back({current_sequence_, number_of_records, true, number_of_records});
+    return open_next_file_();
+  }
+  if (!range->claim(start_record, &claimed_end_)) {
+    return open_next_file_();
+  }
+  if (start_record != current_record_index_) {
+    seek_to_record_(start_record);
+  }
+  return true;
+}
+
+/**
+ * Open file_name_ and read its header.
+ */
+template <class T>
+void DataReaderMultiThreads<T>::open_file_() {
+  if (reader_mode_ == ReaderMode_t::Mmap) {
+    mmap_file_.open(file_name_);
+    mmap_cursor_ = mmap_file_.get_data();
+  } else if (reader_mode_ == ReaderMode_t::Direct) {
+    async_file_->open(file_name_);
+  } else {
+    if (in_file_stream_.is_open()) {
+      in_file_stream_.close();
+    }
+    in_file_stream_.open(file_name_, std::ifstream::binary);
     if (!in_file_stream_.is_open()) {
-      std::string file_name = file_list_.get_a_file();
-      in_file_stream_.open(file_name, std::ifstream::binary);
-      in_file_stream_.read(reinterpret_cast<char*>(&data_set_header_), sizeof(DataSetHeader));
-      if (!in_file_stream_.is_open()) {
-        CK_THROW_(Error_t::FileCannotOpen, "in_file_stream_.is_open() failed: " + file_name);
+      CK_THROW_(Error_t::FileCannotOpen, "in_file_stream_.is_open() failed: " + file_name_);
+    }
+  }
+  codec_ = DATA_SET_CODEC_NONE;
+  block_.clear();
+  block_pos_ = 0;
+  read_to_(&data_set_header_, sizeof(DataSetHeader));
+  check_data_set_version(data_set_header_, file_name_);
+  codec_ = get_data_set_codec(data_set_header_);
+  current_record_index_ = 0;
+
+#ifndef NDEBUG
+  std::cout << file_name_ << std::endl;
+  std::cout << "number_of_records:" << data_set_header_.number_of_records
+            << ", label_dim:" << data_set_header_.label_dim
+            << ", slot_num:" << data_set_header_.slot_num << std::endl;
+#endif
+  if (!(data_set_header_.number_of_records > 0))
+    CK_THROW_(Error_t::WrongInput, "number_of_records <= 0");
+}
+
+/**
+ * Move to a record of current file.
+ * The bytes skipped are not counted as read.
+ */
+template <class T>
+void DataReaderMultiThreads<T>::seek_to_record_(long long record_id) {
+  long long offset = 0;
+  long long records_to_skip = 0;
+  find_record_offset(file_name_, data_set_header_, record_id, &offset, &records_to_skip);
+  if (reader_mode_ == ReaderMode_t::Mmap) {
+    if (offset > static_cast<long long>(mmap_file_.get_size())) {
+      CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name_);
+    }
+    mmap_cursor_ = mmap_file_.get_data() + offset;
+  } else if (reader_mode_ == ReaderMode_t::Direct) {
+    async_file_->seek(offset);
+  } else {
+    in_file_stream_.seekg(offset, std::ios_base::beg);
+  }
+  // the offset of a compressed file is a block, which is loaded by the first read
+  block_.clear();
+  block_pos_ = 0;
+  long long pending_bytes = pending_bytes_;
+  for (long long i = 0; i < records_to_skip; i++) {
+    skip_(get_data_set_dense_offset(data_set_header_));
+    for (int k = 0; k < data_set_header_.slot_num; k++) {
+      int nnz;
+      read_to_(&nnz, sizeof(int));
+      if (nnz < 0) {
+        CK_THROW_(Error_t::WrongInput, "nnz < 0: " + file_name_);
+      }
+      skip_(sizeof(T) * nnz);
+    }
+  }
+  pending_bytes_ = pending_bytes;
+  current_record_index_ = record_id;
+}
+
+/**
+ * Skip the next length bytes of the samples of current file.
+ */
+template <class T>
+void DataReaderMultiThreads<T>::skip_(size_t length) {
+  if (codec_ == DATA_SET_CODEC_NONE) {
+    skip_file_(length);
+    return;
+  }
+  while (length > 0) {
+    if (block_pos_ == block_.size()) {
+      load_block_();
+    }
+    size_t n = std::min(length, block_.size() - block_pos_);
+    block_pos_ += n;
+    length -= n;
+  }
+}
+
+/**
+ * Skip the next length bytes of current file.
+ */
+template <class T>
+void DataReaderMultiThreads<T>::skip_file_(size_t length) {
+  if (reader_mode_ == ReaderMode_t::Mmap) {
+    const char* end = mmap_file_.get_data() + mmap_file_.get_size();
+    if (length > static_cast<size_t>(end - mmap_cursor_)) {
+      CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name_);
+    }
+    mmap_cursor_ += length;
+    return;
+  }
+  if (reader_mode_ == ReaderMode_t::Direct) {
+    async_file_->skip(length);
+    return;
+  }
+  in_file_stream_.seekg(length, std::ios_base::cur);
+  if (!in_file_stream_) {
+    CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name_);
+  }
+}
+
+/**
+ * Get the next length bytes of the samples of current file.
+ * If the file is compressed, the returned pointer is inside the decompressed block,
+ * otherwise see read_file_().
+ */
+template <class T>
+const char* DataReaderMultiThreads<T>::read_(size_t length, void* scratch) {
+  if (codec_ == DATA_SET_CODEC_NONE) {
+    return read_file_(length, scratch);
+  }
+  if (block_pos_ == block_.size() && length > 0) {
+    load_block_();
+  }
+  // a sample doesn't span two blocks
+  if (length > block_.size() - block_pos_) {
+    CK_THROW_(Error_t::WrongInput, "broken compressed block: " + file_name_);
+  }
+  const char* ptr = block_.data() + block_pos_;
+  block_pos_ += length;
+  return ptr;
+}
+
+/**
+ * Read the next block of a compressed file and decompress it into block_.
+ */
+template <class T>
+void DataReaderMultiThreads<T>::load_block_() {
+  DataSetCompressedBlockHeader block_header;
+  const char* src = read_file_(sizeof(DataSetCompressedBlockHeader), &block_header);
+  if (src != reinterpret_cast<const char*>(&block_header)) {
+    memcpy(&block_header, src, sizeof(DataSetCompressedBlockHeader));
+  }
+  if (block_header.compressed_size <= 0 || block_header.uncompressed_size <= 0 ||
+      block_header.compressed_size > INT_MAX || block_header.uncompressed_size > INT_MAX) {
+    CK_THROW_(Error_t::WrongInput, "broken compressed block: " + file_name_);
+  }
+  if (reader_mode_ != ReaderMode_t::Mmap &&
+      compressed_block_.size() < static_cast<size_t>(block_header.compressed_size)) {
+    compressed_block_.resize(block_header.compressed_size);
+  }
+  src = read_file_(block_header.compressed_size, compressed_block_.data());
+  block_.resize(block_header.uncompressed_size);
+  decompress_block(codec_, src, block_header.compressed_size, block_.data(), block_.size());
+  block_pos_ = 0;
+}
+
+/**
+ * Get the next length bytes of current file.
+ * In Mmap mode the returned pointer is inside the mapping and scratch is not used,
+ * in Direct mode it's inside a block read ahead unless the bytes span two blocks,
+ * otherwise the bytes are read into scratch.
+ * Note that the returned pointer is not necessarily aligned.
+ */
+template <class T>
+const char* DataReaderMultiThreads<T>::read_file_(size_t length, void* scratch) {
+  pending_bytes_ += length;
+  if (reader_mode_ == ReaderMode_t::Mmap) {
+    const char* ptr = mmap_cursor_;
+    if (length > static_cast<size_t>(mmap_file_.get_data() + mmap_file_.get_size() - ptr)) {
+      CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name_);
+    }
+    mmap_cursor_ += length;
+    return ptr;
+  }
+  if (reader_mode_ == ReaderMode_t::Direct) {
+    return async_file_->read(length, scratch);
+  }
+  in_file_stream_.read(reinterpret_cast<char*>(scratch), length);
+  if (!in_file_stream_) {
+    CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name_);
+  }
+  return reinterpret_cast<const char*>(scratch);
+}
+
+/**
+ * Decode the i-th sample of a batch into chunk.
+ * @param read a callable like read_(), returning the next length bytes of the sample.
+ * @param label a buffer of label_dim ints.
+ */
+template <class T>
+template <typename Read>
+void DataReaderMultiThreads<T>::parse_sample_(Read read, int i, CSRChunk<T>* chunk_tmp,
+                                              int* label) {
+  const std::vector<CSR<T>*>& csr_buffers = chunk_tmp->get_csr_buffers();
+  const std::vector<float*>& label_buffers = chunk_tmp->get_label_buffers();
+  const int label_dim = chunk_tmp->get_label_dim();
+  auto read_to = [&read](void* dst, size_t length) {
+    const char* src = read(length, dst);
+    if (src != dst) {
+      memcpy(dst, src, length);
+    }
+  };
+  read_to(label, sizeof(int) * (label_dim));
+  {
+    const int batchsize_per_buffer = chunk_tmp->get_batchsize_per_buffer();
+    // We suppose that the data parallel mode is like this
+    int buffer_id = i / batchsize_per_buffer;
+    assert(buffer_id < label_buffers.size());
+    int local_id = i % batchsize_per_buffer;
+    for (int j = 0; j < label_dim; j++) {
+      label_buffers[buffer_id][local_id * label_dim + j] = label[j];  // row major for label buffer
+    }
+    const int dense_dim = chunk_tmp->get_dense_dim();
+    if (dense_dim > 0) {
+      read_to(chunk_tmp->get_dense_buffers()[buffer_id] + local_id * dense_dim,
+              sizeof(float) * dense_dim);
+    }
+  }
+
+  for (int k = 0; k < data_set_header_.slot_num; k++) {
+    for (auto iter = csr_buffers.begin(); iter != csr_buffers.end(); iter++) {
+      iter[0]->new_row();
+    }
+    int nnz;
+    read_to(&nnz, sizeof(int));
+    if (nnz > (int)buffer_length_ || nnz < 0) {
+      ERROR_MESSAGE_("nnz > buffer_length_ | nnz < 0");
+      if (nnz < 0) {
+        CK_THROW_(Error_t::WrongInput, "nnz < 0: " + file_name_);
       }
+      if (reader_mode_ != ReaderMode_t::Mmap && nnz > (int)feature_ids_.size()) {
+        feature_ids_.resize(nnz);
+      }
+    }
+
+#ifndef NDEBUG
+    if (i == 0)
+      std::cout << "[HCDEBUG]"
+                << "nnz: " << nnz << std::endl;
+#endif
 
+    const char* keys = read(sizeof(T) * nnz, feature_ids_.data());
+    if (csr_buffers.size() == 1) {
+      csr_buffers[0]->push_back_n(keys, nnz);
+    } else {
+      for (int j = 0; j < nnz; j++) {
+        T local_id;
+        memcpy(&local_id, keys + j * sizeof(T), sizeof(T));
+        // We suppose that the module parallel mode is like this
+        int buffer_id = key_partitioner_ ? key_partitioner_->get_device(local_id)
+                                         : local_id % csr_buffers.size();
+        assert(buffer_id < csr_buffers.size());
+        csr_buffers[buffer_id]->push_back(local_id);
 #ifndef NDEBUG
-      std::cout << file_name << std::endl;
-      std::cout << "number_of_records:" << data_set_header_.number_of_records
-                << ", label_dim:" << data_set_header_.label_dim
-                << ", slot_num:" << data_set_header_.slot_num << std::endl;
+        if (i == 0)
+          std::cout << "[HCDEBUG]"
+                    << "feature_ids:" << local_id << " local_id: " << local_id << std::endl;
 #endif
-      current_record_index_ = 0;
-      if (!(data_set_header_.number_of_records > 0))
-        CK_THROW_(Error_t::WrongInput, "number_of_records <= 0");
+      }
+    }
+  }
+}
+
+/**
+ * Decode the next sample (from the file or the shuffle buffer) into the i-th sample of chunk.
+ * @return false if there's no sample left in the epoch.
+ */
+template <class T>
+bool DataReaderMultiThreads<T>::read_a_sample_(int i, CSRChunk<T>* chunk, int* label) {
+  if (shuffle_buffer_size_ > 0) {
+    // fill the buffer before the first pick
+    while (static_cast<int>(shuffle_buffer_.size()) < shuffle_buffer_size_ && is_file_open_()) {
+      shuffle_buffer_.emplace_back();
+      shuffle_records_.emplace_back();
+      read_raw_sample_(&shuffle_buffer_.back(), &shuffle_records_.back());
+    }
+    if (shuffle_buffer_.empty()) {
+      return false;
+    }
+    size_t pick = shuffle_generator_() % shuffle_buffer_.size();
+    const char* cursor = shuffle_buffer_[pick].data();
+    parse_sample_(
+        [&cursor](size_t length, void*) {
+          const char* ptr = cursor;
+          cursor += length;
+          return ptr;
+        },
+        i, chunk, label);
+    taken_records_.push_back(shuffle_records_[pick]);
+    if (is_file_open_()) {
+      read_raw_sample_(&shuffle_buffer_[pick], &shuffle_records_[pick]);
+    } else {
+      // drain the buffer at the end of epoch
+      std::swap(shuffle_buffer_[pick], shuffle_buffer_.back());
+      shuffle_buffer_.pop_back();
+      std::swap(shuffle_records_[pick], shuffle_records_.back());
+      shuffle_records_.pop_back();
+    }
+    return true;
+  }
+  if (!is_file_open_()) {
+    return false;
+  }
+  parse_sample_([this](size_t length, void* scratch) { return read_(length, scratch); }, i, chunk,
+                label);
+  next_record_();
+  return true;
+}
+
+/**
+ * Move to the next record, and start a new range when finish one range read.
+ */
+template <class T>
+void DataReaderMultiThreads<T>::next_record_() {
+  current_record_index_++;
+  const bool end_of_file = current_record_index_ >= data_set_header_.number_of_records;
+  if (current_record_index_ < claimed_end_ && !end_of_file) {
+    return;
+  }
+  if (end_of_file || !range_->claim(current_record_index_, &claimed_end_)) {
+    // the samples in the shuffle buffer are added once they're taken out, see add_taken_records_()
+    if (shuffle_buffer_size_ == 0) {
+      progress_.push_back(
+          {current_sequence_, current_record_index_, end_of_file, range_->get_begin()});
+    }
+    open_next_file_();
+  }
+}
+
+/**
+ * Read the next sample of current file into sample without decoding it, for the shuffle buffer.
+ * The layout of sample is the same as in the data file.
+ * @param record the record of the sample, as the progress of reading it alone.
+ */
+template <class T>
+void DataReaderMultiThreads<T>::read_raw_sample_(std::vector<char>* sample,
+                                                 FileProgress* record) {
+  size_t length = get_data_set_dense_offset(data_set_header_);
+  sample->resize(length);
+  read_to_(sample->data(), length);
+  for (int k = 0; k < data_set_header_.slot_num; k++) {
+    int nnz;
+    read_to_(&nnz, sizeof(int));
+    if (nnz < 0) {
+      CK_THROW_(Error_t::WrongInput, "nnz < 0: " + file_name_);
+    }
+    sample->resize(length + sizeof(int) + sizeof(T) * nnz);
+    memcpy(sample->data() + length, &nnz, sizeof(int));
+    length += sizeof(int);
+    read_to_(sample->data() + length, sizeof(T) * nnz);
+    length += sizeof(T) * nnz;
+  }
+  const long long next_record = current_record_index_ + 1;
+  *record = {current_sequence_, next_record, next_record >= data_set_header_.number_of_records,
+             current_record_index_};
+  next_record_();
+}
+
+/**
+ * Add the records taken out of the shuffle buffer to the progress of the batch, the records
+ * next to each other in a file are merged into one range.
+ */
+template <class T>
+void DataReaderMultiThreads<T>::add_taken_records_() {
+  std::sort(taken_records_.begin(), taken_records_.end(),
+            [](const FileProgress& a, const FileProgress& b) {
+              return a.sequence < b.sequence ||
+                     (a.sequence == b.sequence && a.first_record < b.first_record);
+            });
+  for (auto& record : taken_records_) {
+    if (!progress_.empty() && progress_.back().sequence == record.sequence &&
+        progress_.back().next_record == record.first_record) {
+      progress_.back().next_record = record.next_record;
+      progress_.back().finished = record.finished;
+    } else {
+      progress_.push_back(record);
+    }
+  }
+  taken_records_.clear();
+}
+
+template <class T>
+void DataReaderMultiThreads<T>::read_a_batch() {
+  try {
+    if (end_of_epoch_) {
+      // the end is marked, wait for the next epoch
+      if (!file_list_.wait_for_epoch(next_epoch_)) {
+        return;
+      }
+      end_of_epoch_ = false;
+    }
+    if (!is_file_open_()) {
+      open_next_file_();
     }
     unsigned int key = 0;
     CSRChunk<T>* chunk_tmp = nullptr;
+    auto wait_start_time = LatencyHistogram::Clock::now();
     csr_heap_.free_chunk_checkout(&chunk_tmp, &key);
+    free_chunk_wait_.record_since(wait_start_time);
     if (!skip_read_) {
+      auto start_time = std::chrono::steady_clock::now();
       const std::vector<CSR<T>*>& csr_buffers = chunk_tmp->get_csr_buffers();
       const std::vector<float*>& label_buffers = chunk_tmp->get_label_buffers();
       const int label_dim = chunk_tmp->get_label_dim();
-      if (data_set_header_.label_dim != label_dim)
+      if (is_file_open_() && data_set_header_.label_dim != label_dim)
         CK_THROW_(Error_t::WrongInput, "data_set_header_.label_dim != label_dim");
+      const int dense_dim = chunk_tmp->get_dense_dim();
+      if (is_file_open_() && get_data_set_dense_dim(data_set_header_) != dense_dim)
+        CK_THROW_(Error_t::WrongInput, "dense_dim of the data file != dense_dim: " + file_name_);
 
       int* label = new int[label_dim]();
       for (auto iter = csr_buffers.begin(); iter != csr_buffers.end(); iter++) {
         iter[0]->reset();
       }
       assert(label_buffers.size() > 0);
-      for (int i = 0; i < chunk_tmp->get_batchsize(); i++) {
-        in_file_stream_.read(reinterpret_cast<char*>(label), sizeof(int) * (label_dim));
-        {
-          int buffer_id =
-              i / (chunk_tmp->get_batchsize() /
-                   label_buffers.size());  // We suppose that the data parallel mode is like this
-          assert(buffer_id < label_buffers.size());
-          int local_id = i % (chunk_tmp->get_batchsize() / label_buffers.size());
-          assert(local_id < (chunk_tmp->get_batchsize() / label_buffers.size()));
-          for (int j = 0; j < label_dim; j++) {
-            label_buffers[buffer_id][local_id * label_dim + j] = label[j];  // row major for label buffer
-          }
-        }
-
-        for (int k = 0; k < data_set_header_.slot_num; k++) {
+      int num_samples = 0;
+      while (num_samples < chunk_tmp->get_batchsize() &&
+             read_a_sample_(num_samples, chunk_tmp, label)) {
+        num_samples++;
+      }
+      // pad a short batch, and the batch size to a multiple of the devices, with empty samples
+      const int batchsize_per_buffer = chunk_tmp->get_batchsize_per_buffer();
+      const int num_rows = batchsize_per_buffer * static_cast<int>(label_buffers.size());
+      for (int i = num_samples; i < num_rows; i++) {
+        for (int k = 0; k < chunk_tmp->get_slot_num(); k++) {
           for (auto iter = csr_buffers.begin(); iter != csr_buffers.end(); iter++) {
             iter[0]->new_row();
           }
-          int nnz;
-          in_file_stream_.read(reinterpret_cast<char*>(&nnz), sizeof(int));
-          if (nnz > (int)buffer_length_ || nnz < 0) {
-            ERROR_MESSAGE_("nnz > buffer_length_ | nnz < 0");
-          }
-
-#ifndef NDEBUG
-          if (i == 0)
-            std::cout << "[HCDEBUG]"
-                      << "nnz: " << nnz << std::endl;
-#endif
-
-          in_file_stream_.read(reinterpret_cast<char*>(feature_ids_), sizeof(T) * nnz);
-          for (int j = 0; j < nnz; j++) {
-            int buffer_id =
-                feature_ids_[j] %
-                csr_buffers.size();  // We suppose that the module parallel mode is like this
-            T local_id = feature_ids_[j];
-            assert(buffer_id < csr_buffers.size());
-            csr_buffers[buffer_id]->push_back(local_id);
-#ifndef NDEBUG
-            if (i == 0)
-              std::cout << "[HCDEBUG]"
-                        << "feature_ids:" << feature_ids_[j] << " local_id: " << local_id
-                        << std::endl;
-#endif
-          }
         }
-        current_record_index_++;
-        // start a new file when finish one file read
-        if (current_record_index_ >= data_set_header_.number_of_records) {
-          in_file_stream_.close();
-          std::string file_name = file_list_.get_a_file();
-          current_record_index_ = 0;
-          in_file_stream_.open(file_name, std::ifstream::binary);
-          if (!in_file_stream_.is_open()) {
-            CK_THROW_(Error_t::FileCannotOpen, "in_file_stream_.is_open() fail: " + file_name);
-          }
-#ifndef NDEBUG
-          std::cout << file_name << std::endl;
-          std::cout << "number_of_records:" << data_set_header_.number_of_records
-                    << ", label_dim:" << data_set_header_.label_dim << std::endl;
-#endif
-          in_file_stream_.read(reinterpret_cast<char*>(&data_set_header_), sizeof(DataSetHeader));
-          if (data_set_header_.number_of_records <= 0)
-            CK_THROW_(Error_t::WrongInput, "number_of_records <= 0");
+        float* label_buffer = label_buffers[i / batchsize_per_buffer];
+        std::fill_n(label_buffer + (i % batchsize_per_buffer) * label_dim, label_dim, 0.f);
+        if (dense_dim > 0) {
+          float* dense_buffer = chunk_tmp->get_dense_buffers()[i / batchsize_per_buffer];
+          std::fill_n(dense_buffer + (i % batchsize_per_buffer) * dense_dim, dense_dim, 0.f);
         }
       }
+      chunk_tmp->set_num_samples(num_samples);
+      if (num_samples == 0) {
+        end_of_epoch_ = true;
+        next_epoch_ = file_list_.get_epoch() + 1;
+      }
       for (auto iter = csr_buffers.begin(); iter != csr_buffers.end(); iter++) {
         iter[0]->new_row();
       }
+      chunk_tmp->compute_unique_keys(&key_dedup_);
+      if (shuffle_buffer_size_ > 0) {
+        add_taken_records_();
+      } else if (is_file_open_()) {
+        progress_.push_back(
+            {current_sequence_, current_record_index_, false, range_->get_begin()});
+      }
+      chunk_tmp->set_progress(progress_);
+      progress_.clear();
       delete[] label;
+      bytes_read_ += pending_bytes_;
+      pending_bytes_ = 0;
+      records_decoded_ += num_samples;
+      busy_time_us_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start_time)
+                           .count();
     }
     csr_heap_.chunk_write_and_checkin(key);
   } catch (const std::runtime_error& rt_err) {
@@ -0,0 +1,804 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "HugeCTR/include/block_codec.hpp"
+#include "HugeCTR/include/common.hpp"
+
+namespace HugeCTR {
+
+/**
+ * Versions of the data file.
+ * DataSetHeader::reserved is used as a version / flags word:
+ * bits 0-15 are the version and bits 16-63 are flags. reserved == 0 means v1.
+ * Bits 8-15 of the flags are the codec of the blocks of a v2 file (see block_codec.hpp),
+ * bits 16-31 are dense_dim, the number of dense features of a sample.
+ * @verbatim
+ * v1: header | sample 0 | sample 1 | ...
+ *     sample:      int label[label_dim] | float dense[dense_dim] | slot 0 | slot 1 | ...
+ *     slot:        int nnz | T key[nnz]
+ * v2: header | block 0 | block 1 | ... | block index | footer
+ *     block:       samples in the v1 encoding, records_per_block samples but the last one
+ *     compressed:  DataSetCompressedBlockHeader | the samples of the block compressed
+ *     block index: DataSetBlock[number_of_blocks] | long long nnz[number_of_blocks][slot_num]
+ *     footer:      DataSetFooter, the last 32 bytes of the file
+ * @endverbatim
+ * The samples of an uncompressed v2 file are contiguous after the header, so v2 files can
+ * be read sequentially like v1, and the index is only needed for random access. The blocks
+ * of a compressed file are read one by one and decompressed by the reader.
+ */
+const long long DATA_SET_V1 = 1;
+const long long DATA_SET_V2 = 2;
+const long long DATA_SET_VERSION_MASK = 0xffff;
+const int DATA_SET_CODEC_SHIFT = 8; /**< the codec is in bits 8-15 of the flags */
+const long long DATA_SET_CODEC_MASK = 0xff;
+const int DATA_SET_DENSE_DIM_SHIFT = 16; /**< dense_dim is in bits 16-31 of the flags */
+const long long DATA_SET_DENSE_DIM_MASK = 0xffff;
+const long long DATA_SET_FOOTER_MAGIC = 0x32584449434748LL; /**< "HGCIDX2" */
+const long long DATA_SET_DEFAULT_RECORDS_PER_BLOCK = 8192;
+const long long RECORD_INDEX_MAGIC = 0x31584449434748LL; /**< "HGCIDX1" */
+const long long RECORD_INDEX_DEFAULT_STRIDE = 1024;
+
+/**
+ * Get the version of a data file from its header.
+ */
+inline long long get_data_set_version(const DataSetHeader& header) {
+  long long version = header.reserved & DATA_SET_VERSION_MASK;
+  return version == 0 ? DATA_SET_V1 : version;
+}
+
+/**
+ * Get the flags of a data file from its header.
+ */
+inline long long get_data_set_flags(const DataSetHeader& header) { return header.reserved >> 16; }
+
+/**
+ * Compose the reserved field of DataSetHeader.
+ */
+inline long long make_data_set_reserved(long long version, long long flags = 0) {
+  return (flags << 16) | (version & DATA_SET_VERSION_MASK);
+}
+
+/**
+ * Get the codec of the blocks of a data file from its header, DATA_SET_CODEC_NONE if the
+ * file isn't compressed.
+ */
+inline int get_data_set_codec(const DataSetHeader& header) {
+  return static_cast<int>((get_data_set_flags(header) >> DATA_SET_CODEC_SHIFT) &
+                          DATA_SET_CODEC_MASK);
+}
+
+/**
+ * Get the number of dense features of a sample from the header of a data file.
+ */
+inline int get_data_set_dense_dim(const DataSetHeader& header) {
+  return static_cast<int>((get_data_set_flags(header) >> DATA_SET_DENSE_DIM_SHIFT) &
+                          DATA_SET_DENSE_DIM_MASK);
+}
+
+/**
+ * Size in bytes of the label and the dense features of a sample, which precede its slots.
+ */
+inline size_t get_data_set_dense_offset(const DataSetHeader& header) {
+  return sizeof(int) * header.label_dim + sizeof(float) * get_data_set_dense_dim(header);
+}
+
+/**
+ * Check whether the data file can be read by this version of HugeCTR.
+ */
+inline void check_data_set_version(const DataSetHeader& header, const std::string& file_name) {
+  long long version = get_data_set_version(header);
+  if (version != DATA_SET_V1 && version != DATA_SET_V2) {
+    CK_THROW_(Error_t::UnSupportedFormat,
+              "unsupported data file version " + std::to_string(version) + ": " + file_name);
+  }
+  int codec = get_data_set_codec(header);
+  if (codec != DATA_SET_CODEC_NONE && version != DATA_SET_V2) {
+    CK_THROW_(Error_t::UnSupportedFormat, "compressed data file isn't v2: " + file_name);
+  }
+  if (!is_codec_available(codec)) {
+    CK_THROW_(Error_t::UnSupportedFormat, "HugeCTR is built without the codec (" +
+                                              std::to_string(codec) + ") of " + file_name);
+  }
+}
+
+typedef struct DataSetBlock_ {
+  long long offset;             // offset of the block in the file
+  long long size;               // size of the block in the file in bytes
+  long long number_of_records;  // the number of samples in this block
+} DataSetBlock;
+
+typedef struct DataSetCompressedBlockHeader_ {
+  long long compressed_size;    // size of the compressed samples after this header
+  long long uncompressed_size;  // size of the samples of this block in the v1 encoding
+} DataSetCompressedBlockHeader;
+
+typedef struct DataSetFooter_ {
+  long long number_of_blocks;
+  long long records_per_block;  // the number of samples in each block but the last one
+  long long index_offset;       // offset of the block index in the file
+  long long magic;              // DATA_SET_FOOTER_MAGIC
+} DataSetFooter;
+
+/**
+ * @brief The block index of a v2 data file.
+ *
+ * It tells where each block starts, how many records it has and the total nnz of each
+ * slot in it, so that the blocks of a file can be read independently and the buffers
+ * for a block can be allocated with the exact size.
+ */
+class DataSetIndex {
+ private:
+  DataSetHeader header_;
+  DataSetFooter footer_;
+  std::vector<DataSetBlock> blocks_;
+  std::vector<long long> block_nnz_; /**< nnz[number_of_blocks][slot_num] */
+
+ public:
+  /**
+   * Ctor. Load the index of a v2 data file.
+   * @param file_name the data file.
+   */
+  DataSetIndex(const std::string& file_name) {
+    std::ifstream in_stream(file_name, std::ifstream::binary);
+    if (!in_stream.is_open()) {
+      CK_THROW_(Error_t::FileCannotOpen, "in_stream.is_open() failed: " + file_name);
+    }
+    in_stream.read(reinterpret_cast<char*>(&header_), sizeof(DataSetHeader));
+    if (!in_stream || get_data_set_version(header_) != DATA_SET_V2) {
+      CK_THROW_(Error_t::UnSupportedFormat, "not a v2 data file: " + file_name);
+    }
+    in_stream.seekg(-static_cast<long long>(sizeof(DataSetFooter)), std::ios_base::end);
+    in_stream.read(reinterpret_cast<char*>(&footer_), sizeof(DataSetFooter));
+    if (!in_stream || footer_.magic != DATA_SET_FOOTER_MAGIC || footer_.number_of_blocks < 0) {
+      CK_THROW_(Error_t::UnSupportedFormat, "broken footer of data file: " + file_name);
+    }
+    blocks_.resize(footer_.number_of_blocks);
+    block_nnz_.resize(footer_.number_of_blocks * header_.slot_num);
+    in_stream.seekg(footer_.index_offset, std::ios_base::beg);
+    in_stream.read(reinterpret_cast<char*>(blocks_.data()), blocks_.size() * sizeof(DataSetBlock));
+    in_stream.read(reinterpret_cast<char*>(block_nnz_.data()),
+                   block_nnz_.size() * sizeof(long long));
+    if (!in_stream) {
+      CK_THROW_(Error_t::UnSupportedFormat, "broken block index of data file: " + file_name);
+    }
+  }
+
+  const DataSetHeader& get_header() const { return header_; }
+  long long get_records_per_block() const { return footer_.records_per_block; }
+  int get_num_blocks() const { return static_cast<int>(blocks_.size()); }
+  const DataSetBlock& get_block(int block_id) const { return blocks_[block_id]; }
+
+  /**
+   * Total nnz of a slot in a block.
+   */
+  long long get_block_nnz(int block_id, int slot_id) const {
+    return block_nnz_[block_id * header_.slot_num + slot_id];
+  }
+
+  /**
+   * Total nnz of all the slots in a block.
+   */
+  long long get_block_nnz(int block_id) const {
+    long long nnz = 0;
+    for (int k = 0; k < header_.slot_num; k++) {
+      nnz += get_block_nnz(block_id, k);
+    }
+    return nnz;
+  }
+
+  /**
+   * The largest get_block_nnz(block_id) of all the blocks.
+   */
+  long long get_max_block_nnz() const {
+    long long max_nnz = 0;
+    for (int i = 0; i < get_num_blocks(); i++) {
+      max_nnz = std::max(max_nnz, get_block_nnz(i));
+    }
+    return max_nnz;
+  }
+
+  /**
+   * Get the block which has the record.
+   */
+  int find_block(long long record_id) const {
+    return static_cast<int>(record_id / footer_.records_per_block);
+  }
+};
+
+/**
+ * The name of the sidecar record index of a data file.
+ */
+inline std::string get_record_index_file_name(const std::string& data_file_name) {
+  return data_file_name + ".idx";
+}
+
+typedef struct RecordIndexHeader_ {
+  long long magic;              // RECORD_INDEX_MAGIC
+  long long number_of_records;  // the number of records of the data file
+  long long stride;             // an offset is kept for every stride records
+  long long data_file_size;     // size of the data file, to detect a stale index
+} RecordIndexHeader;
+
+/**
+ * @brief The sidecar record index of a data file (<data file>.idx).
+ *
+ * It keeps the offset of every stride-th record, so that a reader can seek to a record
+ * of a v1 data file without decoding the records before it (v2 data files have the
+ * block index for that, see find_record_offset()).
+ * @verbatim
+ * RecordIndexHeader | long long offset[(number_of_records + stride - 1) / stride]
+ * @endverbatim
+ */
+class RecordIndex {
+ private:
+  RecordIndexHeader header_;
+  std::vector<long long> offsets_;
+
+ public:
+  /**
+   * Ctor. Load the index of a data file.
+   * @param data_file_name the data file, whose index is get_record_index_file_name().
+   */
+  RecordIndex(const std::string& data_file_name) {
+    std::string index_file_name = get_record_index_file_name(data_file_name);
+    std::ifstream in_stream(index_file_name, std::ifstream::binary);
+    if (!in_stream.is_open()) {
+      CK_THROW_(Error_t::FileCannotOpen, "in_stream.is_open() failed: " + index_file_name);
+    }
+    in_stream.read(reinterpret_cast<char*>(&header_), sizeof(RecordIndexHeader));
+    if (!in_stream || header_.magic != RECORD_INDEX_MAGIC || header_.stride <= 0 ||
+        header_.number_of_records < 0) {
+      CK_THROW_(Error_t::UnSupportedFormat, "broken record index: " + index_file_name);
+    }
+    offsets_.resize((header_.number_of_records + header_.stride - 1) / header_.stride);
+    in_stream.read(reinterpret_cast<char*>(offsets_.data()), offsets_.size() * sizeof(long long));
+    if (!in_stream) {
+      CK_THROW_(Error_t::UnSupportedFormat, "broken record index: " + index_file_name);
+    }
+  }
+
+  const RecordIndexHeader& get_header() const { return header_; }
+
+  /**
+   * Get where to start reading a record.
+   * @param record_id the record.
+   * @param offset the offset of the nearest indexed record before it is passed out.
+   * @param records_to_skip the number of records between that one and record_id.
+   */
+  void find(long long record_id, long long* offset, long long* records_to_skip) const {
+    if (record_id < 0 || record_id >= header_.number_of_records) {
+      CK_THROW_(Error_t::OutOfBound, "record_id out of range: " + std::to_string(record_id));
+    }
+    *offset = offsets_[record_id / header_.stride];
+    *records_to_skip = record_id % header_.stride;
+  }
+};
+
+/**
+ * Write the sidecar record index (get_record_index_file_name()) of a data file.
+ * @param data_file_name the data file (v1 or v2).
+ * @param stride an offset is kept for every stride records.
+ * @return the number of records indexed.
+ */
+template <typename T>
+long long build_record_index(const std::string& data_file_name,
+                             long long stride = RECORD_INDEX_DEFAULT_STRIDE) {
+  if (stride <= 0) {
+    CK_THROW_(Error_t::WrongInput, "stride <= 0");
+  }
+  std::ifstream in_stream(data_file_name, std::ifstream::binary);
+  if (!in_stream.is_open()) {
+    CK_THROW_(Error_t::FileCannotOpen, "in_stream.is_open() failed: " + data_file_name);
+  }
+  in_stream.seekg(0, std::ios_base::end);
+  long long data_file_size = in_stream.tellg();
+  in_stream.seekg(0, std::ios_base::beg);
+  DataSetHeader header;
+  in_stream.read(reinterpret_cast<char*>(&header), sizeof(DataSetHeader));
+  if (!in_stream) {
+    CK_THROW_(Error_t::WrongInput, "data file is truncated: " + data_file_name);
+  }
+  check_data_set_version(header, data_file_name);
+  if (get_data_set_codec(header) != DATA_SET_CODEC_NONE) {
+    CK_THROW_(Error_t::WrongInput, "compressed data file has a block index: " + data_file_name);
+  }
+  std::vector<long long> offsets;
+  offsets.reserve((header.number_of_records + stride - 1) / stride);
+  long long offset = sizeof(DataSetHeader);
+  for (long long i = 0; i < header.number_of_records; i++) {
+    if (i % stride == 0) {
+      offsets.push_back(offset);
+    }
+    // only the nnz of the slots are decoded, the labels, dense features and keys are skipped
+    in_stream.ignore(get_data_set_dense_offset(header));
+    offset += get_data_set_dense_offset(header);
+    for (int k = 0; k < header.slot_num; k++) {
+      int nnz = 0;
+      in_stream.read(reinterpret_cast<char*>(&nnz), sizeof(int));
+      if (!in_stream || nnz < 0) {
+        CK_THROW_(Error_t::WrongInput, "broken data file: " + data_file_name);
+      }
+      in_stream.ignore(sizeof(T) * nnz);
+      offset += sizeof(int) + sizeof(T) * nnz;
+    }
+  }
+  if (!in_stream || offset > data_file_size) {
+    CK_THROW_(Error_t::WrongInput, "data file is truncated: " + data_file_name);
+  }
+  std::string index_file_name = get_record_index_file_name(data_file_name);
+  std::ofstream out_stream(index_file_name, std::ofstream::binary);
+  if (!out_stream.is_open()) {
+    CK_THROW_(Error_t::FileCannotOpen, "out_stream.is_open() failed: " + index_file_name);
+  }
+  RecordIndexHeader index_header = {RECORD_INDEX_MAGIC, header.number_of_records, stride,
+                                    data_file_size};
+  out_stream.write(reinterpret_cast<const char*>(&index_header), sizeof(RecordIndexHeader));
+  out_stream.write(reinterpret_cast<const char*>(offsets.data()),
+                   offsets.size() * sizeof(long long));
+  if (!out_stream) {
+    CK_THROW_(Error_t::UnspecificError, "failed to write " + index_file_name);
+  }
+  return header.number_of_records;
+}
+
+/**
+ * Whether a data file has a sidecar record index which matches it.
+ * A stale index (the data file is rewritten after it) is reported and ignored.
+ */
+inline bool has_valid_record_index(const std::string& data_file_name,
+                                   const DataSetHeader& header) {
+  std::ifstream index_stream(get_record_index_file_name(data_file_name), std::ifstream::binary);
+  if (!index_stream.is_open()) {
+    return false;
+  }
+  index_stream.close();
+  std::ifstream data_stream(data_file_name, std::ifstream::binary | std::ifstream::ate);
+  RecordIndex index(data_file_name);
+  if (index.get_header().number_of_records != header.number_of_records ||
+      index.get_header().data_file_size != static_cast<long long>(data_stream.tellg())) {
+    std::cerr << "stale record index is ignored: "
+              << get_record_index_file_name(data_file_name) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Get where to start reading a record of a data file, with the block index of v2 or the
+ * sidecar record index of v1. Without an index (or with a stale one) the records are
+ * counted from the first one.
+ * @param data_file_name the data file.
+ * @param header the header of the data file.
+ * @param record_id the record.
+ * @param offset the offset of a record before it is passed out.
+ * @param records_to_skip the number of records to skip from that one.
+ */
+inline void find_record_offset(const std::string& data_file_name, const DataSetHeader& header,
+                               long long record_id, long long* offset,
+                               long long* records_to_skip) {
+  if (record_id < 0 || record_id >= header.number_of_records) {
+    CK_THROW_(Error_t::OutOfBound, "record_id out of range: " + std::to_string(record_id));
+  }
+  *offset = sizeof(DataSetHeader);
+  *records_to_skip = record_id;
+  if (get_data_set_version(header) == DATA_SET_V2) {
+    DataSetIndex index(data_file_name);
+    int block_id = index.find_block(record_id);
+    *offset = index.get_block(block_id).offset;
+    *records_to_skip = record_id - block_id * index.get_records_per_block();
+    return;
+  }
+  if (!has_valid_record_index(data_file_name, header)) {
+    return;
+  }
+  RecordIndex index(data_file_name);
+  index.find(record_id, offset, records_to_skip);
+}
+
+/**
+ * The distance of the records of a data file a reader can seek to without decoding the
+ * records before them (see find_record_offset()).
+ * @return the records per block of v2, the stride of the record index of v1, or 0 if the
+ *         v1 file has no (valid) record index.
+ */
+inline long long get_record_stride(const std::string& data_file_name, const DataSetHeader& header) {
+  if (get_data_set_version(header) == DATA_SET_V2) {
+    return DataSetIndex(data_file_name).get_records_per_block();
+  }
+  if (!has_valid_record_index(data_file_name, header)) {
+    return 0;
+  }
+  return RecordIndex(data_file_name).get_header().stride;
+}
+
+/**
+ * @brief Sequential reader of the samples of a data file (v1, v2 or compressed).
+ *
+ * For the tools which scan data files on the host, the training reads the files with
+ * DataReaderMultiThreads.
+ */
+template <typename T>
+class DataSetRecordReader {
+ private:
+  std::ifstream in_stream_;
+  const std::string file_name_;
+  DataSetHeader header_;
+  int codec_;
+  long long record_{0};  /**< the number of samples read */
+  std::vector<char> block_; /**< current block decompressed */
+  size_t block_pos_{0};     /**< next byte to decode in block_ */
+  std::vector<char> compressed_block_;
+  std::vector<int> label_;
+  std::vector<float> dense_;
+  std::vector<int> nnz_;
+  std::vector<T> keys_;
+
+  void read_(void* dst, size_t length) {
+    if (codec_ == DATA_SET_CODEC_NONE) {
+      in_stream_.read(reinterpret_cast<char*>(dst), length);
+      if (!in_stream_) {
+        CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name_);
+      }
+      return;
+    }
+    if (block_pos_ == block_.size() && length > 0) {
+      DataSetCompressedBlockHeader block_header;
+      in_stream_.read(reinterpret_cast<char*>(&block_header),
+                      sizeof(DataSetCompressedBlockHeader));
+      if (!in_stream_ || block_header.compressed_size <= 0 ||
+          block_header.uncompressed_size <= 0) {
+        CK_THROW_(Error_t::WrongInput, "broken compressed block: " + file_name_);
+      }
+      compressed_block_.resize(block_header.compressed_size);
+      in_stream_.read(compressed_block_.data(), compressed_block_.size());
+      if (!in_stream_) {
+        CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name_);
+      }
+      block_.resize(block_header.uncompressed_size);
+      decompress_block(codec_, compressed_block_.data(), compressed_block_.size(), block_.data(),
+                       block_.size());
+      block_pos_ = 0;
+    }
+    if (length > block_.size() - block_pos_) {
+      CK_THROW_(Error_t::WrongInput, "broken compressed block: " + file_name_);
+    }
+    memcpy(dst, block_.data() + block_pos_, length);
+    block_pos_ += length;
+  }
+
+ public:
+  /**
+   * Ctor. Open a data file and read its header.
+   */
+  DataSetRecordReader(const std::string& file_name)
+      : in_stream_(file_name, std::ifstream::binary), file_name_(file_name) {
+    if (!in_stream_.is_open()) {
+      CK_THROW_(Error_t::FileCannotOpen, "in_stream_.is_open() failed: " + file_name);
+    }
+    in_stream_.read(reinterpret_cast<char*>(&header_), sizeof(DataSetHeader));
+    if (!in_stream_) {
+      CK_THROW_(Error_t::WrongInput, "data file is truncated: " + file_name);
+    }
+    check_data_set_version(header_, file_name);
+    if (header_.label_dim <= 0 || header_.slot_num <= 0) {
+      CK_THROW_(Error_t::WrongInput, "label_dim <= 0 || slot_num <= 0: " + file_name);
+    }
+    codec_ = get_data_set_codec(header_);
+    label_.resize(header_.label_dim);
+    dense_.resize(get_data_set_dense_dim(header_));
+    nnz_.resize(header_.slot_num);
+  }
+  DataSetRecordReader(const DataSetRecordReader&) = delete;
+  DataSetRecordReader& operator=(const DataSetRecordReader&) = delete;
+
+  const DataSetHeader& get_header() const { return header_; }
+
+  /**
+   * Read the next sample.
+   * @return false if all the samples are read.
+   */
+  bool next() {
+    if (record_ >= header_.number_of_records) {
+      return false;
+    }
+    read_(label_.data(), sizeof(int) * header_.label_dim);
+    read_(dense_.data(), sizeof(float) * dense_.size());
+    keys_.clear();
+    for (int k = 0; k < header_.slot_num; k++) {
+      read_(&nnz_[k], sizeof(int));
+      if (nnz_[k] < 0) {
+        CK_THROW_(Error_t::WrongInput, "broken data file: " + file_name_);
+      }
+      size_t offset = keys_.size();
+      keys_.resize(offset + nnz_[k]);
+      read_(keys_.data() + offset, sizeof(T) * nnz_[k]);
+    }
+    record_++;
+    return true;
+  }
+
+  /** label[label_dim] of the current sample */
+  const int* get_label() const { return label_.data(); }
+  /** dense[dense_dim] of the current sample */
+  const float* get_dense() const { return dense_.data(); }
+  /** nnz[slot_num] of the current sample */
+  const int* get_nnz() const { return nnz_.data(); }
+  /** the keys of all the slots of the current sample */
+  const T* get_keys() const { return keys_.data(); }
+};
+
+/**
+ * @brief Writer of a data file.
+ *
+ * Samples are written one by one with write_record(), and the header (and the index for
+ * v2) is finalized in close(). The samples of a compressed file are buffered until their
+ * block is full, then the block is compressed and written.
+ */
+template <typename T>
+class DataSetWriter {
+ private:
+  std::ofstream out_stream_;
+  DataSetHeader header_;
+  const long long records_per_block_;
+  const int codec_;
+  const int level_;
+  std::vector<DataSetBlock> blocks_;
+  std::vector<long long> block_nnz_;
+  long long offset_; /**< current offset in the file */
+  std::vector<char> record_buffer_;
+  std::vector<char> block_buffer_;      /**< the samples of current block (compressed only) */
+  std::vector<char> compressed_buffer_; /**< current block compressed */
+
+  bool is_v2_() const { return get_data_set_version(header_) == DATA_SET_V2; }
+
+  void write_compressed_block_() {
+    if (block_buffer_.empty()) {
+      return;
+    }
+    compress_block(codec_, level_, block_buffer_.data(), block_buffer_.size(),
+                   &compressed_buffer_);
+    DataSetCompressedBlockHeader block_header = {
+        static_cast<long long>(compressed_buffer_.size()),
+        static_cast<long long>(block_buffer_.size())};
+    out_stream_.write(reinterpret_cast<const char*>(&block_header),
+                      sizeof(DataSetCompressedBlockHeader));
+    out_stream_.write(compressed_buffer_.data(), compressed_buffer_.size());
+    long long size = sizeof(DataSetCompressedBlockHeader) + compressed_buffer_.size();
+    blocks_.back().size = size;
+    offset_ += size;
+    block_buffer_.clear();
+  }
+
+ public:
+  /**
+   * Ctor.
+   * @param file_name the output data file.
+   * @param label_dim dimension of label.
+   * @param slot_num slot num.
+   * @param version DATA_SET_V1 or DATA_SET_V2.
+   * @param records_per_block the number of samples in a block (v2 only).
+   * @param codec the codec to compress the blocks with (v2 only).
+   * @param level the compression level of the codec.
+   * @param dense_dim the number of dense features of a sample.
+   */
+  DataSetWriter(const std::string& file_name, int label_dim, int slot_num,
+                long long version = DATA_SET_V2,
+                long long records_per_block = DATA_SET_DEFAULT_RECORDS_PER_BLOCK,
+                int codec = DATA_SET_CODEC_NONE, int level = 1, int dense_dim = 0)
+      : out_stream_(file_name, std::ofstream::binary),
+        header_({0, label_dim, slot_num,
+                 make_data_set_reserved(
+                     version,
+                     (static_cast<long long>(codec) << DATA_SET_CODEC_SHIFT) |
+                         (static_cast<long long>(dense_dim) << DATA_SET_DENSE_DIM_SHIFT))}),
+        records_per_block_(records_per_block),
+        codec_(codec),
+        level_(level),
+        offset_(sizeof(DataSetHeader)) {
+    if (!out_stream_.is_open()) {
+      CK_THROW_(Error_t::FileCannotOpen, "out_stream_.is_open() failed: " + file_name);
+    }
+    if (label_dim <= 0 || slot_num <= 0 || records_per_block <= 0) {
+      CK_THROW_(Error_t::WrongInput, "label_dim <= 0 || slot_num <= 0 || records_per_block <= 0");
+    }
+    if (dense_dim < 0 || dense_dim > DATA_SET_DENSE_DIM_MASK) {
+      CK_THROW_(Error_t::WrongInput, "dense_dim < 0 || dense_dim > 65535");
+    }
+    if (version != DATA_SET_V1 && version != DATA_SET_V2) {
+      CK_THROW_(Error_t::WrongInput, "version is neither DATA_SET_V1 nor DATA_SET_V2");
+    }
+    if (codec != DATA_SET_CODEC_NONE && version != DATA_SET_V2) {
+      CK_THROW_(Error_t::WrongInput, "only v2 data files can be compressed");
+    }
+    if (!is_codec_available(codec)) {
+      CK_THROW_(Error_t::WrongInput,
+                std::string("codec is not available: ") + get_codec_name(codec));
+    }
+    if (version == DATA_SET_V1 && dense_dim == 0) {
+      // a v1 file without flags is written like the files before versioning
+      header_.reserved = 0;
+    }
+    out_stream_.write(reinterpret_cast<char*>(&header_), sizeof(DataSetHeader));
+  }
+  DataSetWriter(const DataSetWriter&) = delete;
+  DataSetWriter& operator=(const DataSetWriter&) = delete;
+
+  /**
+   * Write a sample.
+   * @param label label[label_dim].
+   * @param nnz nnz[slot_num], the number of keys of each slot.
+   * @param keys the keys of all the slots.
+   * @param dense dense[dense_dim], can be nullptr if dense_dim is 0.
+   */
+  void write_record(const int* label, const int* nnz, const T* keys,
+                    const float* dense = nullptr) {
+    if (!out_stream_.is_open()) {
+      CK_THROW_(Error_t::IllegalCall, "the writer is closed");
+    }
+    const int dense_dim = get_data_set_dense_dim(header_);
+    if (dense_dim > 0 && dense == nullptr) {
+      CK_THROW_(Error_t::WrongInput, "dense == nullptr");
+    }
+    if (is_v2_() && header_.number_of_records % records_per_block_ == 0) {
+      blocks_.push_back({offset_, 0, 0});
+      block_nnz_.resize(block_nnz_.size() + header_.slot_num, 0);
+    }
+    long long total_nnz = 0;
+    for (int k = 0; k < header_.slot_num; k++) {
+      total_nnz += nnz[k];
+    }
+    size_t record_size = get_data_set_dense_offset(header_) + sizeof(int) * header_.slot_num +
+                         sizeof(T) * total_nnz;
+    record_buffer_.resize(record_size);
+    char* ptr = record_buffer_.data();
+    memcpy(ptr, label, sizeof(int) * header_.label_dim);
+    ptr += sizeof(int) * header_.label_dim;
+    if (dense_dim > 0) {
+      memcpy(ptr, dense, sizeof(float) * dense_dim);
+      ptr += sizeof(float) * dense_dim;
+    }
+    for (int k = 0; k < header_.slot_num; k++) {
+      memcpy(ptr, &nnz[k], sizeof(int));
+      ptr += sizeof(int);
+      memcpy(ptr, keys, sizeof(T) * nnz[k]);
+      ptr += sizeof(T) * nnz[k];
+      keys += nnz[k];
+    }
+    header_.number_of_records++;
+    if (codec_ != DATA_SET_CODEC_NONE) {
+      block_buffer_.insert(block_buffer_.end(), record_buffer_.begin(), record_buffer_.end());
+    } else {
+      out_stream_.write(record_buffer_.data(), record_size);
+      offset_ += record_size;
+    }
+    if (is_v2_()) {
+      DataSetBlock& block = blocks_.back();
+      block.size += record_size;
+      block.number_of_records++;
+      long long* slot_nnz = &block_nnz_[block_nnz_.size() - header_.slot_num];
+      for (int k = 0; k < header_.slot_num; k++) {
+        slot_nnz[k] += nnz[k];
+      }
+      if (codec_ != DATA_SET_CODEC_NONE && block.number_of_records == records_per_block_) {
+        write_compressed_block_();
+      }
+    }
+  }
+
+  /**
+   * The number of samples written.
+   */
+  long long get_number_of_records() const { return header_.number_of_records; }
+
+  /**
+   * Write the index and footer (v2) and finalize the header.
+   */
+  void close() {
+    if (!out_stream_.is_open()) {
+      return;
+    }
+    if (codec_ != DATA_SET_CODEC_NONE) {
+      write_compressed_block_();
+    }
+    if (is_v2_()) {
+      DataSetFooter footer = {static_cast<long long>(blocks_.size()), records_per_block_, offset_,
+                              DATA_SET_FOOTER_MAGIC};
+      out_stream_.write(reinterpret_cast<const char*>(blocks_.data()),
+                        blocks_.size() * sizeof(DataSetBlock));
+      out_stream_.write(reinterpret_cast<const char*>(block_nnz_.data()),
+                        block_nnz_.size() * sizeof(long long));
+      out_stream_.write(reinterpret_cast<const char*>(&footer), sizeof(DataSetFooter));
+    }
+    out_stream_.seekp(0, std::ios_base::beg);
+    out_stream_.write(reinterpret_cast<const char*>(&header_), sizeof(DataSetHeader));
+    out_stream_.close();
+  }
+
+  /**
+   * Dtor
+   */
+  ~DataSetWriter() {
+    try {
+      close();
+    } catch (const std::runtime_error& rt_err) {
+      std::cerr << rt_err.what() << std::endl;
+    }
+  }
+};
+
+/**
+ * Convert a data file to v2.
+ * @param in_file_name the input data file (v1 or uncompressed v2).
+ * @param out_file_name the output data file.
+ * @param records_per_block the number of samples in a block.
+ * @param codec the codec to compress the blocks with.
+ * @param level the compression level of the codec.
+ * @return the number of samples converted.
+ */
+template <typename T>
+long long convert_data_set_to_v2(const std::string& in_file_name, const std::string& out_file_name,
+                                 long long records_per_block = DATA_SET_DEFAULT_RECORDS_PER_BLOCK,
+                                 int codec = DATA_SET_CODEC_NONE, int level = 1) {
+  std::ifstream in_stream(in_file_name, std::ifstream::binary);
+  if (!in_stream.is_open()) {
+    CK_THROW_(Error_t::FileCannotOpen, "in_stream.is_open() failed: " + in_file_name);
+  }
+  DataSetHeader header;
+  in_stream.read(reinterpret_cast<char*>(&header), sizeof(DataSetHeader));
+  if (!in_stream) {
+    CK_THROW_(Error_t::WrongInput, "data file is truncated: " + in_file_name);
+  }
+  check_data_set_version(header, in_file_name);
+  if (get_data_set_codec(header) != DATA_SET_CODEC_NONE) {
+    CK_THROW_(Error_t::WrongInput, "data file is compressed already: " + in_file_name);
+  }
+  const int dense_dim = get_data_set_dense_dim(header);
+  DataSetWriter<T> writer(out_file_name, header.label_dim, header.slot_num, DATA_SET_V2,
+                          records_per_block, codec, level, dense_dim);
+  std::vector<int> label(header.label_dim);
+  std::vector<float> dense(dense_dim);
+  std::vector<int> nnz(header.slot_num);
+  std::vector<T> keys;
+  for (long long i = 0; i < header.number_of_records; i++) {
+    in_stream.read(reinterpret_cast<char*>(label.data()), sizeof(int) * header.label_dim);
+    in_stream.read(reinterpret_cast<char*>(dense.data()), sizeof(float) * dense_dim);
+    keys.clear();
+    for (int k = 0; k < header.slot_num; k++) {
+      in_stream.read(reinterpret_cast<char*>(&nnz[k]), sizeof(int));
+      if (!in_stream || nnz[k] < 0) {
+        CK_THROW_(Error_t::WrongInput, "broken data file: " + in_file_name);
+      }
+      size_t offset = keys.size();
+      keys.resize(offset + nnz[k]);
+      in_stream.read(reinterpret_cast<char*>(keys.data() + offset), sizeof(T) * nnz[k]);
+    }
+    if (!in_stream) {
+      CK_THROW_(Error_t::WrongInput, "data file is truncated: " + in_file_name);
+    }
+    writer.write_record(label.data(), nnz.data(), keys.data(), dense.data());
+  }
+  writer.close();
+  return writer.get_number_of_records();
+}
+
+}  // namespace HugeCTR
@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "HugeCTR/include/common.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
+
+namespace HugeCTR {
+
+/**
+ * The finalizer of MurmurHash3 (fmix64), a 64-bit hash of a key good enough for sketching.
+ */
+inline uint64_t mix_key_hash(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9a64b4efe53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+/**
+ * @brief HyperLogLog estimator of the number of distinct keys.
+ *
+ * 2^precision registers of one byte, the relative standard error of the estimate is
+ * about 1.04 / sqrt(2^precision), 0.8% with the default precision. Sketches of the same
+ * precision are merged by taking the max of each register.
+ */
+class HyperLogLog {
+ private:
+  int precision_;
+  std::vector<uint8_t> registers_;
+
+ public:
+  /**
+   * Ctor.
+   * @param precision the number of bits of the hash used to pick a register, in [4, 18].
+   */
+  HyperLogLog(int precision = 14) : precision_(precision) {
+    if (precision < 4 || precision > 18) {
+      CK_THROW_(Error_t::WrongInput, "precision is not in [4, 18]");
+    }
+    registers_.resize(1 << precision, 0);
+  }
+
+  /**
+   * Add a key by its hash (see mix_key_hash()).
+   */
+  void add(uint64_t hash) {
+    const size_t index = hash >> (64 - precision_);
+    const uint64_t rest = hash << precision_;
+    const int rank = rest == 0 ? 64 - precision_ + 1 : __builtin_clzll(rest) + 1;
+    if (rank > registers_[index]) {
+      registers_[index] = static_cast<uint8_t>(rank);
+    }
+  }
+
+  void merge(const HyperLogLog& other) {
+    if (other.precision_ != precision_) {
+      CK_THROW_(Error_t::WrongInput, "merging HyperLogLog of different precisions");
+    }
+    for (size_t i = 0; i < registers_.size(); i++) {
+      registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+  }
+
+  /**
+   * The estimated number of distinct keys added.
+   */
+  double estimate() const {
+    const double m = static_cast<double>(registers_.size());
+    double sum = 0.0;
+    int zeros = 0;
+    for (uint8_t r : registers_) {
+      sum += std::ldexp(1.0, -r);
+      zeros += r == 0;
+    }
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    const double raw = alpha * m * m / sum;
+    // linear counting is more accurate for small cardinalities
+    if (raw <= 2.5 * m && zeros > 0) {
+      return m * std::log(m / zeros);
+    }
+    return raw;
+  }
+
+  /**
+   * The relative standard error of estimate().
+   */
+  double get_relative_error() const {
+    return 1.04 / std::sqrt(static_cast<double>(registers_.size()));
+  }
+};
+
+/**
+ * Config values suggested by a DataSetProfile, see DataSetProfile::recommend().
+ */
+struct DataSetRecommendation {
+  long long label_dim;
+  long long slot_num;
+  int dense_dim;
+  int max_feature_num_per_sample;
+  long long vocabulary_size;
+  float load_factor;
+};
+
+/**
+ * @brief Statistics of the samples of a data set, for sizing the configuration.
+ *
+ * - the histogram of the nnz of each slot and of the total nnz of a sample;
+ * - the number of distinct keys, of all the slots and of each slot (HyperLogLog);
+ * - the frequencies of a sample of the keys: a key is sampled if its hash is a multiple
+ *   of key_sample_rate, so the keys sampled are the same in every file and thread and
+ *   their counts are exact. The skew of the sampled keys is an estimate of the skew of
+ *   all the keys.
+ * Profiles of the parts of a data set (files, threads) are merged with merge().
+ */
+template <typename T>
+class DataSetProfile {
+ private:
+  long long label_dim_;
+  long long slot_num_;
+  long long key_sample_rate_;
+  int dense_dim_;
+  long long number_of_records_{0};
+  long long number_of_keys_{0};
+  std::vector<std::vector<long long>> slot_nnz_histogram_; /**< [slot][nnz] */
+  std::vector<long long> sample_nnz_histogram_;            /**< [total nnz of a sample] */
+  HyperLogLog keys_;
+  std::vector<HyperLogLog> slot_keys_;
+  std::unordered_map<T, long long> sampled_key_counts_;
+
+  static void add_to_histogram(std::vector<long long>* histogram, size_t value,
+                               long long count = 1) {
+    if (value >= histogram->size()) {
+      histogram->resize(value + 1, 0);
+    }
+    (*histogram)[value] += count;
+  }
+
+  /**
+   * The counts of the sampled keys, the largest first.
+   */
+  std::vector<long long> get_sorted_counts_() const {
+    std::vector<long long> counts;
+    counts.reserve(sampled_key_counts_.size());
+    for (auto& key_count : sampled_key_counts_) {
+      counts.push_back(key_count.second);
+    }
+    std::sort(counts.begin(), counts.end(), std::greater<long long>());
+    return counts;
+  }
+
+ public:
+  /**
+   * Ctor.
+   * @param label_dim dimension of label.
+   * @param slot_num slot num.
+   * @param key_sample_rate one in key_sample_rate keys are counted, 1 to count all the keys.
+   * @param dense_dim the number of dense features of a sample.
+   */
+  DataSetProfile(long long label_dim, long long slot_num, long long key_sample_rate = 1,
+                 int dense_dim = 0)
+      : label_dim_(label_dim),
+        slot_num_(slot_num),
+        key_sample_rate_(key_sample_rate),
+        dense_dim_(dense_dim),
+        slot_nnz_histogram_(slot_num),
+        slot_keys_(slot_num, HyperLogLog(10)) {
+    if (label_dim <= 0 || slot_num <= 0 || key_sample_rate <= 0) {
+      CK_THROW_(Error_t::WrongInput, "label_dim <= 0 || slot_num <= 0 || key_sample_rate <= 0");
+    }
+  }
+
+  /**
+   * Add a sample.
+   * @param nnz nnz[slot_num], the number of keys of each slot.
+   * @param keys the keys of all the slots.
+   */
+  void add_sample(const int* nnz, const T* keys) {
+    long long total_nnz = 0;
+    for (int k = 0; k < slot_num_; k++) {
+      add_to_histogram(&slot_nnz_histogram_[k], nnz[k]);
+      for (int j = 0; j < nnz[k]; j++) {
+        const uint64_t hash = mix_key_hash(static_cast<uint64_t>(keys[j]));
+        keys_.add(hash);
+        slot_keys_[k].add(hash);
+        if (hash % key_sample_rate_ == 0) {
+          sampled_key_counts_[keys[j]]++;
+        }
+      }
+      keys += nnz[k];
+      total_nnz += nnz[k];
+    }
+    add_to_histogram(&sample_nnz_histogram_, total_nnz);
+    number_of_keys_ += total_nnz;
+    number_of_records_++;
+  }
+
+  /**
+   * Add all the samples of a data file.
+   */
+  void add_file(const std::string& file_name) {
+    DataSetRecordReader<T> reader(file_name);
+    if (reader.get_header().label_dim != label_dim_ ||
+        reader.get_header().slot_num != slot_num_ ||
+        get_data_set_dense_dim(reader.get_header()) != dense_dim_) {
+      CK_THROW_(Error_t::WrongInput,
+                "label_dim, slot_num or dense_dim doesn't match: " + file_name);
+    }
+    while (reader.next()) {
+      add_sample(reader.get_nnz(), reader.get_keys());
+    }
+  }
+
+  void merge(const DataSetProfile& other) {
+    if (other.label_dim_ != label_dim_ || other.slot_num_ != slot_num_ ||
+        other.key_sample_rate_ != key_sample_rate_ || other.dense_dim_ != dense_dim_) {
+      CK_THROW_(Error_t::WrongInput, "merging profiles of different data sets");
+    }
+    number_of_records_ += other.number_of_records_;
+    number_of_keys_ += other.number_of_keys_;
+    for (int k = 0; k < slot_num_; k++) {
+      const std::vector<long long>& histogram = other.slot_nnz_histogram_[k];
+      for (size_t nnz = 0; nnz < histogram.size(); nnz++) {
+        add_to_histogram(&slot_nnz_histogram_[k], nnz, histogram[nnz]);
+      }
+      slot_keys_[k].merge(other.slot_keys_[k]);
+    }
+    for (size_t nnz = 0; nnz < other.sample_nnz_histogram_.size(); nnz++) {
+      add_to_histogram(&sample_nnz_histogram_, nnz, other.sample_nnz_histogram_[nnz]);
+    }
+    keys_.merge(other.keys_);
+    for (auto& key_count : other.sampled_key_counts_) {
+      sampled_key_counts_[key_count.first] += key_count.second;
+    }
+  }
+
+  long long get_label_dim() const { return label_dim_; }
+  long long get_slot_num() const { return slot_num_; }
+  long long get_key_sample_rate() const { return key_sample_rate_; }
+  int get_dense_dim() const { return dense_dim_; }
+  long long get_number_of_records() const { return number_of_records_; }
+  long long get_number_of_keys() const { return number_of_keys_; }
+
+  /**
+   * The number of samples of each nnz of a slot, indexed by nnz.
+   */
+  const std::vector<long long>& get_slot_nnz_histogram(int slot_id) const {
+    return slot_nnz_histogram_[slot_id];
+  }
+
+  /**
+   * The number of samples of each total nnz of the slots, indexed by nnz.
+   */
+  const std::vector<long long>& get_sample_nnz_histogram() const {
+    return sample_nnz_histogram_;
+  }
+
+  /**
+   * The largest total nnz of a sample.
+   */
+  long long get_max_sample_nnz() const {
+    return sample_nnz_histogram_.empty() ? 0 : sample_nnz_histogram_.size() - 1;
+  }
+
+  /**
+   * The smallest nnz which the nnz of a fraction of the samples don't exceed.
+   * @param histogram a histogram indexed by nnz.
+   * @param fraction in (0, 1].
+   */
+  static long long get_percentile(const std::vector<long long>& histogram, double fraction) {
+    long long total = 0;
+    for (long long count : histogram) {
+      total += count;
+    }
+    long long seen = 0;
+    for (size_t nnz = 0; nnz < histogram.size(); nnz++) {
+      seen += histogram[nnz];
+      if (seen >= fraction * total) {
+        return nnz;
+      }
+    }
+    return histogram.empty() ? 0 : histogram.size() - 1;
+  }
+
+  /**
+   * The estimated number of distinct keys of all the slots.
+   */
+  double estimate_distinct_keys() const { return keys_.estimate(); }
+
+  /**
+   * The estimated number of distinct keys of a slot, less accurate than of all the slots
+   * (about 3% relative error).
+   */
+  double estimate_distinct_keys(int slot_id) const { return slot_keys_[slot_id].estimate(); }
+
+  /**
+   * The number of distinct keys sampled.
+   */
+  long long get_number_of_sampled_keys() const { return sampled_key_counts_.size(); }
+
+  /**
+   * The share of the occurrences of the sampled keys taken by the most frequent ones.
+   * @param fraction the fraction of the keys, e.g. 0.01 for the top 1%.
+   */
+  double get_top_keys_share(double fraction) const {
+    std::vector<long long> counts = get_sorted_counts_();
+    if (counts.empty()) {
+      return 0.0;
+    }
+    size_t top = std::max<size_t>(1, static_cast<size_t>(std::ceil(fraction * counts.size())));
+    top = std::min(top, counts.size());
+    long long total = 0, top_total = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+      total += counts[i];
+      if (i < top) {
+        top_total += counts[i];
+      }
+    }
+    return static_cast<double>(top_total) / total;
+  }
+
+  /**
+   * The fraction of the sampled keys which occur only once.
+   */
+  double get_singleton_fraction() const {
+    if (sampled_key_counts_.empty()) {
+      return 0.0;
+    }
+    long long singletons = 0;
+    for (auto& key_count : sampled_key_counts_) {
+      singletons += key_count.second == 1;
+    }
+    return static_cast<double>(singletons) / sampled_key_counts_.size();
+  }
+
+  /**
+   * Fit the frequencies of the sampled keys to frequency ~ rank^-s (Zipf), by least squares
+   * in log-log scale over the keys which occur more than once.
+   * @return s, 0 if there are too few keys to fit.
+   */
+  double estimate_zipf_exponent() const {
+    std::vector<long long> counts = get_sorted_counts_();
+    double sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_xy = 0.0;
+    long long n = 0;
+    for (size_t i = 0; i < counts.size() && counts[i] > 1; i++) {
+      const double x = std::log(static_cast<double>(i + 1));
+      const double y = std::log(static_cast<double>(counts[i]));
+      sum_x += x;
+      sum_y += y;
+      sum_xx += x * x;
+      sum_xy += x * y;
+      n++;
+    }
+    const double denominator = n * sum_xx - sum_x * sum_x;
+    if (n < 3 || denominator <= 0.0) {
+      return 0.0;
+    }
+    return -(n * sum_xy - sum_x * sum_y) / denominator;
+  }
+
+  /**
+   * Suggest the config values of the data set.
+   * max_feature_num_per_sample is the largest total nnz of a sample, which also bounds the
+   * nnz of a slot, and vocabulary_size is the number of distinct keys plus three standard
+   * errors of the estimate.
+   * @param load_factor the load factor of the hash table of the embedding.
+   */
+  DataSetRecommendation recommend(float load_factor = 0.75f) const {
+    const double distinct_keys = estimate_distinct_keys();
+    DataSetRecommendation recommendation;
+    recommendation.label_dim = label_dim_;
+    recommendation.slot_num = slot_num_;
+    recommendation.dense_dim = dense_dim_;
+    recommendation.max_feature_num_per_sample =
+        static_cast<int>(std::max(get_max_sample_nnz(), 1LL));
+    recommendation.vocabulary_size = static_cast<long long>(
+        std::ceil(distinct_keys * (1.0 + 3.0 * keys_.get_relative_error())));
+    recommendation.load_factor = load_factor;
+    return recommendation;
+  }
+};
+
+/**
+ * Profile the data files with a few threads, each of which profiles a file at a time.
+ * @param file_names the data files, which have the same label_dim, slot_num and dense_dim.
+ * @param num_threads the number of threads.
+ * @param key_sample_rate see DataSetProfile.
+ */
+template <typename T>
+DataSetProfile<T> profile_data_set(const std::vector<std::string>& file_names, int num_threads,
+                                   long long key_sample_rate = 1) {
+  if (file_names.empty() || num_threads <= 0) {
+    CK_THROW_(Error_t::WrongInput, "file_names.empty() || num_threads <= 0");
+  }
+  DataSetHeader header = DataSetRecordReader<T>(file_names[0]).get_header();
+  std::vector<DataSetProfile<T>> profiles(
+      num_threads, DataSetProfile<T>(header.label_dim, header.slot_num, key_sample_rate,
+                                     get_data_set_dense_dim(header)));
+  std::vector<std::string> errors(num_threads);
+  std::atomic<size_t> next_file{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i]() {
+      try {
+        for (size_t f = next_file++; f < file_names.size(); f = next_file++) {
+          profiles[i].add_file(file_names[f]);
+        }
+      } catch (const std::runtime_error& rt_err) {
+        errors[i] = rt_err.what();
+        next_file = file_names.size();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < num_threads; i++) {
+    if (!errors[i].empty()) {
+      CK_THROW_(Error_t::WrongInput, errors[i]);
+    }
+    if (i > 0) {
+      profiles[0].merge(profiles[i]);
+    }
+  }
+  return profiles[0];
+}
+
+}  // namespace HugeCTR
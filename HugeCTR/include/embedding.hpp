@@ -18,12 +18,68 @@
 #include <nccl.h>
 #include <fstream>
 #include <functional>
+#include <memory>
 #include <vector>
 #include "HugeCTR/include/data_reader.hpp"
 #include "HugeCTR/include/gpu_resource.hpp"
+#include "HugeCTR/include/hashtable/count_min_sketch.hpp"
+#include "HugeCTR/include/key_partitioner.hpp"
 #include "HugeCTR/include/tensor.hpp"
 
 namespace HugeCTR {
+/**
+ * @brief The part of Embedding which doesn't depend on the key type.
+ *
+ * Session holds the embedding by it, as the key type is chosen by the configure file.
+ */
+class IEmbedding {
+ public:
+  virtual ~IEmbedding() {}
+  /**
+   * The forward propagation of embedding layer.
+   */
+  virtual void forward() = 0;
+  /**
+   * The first stage of backward propagation of embedding layer,
+   * which only computes the wgrad by the dgrad from the top layer.
+   */
+  virtual void backward() = 0;
+  /**
+   * The second stage of backward propagation of embedding layer, which
+   * updates the embedding table weights by wgrad(from backward()) and
+   * optimizer.
+   */
+  virtual void update_params() = 0;
+  /**
+   * Read the embedding table from the weight_stream on the host, and
+   * upload it onto multi-GPUs global memory.
+   * @param weight_stream the host file stream for reading data from.
+   */
+  virtual void upload_params_to_device(std::ifstream& weight_stream) = 0;
+  /**
+   * Download the embedding table from multi-GPUs global memroy to CPU memory
+   * and write it to the weight_stream on the host.
+   * @param weight_stream the host file stream for writing data to.
+   */
+  virtual void download_params_to_host(
+      std::ofstream& weight_stream) = 0;  // please refer to file format definition of HugeCTR
+  /**
+   * Get the total size of embedding tables on all GPUs.
+   */
+  virtual long long get_params_num() = 0;
+  /**
+   * Set the number of valid samples of the current batch, the first ones of the input.
+   * The rest rows are empty, and they're skipped by forward() and backward().
+   * @param num_samples the number of valid samples of all the GPUs.
+   */
+  virtual void set_num_samples(int num_samples) = 0;
+  /**
+   * Get the statistics of the admission filter of the keys since the embedding is created,
+   * all 0 if the filter is disabled.
+   */
+  virtual nv::AdmissionStats get_admission_stats() = 0;
+};
+
 /**
  * @brief The base class of embedding layers.
  *
@@ -38,7 +94,7 @@ namespace HugeCTR {
  * upload_params_to_device() and download_params_to_host().
  */
 template <typename TypeKey>
-class Embedding {
+class Embedding : public IEmbedding {
  protected:
   std::vector<GeneralBuffer<float>*> output_buffers_; /**< The buffer for storing output tensors. */
   std::vector<Tensor<float>*> output_tensors_;        /**< The output tensors. */
@@ -47,6 +103,9 @@ class Embedding {
   const std::vector<Tensor<TypeKey>*>& value_tensors_; /**< The value tensors of the input data. */
   GPUResourceGroup& device_resources_;                 /**< The GPU device resources. */
   const int batchsize_; /**< The batch size of the input data for the current training process. */
+  int num_samples_;     /**< The number of valid samples of the current batch, <= batchsize_. */
+  std::shared_ptr<const KeyPartitioner<TypeKey>>
+      key_partitioner_; /**< The GPU of a key when a model is uploaded, modulo by default. */
  public:
   /**
    * The constructor of Embedding class.
@@ -70,42 +129,27 @@ class Embedding {
    * The destructor of Embedding class.
    */
   virtual ~Embedding();
-  /**
-   * The forward propagation of embedding layer.
-   */
-  virtual void forward() = 0;
-  /**
-   * The first stage of backward propagation of embedding layer,
-   * which only computes the wgrad by the dgrad from the top layer.
-   */
-  virtual void backward() = 0;
-  /**
-   * The second stage of backward propagation of embedding layer, which
-   * updates the embedding table weights by wgrad(from backward()) and
-   * optimizer.
-   */
-  virtual void update_params() = 0;
-  /**
-   * Read the embedding table from the weight_stream on the host, and
-   * upload it onto multi-GPUs global memory.
-   * @param weight_stream the host file stream for reading data from.
-   */
-  virtual void upload_params_to_device(std::ifstream& weight_stream) = 0;
-  /**
-   * Download the embedding table from multi-GPUs global memroy to CPU memory
-   * and write it to the weight_stream on the host.
-   * @param weight_stream the host file stream for writing data to.
-   */
-  virtual void download_params_to_host(
-      std::ofstream& weight_stream) = 0;  // please refer to file format definition of HugeCTR
-  /**
-   * Get the total size of embedding tables on all GPUs.
-   */
-  virtual long long get_params_num() = 0;
   /**
    * Return the output tensors.
    */
   std::vector<Tensor<float>*>& get_output_tensors() { return output_tensors_; }
+  void set_num_samples(int num_samples) override {
+    if (num_samples < 0 || num_samples > batchsize_) {
+      CK_THROW_(Error_t::WrongInput, "num_samples < 0 || num_samples > batchsize");
+    }
+    num_samples_ = num_samples;
+  }
+  /**
+   * Set the partitioner of the keys, which must be the one of the data reader, so that the
+   * keys of a model uploaded are on the GPUs their lookups go to.
+   * @param key_partitioner the partitioner over all the GPUs (of all the nodes).
+   */
+  void set_key_partitioner(const std::shared_ptr<const KeyPartitioner<TypeKey>>& key_partitioner) {
+    if (key_partitioner->get_num_devices() != device_resources_.get_total_gpu_count()) {
+      CK_THROW_(Error_t::WrongInput, "key_partitioner isn't for total_gpu_count GPUs");
+    }
+    key_partitioner_ = key_partitioner;
+  }
 
   // only used for results check
   /**
@@ -141,7 +185,10 @@ Embedding<TypeKey>::Embedding(const std::vector<Tensor<TypeKey>*>& row_offsets_t
     : row_offsets_tensors_(row_offsets_tensors),
       value_tensors_(value_tensors),
       device_resources_(gpu_resource_group),
-      batchsize_(batchsize) {
+      batchsize_(batchsize),
+      num_samples_(batchsize),
+      key_partitioner_(std::make_shared<ModuloKeyPartitioner<TypeKey>>(
+          gpu_resource_group.get_total_gpu_count())) {
   try {
     // Error check
     if (batchsize < 1 || slot_num < 1 || embedding_vec_size < 1) {
@@ -230,6 +277,10 @@ typedef struct SparseEmbeddingHashParams_ {
   int slot_num;            // slot number
   int combiner;            // 0-sum, 1-mean
   OptParams opt_params;    // optimizer params
+  int admit_threshold;     // occurrences of a key before it gets its own row, 0: disabled
+  int admit_sketch_width;  // counters of a row of the admission sketch per GPU, 0: one per row of
+                           // hash table
+  int admit_decay_interval;  // training batches between halvings of the admission sketch, 0: never
 } SparseEmbeddingHashParams;
 
 // Embedding should be register here
@@ -21,6 +21,7 @@
 #include "HugeCTR/include/common.hpp"
 #include "cub/cub/device/device_radix_sort.cuh"
 
+#include "HugeCTR/include/hashtable/count_min_sketch.hpp"
 #include "HugeCTR/include/hashtable/nv_hashtable.cuh"
 
 // using namespace cooperative_groups;
@@ -143,6 +144,71 @@ __global__ void sample_id_expand_kernel(const int batch_size, const int slot_num
   }
 }
 
+// admission kernel: a key is replaced by default_key until its count-min estimate reaches the
+// threshold, unless it's in the hash table already (its hash_value_index isn't missing_index).
+// admission_counter[0] counts the rejected keys and admission_counter[1] the input keys equal to
+// default_key, which is reserved for the shared row. Both are counted once per warp
+template <typename TypeHashKey, typename TypeHashValueIndex>
+__global__ void admit_kernel(const size_t nnz, const TypeHashKey *hash_key,
+                             const TypeHashValueIndex *hash_value_index,
+                             const TypeHashValueIndex missing_index, const uint32_t *sketch,
+                             const size_t width, const uint32_t threshold,
+                             const TypeHashKey default_key, TypeHashKey *admitted_key,
+                             uint32_t *admission_counter) {
+  const size_t gid = blockIdx.x * blockDim.x + threadIdx.x;
+
+  bool rejected = false;
+  bool reserved = false;
+  if (gid < nnz) {
+    const TypeHashKey key = hash_key[gid];
+    const hash_value_type hash = MurmurHash3_32<TypeHashKey>()(key);
+    uint32_t estimate = threshold;
+    for (int row = 0; row < nv::COUNT_MIN_DEPTH; row++) {
+      estimate = min(estimate, sketch[row * width + nv::count_min_index(hash, row, width)]);
+    }
+    rejected = estimate < threshold && hash_value_index[gid] == missing_index;
+    reserved = key == default_key;
+    admitted_key[gid] = rejected ? default_key : key;
+  }
+  const unsigned int rejected_mask = __ballot_sync(0xffffffff, rejected);
+  const unsigned int reserved_mask = __ballot_sync(0xffffffff, reserved);
+  if (threadIdx.x % 32 == 0 && rejected_mask != 0) {
+    atomicAdd(&admission_counter[0], __popc(rejected_mask));
+  }
+  if (threadIdx.x % 32 == 0 && reserved_mask != 0) {
+    atomicAdd(&admission_counter[1], __popc(reserved_mask));
+  }
+}
+}
+
+// count the keys in the count-min sketch, the counters stop at the threshold
+template <typename TypeHashKey>
+__global__ void count_keys_kernel(const size_t nnz, const TypeHashKey *hash_key, uint32_t *sketch,
+                                  const size_t width, const uint32_t threshold) {
+  const size_t gid = blockIdx.x * blockDim.x + threadIdx.x;
+
+  if (gid < nnz) {
+    const hash_value_type hash = MurmurHash3_32<TypeHashKey>()(hash_key[gid]);
+    for (int row = 0; row < nv::COUNT_MIN_DEPTH; row++) {
+      uint32_t *counter = &sketch[row * width + nv::count_min_index(hash, row, width)];
+      // a racing increment may pass the threshold by a few, which doesn't matter
+      if (*counter < threshold) {
+        atomicAdd(counter, 1u);
+      }
+    }
+  }
+}
+
+// halve the counters of the count-min sketch, so that the counts of the keys age
+template <typename TypeCounter>
+__global__ void decay_sketch_kernel(const size_t size, TypeCounter *sketch) {
+  const size_t gid = blockIdx.x * blockDim.x + threadIdx.x;
+
+  if (gid < size) {
+    sketch[gid] >>= 1;
+  }
+}
+
 template <typename TypeHashKey>
 __device__ __forceinline__ void swap(TypeHashKey &a, TypeHashKey &b) {
   TypeHashKey temp = a;
@@ -365,7 +431,7 @@ void do_forward(const cudaStream_t stream, const int batch_size, const int slot_
                 float *embedding_feature) {
   try {
     // get hash_value_index from hash_table by hash_key
-    size_t num;
+    TypeHashKey num;
     CK_CUDA_THROW_(cudaMemcpyAsync(&num, &row_offset[batch_size * slot_num], sizeof(TypeHashKey),
                                    cudaMemcpyDeviceToHost, stream));
     hash_table->get_insert(hash_key, hash_value_index, num, stream);
@@ -388,6 +454,82 @@ void do_forward(const cudaStream_t stream, const int batch_size, const int slot_
   return;
 }
 
+// replace the keys below the admission threshold by default_key, before do_forward(). The keys
+// already in hash_table (e.g. loaded with a model) are admitted whatever their count, so
+// hash_value_index is a scratch buffer for their lookup. admission_counter holds 2 counters, see
+// admit_kernel()
+template <typename TypeHashKey, typename TypeHashValueIndex>
+size_t do_admit(const cudaStream_t stream, const int batch_size, const int slot_num,
+                const TypeHashKey *row_offset, const TypeHashKey *hash_key,
+                const nv::HashTable<TypeHashKey, TypeHashValueIndex,
+                                    std::numeric_limits<TypeHashKey>::max()> *hash_table,
+                TypeHashValueIndex *hash_value_index, const uint32_t *sketch, const size_t width,
+                const uint32_t threshold, const TypeHashKey default_key,
+                TypeHashKey *admitted_key, uint32_t *admission_counter) {
+  TypeHashKey nnz = 0;
+  try {
+    CK_CUDA_THROW_(cudaMemcpyAsync(&nnz, &row_offset[batch_size * slot_num], sizeof(TypeHashKey),
+                                   cudaMemcpyDeviceToHost, stream));
+    if (nnz > 0) {
+      const TypeHashValueIndex missing_index = std::numeric_limits<TypeHashValueIndex>::max();
+      hash_table->get_or_default(hash_key, hash_value_index, missing_index, nnz, stream);
+
+      // a multiple of the warp size, for the admission counters
+      const int blockSize = 256;
+      const int gridSize = (nnz + blockSize - 1) / blockSize;
+      admit_kernel<<<gridSize, blockSize, 0, stream>>>(nnz, hash_key, hash_value_index,
+                                                       missing_index, sketch, width, threshold,
+                                                       default_key, admitted_key,
+                                                       admission_counter);
+    }
+  } catch (const std::runtime_error &rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    throw;
+  }
+
+  return nnz;
+}
+
+// count the keys of a training batch in the count-min sketch of the admission
+template <typename TypeHashKey>
+void do_count_keys(const cudaStream_t stream, const int batch_size, const int slot_num,
+                   const TypeHashKey *row_offset, const TypeHashKey *hash_key, uint32_t *sketch,
+                   const size_t width, const uint32_t threshold) {
+  try {
+    TypeHashKey nnz = 0;
+    CK_CUDA_THROW_(cudaMemcpyAsync(&nnz, &row_offset[batch_size * slot_num], sizeof(TypeHashKey),
+                                   cudaMemcpyDeviceToHost, stream));
+    if (nnz > 0) {
+      const int blockSize = 256;
+      const int gridSize = (nnz + blockSize - 1) / blockSize;
+      count_keys_kernel<<<gridSize, blockSize, 0, stream>>>(nnz, hash_key, sketch, width,
+                                                            threshold);
+    }
+  } catch (const std::runtime_error &rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    throw;
+  }
+
+  return;
+}
+
+// halve the counters of the count-min sketch of the admission
+template <typename TypeCounter>
+void do_decay_sketch(const cudaStream_t stream, const size_t size, TypeCounter *sketch) {
+  try {
+    if (size > 0) {
+      const int blockSize = 256;
+      const int gridSize = (size + blockSize - 1) / blockSize;
+      decay_sketch_kernel<<<gridSize, blockSize, 0, stream>>>(size, sketch);
+    }
+  } catch (const std::runtime_error &rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    throw;
+  }
+
+  return;
+}
+
 // this is an additional function for combiner=mean
 template <typename TypeHashKey>
 void do_forward_scale(const cudaStream_t stream, const int batch_size, const int slot_num,
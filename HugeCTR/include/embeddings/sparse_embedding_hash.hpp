@@ -105,6 +105,15 @@ class SparseEmbeddingHash : public Embedding<TypeHashKey> {
                                            deltaw in update_params(). */
   std::vector<Tensor<float> *>
       deltaw_tensors_; /**< The temp memory to store the deltaw in update_params(). */
+  std::vector<Tensor<uint32_t> *>
+      admission_sketch_tensors_; /**< The count-min sketch of the keys of the training batches,
+                                    if admit_threshold > 0. */
+  std::vector<Tensor<TypeHashKey> *>
+      admitted_key_tensors_; /**< The keys looked up in the hash table if admit_threshold > 0: the
+                                input keys, or the default key for those below the threshold. */
+  std::vector<Tensor<uint32_t> *>
+      admission_counter_tensors_; /**< The number of keys below the threshold in forward(), and
+                                     the number of input keys equal to the default key. */
 
   // define GeneralBuffers
   std::vector<GeneralBuffer<float> *> float_bufs_;     /**< float type general buffer. */
@@ -116,6 +125,24 @@ class SparseEmbeddingHash : public Embedding<TypeHashKey> {
   std::vector<size_t> temp_storage_sort_bytes_;  // for CUB radix sort /**< The temp variable for
                                                  // CUB lib sorting API. */
   int max_vocabulary_size_per_gpu;               /**< Max vocabulary size for each GPU. */
+  int admission_sketch_width_; /**< The counters of a row of the admission sketch on each GPU. */
+  long long admission_batches_; /**< The training batches counted in the admission sketch. */
+  nv::AdmissionStats admission_stats_; /**< The admission stats of the training batches. */
+  nv::AdmissionStats forward_admission_stats_; /**< The admission stats of the last forward(),
+                                                  added to admission_stats_ by update_params(). */
+
+  /**
+   * The key of the row shared by the keys below the admission threshold. It's reserved, forward()
+   * throws if an input key is equal to it.
+   */
+  static TypeHashKey get_default_key() { return std::numeric_limits<TypeHashKey>::max() - 1; }
+  /**
+   * The keys looked up in the hash table on a GPU, after the admission if it's enabled.
+   */
+  const TypeHashKey *get_lookup_keys(int id) {
+    return embedding_params_.admit_threshold > 0 ? admitted_key_tensors_[id]->get_ptr()
+                                                 : Base::value_tensors_[id]->get_ptr();
+  }
 
  public:
   /**
@@ -197,6 +224,11 @@ class SparseEmbeddingHash : public Embedding<TypeHashKey> {
    * @param hash_table_value the host pointer for stroing the hash table values.
    */
   void get_hash_table_ptr(TypeHashKey *hash_table_key, float *hash_table_value) override;
+  /**
+   * Get the statistics of the admission of the keys in forward() since the embedding is created.
+   * Only the training batches are counted, i.e. the forward() calls followed by update_params().
+   */
+  nv::AdmissionStats get_admission_stats() override { return admission_stats_; }
 
 };  // end of class SparseEmbeddingHash
 
@@ -214,9 +246,9 @@ SparseEmbeddingHash<TypeHashKey>::SparseEmbeddingHash(
     CK_CUDA_THROW_(get_set_device(Base::device_resources_[0]->get_device_id(), &o_device));
 
     // CAUSION: can not decide how many <key,value> pairs in each GPU, because the GPU distribution
-    // is computed by (key%gpu_count) In order to not allocate the total size of hash table on each
-    // GPU, meanwhile get a better performance by a unfull hash table, the users need to set the
-    // param "load_factor"(load_factor<1). The size of
+    // is computed by the key partitioner In order to not allocate the total size of hash table on
+    // each GPU, meanwhile get a better performance by a unfull hash table, the users need to set
+    // the param "load_factor"(load_factor<1). The size of
     // max_vocabulary_size_per_gpu=vocabulary_size/gpu_count/load_factor, which should be more than
     // vocabulary_size/gpu_count.
     // TODO: Is "int" enough here?
@@ -230,6 +262,12 @@ SparseEmbeddingHash<TypeHashKey>::SparseEmbeddingHash(
     std::cout << "max_vocabulary_size_per_gpu:" << max_vocabulary_size_per_gpu;
 #endif
 
+    // the sketch has a counter per slot of the hash table in each row, unless its width is set
+    admission_sketch_width_ = embedding_params_.admit_sketch_width > 0
+                                  ? embedding_params_.admit_sketch_width
+                                  : max_vocabulary_size_per_gpu;
+    admission_batches_ = 0;
+
     // for hash_table_value initialization
     HugeCTR::UnifiedDataSimulator<float> fdata_sim(-1.f / embedding_params_.embedding_vec_size,
                                                    1.f / embedding_params_.embedding_vec_size);
@@ -353,6 +391,18 @@ SparseEmbeddingHash<TypeHashKey>::SparseEmbeddingHash(
       temp_storage_sort_tensors_.push_back(
           new Tensor<TypeHashKey>({1, size}, *(key_bufs_.back()), TensorFormat_t::HW));
 
+      // new admission tensors
+      if (embedding_params_.admit_threshold > 0) {
+        admission_sketch_tensors_.push_back(
+            new Tensor<uint32_t>({nv::COUNT_MIN_DEPTH, admission_sketch_width_},
+                                 *(uint32_bufs_.back()), TensorFormat_t::HW));
+        admitted_key_tensors_.push_back(new Tensor<TypeHashKey>(
+            {1, embedding_params_.batch_size * embedding_params_.max_feature_num},
+            *(key_bufs_.back()), TensorFormat_t::HW));
+        admission_counter_tensors_.push_back(
+            new Tensor<uint32_t>({1, 2}, *(uint32_bufs_.back()), TensorFormat_t::HW));
+      }
+
       // init GenenralBuffers to do real allocation
 #ifndef NDEBUG
       std::cout << " max_feature_num_:" << embedding_params_.max_feature_num;
@@ -371,6 +421,12 @@ SparseEmbeddingHash<TypeHashKey>::SparseEmbeddingHash(
           hash_table_value_tensors_[id]->get_ptr(), h_hash_table_value,
           max_vocabulary_size_per_gpu * embedding_params_.embedding_vec_size * sizeof(float),
           cudaMemcpyHostToDevice));
+      if (embedding_params_.admit_threshold > 0) {
+        CK_CUDA_THROW_(cudaMemsetAsync(
+            admission_sketch_tensors_[id]->get_ptr(), 0,
+            (size_t)nv::COUNT_MIN_DEPTH * admission_sketch_width_ * sizeof(uint32_t),
+            *Base::device_resources_[id]->get_stream_ptr()));
+      }
 
       switch (embedding_params_.opt_params.optimizer) {
         case 0:  // adam
@@ -510,6 +566,15 @@ SparseEmbeddingHash<TypeHashKey>::~SparseEmbeddingHash() {
     for (auto deltaw_tensor : deltaw_tensors_) {
       delete deltaw_tensor;
     }
+    for (auto admission_sketch_tensor : admission_sketch_tensors_) {
+      delete admission_sketch_tensor;
+    }
+    for (auto admitted_key_tensor : admitted_key_tensors_) {
+      delete admitted_key_tensor;
+    }
+    for (auto admission_counter_tensor : admission_counter_tensors_) {
+      delete admission_counter_tensor;
+    }
 
     // delete GenenralBuffers
     for (auto float_buf : float_bufs_) {
@@ -569,23 +634,65 @@ void SparseEmbeddingHash<TypeHashKey>::forward() {
 
   int local_gpu_count = Base::device_resources_.size();
   int total_gpu_count = Base::device_resources_.get_total_gpu_count();
+  // only the valid samples are looked up, the features of the empty rows after them are 0
+  const int num_samples = Base::num_samples_;
+  const size_t feature_size_per_sample =
+      embedding_params_.slot_num * embedding_params_.embedding_vec_size;
+  // the admission stats of an evaluation batch are dropped, update_params() keeps the training ones
+  forward_admission_stats_ = nv::AdmissionStats();
   // launch kernels on GPUs: do embedding lookup on multi GPUs
   for (int id = 0; id < local_gpu_count; id++) {
     CK_CUDA_THROW_(get_set_device(Base::device_resources_[id]->get_device_id()));
 
+    // the keys below the admission threshold are looked up as the default key
+    if (num_samples > 0 && embedding_params_.admit_threshold > 0) {
+      CK_CUDA_THROW_(cudaMemsetAsync(admission_counter_tensors_[id]->get_ptr(), 0,
+                                     2 * sizeof(uint32_t),
+                                     *Base::device_resources_[id]->get_stream_ptr()));
+      // hash_value_index is written by do_forward() next, so it holds the lookup of do_admit()
+      forward_admission_stats_.keys += SparseEmbeddingHashKernels::do_admit(
+          *Base::device_resources_[id]->get_stream_ptr(), num_samples, embedding_params_.slot_num,
+          Base::row_offsets_tensors_[id]->get_ptr(), Base::value_tensors_[id]->get_ptr(),
+          hash_tables_[id], hash_value_index_tensors_[id]->get_ptr(),
+          admission_sketch_tensors_[id]->get_ptr(), admission_sketch_width_,
+          embedding_params_.admit_threshold, get_default_key(),
+          admitted_key_tensors_[id]->get_ptr(), admission_counter_tensors_[id]->get_ptr());
+    }
+
     // embedding lookup and reduction(sum)
-    SparseEmbeddingHashKernels::do_forward(
-        *Base::device_resources_[id]->get_stream_ptr(), embedding_params_.batch_size,
-        embedding_params_.slot_num, embedding_params_.embedding_vec_size,
-        Base::row_offsets_tensors_[id]->get_ptr(), Base::value_tensors_[id]->get_ptr(),
-        hash_tables_[id], hash_table_value_tensors_[id]->get_ptr(),
-        hash_value_index_tensors_[id]->get_ptr(), embedding_feature_tensors_[id]->get_ptr());
+    if (num_samples > 0) {
+      SparseEmbeddingHashKernels::do_forward(
+          *Base::device_resources_[id]->get_stream_ptr(), num_samples,
+          embedding_params_.slot_num, embedding_params_.embedding_vec_size,
+          Base::row_offsets_tensors_[id]->get_ptr(), get_lookup_keys(id),
+          hash_tables_[id], hash_table_value_tensors_[id]->get_ptr(),
+          hash_value_index_tensors_[id]->get_ptr(), embedding_feature_tensors_[id]->get_ptr());
+    }
+    if (num_samples < embedding_params_.batch_size) {
+      CK_CUDA_THROW_(cudaMemsetAsync(
+          embedding_feature_tensors_[id]->get_ptr() + num_samples * feature_size_per_sample, 0,
+          (embedding_params_.batch_size - num_samples) * feature_size_per_sample * sizeof(float),
+          *Base::device_resources_[id]->get_stream_ptr()));
+    }
   }
 
   // sync
   for (int id = 0; id < local_gpu_count; id++) {
     CK_CUDA_THROW_(get_set_device(Base::device_resources_[id]->get_device_id()));
     CK_CUDA_THROW_(cudaStreamSynchronize(*Base::device_resources_[id]->get_stream_ptr()));
+    if (num_samples > 0 && embedding_params_.admit_threshold > 0) {
+      uint32_t admission_counter[2] = {0, 0};
+      CK_CUDA_THROW_(cudaMemcpy(admission_counter, admission_counter_tensors_[id]->get_ptr(),
+                                sizeof(admission_counter), cudaMemcpyDeviceToHost));
+      // a real key equal to the default key would silently share the row of the rare keys
+      if (admission_counter[1] != 0) {
+        CK_THROW_(Error_t::WrongInput,
+                  "key " + std::to_string(get_default_key()) +
+                      " is reserved for the shared row of the admission, remap it (e.g. with "
+                      "key_compactor) or set admit_threshold to 0");
+      }
+      forward_admission_stats_.rejected += admission_counter[0];
+    }
   }
 
   // use NCCL to do Reduce-Scatter
@@ -737,8 +844,12 @@ void SparseEmbeddingHash<TypeHashKey>::backward() {
     CK_CUDA_THROW_(get_set_device(Base::device_resources_[id]->get_device_id()));
 
     // before backward, top diff data are already in embedding_feature_tensors_
+    // the wgrad of the empty rows after the valid samples isn't used by any key
+    if (Base::num_samples_ == 0) {
+      continue;
+    }
     SparseEmbeddingHashKernels::do_backward(
-        *Base::device_resources_[id]->get_stream_ptr(), embedding_params_.batch_size,
+        *Base::device_resources_[id]->get_stream_ptr(), Base::num_samples_,
         embedding_params_.slot_num, embedding_params_.embedding_vec_size,
         embedding_params_.combiner, row_offset_allreduce_tensors_[id]->get_ptr(),
         embedding_feature_tensors_[id]
@@ -774,10 +885,10 @@ void SparseEmbeddingHash<TypeHashKey>::update_params_per_thread(int tid) {
   SparseEmbeddingHashKernels::do_update_params(
       *Base::device_resources_[tid]->get_stream_ptr(), embedding_params_.batch_size,
       embedding_params_.slot_num, embedding_params_.embedding_vec_size, max_vocabulary_size_per_gpu,
-      *opt_params_[tid], Base::row_offsets_tensors_[tid]->get_ptr(),
-      Base::value_tensors_[tid]->get_ptr(), hash_tables_[tid],
-      hash_value_index_tensors_[tid]->get_ptr(), sample_id_tensors_[tid]->get_ptr(),
-      sample_id_sort_tensors_[tid]->get_ptr(), hash_value_index_sort_tensors_[tid]->get_ptr(),
+      *opt_params_[tid], Base::row_offsets_tensors_[tid]->get_ptr(), get_lookup_keys(tid),
+      hash_tables_[tid], hash_value_index_tensors_[tid]->get_ptr(),
+      sample_id_tensors_[tid]->get_ptr(), sample_id_sort_tensors_[tid]->get_ptr(),
+      hash_value_index_sort_tensors_[tid]->get_ptr(),
       hash_value_index_count_tensors_[tid]->get_ptr(),
       hash_value_index_count_offset_tensors_[tid]->get_ptr(),
       hash_value_index_count_counter_tensors_[tid]->get_ptr(),
@@ -785,6 +896,24 @@ void SparseEmbeddingHash<TypeHashKey>::update_params_per_thread(int tid) {
       wgrad_tensors_[tid]->get_ptr(), deltaw_hash_value_index_tensors_[tid]->get_ptr(),
       deltaw_tensors_[tid]->get_ptr(), hash_table_value_tensors_[tid]->get_ptr());
 
+  // count the keys of the training batch after it's admitted: a key gets its own row from the
+  // batch after the one it reaches the threshold in. Every admit_decay_interval batches the
+  // counts are halved first, so that the rare keys of a long run don't add up to the threshold
+  if (embedding_params_.admit_threshold > 0) {
+    if (embedding_params_.admit_decay_interval > 0 && admission_batches_ > 0 &&
+        admission_batches_ % embedding_params_.admit_decay_interval == 0) {
+      SparseEmbeddingHashKernels::do_decay_sketch(
+          *Base::device_resources_[tid]->get_stream_ptr(),
+          (size_t)nv::COUNT_MIN_DEPTH * admission_sketch_width_,
+          admission_sketch_tensors_[tid]->get_ptr());
+    }
+    SparseEmbeddingHashKernels::do_count_keys(
+        *Base::device_resources_[tid]->get_stream_ptr(), embedding_params_.batch_size,
+        embedding_params_.slot_num, Base::row_offsets_tensors_[tid]->get_ptr(),
+        Base::value_tensors_[tid]->get_ptr(), admission_sketch_tensors_[tid]->get_ptr(),
+        admission_sketch_width_, embedding_params_.admit_threshold);
+  }
+
   // stream sync
   CK_CUDA_THROW_(cudaStreamSynchronize(*Base::device_resources_[tid]->get_stream_ptr()));
 
@@ -823,6 +952,14 @@ void SparseEmbeddingHash<TypeHashKey>::update_params() {
         std::string("[HCDEBUG][ERROR] Runtime error: total_gpu_count <= 0 \n"));
   }
 
+  // the last forward() was a training one
+  if (embedding_params_.admit_threshold > 0) {
+    admission_stats_.keys += forward_admission_stats_.keys;
+    admission_stats_.rejected += forward_admission_stats_.rejected;
+    forward_admission_stats_ = nv::AdmissionStats();
+    admission_batches_++;
+  }
+
   return;
 }
 
@@ -935,7 +1072,7 @@ void SparseEmbeddingHash<TypeHashKey>::upload_params_to_device(std::ifstream &we
     float *value_dst_buf;
     for (int k = 0; k < chunk_loop; k++) {
       TypeHashKey key = *((TypeHashKey *)src_buf);
-      int gid = key % Base::device_resources_.get_total_gpu_count();  // global GPU ID
+      int gid = Base::key_partitioner_->get_device(key);              // global GPU ID
       int id = Base::device_resources_.get_local_device_id(gid);      // local GPU ID
       int dst_rank = Base::device_resources_.get_pid(gid);
 
@@ -1038,7 +1175,7 @@ void SparseEmbeddingHash<TypeHashKey>::upload_params_to_device(std::ifstream &we
     float *value_dst_buf;
     for (int i = 0; i < remain_loop_num; i++) {
       TypeHashKey key = *((TypeHashKey *)src_buf);
-      int gid = key % Base::device_resources_.get_total_gpu_count();  // global GPU ID
+      int gid = Base::key_partitioner_->get_device(key);              // global GPU ID
       int id = Base::device_resources_.get_local_device_id(gid);      // local GPU ID
       int dst_rank = Base::device_resources_.get_pid(gid);
 
@@ -15,17 +15,66 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <random>
+#include <string>
 #include <vector>
+#include "HugeCTR/include/data_set_format.hpp"
+#include "HugeCTR/include/reader_position.hpp"
+#include "HugeCTR/include/record_range.hpp"
 
 namespace HugeCTR {
 
+/**
+ * Read the file names of a file list (see FileList for the format).
+ * @param file_list_name the text file of the list.
+ * @return the file names, at least one.
+ */
+inline std::vector<std::string> read_file_list(const std::string& file_list_name) {
+  std::ifstream read_stream(file_list_name, std::ifstream::in);
+  if (!read_stream.is_open()) {
+    CK_THROW_(Error_t::FileCannotOpen, "file list open failed: " + file_list_name);
+  }
+  std::string buff;
+  std::getline(read_stream, buff);
+  const int num_of_files = std::stoi(buff);
+  if (num_of_files <= 0) {
+    CK_THROW_(Error_t::UnSupportedFormat, "Unsupported file format");
+  }
+  std::vector<std::string> file_names(num_of_files);
+  for (auto& file_name : file_names) {
+    if (!std::getline(read_stream, file_name)) {
+      CK_THROW_(Error_t::WrongInput, "broken file list: " + file_list_name);
+    }
+  }
+  return file_names;
+}
+
 /**
  * @brief A threads safe file list implementation.
  *
  * FileList reads file list from text file, and maintains a vector of file name. It supports
  * getting file names with multiple threads. All the threads will get the names in order.
+ * With shuffle enabled, the order is a new permutation of the files in each epoch (a pass
+ * over the list), which only depends on the seed and the epoch.
+ * By default the list wraps around forever. In epoch mode (repeat == false) an empty name is
+ * returned once all the files of the current epoch are handed out, and the next epoch
+ * only starts after next_epoch() is called, which the readers can wait for.
+ * The files are numbered by a sequence number (see FileProgress). A reading can be resumed
+ * with set_position(), after which the finished files are skipped and get_a_file() tells
+ * the record to start a file from.
+ * The work is handed out as ranges of records (get_a_range()), a file is a range of its
+ * own by default. With records_per_range > 0, the files which can be read from the middle
+ * (see get_record_stride()) are split into ranges of about records_per_range records,
+ * so that several threads read a large file at the same time. Once all the files of an
+ * epoch are handed out, an idle thread steals about a half of the records left in the
+ * range of a busy thread, which keeps all the threads busy until the end of the epoch
+ * however the sizes of the files are distributed.
  * Text file begins with the number of files, and then the list of file names.
  * @verbatim
  * Text file example:
@@ -41,48 +90,269 @@ class FileList {
   std::vector<std::string> file_vector_; /**< the vector of file names. */
   int current_file_idx_{0};              /**< the current index of file name getting */
   std::mutex mtx_;                       /**< mutex for threads safty */
+  const bool shuffle_;                   /**< whether to permute the files in each epoch */
+  const unsigned int seed_;              /**< seed of the permutation */
+  long long epoch_{0};                   /**< the number of passes over the list */
+  std::vector<int> order_;               /**< the order of files in current epoch */
+  const bool repeat_;                    /**< false: epoch mode */
+  bool broken_{false};                   /**< whether the waiting is broken */
+  std::condition_variable epoch_cv_;     /**< notified when a new epoch starts */
+  ReaderPosition start_position_;        /**< the position to resume, empty: from the start */
+  const long long records_per_range_;    /**< size of the ranges a file is split to, 0: no split */
+  std::deque<std::shared_ptr<RecordRange>> pending_ranges_; /**< ranges of the files taken */
+  std::vector<std::weak_ptr<RecordRange>> active_ranges_;   /**< ranges which can be stolen */
+
+  /**
+   * Take the next file of the epoch and queue its ranges not read yet.
+   * @return false if the epoch is finished (epoch mode).
+   */
+  bool take_a_file_() {
+    while (current_file_idx_ < num_of_files_) {
+      long long sequence = epoch_ * num_of_files_ + current_file_idx_;
+      std::vector<std::pair<long long, long long>> unread =
+          start_position_.get_unread_ranges(sequence);
+      const std::string& file_name = file_vector_[order_[current_file_idx_]];
+      current_file_idx_++;
+      if (current_file_idx_ == num_of_files_ && repeat_) {
+        current_file_idx_ = 0;
+        epoch_++;
+        permute_();
+      }
+      if (unread.empty()) {
+        continue;
+      }
+      long long stride = 0;
+      if (records_per_range_ > 0) {
+        DataSetHeader header;
+        std::ifstream in_stream(file_name, std::ifstream::binary);
+        in_stream.read(reinterpret_cast<char*>(&header), sizeof(DataSetHeader));
+        if (!in_stream) {
+          CK_THROW_(Error_t::FileCannotOpen, "failed to read the header of " + file_name);
+        }
+        check_data_set_version(header, file_name);
+        stride = get_record_stride(file_name, header);
+        if (unread.back().second < 0) {
+          unread.back().second = header.number_of_records;
+        }
+      }
+      // split points are multiples of the stride
+      const long long split_size =
+          stride > 0 ? (std::max(records_per_range_, stride) + stride - 1) / stride * stride : 0;
+      for (auto& range : unread) {
+        long long begin = range.first;
+        while (split_size > 0 && range.second - begin > split_size) {
+          long long end = (begin / split_size + 1) * split_size;
+          pending_ranges_.push_back(
+              std::make_shared<RecordRange>(file_name, sequence, begin, end, stride));
+          begin = end;
+        }
+        pending_ranges_.push_back(
+            std::make_shared<RecordRange>(file_name, sequence, begin, range.second, stride));
+      }
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * Split the range with the most records left among the ones handed out.
+   * @return the records taken, nullptr if none can be split.
+   */
+  std::shared_ptr<RecordRange> steal_a_range_() {
+    std::shared_ptr<RecordRange> victim;
+    long long max_unclaimed = 0;
+    prune_active_ranges_();
+    for (auto& weak_range : active_ranges_) {
+      std::shared_ptr<RecordRange> range = weak_range.lock();
+      if (!range) {
+        continue;  // finished by its reader
+      }
+      long long unclaimed = range->get_unclaimed();
+      if (unclaimed > max_unclaimed) {
+        max_unclaimed = unclaimed;
+        victim = range;
+      }
+    }
+    long long begin = 0, end = 0;
+    if (!victim || !victim->split(&begin, &end)) {
+      return nullptr;
+    }
+    return std::make_shared<RecordRange>(victim->get_file_name(), victim->get_sequence(), begin,
+                                         end, victim->get_stride());
+  }
+
+  /**
+   * Drop the ranges finished by their readers from active_ranges_.
+   */
+  void prune_active_ranges_() {
+    active_ranges_.erase(std::remove_if(active_ranges_.begin(), active_ranges_.end(),
+                                        [](const std::weak_ptr<RecordRange>& range) {
+                                          return range.expired();
+                                        }),
+                         active_ranges_.end());
+  }
+
+  /**
+   * Permute order_ with a generator seeded by seed_ and epoch_.
+   * Fisher-Yates with the raw output of mt19937 is used instead of std::shuffle,
+   * so that the order doesn't depend on the standard library implementation.
+   */
+  void permute_() {
+    for (int i = 0; i < num_of_files_; i++) {
+      order_[i] = i;
+    }
+    if (!shuffle_) {
+      return;
+    }
+    std::mt19937 generator(seed_ + static_cast<unsigned int>(epoch_));
+    for (int i = num_of_files_ - 1; i > 0; i--) {
+      std::swap(order_[i], order_[generator() % (i + 1)]);
+    }
+  }
+
  public:
   /*
    * Ctor
+   * @param file_list_name the text file of the file list.
+   * @param shuffle whether to permute the files in each epoch.
+   * @param seed seed of the permutation.
+   * @param repeat whether to wrap around at the end of an epoch, false for epoch mode.
+   * @param records_per_range size of the ranges the files are split to, 0 to read each file
+   *        by one thread.
    */
-  FileList(const std::string& file_list_name) {
+  FileList(const std::string& file_list_name, bool shuffle = false, unsigned int seed = 0,
+           bool repeat = true, long long records_per_range = 0)
+      : shuffle_(shuffle), seed_(seed), repeat_(repeat), records_per_range_(records_per_range) {
+    if (records_per_range < 0) {
+      CK_THROW_(Error_t::WrongInput, "records_per_range < 0");
+    }
     try {
-      std::ifstream read_stream(file_list_name, std::ifstream::in);
-      if (!read_stream.is_open()) {
-        CK_THROW_(Error_t::FileCannotOpen, "file list open failed: " + file_list_name);
-      }
-
-      std::string buff;
-      std::getline(read_stream, buff);
-      num_of_files_ = std::stoi(buff);
-      assert(file_vector_.empty());
-      if (num_of_files_ > 0) {
-        for (int i = 0; i < num_of_files_; i++) {
-          std::getline(read_stream, buff);
-          file_vector_.push_back(buff);
-        }
-        read_stream.close();
-      } else {
-        CK_THROW_(Error_t::UnSupportedFormat, "Unsupported file format");
-      }
+      file_vector_ = read_file_list(file_list_name);
+      num_of_files_ = static_cast<int>(file_vector_.size());
+      order_.resize(num_of_files_);
+      permute_();
     } catch (const std::runtime_error& rt_err) {
       std::cerr << rt_err.what() << std::endl;
       throw;
     }
   }
 
+  /**
+   * Get a range of records to read.
+   * The ranges of a file are handed out in order, and the next file is taken once they are
+   * all handed out. At the end of an epoch (epoch mode) a range is stolen from the ranges
+   * being read.
+   * @param range the range is passed out.
+   * @return false if the epoch is finished (epoch mode).
+   */
+  bool get_a_range(std::shared_ptr<RecordRange>* range) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (pending_ranges_.empty() && !take_a_file_()) {
+      *range = steal_a_range_();
+    } else {
+      *range = pending_ranges_.front();
+      pending_ranges_.pop_front();
+    }
+    if (!*range) {
+      return false;
+    }
+    // only the ranges of an epoch which can be split are stolen from (see steal_a_range_())
+    if (!repeat_ && (*range)->get_stride() > 0) {
+      prune_active_ranges_();
+      active_ranges_.push_back(*range);
+    }
+    return true;
+  }
+
+  /**
+   * The number of ranges handed out which may be stolen from, for the tests.
+   */
+  size_t get_num_active_ranges() const { return active_ranges_.size(); }
+
   /**
    * Get a file name from the list.
-   * @return the file name.
+   * A file whose records are read in several ranges (see get_a_range()) is returned once for
+   * each range.
+   * @param sequence the sequence number of the file is passed out if it's not nullptr.
+   * @param start_record the index of the record to start reading is passed out if it's not
+   *        nullptr, which is only non zero for the file being read when the position is set.
+   * @return the file name, or an empty string if the epoch is finished (epoch mode).
+   */
+  std::string get_a_file(long long* sequence = nullptr, long long* start_record = nullptr) {
+    std::shared_ptr<RecordRange> range;
+    if (!get_a_range(&range)) {
+      return std::string();
+    }
+    if (sequence != nullptr) {
+      *sequence = range->get_sequence();
+    }
+    if (start_record != nullptr) {
+      *start_record = range->get_begin();
+    }
+    return range->get_file_name();
+  }
+
+  /**
+   * Resume from a position, it must be called before any get_a_file().
+   * The position must be captured from a reader of the same list (and shuffling seed).
+   */
+  void set_position(const ReaderPosition& position) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (position.get_num_files() != num_of_files_) {
+      CK_THROW_(Error_t::WrongInput, "the position is captured from a list of " +
+                                         std::to_string(position.get_num_files()) + " files, not " +
+                                         std::to_string(num_of_files_));
+    }
+    start_position_ = position;
+    pending_ranges_.clear();
+    epoch_ = position.get_first_sequence() / num_of_files_;
+    current_file_idx_ = position.get_first_sequence() % num_of_files_;
+    permute_();
+  }
+
+  int get_num_files() const { return num_of_files_; }
+
+  /**
+   * Start the next epoch (epoch mode), and wake up the threads waiting for it.
    */
-  std::string get_a_file() {
+  void next_epoch() {
     std::lock_guard<std::mutex> lock(mtx_);
-    std::string file_name = file_vector_[current_file_idx_];
-    current_file_idx_++;
-    if (current_file_idx_ == num_of_files_) {
+    if (!repeat_) {
+      pending_ranges_.clear();
       current_file_idx_ = 0;
+      epoch_++;
+      permute_();
     }
-    return file_name;
+    epoch_cv_.notify_all();
+  }
+
+  /**
+   * Block until the epoch-th epoch starts.
+   * @return false if the waiting is broken by break_waiting().
+   */
+  bool wait_for_epoch(long long epoch) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    epoch_cv_.wait(lock, [this, epoch]() { return epoch_ >= epoch || broken_; });
+    return !broken_;
+  }
+
+  /**
+   * Break the waiting in wait_for_epoch(), used in destruction.
+   */
+  void break_waiting() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    broken_ = true;
+    epoch_cv_.notify_all();
+  }
+
+  bool is_epoch_mode() const { return !repeat_; }
+
+  /**
+   * The number of complete passes over the list (repeat), or the index of current epoch.
+   */
+  long long get_epoch() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return epoch_;
   }
 };
 
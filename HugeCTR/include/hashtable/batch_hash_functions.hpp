@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BATCH_HASH_FUNCTIONS_H_
+#define BATCH_HASH_FUNCTIONS_H_
+#include <cuda_runtime_api.h>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "cudf/hash_functions.cuh"
+
+// the SIMD code paths are compiled for x86-64 hosts by gcc / clang, with the target attribute
+// of each function, so they don't need any -m flag and are chosen at run time
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(__CUDACC__)
+#define NV_BATCH_HASH_X86
+#include <immintrin.h>
+#endif
+
+namespace nv {
+
+/**
+ * The instruction sets of batch_murmur_hash3_32().
+ */
+enum class HashIsa { Scalar, AVX2, AVX512 };
+
+/**
+ * Whether the CPU (and the compiler) support an instruction set.
+ */
+inline bool is_hash_isa_supported(HashIsa isa) {
+  switch (isa) {
+    case HashIsa::Scalar:
+      return true;
+#ifdef NV_BATCH_HASH_X86
+    case HashIsa::AVX2:
+      return __builtin_cpu_supports("avx2");
+    case HashIsa::AVX512:
+      return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+      return false;
+  }
+}
+
+/**
+ * The best instruction set of the CPU, detected once.
+ */
+inline HashIsa get_hash_isa() {
+  static const HashIsa isa = is_hash_isa_supported(HashIsa::AVX512)
+                                 ? HashIsa::AVX512
+                                 : is_hash_isa_supported(HashIsa::AVX2) ? HashIsa::AVX2
+                                                                        : HashIsa::Scalar;
+  return isa;
+}
+
+namespace batch_hash_detail {
+
+inline void hash_scalar(const uint32_t* keys, hash_value_type* hashes, size_t len) {
+  const MurmurHash3_32<uint32_t> hasher;
+  for (size_t i = 0; i < len; i++) {
+    hashes[i] = hasher(keys[i]);
+  }
+}
+
+inline void hash_scalar(const uint64_t* keys, hash_value_type* hashes, size_t len) {
+  const MurmurHash3_32<uint64_t> hasher;
+  for (size_t i = 0; i < len; i++) {
+    hashes[i] = hasher(keys[i]);
+  }
+}
+
+#ifdef NV_BATCH_HASH_X86
+
+/*
+ * The steps of MurmurHash3_32 (seed 0) on 8 / 16 lanes of 32 bits: a 4-byte key is one block,
+ * an 8-byte key two blocks of its low and high words (little endian).
+ */
+
+__attribute__((target("avx2"))) inline __m256i rotl_avx2(__m256i x, int r) {
+  return _mm256_or_si256(_mm256_slli_epi32(x, r), _mm256_srli_epi32(x, 32 - r));
+}
+
+__attribute__((target("avx2"))) inline __m256i mix_block_avx2(__m256i h, __m256i k) {
+  k = _mm256_mullo_epi32(k, _mm256_set1_epi32(0xcc9e2d51));
+  k = rotl_avx2(k, 15);
+  k = _mm256_mullo_epi32(k, _mm256_set1_epi32(0x1b873593));
+  h = _mm256_xor_si256(h, k);
+  h = rotl_avx2(h, 13);
+  return _mm256_add_epi32(_mm256_mullo_epi32(h, _mm256_set1_epi32(5)),
+                          _mm256_set1_epi32(0xe6546b64));
+}
+
+__attribute__((target("avx2"))) inline __m256i fmix_avx2(__m256i h, int len) {
+  h = _mm256_xor_si256(h, _mm256_set1_epi32(len));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x85ebca6b));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0xc2b2ae35));
+  return _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+}
+
+__attribute__((target("avx2"))) inline void hash_avx2(const uint32_t* keys,
+                                                     hash_value_type* hashes, size_t len) {
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+    __m256i h = mix_block_avx2(_mm256_setzero_si256(), k);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), fmix_avx2(h, 4));
+  }
+  hash_scalar(keys + i, hashes + i, len - i);
+}
+
+__attribute__((target("avx2"))) inline void hash_avx2(const uint64_t* keys,
+                                                     hash_value_type* hashes, size_t len) {
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 a = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)));
+    __m256 b =
+        _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i + 4)));
+    // the words of the keys in the order 0 1 4 5 2 3 6 7, then 64-bit lanes 0 2 1 3
+    __m256i lo = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(a, b, 0x88)), 0xd8);
+    __m256i hi = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(a, b, 0xdd)), 0xd8);
+    __m256i h = mix_block_avx2(_mm256_setzero_si256(), lo);
+    h = mix_block_avx2(h, hi);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), fmix_avx2(h, 8));
+  }
+  hash_scalar(keys + i, hashes + i, len - i);
+}
+
+// GCC 12 warns that the _mm512_undefined_epi32() passed by _mm512_rol_epi32() and
+// _mm512_srli_epi32() as the masked-off source may be used uninitialized, which it isn't
+// as all the lanes are written
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+__attribute__((target("avx512f"))) inline __m512i mix_block_avx512(__m512i h, __m512i k) {
+  k = _mm512_mullo_epi32(k, _mm512_set1_epi32(0xcc9e2d51));
+  k = _mm512_rol_epi32(k, 15);
+  k = _mm512_mullo_epi32(k, _mm512_set1_epi32(0x1b873593));
+  h = _mm512_xor_si512(h, k);
+  h = _mm512_rol_epi32(h, 13);
+  return _mm512_add_epi32(_mm512_mullo_epi32(h, _mm512_set1_epi32(5)),
+                          _mm512_set1_epi32(0xe6546b64));
+}
+
+__attribute__((target("avx512f"))) inline __m512i fmix_avx512(__m512i h, int len) {
+  h = _mm512_xor_si512(h, _mm512_set1_epi32(len));
+  h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+  h = _mm512_mullo_epi32(h, _mm512_set1_epi32(0x85ebca6b));
+  h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 13));
+  h = _mm512_mullo_epi32(h, _mm512_set1_epi32(0xc2b2ae35));
+  return _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+}
+
+__attribute__((target("avx512f"))) inline void hash_avx512(const uint32_t* keys,
+                                                          hash_value_type* hashes, size_t len) {
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512i k = _mm512_loadu_si512(keys + i);
+    __m512i h = mix_block_avx512(_mm512_setzero_si512(), k);
+    _mm512_storeu_si512(hashes + i, fmix_avx512(h, 4));
+  }
+  hash_scalar(keys + i, hashes + i, len - i);
+}
+
+__attribute__((target("avx512f"))) inline void hash_avx512(const uint64_t* keys,
+                                                          hash_value_type* hashes, size_t len) {
+  const __m512i lo_index =
+      _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
+  const __m512i hi_index =
+      _mm512_set_epi32(31, 29, 27, 25, 23, 21, 19, 17, 15, 13, 11, 9, 7, 5, 3, 1);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m512i a = _mm512_loadu_si512(keys + i);
+    __m512i b = _mm512_loadu_si512(keys + i + 8);
+    __m512i h = mix_block_avx512(_mm512_setzero_si512(), _mm512_permutex2var_epi32(a, lo_index, b));
+    h = mix_block_avx512(h, _mm512_permutex2var_epi32(a, hi_index, b));
+    _mm512_storeu_si512(hashes + i, fmix_avx512(h, 8));
+  }
+  hash_scalar(keys + i, hashes + i, len - i);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+template <typename Word>
+void hash_words(const Word* keys, hash_value_type* hashes, size_t len, HashIsa isa) {
+  switch (isa) {
+#ifdef NV_BATCH_HASH_X86
+    case HashIsa::AVX512:
+      hash_avx512(keys, hashes, len);
+      break;
+    case HashIsa::AVX2:
+      hash_avx2(keys, hashes, len);
+      break;
+#endif
+    default:
+      hash_scalar(keys, hashes, len);
+  }
+}
+
+}  // namespace batch_hash_detail
+
+/**
+ * Hash a batch of keys, the same as MurmurHash3_32<Key> for each one (bit-identical), with the
+ * SIMD instructions of the CPU.
+ * @param keys the keys, of 4 or 8 bytes.
+ * @param hashes the hashes of the keys.
+ * @param len the number of keys.
+ * @param isa the instruction set, get_hash_isa() by default. It must be supported by the CPU.
+ */
+template <typename Key>
+void batch_murmur_hash3_32(const Key* keys, hash_value_type* hashes, size_t len,
+                           HashIsa isa = get_hash_isa()) {
+  static_assert(sizeof(Key) == 4 || sizeof(Key) == 8, "keys of 4 or 8 bytes only");
+  typedef typename std::conditional<sizeof(Key) == 4, uint32_t, uint64_t>::type Word;
+  batch_hash_detail::hash_words(reinterpret_cast<const Word*>(keys), hashes, len, isa);
+}
+
+}  // namespace nv
+#endif
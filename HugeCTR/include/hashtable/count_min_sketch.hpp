@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COUNT_MIN_SKETCH_H_
+#define COUNT_MIN_SKETCH_H_
+#include <cuda_runtime_api.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cudf/hash_functions.cuh"
+
+namespace nv {
+
+/**
+ * The number of rows of a count-min sketch, one hash function each.
+ */
+const int COUNT_MIN_DEPTH = 4;
+
+/**
+ * The counter of a key in a row of a count-min sketch, from the MurmurHash3_32 of the key.
+ * The rows use the double hashing hash + row * step, with an odd step mixed from the hash.
+ */
+__forceinline__ __host__ __device__ size_t count_min_index(hash_value_type hash, int row,
+                                                           size_t width) {
+  uint32_t step = hash ^ 0x9e3779b9;
+  step ^= step >> 16;
+  step *= 0x85ebca6b;
+  step ^= step >> 13;
+  step *= 0xc2b2ae35;
+  step ^= step >> 16;
+  return (hash + static_cast<uint32_t>(row) * (step | 1)) % width;
+}
+
+/**
+ * The statistics of a frequency-based admission filter.
+ */
+struct AdmissionStats {
+  long long keys{0};     /**< the keys looked up, with their duplicates */
+  long long rejected{0}; /**< the keys below the threshold, mapped to the default key */
+
+  /**
+   * The counts after an earlier snapshot of the same filter.
+   */
+  AdmissionStats since(const AdmissionStats& earlier) const {
+    AdmissionStats stats;
+    stats.keys = keys - earlier.keys;
+    stats.rejected = rejected - earlier.rejected;
+    return stats;
+  }
+
+  /**
+   * One line for the log.
+   */
+  std::string to_string() const {
+    char str[96];
+    snprintf(str, sizeof(str), "%lld keys, %lld rejected (%.2f%%)", keys, rejected,
+             keys > 0 ? 100.0 * rejected / keys : 0.0);
+    return str;
+  }
+};
+
+/**
+ * The host reference of the admission filter of SparseEmbeddingHash: a count-min sketch counts
+ * the occurrences of the keys, and a key is admitted to the hash table once its estimate reaches
+ * the threshold, or if it's in the hash table already (e.g. loaded with a model). Until then
+ * it's replaced by default_key, whose row is shared by all the rare keys. The counters saturate
+ * at the threshold, which is all they need to tell, and decay() halves them so that the counts
+ * of a long stream don't fill the sketch up. An admitted key stays admitted as it's in the
+ * hash table.
+ */
+template <typename KeyType>
+class CountMinAdmission {
+ private:
+  std::vector<uint32_t> counters_; /**< COUNT_MIN_DEPTH rows of width_ counters */
+  const size_t width_;
+  const uint32_t threshold_;
+  const KeyType default_key_;
+  AdmissionStats stats_;
+
+ public:
+  /**
+   * The constructor of CountMinAdmission.
+   * @param width the counters of a row of the sketch.
+   * @param threshold the occurrences of a key before it's admitted.
+   * @param default_key the key of the shared row.
+   */
+  CountMinAdmission(size_t width, uint32_t threshold, KeyType default_key)
+      : counters_(COUNT_MIN_DEPTH * width, 0),
+        width_(width),
+        threshold_(threshold),
+        default_key_(default_key) {
+    if (width == 0) {
+      throw std::invalid_argument("CountMinAdmission: width == 0");
+    }
+  }
+  /**
+   * The estimated occurrences of key, at most the threshold.
+   */
+  uint32_t estimate(const KeyType& key) const {
+    const hash_value_type hash = MurmurHash3_32<KeyType>()(key);
+    uint32_t estimate = threshold_;
+    for (int row = 0; row < COUNT_MIN_DEPTH; row++) {
+      estimate = std::min(estimate, counters_[row * width_ + count_min_index(hash, row, width_)]);
+    }
+    return estimate;
+  }
+  /**
+   * Copy keys to admitted, a key below the threshold is replaced by default_key.
+   * @param in_table whether each key is in the hash table, which admits it whatever its
+   *        estimate. nullptr if none is.
+   * @throw std::invalid_argument if a key is default_key, which is reserved for the shared row.
+   */
+  void admit(const KeyType* keys, KeyType* admitted, size_t len, const bool* in_table = nullptr) {
+    for (size_t i = 0; i < len; i++) {
+      if (keys[i] == default_key_) {
+        throw std::invalid_argument("CountMinAdmission: the default key is reserved");
+      }
+    }
+    for (size_t i = 0; i < len; i++) {
+      if ((in_table != nullptr && in_table[i]) || estimate(keys[i]) >= threshold_) {
+        admitted[i] = keys[i];
+      } else {
+        admitted[i] = default_key_;
+        stats_.rejected++;
+      }
+    }
+    stats_.keys += len;
+  }
+  /**
+   * Count the occurrences of keys.
+   */
+  void count(const KeyType* keys, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      const hash_value_type hash = MurmurHash3_32<KeyType>()(keys[i]);
+      for (int row = 0; row < COUNT_MIN_DEPTH; row++) {
+        uint32_t& counter = counters_[row * width_ + count_min_index(hash, row, width_)];
+        if (counter < threshold_) {
+          counter++;
+        }
+      }
+    }
+  }
+  /**
+   * Halve the counters.
+   */
+  void decay() {
+    for (auto& counter : counters_) {
+      counter >>= 1;
+    }
+  }
+  /**
+   * Get the statistics of admit().
+   */
+  const AdmissionStats& get_stats() const { return stats_; }
+};
+
+}  // namespace nv
+#endif
@@ -84,6 +84,17 @@ __global__ void search_kernel(Table* table, const typename Table::key_type* cons
   }
 }
 
+template <typename Table>
+__global__ void search_or_default_kernel(Table* table, const typename Table::key_type* const keys,
+                                         typename Table::mapped_type* const vals, size_t len,
+                                         typename Table::mapped_type default_val) {
+  const size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < len) {
+    auto it = table->find(keys[i]);
+    vals[i] = it != table->end() ? it->second : default_val;
+  }
+}
+
 template <typename Table, typename counter_type>
 __global__ void get_insert_kernel(Table* table, const typename Table::key_type* const keys,
                                   typename Table::mapped_type* const vals, size_t len,
@@ -247,6 +258,23 @@ class HashTable {
     const int grid_size = (len - 1) / BLOCK_SIZE_ + 1;
     search_kernel<<<grid_size, BLOCK_SIZE_, 0, stream>>>(table_, d_keys, d_vals, len);
   }
+  /**
+   * The get function for keys which may not be in the hash table.
+   * @param d_keys the device pointers for the keys.
+   * @param d_vals the device pointers for the values.
+   * @param default_val the value of a key not in the hash table.
+   * @param len the number of <key,value> pairs to be got from the hash table.
+   * @param stream the cuda stream for this operation.
+   */
+  void get_or_default(const KeyType* d_keys, ValType* d_vals, ValType default_val, size_t len,
+                      cudaStream_t stream) const {
+    if (len == 0) {
+      return;
+    }
+    const int grid_size = (len - 1) / BLOCK_SIZE_ + 1;
+    search_or_default_kernel<<<grid_size, BLOCK_SIZE_, 0, stream>>>(table_, d_keys, d_vals, len,
+                                                                    default_val);
+  }
   /**
    * The set function for hash table. "set" means using the given values to
    * overwrite the values indexed by the given keys.
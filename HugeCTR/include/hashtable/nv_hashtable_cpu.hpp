@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NV_HASHTABLE_CPU_H_
+#define NV_HASHTABLE_CPU_H_
+#include <cuda_runtime_api.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include "batch_hash_functions.hpp"
+
+namespace nv {
+
+/**
+ * The host counterpart of HashTable, with the same operations on host pointers.
+ * It's an open addressing table with linear probing, like concurrent_unordered_map: a slot is
+ * claimed by a CAS of its key from empty_key, then its value is stored. The value of a slot is
+ * max() of ValType until it's stored, a reader of the key waits for it. All the functions can
+ * be called concurrently from several threads, each one with its own batch of keys, and there's
+ * no lock: batches of many threads scale with the cores.
+ * The keys of a batch are hashed by batch_murmur_hash3_32() before they're probed.
+ * The keys must not be empty_key and the values must not be max() of ValType.
+ *
+ * The table can grow instead of being over-provisioned, see set_growth(): once its load factor
+ * is over the maximum, rehash_step() allocates larger slots and migrates the old ones to them
+ * in bounded steps, between the batches. While it's in progress a key is looked up in the new
+ * slots, then in the old ones, and a new key is claimed in the new slots. The value of a key
+ * never changes with a rehash, so the rows it indexes (e.g. hash_table_value) stay where they
+ * are.
+ */
+template <typename KeyType, typename ValType, KeyType empty_key,
+          typename counter_type = unsigned long long int>
+class CpuHashTable {
+ private:
+  struct Slot {
+    std::atomic<KeyType> key;
+    std::atomic<ValType> value;
+  };
+
+  Slot* slots_;
+  size_t capacity_;
+  Slot* old_slots_;       /**< the slots being migrated to slots_, nullptr if no rehash */
+  size_t old_capacity_;   /**< the capacity of old_slots_ */
+  size_t rehash_cursor_;  /**< the first slot of old_slots_ which isn't migrated yet */
+  double max_load_factor_;
+  double growth_factor_;
+  std::atomic<size_t> size_;
+  std::atomic<counter_type> counter_;
+  static const size_t HASH_BATCH_ = 256; /**< keys hashed at once */
+
+  static ValType empty_value() { return std::numeric_limits<ValType>::max(); }
+
+  static size_t next(size_t index, size_t capacity) {
+    return index + 1 == capacity ? 0 : index + 1;
+  }
+
+  static Slot* allocate(size_t capacity) {
+    Slot* slots = new Slot[capacity];
+    for (size_t i = 0; i < capacity; i++) {
+      slots[i].key.store(empty_key, std::memory_order_relaxed);
+      slots[i].value.store(empty_value(), std::memory_order_relaxed);
+    }
+    return slots;
+  }
+
+  /**
+   * Call func(i, hash of keys[i]) for each key, hashing them by batches.
+   */
+  template <typename Func>
+  static void for_each_hash(const KeyType* keys, size_t len, Func func) {
+    hash_value_type hashes[HASH_BATCH_];
+    for (size_t begin = 0; begin < len; begin += HASH_BATCH_) {
+      const size_t n = std::min(len - begin, static_cast<size_t>(HASH_BATCH_));
+      batch_murmur_hash3_32(keys + begin, hashes, n);
+      for (size_t j = 0; j < n; j++) {
+        func(begin + j, hashes[j]);
+      }
+    }
+  }
+
+  /**
+   * Find the slot of key in slots.
+   * @return nullptr if key isn't in slots.
+   */
+  static Slot* find_in(Slot* slots, size_t capacity, const KeyType& key, hash_value_type hash) {
+    size_t index = hash % capacity;
+    for (size_t n = 0; n < capacity; n++, index = next(index, capacity)) {
+      const KeyType existing = slots[index].key.load(std::memory_order_acquire);
+      if (existing == key) {
+        return &slots[index];
+      }
+      if (existing == empty_key) {
+        return nullptr;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Find the slot of key in slots, or claim an empty one for it.
+   * @param inserted set to whether the slot is claimed by this call.
+   * @return nullptr if key isn't in slots and they're full.
+   */
+  static Slot* claim_in(Slot* slots, size_t capacity, const KeyType& key, hash_value_type hash,
+                        bool* inserted) {
+    size_t index = hash % capacity;
+    for (size_t n = 0; n < capacity; n++, index = next(index, capacity)) {
+      KeyType existing = slots[index].key.load(std::memory_order_acquire);
+      if (existing == empty_key) {
+        if (slots[index].key.compare_exchange_strong(existing, key, std::memory_order_acq_rel)) {
+          *inserted = true;
+          return &slots[index];
+        }
+        // claimed by another thread in the meantime, maybe for the same key
+      }
+      if (existing == key) {
+        *inserted = false;
+        return &slots[index];
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Find the slot of key, in the new slots first as the old slots of the keys migrated already
+   * are stale.
+   * @return nullptr if key isn't in the table.
+   */
+  Slot* find(const KeyType& key, hash_value_type hash) const {
+    Slot* slot = find_in(slots_, capacity_, key, hash);
+    if (slot == nullptr && old_slots_ != nullptr) {
+      slot = find_in(old_slots_, old_capacity_, key, hash);
+    }
+    return slot;
+  }
+
+  /**
+   * Find the slot of key, or claim an empty one for it.
+   * @param inserted set to whether the slot is claimed by this call.
+   * @return nullptr if key isn't in the table and the table is full.
+   */
+  Slot* find_or_claim(const KeyType& key, hash_value_type hash, bool* inserted) {
+    if (old_slots_ != nullptr) {
+      // the keys of the old slots are claimed in the new slots by rehash_step() only
+      Slot* slot = find(key, hash);
+      if (slot != nullptr) {
+        *inserted = false;
+        return slot;
+      }
+    }
+    Slot* slot = claim_in(slots_, capacity_, key, hash, inserted);
+    if (slot != nullptr && *inserted) {
+      size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return slot;
+  }
+
+  /**
+   * The value of a slot, once the thread which has claimed it has stored it.
+   */
+  static ValType wait_value(const Slot& slot) {
+    ValType value = slot.value.load(std::memory_order_acquire);
+    while (value == empty_value()) {
+      std::this_thread::yield();
+      value = slot.value.load(std::memory_order_acquire);
+    }
+    return value;
+  }
+
+ public:
+  /**
+   * The constructor of CpuHashTable.
+   * @param capacity the number of <key,value> pairs in the hash table.
+   * @param count the existed number of <key,value> pairs in the hash table.
+   */
+  CpuHashTable(size_t capacity, counter_type count = 0)
+      : slots_(nullptr),
+        capacity_(capacity),
+        old_slots_(nullptr),
+        old_capacity_(0),
+        rehash_cursor_(0),
+        max_load_factor_(0),
+        growth_factor_(0),
+        size_(0),
+        counter_(count) {
+    if (capacity == 0) {
+      throw std::invalid_argument("CpuHashTable: capacity == 0");
+    }
+    slots_ = allocate(capacity_);
+  }
+  /**
+   * The destructor of CpuHashTable.
+   */
+  ~CpuHashTable() {
+    delete[] slots_;
+    delete[] old_slots_;
+  }
+  /**
+   * The declaration for indicating that there is no default copy construtor in this class.
+   */
+  CpuHashTable(const CpuHashTable&) = delete;
+  /**
+   * The declaration for indicating that there is no default operator "=" overloading in this class.
+   */
+  CpuHashTable& operator=(const CpuHashTable&) = delete;
+  /**
+   * Put <key,value> pairs into the table, the value of a key which is already in it is replaced.
+   * @param keys the keys.
+   * @param vals the values.
+   * @param len the number of <key,value> pairs.
+   * @throw std::runtime_error if the table is full.
+   */
+  void insert(const KeyType* keys, const ValType* vals, size_t len) {
+    for_each_hash(keys, len, [this, keys, vals](size_t i, hash_value_type hash) {
+      bool inserted;
+      Slot* slot = find_or_claim(keys[i], hash, &inserted);
+      if (slot == nullptr) {
+        throw std::runtime_error("CpuHashTable::insert: table is full");
+      }
+      slot->value.store(vals[i], std::memory_order_release);
+    });
+  }
+  /**
+   * Fetch the values of keys.
+   * @param keys the keys.
+   * @param vals the values, max() of ValType for a key which isn't in the table.
+   * @param len the number of keys.
+   * @return the number of keys found.
+   */
+  size_t get(const KeyType* keys, ValType* vals, size_t len) const {
+    size_t found = 0;
+    for_each_hash(keys, len, [this, keys, vals, &found](size_t i, hash_value_type hash) {
+      const Slot* slot = find(keys[i], hash);
+      if (slot != nullptr) {
+        vals[i] = wait_value(*slot);
+        found++;
+      } else {
+        vals[i] = empty_value();
+      }
+    });
+    return found;
+  }
+  /**
+   * Overwrite the values of keys, the same as insert().
+   */
+  void set(const KeyType* keys, const ValType* vals, size_t len) { insert(keys, vals, len); }
+  /**
+   * Add vals to the values of keys, a key which isn't in the table is skipped.
+   * @return the number of keys found.
+   */
+  size_t accum(const KeyType* keys, const ValType* vals, size_t len) {
+    size_t found = 0;
+    for_each_hash(keys, len, [this, keys, vals, &found](size_t i, hash_value_type hash) {
+      Slot* slot = find(keys[i], hash);
+      if (slot == nullptr) {
+        return;
+      }
+      ValType value = wait_value(*slot);
+      while (!slot->value.compare_exchange_weak(value, value + vals[i],
+                                                std::memory_order_acq_rel)) {
+      }
+      found++;
+    });
+    return found;
+  }
+  /**
+   * Fetch the values of keys, a key which isn't in the table is inserted with the value of
+   * the counter, which is incremented atomically: the new keys get consecutive values.
+   * @throw std::runtime_error if the table is full.
+   */
+  void get_insert(const KeyType* keys, ValType* vals, size_t len) {
+    for_each_hash(keys, len, [this, keys, vals](size_t i, hash_value_type hash) {
+      bool inserted;
+      Slot* slot = find_or_claim(keys[i], hash, &inserted);
+      if (slot == nullptr) {
+        throw std::runtime_error("CpuHashTable::get_insert: table is full");
+      }
+      if (inserted) {
+        vals[i] = static_cast<ValType>(counter_.fetch_add(1, std::memory_order_relaxed));
+        slot->value.store(vals[i], std::memory_order_release);
+      } else {
+        vals[i] = wait_value(*slot);
+      }
+    });
+  }
+  /**
+   * Get the current size of the hash table, the number of <key,value> pairs.
+   */
+  size_t get_size() const { return size_.load(); }
+  /**
+   * Copy the <key,value> pairs of the slots [offset, offset + search_length) to keys and vals.
+   * A rehash in progress must be finished first, see finish_rehash().
+   * @return the number of pairs copied.
+   */
+  size_t dump(KeyType* keys, ValType* vals, size_t offset, size_t search_length) const {
+    size_t count = 0;
+    for (size_t i = offset; i < capacity_ && i - offset < search_length; i++) {
+      const KeyType key = slots_[i].key.load(std::memory_order_acquire);
+      if (key != empty_key) {
+        keys[count] = key;
+        vals[count] = wait_value(slots_[i]);
+        count++;
+      }
+    }
+    return count;
+  }
+  /**
+   * Get the capacity of the hash table, the number of slots (the new ones during a rehash).
+   */
+  size_t get_capacity() const { return capacity_; }
+  /**
+   * Let the table grow: rehash_step() starts a rehash once the size is over
+   * max_load_factor * capacity. The growth is disabled by default.
+   * The headroom of (1 - max_load_factor) * capacity must hold the new keys of the batches
+   * between two calls of rehash_step(), the table is full otherwise.
+   * @param max_load_factor the maximum load factor, in (0, 1).
+   * @param growth_factor the new capacity over the old one, > 1.
+   */
+  void set_growth(double max_load_factor, double growth_factor = 2.0) {
+    if (!(max_load_factor > 0 && max_load_factor < 1) || !(growth_factor > 1)) {
+      throw std::invalid_argument("CpuHashTable::set_growth: invalid factor");
+    }
+    max_load_factor_ = max_load_factor;
+    growth_factor_ = growth_factor;
+  }
+  /**
+   * Start a rehash if the load factor is over the maximum, then migrate up to max_slots old
+   * slots to the new ones. It must be called between the batches, e.g. once per iteration, and
+   * not concurrently with the other functions. The old slots are freed with the last step.
+   * @return whether a rehash is still in progress.
+   * @throw std::runtime_error if the table is full, the step can be retried once it has room.
+   */
+  bool rehash_step(size_t max_slots) {
+    if (old_slots_ == nullptr) {
+      if (max_load_factor_ == 0 || size_.load() <= max_load_factor_ * capacity_) {
+        return false;
+      }
+      old_slots_ = slots_;
+      old_capacity_ = capacity_;
+      rehash_cursor_ = 0;
+      capacity_ = static_cast<size_t>(std::ceil(old_capacity_ * growth_factor_));
+      slots_ = allocate(capacity_);
+    }
+    const size_t end = rehash_cursor_ + std::min(max_slots, old_capacity_ - rehash_cursor_);
+    KeyType keys[HASH_BATCH_];
+    ValType vals[HASH_BATCH_];
+    while (rehash_cursor_ < end) {
+      const size_t batch_begin = rehash_cursor_;
+      size_t count = 0;
+      for (; rehash_cursor_ < end && count < HASH_BATCH_; rehash_cursor_++) {
+        const Slot& slot = old_slots_[rehash_cursor_];
+        const KeyType key = slot.key.load(std::memory_order_relaxed);
+        if (key != empty_key) {
+          keys[count] = key;
+          vals[count] = slot.value.load(std::memory_order_relaxed);
+          count++;
+        }
+      }
+      // the new slots are larger than the old ones, but the keys inserted since the rehash
+      // started may have filled them
+      for_each_hash(keys, count, [this, &keys, &vals, batch_begin](size_t i, hash_value_type hash) {
+        bool inserted;
+        Slot* slot = claim_in(slots_, capacity_, keys[i], hash, &inserted);
+        if (slot == nullptr) {
+          // the old slots of the batch stay and are migrated again by the next step
+          rehash_cursor_ = batch_begin;
+          throw std::runtime_error("CpuHashTable::rehash_step: table is full");
+        }
+        slot->value.store(vals[i], std::memory_order_relaxed);
+      });
+    }
+    if (rehash_cursor_ == old_capacity_) {
+      delete[] old_slots_;
+      old_slots_ = nullptr;
+    }
+    return old_slots_ != nullptr;
+  }
+  /**
+   * Migrate all the old slots of a rehash in progress, if any.
+   */
+  void finish_rehash() {
+    if (old_slots_ != nullptr) {
+      rehash_step(old_capacity_);
+    }
+  }
+  /**
+   * Whether a rehash is in progress.
+   */
+  bool is_rehashing() const { return old_slots_ != nullptr; }
+  /**
+   * Get the head of the value from the counter.
+   */
+  counter_type get_value_head() const { return counter_.load(); }
+  /**
+   * Set the head of the value.
+   */
+  void set_value_head(counter_type counter_value) { counter_.store(counter_value); }
+  /**
+   * Add a number to the head of the value.
+   * @return the new head.
+   */
+  counter_type add_value_head(counter_type counter_add) {
+    return counter_.fetch_add(counter_add) + counter_add;
+  }
+};
+
+}  // namespace nv
+#endif
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NV_HASHTABLE_EVICT_CPU_H_
+#define NV_HASHTABLE_EVICT_CPU_H_
+#include <cuda_runtime_api.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "batch_hash_functions.hpp"
+
+namespace nv {
+
+/**
+ * The keys evicted by EvictingCpuHashTable when it's full.
+ */
+enum class EvictionPolicy {
+  LRU, /**< the least recently used key */
+  LFU  /**< the least frequently used key, the least recently used one of a tie */
+};
+
+/**
+ * The statistics of EvictingCpuHashTable::get_insert().
+ */
+struct EvictionStats {
+  size_t hits;      /**< the keys found in the table */
+  size_t misses;    /**< the keys inserted */
+  size_t evictions; /**< the keys evicted for the inserted ones */
+};
+
+/**
+ * The CPU reference of a capacity-bounded embedding table: get_insert() gives each key one of
+ * the rows [0, capacity), and once they're all taken the row of an evicted key is recycled for
+ * a new key. The caller resets the recycled rows, see recycle_rows().
+ * The victim is the LRU / LFU key among sample_size rows drawn at random (all the rows if
+ * sample_size >= capacity, which is exact), and a key used by the current batch is never
+ * evicted. The access metadata of a row is 8 bytes: its last batch and its access count.
+ * The index is an open addressing table with linear probing and backward shift deletion.
+ * It isn't thread safe.
+ */
+template <typename KeyType, typename ValType, KeyType empty_key>
+class EvictingCpuHashTable {
+ private:
+  struct Slot {
+    KeyType key;
+    ValType row;
+  };
+  struct RowMeta {
+    uint32_t last_use;  /**< the last batch which has used the row */
+    uint32_t frequency; /**< the number of uses, saturated */
+  };
+
+  const size_t capacity_;
+  const EvictionPolicy policy_;
+  const size_t sample_size_;
+  size_t mask_; /**< the number of slots - 1, a power of 2 */
+  std::vector<Slot> slots_;
+  std::vector<KeyType> row_keys_;
+  std::vector<RowMeta> meta_;
+  size_t num_rows_; /**< the rows given to keys so far */
+  uint32_t clock_;  /**< the current batch */
+  uint64_t random_state_;
+  EvictionStats stats_;
+  static const size_t HASH_BATCH_ = 256; /**< keys hashed at once */
+
+  static ValType empty_value() { return std::numeric_limits<ValType>::max(); }
+
+  static hash_value_type hash(const KeyType& key) { return MurmurHash3_32<KeyType>()(key); }
+
+  /**
+   * The slot of key, or the empty slot where it would be inserted.
+   */
+  size_t probe(const KeyType& key, hash_value_type hash) const {
+    size_t index = hash & mask_;
+    while (slots_[index].row != empty_value() && slots_[index].key != key) {
+      index = (index + 1) & mask_;
+    }
+    return index;
+  }
+
+  /**
+   * Empty a slot, and move back the following slots of its probe sequence.
+   */
+  void erase(size_t hole) {
+    for (size_t index = (hole + 1) & mask_; slots_[index].row != empty_value();
+         index = (index + 1) & mask_) {
+      const size_t home = hash(slots_[index].key) & mask_;
+      // the key can move to the hole if the hole is between its home and its slot
+      if (((index - home) & mask_) >= ((index - hole) & mask_)) {
+        slots_[hole] = slots_[index];
+        hole = index;
+      }
+    }
+    slots_[hole].row = empty_value();
+  }
+
+  void touch(ValType row) {
+    meta_[row].last_use = clock_;
+    if (meta_[row].frequency != std::numeric_limits<uint32_t>::max()) {
+      meta_[row].frequency++;
+    }
+  }
+
+  /**
+   * Whether row a is a better victim than row b.
+   */
+  bool less_used(ValType a, ValType b) const {
+    if (policy_ == EvictionPolicy::LFU && meta_[a].frequency != meta_[b].frequency) {
+      return meta_[a].frequency < meta_[b].frequency;
+    }
+    return meta_[a].last_use < meta_[b].last_use;
+  }
+
+  size_t next_random() {
+    // xorshift64*
+    random_state_ ^= random_state_ >> 12;
+    random_state_ ^= random_state_ << 25;
+    random_state_ ^= random_state_ >> 27;
+    return static_cast<size_t>((random_state_ * 0x2545F4914F6CDD1DULL) >> 32);
+  }
+
+  /**
+   * Evict the key of a row unused by the current batch.
+   * @return the row.
+   */
+  ValType evict() {
+    ValType victim = empty_value();
+    const bool exact = sample_size_ >= capacity_;
+    // a batch is unlikely to hold most of the rows, the sampling retries otherwise
+    for (size_t n = 0; n < (exact ? capacity_ : std::max(sample_size_, capacity_)); n++) {
+      const ValType row = static_cast<ValType>(exact ? n : next_random() % capacity_);
+      if (meta_[row].last_use != clock_ && (victim == empty_value() || less_used(row, victim))) {
+        victim = row;
+      }
+      if (!exact && n + 1 >= sample_size_ && victim != empty_value()) {
+        break;
+      }
+    }
+    if (victim == empty_value()) {
+      throw std::runtime_error("EvictingCpuHashTable: a batch has more keys than capacity");
+    }
+    erase(probe(row_keys_[victim], hash(row_keys_[victim])));
+    stats_.evictions++;
+    return victim;
+  }
+
+ public:
+  /**
+   * The constructor of EvictingCpuHashTable.
+   * @param capacity the number of rows.
+   * @param policy the eviction policy.
+   * @param sample_size the number of rows sampled for an eviction.
+   * @param seed the seed of the sampling.
+   */
+  EvictingCpuHashTable(size_t capacity, EvictionPolicy policy, size_t sample_size = 8,
+                       uint64_t seed = 0)
+      : capacity_(capacity),
+        policy_(policy),
+        sample_size_(sample_size),
+        mask_(1),
+        row_keys_(capacity, empty_key),
+        meta_(capacity, RowMeta{0, 0}),
+        num_rows_(0),
+        clock_(0),
+        random_state_(seed * 0x9E3779B97F4A7C15ULL + 1),
+        stats_{0, 0, 0} {
+    if (capacity == 0 || sample_size == 0) {
+      throw std::invalid_argument("EvictingCpuHashTable: capacity == 0 or sample_size == 0");
+    }
+    if (static_cast<unsigned long long>(capacity) >=
+        static_cast<unsigned long long>(empty_value())) {
+      throw std::invalid_argument("EvictingCpuHashTable: capacity is too large for ValType");
+    }
+    // a load factor of 0.5 at most
+    while (mask_ + 1 < capacity * 2) {
+      mask_ = mask_ * 2 + 1;
+    }
+    slots_.assign(mask_ + 1, Slot{empty_key, empty_value()});
+  }
+  /**
+   * Fetch the rows of a batch of keys, a key which isn't in the table gets a free row, or the
+   * row of an evicted key once the table is full.
+   * @param keys the keys.
+   * @param vals the rows.
+   * @param len the number of keys.
+   * @param recycled the rows of the evicted keys are appended to it, if not nullptr.
+   * @throw std::runtime_error if the batch has more distinct keys than the capacity.
+   */
+  void get_insert(const KeyType* keys, ValType* vals, size_t len,
+                  std::vector<ValType>* recycled = nullptr) {
+    clock_++;
+    hash_value_type hashes[HASH_BATCH_];
+    for (size_t begin = 0; begin < len; begin += HASH_BATCH_) {
+      const size_t n = std::min(len - begin, static_cast<size_t>(HASH_BATCH_));
+      batch_murmur_hash3_32(keys + begin, hashes, n);
+      for (size_t j = 0; j < n; j++) {
+        const KeyType& key = keys[begin + j];
+        size_t index = probe(key, hashes[j]);
+        ValType row = slots_[index].row;
+        if (row != empty_value()) {
+          stats_.hits++;
+        } else {
+          stats_.misses++;
+          if (num_rows_ < capacity_) {
+            row = static_cast<ValType>(num_rows_++);
+          } else {
+            row = evict();
+            if (recycled != nullptr) {
+              recycled->push_back(row);
+            }
+            // the eviction may have moved the slots
+            index = probe(key, hashes[j]);
+          }
+          slots_[index] = Slot{key, row};
+          row_keys_[row] = key;
+          meta_[row] = RowMeta{0, 0};
+        }
+        touch(row);
+        vals[begin + j] = row;
+      }
+    }
+  }
+  /**
+   * Fetch the rows of keys, without the access metadata.
+   * @param vals the rows, max() of ValType for a key which isn't in the table.
+   * @return the number of keys found.
+   */
+  size_t get(const KeyType* keys, ValType* vals, size_t len) const {
+    size_t found = 0;
+    for (size_t i = 0; i < len; i++) {
+      vals[i] = slots_[probe(keys[i], hash(keys[i]))].row;
+      if (vals[i] != empty_value()) {
+        found++;
+      }
+    }
+    return found;
+  }
+  /**
+   * Get the number of keys in the table.
+   */
+  size_t get_size() const { return num_rows_; }
+  /**
+   * Get the capacity of the table, the number of rows.
+   */
+  size_t get_capacity() const { return capacity_; }
+  /**
+   * Get the statistics of get_insert() since the last reset_stats().
+   */
+  const EvictionStats& get_stats() const { return stats_; }
+  /**
+   * Reset the statistics.
+   */
+  void reset_stats() { stats_ = EvictionStats{0, 0, 0}; }
+};
+
+/**
+ * Reset the rows recycled for new keys, as SparseEmbeddingHash initializes them: the embedding
+ * vectors are drawn from uniform(-1 / embedding_vec_size, 1 / embedding_vec_size), and the
+ * optimizer states (opt_m and opt_v, or momentum) are zeroed.
+ * @param opt_states the optimizer states, embedding_vec_size floats per row.
+ */
+template <typename ValType>
+void recycle_rows(const ValType* rows, size_t num_rows, size_t embedding_vec_size,
+                  float* hash_table_value, const std::vector<float*>& opt_states,
+                  std::mt19937& generator) {
+  std::uniform_real_distribution<float> distribution(-1.f / embedding_vec_size,
+                                                     1.f / embedding_vec_size);
+  for (size_t i = 0; i < num_rows; i++) {
+    const size_t offset = static_cast<size_t>(rows[i]) * embedding_vec_size;
+    for (size_t j = 0; j < embedding_vec_size; j++) {
+      hash_table_value[offset + j] = distribution(generator);
+    }
+    for (float* opt_state : opt_states) {
+      std::fill(opt_state + offset, opt_state + offset + embedding_vec_size, 0.f);
+    }
+  }
+}
+
+}  // namespace nv
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cuda_runtime_api.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include "HugeCTR/include/common.hpp"
+
+namespace HugeCTR {
+
+/**
+ * @brief Policy of the host memory of the CSR / CSRChunk buffers.
+ *
+ * The memory returned by allocate() is aligned to a page and not initialized.
+ * An allocator is shared (std::shared_ptr) by all the buffers allocated with it,
+ * e.g. all the chunks of a ring, and must be thread safe.
+ */
+class HostAllocator {
+ public:
+  virtual ~HostAllocator() {}
+  /**
+   * @param size size in bytes.
+   */
+  virtual void* allocate(size_t size) = 0;
+  /**
+   * @param ptr memory returned by allocate().
+   * @param size the size passed to allocate().
+   */
+  virtual void deallocate(void* ptr, size_t size) = 0;
+  virtual HostAllocator_t get_type() const = 0;
+};
+
+/**
+ * Page aligned memory from posix_memalign(), without any CUDA call.
+ */
+class AlignedHostAllocator : public HostAllocator {
+ public:
+  static const size_t ALIGNMENT = 4096;
+
+  void* allocate(size_t size) override {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, ALIGNMENT, size > 0 ? size : 1) != 0) {
+      CK_THROW_(Error_t::OutOfMemory, "posix_memalign() failed");
+    }
+    return ptr;
+  }
+  void deallocate(void* ptr, size_t) override { free(ptr); }
+  HostAllocator_t get_type() const override { return HostAllocator_t::Aligned; }
+};
+
+/**
+ * Aligned memory registered to CUDA (page-locked), so that it can be copied to GPU
+ * asynchronously. This is the default of CSR and CSRChunk.
+ */
+class PinnedHostAllocator : public AlignedHostAllocator {
+ public:
+  void* allocate(size_t size) override {
+    void* ptr = AlignedHostAllocator::allocate(size);
+    cudaError_t ret = cudaHostRegister(ptr, size > 0 ? size : 1, cudaHostRegisterDefault);
+    if (ret != cudaSuccess) {
+      AlignedHostAllocator::deallocate(ptr, size);
+      CK_THROW_(Error_t::CudaError,
+                std::string("cudaHostRegister() failed: ") + cudaGetErrorString(ret));
+    }
+    return ptr;
+  }
+  void deallocate(void* ptr, size_t size) override {
+    CK_CUDA_THROW_(cudaHostUnregister(ptr));
+    AlignedHostAllocator::deallocate(ptr, size);
+  }
+  HostAllocator_t get_type() const override { return HostAllocator_t::Pinned; }
+};
+
+/**
+ * Anonymous mappings backed by 2MB pages.
+ * Explicit huge pages (MAP_HUGETLB) are used when the system has some reserved,
+ * otherwise the mapping is advised to transparent huge pages (MADV_HUGEPAGE).
+ * The sizes are rounded up to 2MB.
+ */
+class HugePageHostAllocator : public HostAllocator {
+ protected:
+  static size_t round_up_(size_t size) {
+    return (std::max(size, static_cast<size_t>(1)) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE *
+           HUGE_PAGE_SIZE;
+  }
+
+ public:
+  static const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+  void* allocate(size_t size) override {
+    const size_t length = round_up_(size);
+    void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr == MAP_FAILED) {
+      ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ptr == MAP_FAILED) {
+        CK_THROW_(Error_t::OutOfMemory, "mmap() failed");
+      }
+      madvise(ptr, length, MADV_HUGEPAGE);
+    }
+    return ptr;
+  }
+  void deallocate(void* ptr, size_t size) override { munmap(ptr, round_up_(size)); }
+  HostAllocator_t get_type() const override { return HostAllocator_t::HugePage; }
+};
+
+/**
+ * 2MB pages (see HugePageHostAllocator) bound to a NUMA node with mbind().
+ * Without a node (numa_node < 0) the pages are left to the default first touch policy.
+ * The chunks of a data reader are created on its constructing thread, which zeroes their
+ * label buffers, and are shared by all the reading threads, so their pages don't follow
+ * any one reading thread: bind the reading threads and numa_node to the same node instead.
+ */
+class NumaHostAllocator : public HugePageHostAllocator {
+ private:
+  const int numa_node_;
+
+ public:
+  static const int MAX_NUMA_NODES = 1024;
+
+  /**
+   * Ctor.
+   * @param numa_node the NUMA node the pages are bound to, -1 for the first touch policy.
+   */
+  explicit NumaHostAllocator(int numa_node = -1) : numa_node_(numa_node) {
+    if (numa_node >= MAX_NUMA_NODES) {
+      CK_THROW_(Error_t::WrongInput, "numa_node >= " + std::to_string(MAX_NUMA_NODES));
+    }
+  }
+
+  void* allocate(size_t size) override {
+    void* ptr = HugePageHostAllocator::allocate(size);
+    if (numa_node_ >= 0) {
+      const int MPOL_BIND = 2;
+      const int BITS = sizeof(unsigned long) * 8;
+      unsigned long node_mask[MAX_NUMA_NODES / BITS] = {0};
+      node_mask[numa_node_ / BITS] |= 1UL << (numa_node_ % BITS);
+      if (syscall(SYS_mbind, ptr, round_up_(size), MPOL_BIND, node_mask, MAX_NUMA_NODES, 0)) {
+        HugePageHostAllocator::deallocate(ptr, size);
+        CK_THROW_(Error_t::WrongInput,
+                  "mbind() failed on NUMA node " + std::to_string(numa_node_));
+      }
+    }
+    return ptr;
+  }
+  HostAllocator_t get_type() const override { return HostAllocator_t::Numa; }
+  int get_numa_node() const { return numa_node_; }
+};
+
+/**
+ * Create an allocator of type.
+ * @param numa_node the NUMA node of HostAllocator_t::Numa, -1 for the first touch policy.
+ */
+inline std::shared_ptr<HostAllocator> create_host_allocator(HostAllocator_t type,
+                                                            int numa_node = -1) {
+  switch (type) {
+    case HostAllocator_t::Pinned:
+      return std::make_shared<PinnedHostAllocator>();
+    case HostAllocator_t::Aligned:
+      return std::make_shared<AlignedHostAllocator>();
+    case HostAllocator_t::HugePage:
+      return std::make_shared<HugePageHostAllocator>();
+    case HostAllocator_t::Numa:
+      return std::make_shared<NumaHostAllocator>(numa_node);
+  }
+  CK_THROW_(Error_t::WrongInput, "unknown HostAllocator_t");
+  return nullptr;
+}
+
+/**
+ * The allocator shared by the buffers created without one.
+ */
+inline const std::shared_ptr<HostAllocator>& default_host_allocator() {
+  static std::shared_ptr<HostAllocator> allocator = std::make_shared<PinnedHostAllocator>();
+  return allocator;
+}
+
+}  // namespace HugeCTR
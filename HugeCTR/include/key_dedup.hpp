@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "HugeCTR/include/common.hpp"
+
+namespace HugeCTR {
+
+/**
+ * @brief Deduplication of the keys of a batch on CPU.
+ *
+ * The keys are inserted into an open addressing (linear probing) table, which is
+ * kept between the calls and only the used slots are cleared, so a call costs
+ * O(number of keys) without allocation once the table has grown to the batch size.
+ * An object is used by one thread (e.g. a DataReaderMultiThreads).
+ * @verbatim
+ * For example keys:    7,3,7,9,3,7
+ * Unique keys:         7,3,9        (in the order of first appearance)
+ * Inverse index:       0,1,0,2,1,0  (keys[j] == unique_keys[inverse_index[j]])
+ * @endverbatim
+ */
+template <typename T>
+class KeyDedup {
+ private:
+  static const int EMPTY = -1;
+  std::vector<T> table_keys_;
+  std::vector<int> table_ids_;  /**< index of the key in unique keys, EMPTY if the slot is free */
+  std::vector<size_t> used_;    /**< slots used by the current call */
+  size_t mask_{0};
+
+  static size_t hash_(T key) {
+    // finalizer of MurmurHash3 (64 bits)
+    uint64_t h = static_cast<uint64_t>(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+
+  void reserve_(int num_keys) {
+    size_t size = 16;
+    while (size < 2 * static_cast<size_t>(num_keys)) {
+      size <<= 1;
+    }
+    if (size > table_keys_.size()) {
+      table_keys_.resize(size);
+      table_ids_.assign(size, EMPTY);
+      mask_ = size - 1;
+      used_.reserve(size / 2);
+    }
+  }
+
+ public:
+  /**
+   * Deduplicate num_keys keys.
+   * @param keys the keys.
+   * @param num_keys the number of keys.
+   * @param unique_keys the distinct keys in the order of first appearance are passed out.
+   * @param inverse_index the index in unique_keys of each key is passed out.
+   */
+  void dedup(const T* keys, int num_keys, std::vector<T>* unique_keys,
+             std::vector<int>* inverse_index) {
+    if (num_keys < 0 || unique_keys == nullptr || inverse_index == nullptr) {
+      CK_THROW_(Error_t::WrongInput,
+                "num_keys < 0 || unique_keys == nullptr || inverse_index == nullptr");
+    }
+    reserve_(num_keys);
+    unique_keys->clear();
+    inverse_index->resize(num_keys);
+    for (int j = 0; j < num_keys; j++) {
+      const T key = keys[j];
+      size_t pos = hash_(key) & mask_;
+      while (table_ids_[pos] != EMPTY && table_keys_[pos] != key) {
+        pos = (pos + 1) & mask_;
+      }
+      if (table_ids_[pos] == EMPTY) {
+        table_keys_[pos] = key;
+        table_ids_[pos] = static_cast<int>(unique_keys->size());
+        used_.push_back(pos);
+        unique_keys->push_back(key);
+      }
+      (*inverse_index)[j] = table_ids_[pos];
+    }
+    for (size_t pos : used_) {
+      table_ids_[pos] = EMPTY;
+    }
+    used_.clear();
+  }
+};
+
+template <typename T>
+const int KeyDedup<T>::EMPTY;
+
+}  // namespace HugeCTR
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "HugeCTR/include/common.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
+
+namespace HugeCTR {
+
+const long long KEY_DICTIONARY_MAGIC = 0x31544349444b4748LL; /**< "HGKDICT1" */
+
+/**
+ * The most keys of a dictionary. The compact keys stay below max() - 1 of unsigned int, since
+ * max() is the empty key of the hash table and max() - 1 the default key of the admission.
+ */
+const unsigned long long KEY_DICTIONARY_MAX_KEYS = std::numeric_limits<unsigned int>::max() - 1ULL;
+
+/**
+ * Header of a key dictionary file, followed by long long key[num_keys], the key of
+ * each compact key (the index).
+ */
+typedef struct KeyDictionaryHeader_ {
+  long long magic;     // KEY_DICTIONARY_MAGIC
+  long long num_keys;  // the number of keys in the dictionary
+  long long reserved;
+} KeyDictionaryHeader;
+
+/**
+ * @brief A dense remapping of the 64-bit keys of a data set to 32-bit ones.
+ *
+ * The keys are numbered 0, 1, 2, ... in the order they are added, so a data set with at most
+ * KEY_DICTIONARY_MAX_KEYS distinct keys can be trained with unsigned int keys, which halves the
+ * bytes of the keys in the CSR buffers, the H2D copies and the hash tables. The keys of a data
+ * set are added by their frequency (see add_keys()), so the most frequent keys have the
+ * smallest compact keys and the modulo partitioner deals them to the devices in turn.
+ */
+class KeyDictionary {
+ private:
+  std::unordered_map<long long, unsigned int> compact_keys_;
+  std::vector<long long> keys_; /**< the key of each compact key */
+
+ public:
+  KeyDictionary() {}
+
+  /**
+   * Load a dictionary written by save().
+   */
+  explicit KeyDictionary(const std::string& file_name) {
+    std::ifstream in_stream(file_name, std::ifstream::binary);
+    if (!in_stream.is_open()) {
+      CK_THROW_(Error_t::FileCannotOpen, "in_stream.is_open() failed: " + file_name);
+    }
+    KeyDictionaryHeader header;
+    in_stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in_stream || header.magic != KEY_DICTIONARY_MAGIC || header.num_keys < 0 ||
+        static_cast<unsigned long long>(header.num_keys) > KEY_DICTIONARY_MAX_KEYS) {
+      CK_THROW_(Error_t::UnSupportedFormat, "broken key dictionary: " + file_name);
+    }
+    std::vector<long long> keys(header.num_keys);
+    in_stream.read(reinterpret_cast<char*>(keys.data()), keys.size() * sizeof(long long));
+    if (!in_stream) {
+      CK_THROW_(Error_t::UnSupportedFormat, "broken key dictionary: " + file_name);
+    }
+    compact_keys_.reserve(keys.size());
+    for (long long key : keys) {
+      if (find(key) != nullptr) {
+        CK_THROW_(Error_t::UnSupportedFormat, "duplicate key in key dictionary: " + file_name);
+      }
+      add(key);
+    }
+  }
+
+  /**
+   * Write the dictionary.
+   */
+  void save(const std::string& file_name) const {
+    std::ofstream out_stream(file_name, std::ofstream::binary);
+    if (!out_stream.is_open()) {
+      CK_THROW_(Error_t::FileCannotOpen, "out_stream.is_open() failed: " + file_name);
+    }
+    KeyDictionaryHeader header = {KEY_DICTIONARY_MAGIC, static_cast<long long>(keys_.size()), 0};
+    out_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_stream.write(reinterpret_cast<const char*>(keys_.data()), keys_.size() * sizeof(long long));
+    if (!out_stream) {
+      CK_THROW_(Error_t::UnspecificError, "failed to write " + file_name);
+    }
+  }
+
+  /**
+   * The number of keys, the compact keys are [0, size()).
+   */
+  size_t size() const { return keys_.size(); }
+
+  /**
+   * The compact key of a key, nullptr if the key isn't in the dictionary.
+   */
+  const unsigned int* find(long long key) const {
+    auto it = compact_keys_.find(key);
+    return it == compact_keys_.end() ? nullptr : &it->second;
+  }
+
+  /**
+   * The key of a compact key.
+   */
+  long long get_key(unsigned int compact_key) const {
+    if (compact_key >= keys_.size()) {
+      CK_THROW_(Error_t::WrongInput, "compact_key >= size()");
+    }
+    return keys_[compact_key];
+  }
+
+  /**
+   * Add a key if it isn't in the dictionary.
+   * @return the compact key of the key.
+   */
+  unsigned int add(long long key) {
+    auto it = compact_keys_.find(key);
+    if (it != compact_keys_.end()) {
+      return it->second;
+    }
+    if (keys_.size() >= KEY_DICTIONARY_MAX_KEYS) {
+      CK_THROW_(Error_t::WrongInput, "more than 2^32 - 2 keys, they don't fit in unsigned int");
+    }
+    unsigned int compact_key = static_cast<unsigned int>(keys_.size());
+    compact_keys_.emplace(key, compact_key);
+    keys_.push_back(key);
+    return compact_key;
+  }
+
+  /**
+   * Add the keys of some data files which aren't in the dictionary, the most frequent ones
+   * first (ties by key, so the result doesn't depend on the order of the files).
+   * @return the number of keys added.
+   */
+  size_t add_keys(const std::vector<std::string>& data_file_names) {
+    std::unordered_map<long long, long long> counts;
+    for (auto& file_name : data_file_names) {
+      DataSetRecordReader<long long> reader(file_name);
+      const DataSetHeader& header = reader.get_header();
+      while (reader.next()) {
+        long long nnz = 0;
+        for (int k = 0; k < header.slot_num; k++) {
+          nnz += reader.get_nnz()[k];
+        }
+        for (long long j = 0; j < nnz; j++) {
+          long long key = reader.get_keys()[j];
+          if (find(key) == nullptr) {
+            counts[key]++;
+          }
+        }
+      }
+    }
+    std::vector<std::pair<long long, long long>> new_keys(counts.begin(), counts.end());
+    typedef std::pair<long long, long long> KeyCount;
+    std::sort(new_keys.begin(), new_keys.end(), [](const KeyCount& a, const KeyCount& b) {
+      return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    if (keys_.size() + new_keys.size() > KEY_DICTIONARY_MAX_KEYS) {
+      CK_THROW_(Error_t::WrongInput, "more than 2^32 - 2 keys, they don't fit in unsigned int");
+    }
+    compact_keys_.reserve(keys_.size() + new_keys.size());
+    for (auto& key_count : new_keys) {
+      add(key_count.first);
+    }
+    return new_keys.size();
+  }
+};
+
+/**
+ * Rewrite a data file with long long keys to one with the compact unsigned int keys. The
+ * output keeps the version, block size, codec and dense features of the input.
+ * @param dictionary the dictionary, which must have all the keys of the file.
+ * @return the number of samples written.
+ */
+inline long long compact_data_file(const KeyDictionary& dictionary,
+                                   const std::string& in_file_name,
+                                   const std::string& out_file_name) {
+  DataSetRecordReader<long long> reader(in_file_name);
+  const DataSetHeader& header = reader.get_header();
+  const long long version = get_data_set_version(header);
+  const long long records_per_block = version == DATA_SET_V2
+                                          ? DataSetIndex(in_file_name).get_records_per_block()
+                                          : DATA_SET_DEFAULT_RECORDS_PER_BLOCK;
+  DataSetWriter<unsigned int> writer(out_file_name, header.label_dim, header.slot_num, version,
+                                     records_per_block, get_data_set_codec(header), 1,
+                                     get_data_set_dense_dim(header));
+  std::vector<unsigned int> compact_keys;
+  while (reader.next()) {
+    long long nnz = 0;
+    for (int k = 0; k < header.slot_num; k++) {
+      nnz += reader.get_nnz()[k];
+    }
+    compact_keys.resize(nnz);
+    for (long long j = 0; j < nnz; j++) {
+      const unsigned int* compact_key = dictionary.find(reader.get_keys()[j]);
+      if (compact_key == nullptr) {
+        CK_THROW_(Error_t::WrongInput, "key " + std::to_string(reader.get_keys()[j]) +
+                                           " isn't in the dictionary: " + in_file_name);
+      }
+      compact_keys[j] = *compact_key;
+    }
+    writer.write_record(reader.get_label(), reader.get_nnz(), compact_keys.data(),
+                        reader.get_dense());
+  }
+  writer.close();
+  return writer.get_number_of_records();
+}
+
+/**
+ * Rewrite the keys of an embedding file (pairs of TypeIn key | float value[embedding_vec_size],
+ * see SparseEmbeddingHash::download_params_to_host()) with a function of the keys.
+ * @param convert convert(key, &out_key) returns false to drop the pair.
+ * @return the number of pairs written and dropped.
+ */
+template <typename TypeIn, typename TypeOut, typename Convert>
+std::pair<long long, long long> convert_embedding_file(const std::string& in_file_name,
+                                                       const std::string& out_file_name,
+                                                       int embedding_vec_size, Convert convert) {
+  if (embedding_vec_size <= 0) {
+    CK_THROW_(Error_t::WrongInput, "embedding_vec_size <= 0");
+  }
+  std::ifstream in_stream(in_file_name, std::ifstream::binary);
+  if (!in_stream.is_open()) {
+    CK_THROW_(Error_t::FileCannotOpen, "in_stream.is_open() failed: " + in_file_name);
+  }
+  std::ofstream out_stream(out_file_name, std::ofstream::binary);
+  if (!out_stream.is_open()) {
+    CK_THROW_(Error_t::FileCannotOpen, "out_stream.is_open() failed: " + out_file_name);
+  }
+  in_stream.seekg(0, std::ios_base::end);
+  const long long file_size = in_stream.tellg();
+  in_stream.seekg(0, std::ios_base::beg);
+  const long long pair_size = sizeof(TypeIn) + sizeof(float) * embedding_vec_size;
+  if (file_size % pair_size != 0) {
+    CK_THROW_(Error_t::WrongInput,
+              "the size of embedding file isn't a multiple of a <key, value> pair: " +
+                  in_file_name);
+  }
+  std::vector<float> value(embedding_vec_size);
+  long long written = 0;
+  long long dropped = 0;
+  for (long long i = 0; i < file_size / pair_size; i++) {
+    TypeIn key;
+    in_stream.read(reinterpret_cast<char*>(&key), sizeof(TypeIn));
+    in_stream.read(reinterpret_cast<char*>(value.data()), sizeof(float) * embedding_vec_size);
+    TypeOut out_key;
+    if (!convert(key, &out_key)) {
+      dropped++;
+      continue;
+    }
+    out_stream.write(reinterpret_cast<const char*>(&out_key), sizeof(TypeOut));
+    out_stream.write(reinterpret_cast<const char*>(value.data()),
+                     sizeof(float) * embedding_vec_size);
+    written++;
+  }
+  if (!in_stream || !out_stream) {
+    CK_THROW_(Error_t::UnspecificError, "failed to convert " + in_file_name);
+  }
+  return std::make_pair(written, dropped);
+}
+
+/**
+ * Rewrite an embedding file trained with long long keys to one with the compact keys. The
+ * keys which aren't in the dictionary are dropped, they don't occur in the compacted data.
+ * @return the number of pairs written and dropped.
+ */
+inline std::pair<long long, long long> compact_embedding_file(const KeyDictionary& dictionary,
+                                                              const std::string& in_file_name,
+                                                              const std::string& out_file_name,
+                                                              int embedding_vec_size) {
+  return convert_embedding_file<long long, unsigned int>(
+      in_file_name, out_file_name, embedding_vec_size,
+      [&dictionary](long long key, unsigned int* compact_key) {
+        const unsigned int* found = dictionary.find(key);
+        if (found == nullptr) {
+          return false;
+        }
+        *compact_key = *found;
+        return true;
+      });
+}
+
+/**
+ * Rewrite an embedding file trained with the compact keys to one with the original long long
+ * keys, e.g. for serving with the original data.
+ * @return the number of pairs written (none is dropped).
+ */
+inline long long expand_embedding_file(const KeyDictionary& dictionary,
+                                       const std::string& in_file_name,
+                                       const std::string& out_file_name, int embedding_vec_size) {
+  return convert_embedding_file<unsigned int, long long>(
+             in_file_name, out_file_name, embedding_vec_size,
+             [&dictionary](unsigned int compact_key, long long* key) {
+               *key = dictionary.get_key(compact_key);
+               return true;
+             })
+      .first;
+}
+
+}  // namespace HugeCTR
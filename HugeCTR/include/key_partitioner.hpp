@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "HugeCTR/include/common.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
+
+namespace HugeCTR {
+
+const long long KEY_PARTITION_TABLE_MAGIC = 0x31545041504b4748LL; /**< "HGKPAPT1" */
+
+/**
+ * Header of a key partition table file, followed by num_keys pairs of
+ * long long key | long long device.
+ */
+typedef struct KeyPartitionTableHeader_ {
+  long long magic;        // KEY_PARTITION_TABLE_MAGIC
+  long long num_devices;  // the number of devices the keys are partitioned to
+  long long num_keys;     // the number of keys in the table
+  long long reserved;
+} KeyPartitionTableHeader;
+
+/**
+ * @brief Decides which device a key goes to.
+ *
+ * The reading threads route a key to the CSR buffer of its device, and the embedding uploads
+ * a key of a model file to the hash table of the same device, so the partitioner must be a
+ * function of the key only. The devices are the global ones (all the nodes).
+ */
+template <typename T>
+class KeyPartitioner {
+ private:
+  const int num_devices_;
+
+ public:
+  explicit KeyPartitioner(int num_devices) : num_devices_(num_devices) {
+    if (num_devices <= 0) {
+      CK_THROW_(Error_t::WrongInput, "num_devices <= 0");
+    }
+  }
+  KeyPartitioner(const KeyPartitioner&) = delete;
+  KeyPartitioner& operator=(const KeyPartitioner&) = delete;
+  virtual ~KeyPartitioner() {}
+
+  /**
+   * @return the device of key in [0, num_devices).
+   */
+  virtual int get_device(T key) const = 0;
+  int get_num_devices() const { return num_devices_; }
+};
+
+/**
+ * key % num_devices, the partitioning of HugeCTR before the partitioners.
+ */
+template <typename T>
+class ModuloKeyPartitioner : public KeyPartitioner<T> {
+ public:
+  explicit ModuloKeyPartitioner(int num_devices) : KeyPartitioner<T>(num_devices) {}
+  int get_device(T key) const override {
+    return static_cast<int>(static_cast<unsigned long long>(key) %
+                            static_cast<unsigned long long>(this->get_num_devices()));
+  }
+};
+
+/**
+ * Multiplicative (Fibonacci) hashing: the high bits of key * 2^64 / phi are scaled to
+ * [0, num_devices). Keys with a structure in their low bits (strides, slot ids) are spread
+ * evenly, where the modulo would map them to a few devices.
+ */
+template <typename T>
+class HashKeyPartitioner : public KeyPartitioner<T> {
+ public:
+  explicit HashKeyPartitioner(int num_devices) : KeyPartitioner<T>(num_devices) {}
+  int get_device(T key) const override {
+    const uint64_t hash = static_cast<uint64_t>(key) * 0x9e3779b97f4a7c15ULL;
+    return static_cast<int>(((hash >> 32) * static_cast<uint64_t>(this->get_num_devices())) >>
+                            32);
+  }
+};
+
+/**
+ * For the key spaces where the slot of a key is key % slot_num (e.g. criteo2hugectr): the
+ * modulo maps all the keys of a slot to the same device if slot_num is a multiple of
+ * num_devices, so a popular slot loads a single device. Here the keys of each slot are
+ * striped over all the devices by their rank in the slot (key / slot_num), starting from a
+ * different device for each slot.
+ */
+template <typename T>
+class SlotAwareKeyPartitioner : public KeyPartitioner<T> {
+ private:
+  const unsigned long long slot_num_;
+
+ public:
+  SlotAwareKeyPartitioner(int num_devices, int slot_num)
+      : KeyPartitioner<T>(num_devices), slot_num_(slot_num) {
+    if (slot_num <= 0) {
+      CK_THROW_(Error_t::WrongInput, "slot_num <= 0");
+    }
+  }
+  int get_device(T key) const override {
+    const unsigned long long k = static_cast<unsigned long long>(key);
+    return static_cast<int>((k / slot_num_ + k % slot_num_) %
+                            static_cast<unsigned long long>(this->get_num_devices()));
+  }
+};
+
+/**
+ * The devices of the frequent keys are given by a table built from a profiling pass of the
+ * data set (see build_key_partition_table()), the other keys are hashed.
+ */
+template <typename T>
+class FrequencyKeyPartitioner : public KeyPartitioner<T> {
+ private:
+  std::unordered_map<T, int> table_;
+  HashKeyPartitioner<T> fallback_;
+
+ public:
+  /**
+   * Ctor.
+   * @param num_devices the number of devices.
+   * @param table the device of each frequent key.
+   */
+  FrequencyKeyPartitioner(int num_devices, const std::vector<std::pair<T, int>>& table)
+      : KeyPartitioner<T>(num_devices), fallback_(num_devices) {
+    table_.reserve(table.size());
+    for (auto& key_device : table) {
+      if (key_device.second < 0 || key_device.second >= num_devices) {
+        CK_THROW_(Error_t::WrongInput, "device of a key is out of range");
+      }
+      table_[key_device.first] = key_device.second;
+    }
+  }
+  int get_device(T key) const override {
+    auto it = table_.find(key);
+    return it != table_.end() ? it->second : fallback_.get_device(key);
+  }
+  size_t get_table_size() const { return table_.size(); }
+};
+
+/**
+ * Assign the keys to the devices to balance the lookups: the keys beyond the max_table_keys
+ * most frequent ones are hashed (as FrequencyKeyPartitioner does), then the frequent keys,
+ * the most frequent first, go to the least loaded device.
+ * @param key_counts the number of occurrences of each key in the data set.
+ * @param num_devices the number of devices.
+ * @param max_table_keys the max number of keys in the table.
+ * @return the device of each frequent key.
+ */
+template <typename T>
+std::vector<std::pair<T, int>> build_key_partition_table(
+    const std::unordered_map<T, long long>& key_counts, int num_devices, size_t max_table_keys) {
+  std::vector<std::pair<long long, T>> counts;
+  counts.reserve(key_counts.size());
+  for (auto& key_count : key_counts) {
+    counts.push_back(std::make_pair(key_count.second, key_count.first));
+  }
+  // ties are broken by the key, so the table doesn't depend on the order of the hash map
+  std::sort(counts.begin(), counts.end(), std::greater<std::pair<long long, T>>());
+  const size_t num_table_keys = std::min(max_table_keys, counts.size());
+
+  HashKeyPartitioner<T> fallback(num_devices);
+  std::vector<long long> loads(num_devices, 0);
+  for (size_t i = num_table_keys; i < counts.size(); i++) {
+    loads[fallback.get_device(counts[i].second)] += counts[i].first;
+  }
+  typedef std::pair<long long, int> LoadDevice;
+  std::priority_queue<LoadDevice, std::vector<LoadDevice>, std::greater<LoadDevice>> devices;
+  for (int device = 0; device < num_devices; device++) {
+    devices.push(std::make_pair(loads[device], device));
+  }
+  std::vector<std::pair<T, int>> table;
+  table.reserve(num_table_keys);
+  for (size_t i = 0; i < num_table_keys; i++) {
+    LoadDevice least_loaded = devices.top();
+    devices.pop();
+    table.push_back(std::make_pair(counts[i].second, least_loaded.second));
+    least_loaded.first += counts[i].first;
+    devices.push(least_loaded);
+  }
+  return table;
+}
+
+template <typename T>
+void write_key_partition_table(const std::string& file_name, int num_devices,
+                               const std::vector<std::pair<T, int>>& table) {
+  std::ofstream out_stream(file_name, std::ofstream::binary);
+  if (!out_stream.is_open()) {
+    CK_THROW_(Error_t::FileCannotOpen, "out_stream.is_open() failed: " + file_name);
+  }
+  KeyPartitionTableHeader header = {KEY_PARTITION_TABLE_MAGIC, num_devices,
+                                    static_cast<long long>(table.size()), 0};
+  out_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (auto& key_device : table) {
+    long long pair[2] = {static_cast<long long>(key_device.first), key_device.second};
+    out_stream.write(reinterpret_cast<const char*>(pair), sizeof(pair));
+  }
+  if (!out_stream) {
+    CK_THROW_(Error_t::UnspecificError, "failed to write " + file_name);
+  }
+}
+
+/**
+ * Read a key partition table, which must be built for num_devices devices.
+ */
+template <typename T>
+std::vector<std::pair<T, int>> read_key_partition_table(const std::string& file_name,
+                                                        int num_devices) {
+  std::ifstream in_stream(file_name, std::ifstream::binary);
+  if (!in_stream.is_open()) {
+    CK_THROW_(Error_t::FileCannotOpen, "in_stream.is_open() failed: " + file_name);
+  }
+  KeyPartitionTableHeader header;
+  in_stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in_stream || header.magic != KEY_PARTITION_TABLE_MAGIC || header.num_keys < 0) {
+    CK_THROW_(Error_t::UnSupportedFormat, "broken key partition table: " + file_name);
+  }
+  if (header.num_devices != num_devices) {
+    CK_THROW_(Error_t::WrongInput, "key partition table is built for " +
+                                       std::to_string(header.num_devices) +
+                                       " devices: " + file_name);
+  }
+  std::vector<std::pair<T, int>> table;
+  table.reserve(header.num_keys);
+  for (long long i = 0; i < header.num_keys; i++) {
+    long long pair[2];
+    in_stream.read(reinterpret_cast<char*>(pair), sizeof(pair));
+    table.push_back(std::make_pair(static_cast<T>(pair[0]), static_cast<int>(pair[1])));
+  }
+  if (!in_stream) {
+    CK_THROW_(Error_t::UnSupportedFormat, "broken key partition table: " + file_name);
+  }
+  return table;
+}
+
+/**
+ * Create a partitioner.
+ * @param type the partitioner.
+ * @param num_devices the number of devices (global).
+ * @param slot_num the number of slots, for KeyPartitioner_t::SlotAware.
+ * @param table_file_name the table of KeyPartitioner_t::Frequency.
+ */
+template <typename T>
+std::shared_ptr<const KeyPartitioner<T>> create_key_partitioner(
+    KeyPartitioner_t type, int num_devices, int slot_num,
+    const std::string& table_file_name = std::string()) {
+  switch (type) {
+    case KeyPartitioner_t::Modulo:
+      return std::make_shared<ModuloKeyPartitioner<T>>(num_devices);
+    case KeyPartitioner_t::Hash:
+      return std::make_shared<HashKeyPartitioner<T>>(num_devices);
+    case KeyPartitioner_t::SlotAware:
+      return std::make_shared<SlotAwareKeyPartitioner<T>>(num_devices, slot_num);
+    case KeyPartitioner_t::Frequency:
+      if (table_file_name.empty()) {
+        CK_THROW_(Error_t::WrongInput, "the frequency key partitioner needs a table");
+      }
+      return std::make_shared<FrequencyKeyPartitioner<T>>(
+          num_devices, read_key_partition_table<T>(table_file_name, num_devices));
+  }
+  CK_THROW_(Error_t::WrongInput, "unknown KeyPartitioner_t");
+  return nullptr;
+}
+
+/**
+ * The lookups of each device when the keys of a data set are partitioned.
+ */
+struct KeyLoad {
+  std::vector<long long> lookups;  /**< key occurrences routed to each device */
+  std::vector<long long> keys;     /**< distinct keys of each device (its hash table) */
+  long long batches{0};            /**< the number of batches */
+  double batch_imbalance_sum{0.0}; /**< sum of max / mean lookups of the batches */
+
+  static double get_imbalance(const std::vector<long long>& loads) {
+    long long total = 0;
+    long long max_load = 0;
+    for (long long load : loads) {
+      total += load;
+      max_load = std::max(max_load, load);
+    }
+    return total > 0 ? static_cast<double>(max_load) * loads.size() / total : 1.0;
+  }
+
+  /** max / mean of the lookups of the devices over the data set, 1 is balanced */
+  double get_lookup_imbalance() const { return get_imbalance(lookups); }
+  /** max / mean of the distinct keys of the devices */
+  double get_key_imbalance() const { return get_imbalance(keys); }
+  /**
+   * The mean of max / mean of the lookups in a batch. A step waits for the most loaded
+   * device, so this is the slowdown of the embedding over a balanced one.
+   */
+  double get_batch_imbalance() const {
+    return batches > 0 ? batch_imbalance_sum / batches : 1.0;
+  }
+};
+
+/**
+ * Count the lookups of each device with each partitioner in one pass over the data files.
+ * @param partitioners the partitioners to compare.
+ * @param file_names the data files.
+ * @param batch_size the samples of a batch, for KeyLoad::get_batch_imbalance().
+ * @param key_counts if not nullptr, the occurrences of each key are added to it.
+ */
+template <typename T>
+std::vector<KeyLoad> measure_key_load(
+    const std::vector<std::shared_ptr<const KeyPartitioner<T>>>& partitioners,
+    const std::vector<std::string>& file_names, int batch_size,
+    std::unordered_map<T, long long>* key_counts = nullptr) {
+  if (batch_size <= 0) {
+    CK_THROW_(Error_t::WrongInput, "batch_size <= 0");
+  }
+  std::vector<KeyLoad> loads(partitioners.size());
+  std::vector<std::vector<long long>> batch_lookups(partitioners.size());
+  for (size_t p = 0; p < partitioners.size(); p++) {
+    const int num_devices = partitioners[p]->get_num_devices();
+    loads[p].lookups.resize(num_devices, 0);
+    loads[p].keys.resize(num_devices, 0);
+    batch_lookups[p].resize(num_devices, 0);
+  }
+  std::unordered_map<T, long long> local_counts;
+  std::unordered_map<T, long long>& counts = key_counts ? *key_counts : local_counts;
+  auto end_batch = [&]() {
+    for (size_t p = 0; p < partitioners.size(); p++) {
+      loads[p].batches++;
+      loads[p].batch_imbalance_sum += KeyLoad::get_imbalance(batch_lookups[p]);
+      std::fill(batch_lookups[p].begin(), batch_lookups[p].end(), 0);
+    }
+  };
+  long long samples_in_batch = 0;
+  for (auto& file_name : file_names) {
+    DataSetRecordReader<T> reader(file_name);
+    while (reader.next()) {
+      long long num_keys = 0;
+      for (int k = 0; k < reader.get_header().slot_num; k++) {
+        num_keys += reader.get_nnz()[k];
+      }
+      const T* keys = reader.get_keys();
+      for (long long j = 0; j < num_keys; j++) {
+        counts[keys[j]]++;
+        for (size_t p = 0; p < partitioners.size(); p++) {
+          batch_lookups[p][partitioners[p]->get_device(keys[j])]++;
+        }
+      }
+      if (++samples_in_batch == batch_size) {
+        end_batch();
+        samples_in_batch = 0;
+      }
+    }
+  }
+  if (samples_in_batch > 0) {
+    end_batch();
+  }
+  for (auto& key_count : counts) {
+    for (size_t p = 0; p < partitioners.size(); p++) {
+      const int device = partitioners[p]->get_device(key_count.first);
+      loads[p].lookups[device] += key_count.second;
+      loads[p].keys[device]++;
+    }
+  }
+  return loads;
+}
+
+}  // namespace HugeCTR
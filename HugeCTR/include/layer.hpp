@@ -65,6 +65,12 @@ class Layer {
    */
   virtual void bprop(cudaStream_t stream) = 0;
   virtual std::string get_no_trained_params_in_string() { return std::string(); }
+  /*
+   * Set the valid samples (the first rows) of the current batch, see Loss::set_num_samples().
+   * Only the layers which mix the rows of a batch need them.
+   * @param num_samples: the number of valid samples of this GPU, -1 for all of them.
+   */
+  virtual void set_num_samples(int num_samples) {}
   void init_params(std::ofstream& out_stream);
   inline int get_device_id() const { return device_id_; }
   // Layer(GeneralBuffer& weight_buff, GeneralBuffer& wgrad_buff, int device_id); need to implement
@@ -24,6 +24,7 @@
 
 #include <cudnn.h>
 
+#include <algorithm>
 #include <memory>
 
 namespace HugeCTR {
@@ -73,8 +74,29 @@ class BatchNormLayer : public Layer {
    * See Session::download_params_to_file() for more detailed information.
    */
   std::string get_no_trained_params_in_string() override;
+  /**
+   * Set the valid samples of the current batch. Only they are in the batch statistics and
+   * the running mean & var, the rest of the output and of the input gradient is zeroed.
+   * @param num_samples the number of valid samples (the first rows), -1 for all of them
+   */
+  void set_num_samples(int num_samples) override { num_samples_ = num_samples; }
 
  private:
+  /**
+   * The number of valid samples of the current batch.
+   */
+  int get_num_samples() const {
+    return num_samples_ < 0 ? batch_size_ : std::min(num_samples_, batch_size_);
+  }
+  /**
+   * Set valid_desc_ to the first num_samples rows of the input.
+   */
+  void set_valid_desc_(int num_samples);
+  /**
+   * Zero the rows of a [batch_size_, num_feature_] tensor after the first num_samples.
+   */
+  void zero_padded_rows_(float* data, int num_samples, cudaStream_t stream);
+
   /**
    * A method of defining how gamma and beta are initialized.
    * Gamma is initialized to 1s while Beta is 0ed.
@@ -87,6 +109,11 @@ class BatchNormLayer : public Layer {
   cudnnHandle_t const& cudnn_handle_;
   cudnnTensorDescriptor_t in_out_desc_;
   cudnnTensorDescriptor_t gamma_beta_desc_;
+  cudnnTensorDescriptor_t valid_desc_; /**< in_out_desc_ of the valid samples of a short batch */
+  int batch_size_;
+  int num_feature_;
+  bool is_column_major_;
+  int num_samples_{-1};
 
   // these four pointers are just for convenience
   // they are deleted by Layer d'tor through the other pointer aliases: weight_ and wgrad_
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "HugeCTR/include/layer.hpp"
+
+namespace HugeCTR {
+
+/**
+ * Layer that appends the dense features of a sample to its embedding vectors:
+ * out = [in | dense], row by row.
+ */
+class DenseConcatLayer : public Layer {
+ public:
+  /**
+   * Ctor of DenseConcatLayer.
+   * @param in_tensor the input tensor (batch x n, HW), e.g. the output of a Concat layer
+   * @param dense_tensor the dense features from data reader (batch x dense_dim, HW)
+   * @param out_tensor the output tensor (batch x (n + dense_dim), HW)
+   * @param device_id the id of GPU where this layer belongs
+   */
+  DenseConcatLayer(Tensor<float>& in_tensor, Tensor<float>& dense_tensor,
+                   Tensor<float>& out_tensor, int device_id);
+  ~DenseConcatLayer() override {}
+
+  /**
+   * A method of implementing the forward pass of DenseConcat
+   * @param stream CUDA stream where the foward propagation is executed
+   */
+  void fprop(cudaStream_t stream) override;
+  /**
+   * A method of implementing the backward pass of DenseConcat.
+   * Only the gradient of in_tensor is propagated, the dense features are inputs of the model.
+   * @param stream CUDA stream where the backward propagation is executed
+   */
+  void bprop(cudaStream_t stream) override;
+
+ private:
+  int n_batch_;
+  int in_width_;
+  int dense_width_;
+};
+
+}  // namespace HugeCTR
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <vector>
 #include "HugeCTR/include/general_buffer.hpp"
@@ -55,6 +56,23 @@ class Loss {
    * entropy or multi-class cross entropy loss value.
    */
   std::vector<std::reference_wrapper<Tensor<float>>> loss_tensors_;
+  /**
+   * num_samples_: the number of valid samples in the input of the current batch, the rest rows
+   * get 0 gradient and no loss. -1 means all the rows are valid.
+   */
+  int num_samples_{-1};
+  /**
+   * grad_normalizer_: the loss and the gradients are divided by it instead of the batch size,
+   * if it's positive.
+   */
+  float grad_normalizer_{0.f};
+
+  int get_num_samples(int batch_size) const {
+    return num_samples_ < 0 ? batch_size : std::min(num_samples_, batch_size);
+  }
+  float get_grad_normalizer(int batch_size) const {
+    return grad_normalizer_ > 0.f ? grad_normalizer_ : static_cast<float>(batch_size);
+  }
 
  public:
   /**
@@ -67,6 +85,19 @@ class Loss {
    * @param stream CUDA stream where the fused_loss_computation is executed in
    */
   virtual void fused_loss_computation(cudaStream_t stream) = 0;
+  /**
+   * Set the valid samples of the current batch, which is shorter than the tensors for the last
+   * batch of an epoch or a batch size which isn't a multiple of the GPUs.
+   * @param num_samples the number of valid samples (the first rows) of this GPU.
+   * @param grad_normalizer the loss and the gradients are divided by it. It should be the number
+   *        of valid samples of all the GPUs / the number of GPUs, so that the gradients summed
+   *        across the GPUs and the loss averaged across them are of the valid samples only. It's
+   *        the batch size per GPU for a full batch.
+   */
+  void set_num_samples(int num_samples, float grad_normalizer) {
+    num_samples_ = num_samples;
+    grad_normalizer_ = grad_normalizer;
+  }
   /**
    * @param device_id GPU device executed on
    */
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include "HugeCTR/include/common.hpp"
+
+namespace HugeCTR {
+
+/**
+ * @brief A read-only memory mapping of a whole data file.
+ *
+ * Used by DataReaderMultiThreads in ReaderMode_t::Mmap so that a sample can be
+ * decoded in place instead of being copied out of an ifstream field by field.
+ * The mapping is advised as sequential, so the kernel reads ahead and drops
+ * the pages behind the cursor.
+ */
+class MmapFile {
+ private:
+  int fd_{-1};             /**< file descriptor of the mapped file */
+  char* data_{nullptr};    /**< begining of the mapping */
+  size_t size_{0};         /**< size of the file (and the mapping) in bytes */
+  std::string file_name_;  /**< name of the mapped file */
+ public:
+  MmapFile() = default;
+  MmapFile(const MmapFile& C) = delete;
+  MmapFile& operator=(const MmapFile& C) = delete;
+
+  /**
+   * Map the whole file read-only.
+   * @param file_name the file to be mapped.
+   */
+  void open(const std::string& file_name) {
+    close();
+    fd_ = ::open(file_name.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+      CK_THROW_(Error_t::FileCannotOpen, "open() failed: " + file_name);
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      close();
+      CK_THROW_(Error_t::FileCannotOpen, "fstat() failed: " + file_name);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) {
+      close();
+      CK_THROW_(Error_t::WrongInput, "empty data file: " + file_name);
+    }
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (addr == MAP_FAILED) {
+      close();
+      CK_THROW_(Error_t::OutOfMemory, "mmap() failed: " + file_name);
+    }
+    data_ = static_cast<char*>(addr);
+    // no MADV_WILLNEED: each range reader maps the whole file, and it would read all of it ahead
+    madvise(data_, size_, MADV_SEQUENTIAL);
+    file_name_ = file_name;
+  }
+
+  /**
+   * Unmap the file. It's safe to call it on a closed object.
+   */
+  void close() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+      data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+    size_ = 0;
+    file_name_.clear();
+  }
+
+  bool is_open() const { return data_ != nullptr; }
+  const char* get_data() const { return data_; }
+  size_t get_size() const { return size_; }
+  const std::string& get_file_name() const { return file_name_; }
+
+  /**
+   * Dtor
+   */
+  ~MmapFile() { close(); }
+};
+
+}  // namespace HugeCTR
@@ -42,7 +42,8 @@ namespace HugeCTR {
 class Network {
   friend Network* create_network(const nlohmann::json& j_array, const nlohmann::json& j_optimizor,
                                  Tensor<float>& in_tensor, const Tensor<float>& label_tensor,
-                                 int batch_size, int device_id, const GPUResource* gpu_resource);
+                                 Tensor<float>* dense_tensor, int batch_size, int device_id,
+                                 const GPUResource* gpu_resource);
 
  private:
   std::vector<Tensor<float>*> tensors_; /**< vector of tensors */
@@ -89,6 +90,17 @@ class Network {
    */
   float get_loss();
 
+  /**
+   * Set the valid samples of the current batch for the layers and the loss, see
+   * Loss::set_num_samples().
+   */
+  void set_num_samples(int num_samples, float grad_normalizer) {
+    for (auto layer : layers_) {
+      layer->set_num_samples(num_samples);
+    }
+    loss_->set_num_samples(num_samples, grad_normalizer);
+  }
+
   /**
    * Get number of parameters in this network.
    */
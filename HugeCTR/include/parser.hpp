@@ -65,17 +65,27 @@ class Parser {
   typedef long long TYPE_1;
   typedef unsigned int TYPE_2;
 
+  /**
+   * The key type of the data set, "key_type" in data: "long" (TYPE_1, default) or
+   * "uint" (TYPE_2). The pipeline must be created with it.
+   */
+  KeyType_t get_key_type() const;
+
   /**
    * Create the pipeline, which includes data reader, embedding.
+   * @param reader_position the position the training data reader resumes from.
    */
   void create_pipeline(DataReader<TYPE_1>** data_reader, Embedding<TYPE_1>** embedding,
-                       std::vector<Network*>* network, GPUResourceGroup& gpu_resource_group);
+                       std::vector<Network*>* network, GPUResourceGroup& gpu_resource_group,
+                       const ReaderPosition& reader_position = ReaderPosition());
 
   /**
    * Create the pipeline, which includes data reader, embedding.
+   * @param reader_position the position the training data reader resumes from.
    */
   void create_pipeline(DataReader<TYPE_2>** data_reader, Embedding<TYPE_2>** embedding,
-                       std::vector<Network*>* network, GPUResourceGroup& gpu_resource_group);
+                       std::vector<Network*>* network, GPUResourceGroup& gpu_resource_group,
+                       const ReaderPosition& reader_position = ReaderPosition());
 };
 
 /**
@@ -89,7 +99,8 @@ struct SolverParser {
   int snapshot;                 /**< the number of iterations for a snapshot */
   std::string snapshot_prefix;  /**< naming prefix of snapshot file */
   int eval_interval;            /**< the interval of evaluations */
-  int eval_batches;             /**< the number of batches for evaluations */
+  int eval_batches;             /**< the max number of batches for evaluations, 0: a whole pass */
+  int num_epochs;               /**< the number of passes over the training set, 0: unlimited */
   int batchsize;                /**< batchsize */
   std::string model_file;       /**< name of model file */
   std::string embedding_file;   /**< name of embedding file */
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "HugeCTR/include/common.hpp"
+
+namespace HugeCTR {
+
+const long long READER_POSITION_FINISHED = -1; /**< the next record of a finished file */
+
+/**
+ * Progress of a reading thread in a data file.
+ * The files handed out by a FileList are numbered by a sequence number,
+ * epoch * number_of_files + (index of the file in the epoch), so that a file is identified
+ * across the epochs and the permutations.
+ * A thread reads a range of records of a file (the whole file unless the files are split,
+ * see RecordRange), the records [first_record, next_record) of it are read.
+ */
+typedef struct FileProgress_ {
+  long long sequence;      // sequence number of the file in FileList
+  long long next_record;   // the index of the first record not read yet
+  bool finished;           // whether next_record is the end of the file
+  long long first_record;  // the first record of the range being read
+} FileProgress;
+
+/**
+ * @brief The position of a data reader in its file list.
+ *
+ * It's the set of the records consumed by training, kept as:
+ * a sequence number before which all the files are finished, and for the files after it
+ * the ranges of records read (or whether they are finished). The progress of each batch
+ * is applied in the order the batches are consumed, so that the files being read by
+ * several threads at the same time, and the batches read ahead, are handled exactly.
+ * A file is finished once its ranges read cover all its records.
+ * A sample cached in a shuffle buffer is counted as read once it's taken out of the buffer,
+ * so the samples left in the buffer are read again by a resume.
+ * @verbatim
+ * Text file example (files 0-6 are finished, records [0, 4096) and [8192, 9000) of file 7
+ * are read, file 9 is finished, file 8 and the files after 9 are not read):
+ * hugectr_reader_position 2
+ * num_files 4
+ * first_sequence 7
+ * files 2
+ * 7 0 -1 2 0 4096 8192 9000
+ * 9 1 5000 0
+ * @endverbatim
+ * A file line is: sequence, finished, number of records (-1: unknown), number of ranges
+ * and the ranges [begin, end). Version 1 files (a line of "sequence next_record" per file)
+ * are loaded too.
+ */
+class ReaderPosition {
+ private:
+  typedef std::vector<std::pair<long long, long long>> Ranges;
+  struct FileRecords {
+    bool finished{false};
+    long long number_of_records{-1}; /**< -1 until the end of the file is read */
+    Ranges ranges;                   /**< disjoint and sorted ranges read */
+  };
+  int num_files_{0};             /**< the number of files in the list, 0: not captured yet */
+  long long first_sequence_{0};  /**< files before it are finished */
+  std::map<long long, FileRecords> files_;
+
+  /**
+   * Add [begin, end) to ranges, merging the ranges touching it.
+   */
+  static void add_range_(Ranges* ranges, long long begin, long long end) {
+    // the ranges are sorted by their ends too, the first one touching [begin, end)
+    auto first = std::lower_bound(
+        ranges->begin(), ranges->end(), begin,
+        [](const std::pair<long long, long long>& range, long long value) {
+          return range.second < value;
+        });
+    auto last = first;
+    while (last != ranges->end() && last->first <= end) {
+      begin = std::min(begin, last->first);
+      end = std::max(end, last->second);
+      ++last;
+    }
+    first = ranges->erase(first, last);
+    ranges->insert(first, std::make_pair(begin, end));
+  }
+
+ public:
+  ReaderPosition() {}
+  explicit ReaderPosition(int num_files) : num_files_(num_files) {}
+
+  /**
+   * Apply the progress of a batch.
+   */
+  void update(const FileProgress& progress) {
+    if (progress.sequence < first_sequence_) {
+      return;
+    }
+    if (!progress.finished && progress.next_record <= progress.first_record) {
+      return;
+    }
+    FileRecords& file = files_[progress.sequence];
+    if (file.finished) {
+      return;
+    }
+    if (progress.next_record > progress.first_record) {
+      add_range_(&file.ranges, progress.first_record, progress.next_record);
+    }
+    if (progress.finished) {
+      file.number_of_records = progress.next_record;
+    }
+    if (file.number_of_records < 0 || file.ranges.size() != 1 || file.ranges[0].first != 0 ||
+        file.ranges[0].second < file.number_of_records) {
+      return;
+    }
+    file.finished = true;
+    file.ranges.clear();
+    // move the watermark over the files which are finished
+    auto iter = files_.begin();
+    while (iter != files_.end() && iter->first == first_sequence_ && iter->second.finished) {
+      iter = files_.erase(iter);
+      first_sequence_++;
+    }
+  }
+
+  /**
+   * Where to start reading the file of a sequence number, i.e. the first record not read.
+   * @return the index of the first record to read, or READER_POSITION_FINISHED to skip the file.
+   */
+  long long get_start_record(long long sequence) const {
+    Ranges ranges = get_unread_ranges(sequence);
+    return ranges.empty() ? READER_POSITION_FINISHED : ranges[0].first;
+  }
+
+  /**
+   * The ranges of records not read of the file of a sequence number.
+   * @return the ranges [begin, end), the end of the last one is -1 (the end of the file) if
+   *         the number of records isn't known. Empty if the file is finished.
+   */
+  Ranges get_unread_ranges(long long sequence) const {
+    Ranges unread;
+    if (sequence < first_sequence_) {
+      return unread;
+    }
+    auto iter = files_.find(sequence);
+    if (iter == files_.end()) {
+      unread.emplace_back(0, -1);
+      return unread;
+    }
+    const FileRecords& file = iter->second;
+    if (file.finished) {
+      return unread;
+    }
+    long long begin = 0;
+    for (auto& range : file.ranges) {
+      if (range.first > begin) {
+        unread.emplace_back(begin, range.first);
+      }
+      begin = range.second;
+    }
+    if (file.number_of_records < 0 || begin < file.number_of_records) {
+      unread.emplace_back(begin, file.number_of_records);
+    }
+    return unread;
+  }
+
+  bool empty() const { return first_sequence_ == 0 && files_.empty(); }
+  int get_num_files() const { return num_files_; }
+  long long get_first_sequence() const { return first_sequence_; }
+
+  /**
+   * The epoch of the first file not finished.
+   */
+  long long get_epoch() const { return num_files_ > 0 ? first_sequence_ / num_files_ : 0; }
+
+  /**
+   * Write the position to a text file.
+   */
+  void save(const std::string& file_name) const {
+    std::ofstream out_stream(file_name, std::ofstream::out);
+    if (!out_stream.is_open()) {
+      CK_THROW_(Error_t::FileCannotOpen, "out_stream.is_open() failed: " + file_name);
+    }
+    out_stream << "hugectr_reader_position 2\n"
+               << "num_files " << num_files_ << "\n"
+               << "first_sequence " << first_sequence_ << "\n"
+               << "files " << files_.size() << "\n";
+    for (auto& file : files_) {
+      out_stream << file.first << " " << file.second.finished << " "
+                 << file.second.number_of_records << " " << file.second.ranges.size();
+      for (auto& range : file.second.ranges) {
+        out_stream << " " << range.first << " " << range.second;
+      }
+      out_stream << "\n";
+    }
+    if (!out_stream) {
+      CK_THROW_(Error_t::UnspecificError, "failed to write " + file_name);
+    }
+  }
+
+  /**
+   * Read a position written by save().
+   */
+  void load(const std::string& file_name) {
+    std::ifstream in_stream(file_name, std::ifstream::in);
+    if (!in_stream.is_open()) {
+      CK_THROW_(Error_t::FileCannotOpen, "in_stream.is_open() failed: " + file_name);
+    }
+    std::string magic, num_files_key, first_sequence_key, files_key;
+    int version = 0;
+    size_t num_entries = 0;
+    in_stream >> magic >> version >> num_files_key >> num_files_ >> first_sequence_key >>
+        first_sequence_ >> files_key >> num_entries;
+    if (!in_stream || magic != "hugectr_reader_position" || (version != 1 && version != 2) ||
+        num_files_key != "num_files" || first_sequence_key != "first_sequence" ||
+        files_key != "files" || num_files_ <= 0 || first_sequence_ < 0) {
+      CK_THROW_(Error_t::UnSupportedFormat, "broken reader position file: " + file_name);
+    }
+    files_.clear();
+    for (size_t i = 0; i < num_entries; i++) {
+      long long sequence = 0;
+      FileRecords file;
+      bool valid = true;
+      if (version == 1) {
+        long long next_record = 0;
+        in_stream >> sequence >> next_record;
+        valid = next_record >= READER_POSITION_FINISHED;
+        file.finished = next_record == READER_POSITION_FINISHED;
+        if (next_record > 0) {
+          file.ranges.emplace_back(0, next_record);
+        }
+      } else {
+        size_t num_ranges = 0;
+        in_stream >> sequence >> file.finished >> file.number_of_records >> num_ranges;
+        long long last_end = 0;
+        for (size_t r = 0; r < num_ranges && in_stream; r++) {
+          long long begin = 0, end = 0;
+          in_stream >> begin >> end;
+          valid = valid && begin >= last_end && end > begin;
+          file.ranges.emplace_back(begin, end);
+          last_end = end;
+        }
+      }
+      if (!in_stream || !valid || sequence < first_sequence_) {
+        CK_THROW_(Error_t::UnSupportedFormat, "broken reader position file: " + file_name);
+      }
+      files_[sequence] = file;
+    }
+  }
+};
+
+}  // namespace HugeCTR
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace HugeCTR {
+
+/**
+ * Bucket 0 of a latency histogram counts the latencies under 1us, bucket i (i > 0) the ones
+ * in [2^(i-1), 2^i) us, and the last one all the longer ones.
+ */
+const int LATENCY_HISTOGRAM_BUCKETS = 32;
+
+/**
+ * @brief A snapshot of a LatencyHistogram.
+ *
+ * Snapshots taken at different times can be subtracted to get the latencies recorded in
+ * between, and the snapshots of several histograms can be merged.
+ */
+struct LatencyStats {
+  long long count{0};    /**< number of latencies recorded */
+  long long total_us{0}; /**< sum of the latencies */
+  long long buckets[LATENCY_HISTOGRAM_BUCKETS] = {};
+
+  void merge(const LatencyStats& other) {
+    count += other.count;
+    total_us += other.total_us;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+      buckets[i] += other.buckets[i];
+    }
+  }
+
+  /**
+   * The latencies recorded after an earlier snapshot of the same histogram.
+   */
+  LatencyStats since(const LatencyStats& earlier) const {
+    LatencyStats stats(*this);
+    stats.count -= earlier.count;
+    stats.total_us -= earlier.total_us;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+      stats.buckets[i] -= earlier.buckets[i];
+    }
+    return stats;
+  }
+
+  double get_total_seconds() const { return total_us / 1000000.0; }
+
+  double get_mean_us() const { return count > 0 ? static_cast<double>(total_us) / count : 0.0; }
+
+  /**
+   * An upper bound of the p-th quantile, i.e. the upper bound of the bucket it's in.
+   * @param p in [0, 1].
+   * @return 0 if nothing is recorded.
+   */
+  long long get_percentile_us(double p) const {
+    const long long rank = std::max(1LL, static_cast<long long>(p * count + 0.5));
+    long long accumulated = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS && count > 0; i++) {
+      accumulated += buckets[i];
+      if (accumulated >= rank) {
+        return 1LL << i;
+      }
+    }
+    return count > 0 ? 1LL << (LATENCY_HISTOGRAM_BUCKETS - 1) : 0;
+  }
+};
+
+/**
+ * @brief A lock-free histogram of latencies in microseconds.
+ *
+ * Recording is a few relaxed atomic adds, so a histogram can be shared by several threads
+ * and updated on every batch, while another thread takes snapshots of it.
+ */
+class LatencyHistogram {
+ private:
+  std::atomic<long long> count_{0};
+  std::atomic<long long> total_us_{0};
+  std::atomic<long long> buckets_[LATENCY_HISTOGRAM_BUCKETS];
+
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  LatencyHistogram() {
+    for (auto& bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  static int get_bucket(long long us) {
+    int bucket = 0;
+    while (us > 0 && bucket < LATENCY_HISTOGRAM_BUCKETS - 1) {
+      us >>= 1;
+      bucket++;
+    }
+    return bucket;
+  }
+
+  void record(long long us) {
+    us = std::max(0LL, us);
+    buckets_[get_bucket(us)].fetch_add(1, std::memory_order_relaxed);
+    total_us_.fetch_add(us, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Record the time elapsed from start.
+   */
+  void record_since(Clock::time_point start) {
+    record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+  }
+
+  /**
+   * Add a snapshot of this histogram to stats. It's not atomic as a whole, a latency
+   * recorded meanwhile may be counted in some of the fields but not the others.
+   */
+  void add_to(LatencyStats* stats) const {
+    LatencyStats snapshot;
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.total_us = total_us_.load(std::memory_order_relaxed);
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+      snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    stats->merge(snapshot);
+  }
+};
+
+/**
+ * @brief Counters and latencies of the stages of a data reader.
+ *
+ * The pipeline is: reading threads -> chunk ring -> collector thread (H2D copy) -> training.
+ * Where the time goes tells which stage is the bottleneck:
+ * - free_chunk_wait is high: the ring is full, the readers are faster than the training;
+ * - ready_chunk_wait is high: the ring is empty, the readers are the bottleneck;
+ * - device_wait is high: the training waits for data, look at the stages before it.
+ */
+struct DataReaderStats {
+  long long bytes_read{0};      /**< bytes read from the data files (compressed bytes) */
+  long long records_decoded{0}; /**< samples decoded into chunks by the reading threads */
+  long long batches_copied{0};  /**< batches copied to the devices by the collector */
+  LatencyStats free_chunk_wait;  /**< reading threads waiting for a free chunk */
+  LatencyStats ready_chunk_wait; /**< collector waiting for a chunk to be read */
+  LatencyStats collector_spin;   /**< collector spinning until the last batch is taken */
+  LatencyStats copy;             /**< H2D copies of a batch, including the stream sync */
+  LatencyStats device_wait;      /**< read_a_batch_to_device() waiting for a collected batch */
+
+  /**
+   * The counts and latencies after an earlier snapshot of the same data reader.
+   */
+  DataReaderStats since(const DataReaderStats& earlier) const {
+    DataReaderStats stats;
+    stats.bytes_read = bytes_read - earlier.bytes_read;
+    stats.records_decoded = records_decoded - earlier.records_decoded;
+    stats.batches_copied = batches_copied - earlier.batches_copied;
+    stats.free_chunk_wait = free_chunk_wait.since(earlier.free_chunk_wait);
+    stats.ready_chunk_wait = ready_chunk_wait.since(earlier.ready_chunk_wait);
+    stats.collector_spin = collector_spin.since(earlier.collector_spin);
+    stats.copy = copy.since(earlier.copy);
+    stats.device_wait = device_wait.since(earlier.device_wait);
+    return stats;
+  }
+
+  /**
+   * A latency as "total seconds (p50/p99 in us)".
+   */
+  static std::string format_latency(const LatencyStats& stats) {
+    char str[64];
+    snprintf(str, sizeof(str), "%.3fs (%lld/%lldus)", stats.get_total_seconds(),
+             stats.get_percentile_us(0.5), stats.get_percentile_us(0.99));
+    return str;
+  }
+
+  /**
+   * One line for the log, the rates are over elapsed_seconds and the latencies are formatted
+   * by format_latency().
+   */
+  std::string to_string(double elapsed_seconds) const {
+    const double seconds = elapsed_seconds > 0.0 ? elapsed_seconds : 1.0;
+    char line[512];
+    snprintf(line, sizeof(line),
+             "%.1f MB/s, %.0f records/s, %lld batches; free chunk wait %s, ready chunk wait %s, "
+             "collector spin %s, copy %s, device wait %s",
+             bytes_read / seconds / 1000000.0, records_decoded / seconds, batches_copied,
+             format_latency(free_chunk_wait).c_str(), format_latency(ready_chunk_wait).c_str(),
+             format_latency(collector_spin).c_str(), format_latency(copy).c_str(),
+             format_latency(device_wait).c_str());
+    return line;
+  }
+};
+
+}  // namespace HugeCTR
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+namespace HugeCTR {
+
+const long long RECORD_RANGE_CLAIM_SIZE = 64; /**< records claimed at a time by a reader */
+
+/**
+ * @brief A range of records of a data file, the unit of work of a reading thread.
+ *
+ * The reader claims the records of the range a few at a time (claim()) while another
+ * thread can take the records not claimed yet (split()), which is how an idle thread
+ * steals the work of a busy one. The end of a range is -1 if it's the end of the file
+ * and the number of records isn't known, such a range can't be split.
+ * The split points are multiples of stride, the distance of the records a reader can
+ * seek to without decoding (see find_record_offset()), 0 if the range can't be split.
+ */
+class RecordRange {
+ private:
+  const std::string file_name_;
+  const long long sequence_;
+  const long long begin_;
+  const long long stride_;
+  std::mutex mtx_;
+  long long end_;
+  long long claimed_end_; /**< the records before it are claimed by the reader */
+
+ public:
+  /**
+   * Ctor.
+   * @param file_name the data file.
+   * @param sequence the sequence number of the file in FileList.
+   * @param begin the first record.
+   * @param end the record after the last one, -1 for the end of the file.
+   * @param stride the split points are multiples of it, 0 if the range can't be split.
+   */
+  RecordRange(const std::string& file_name, long long sequence, long long begin, long long end,
+              long long stride = 0)
+      : file_name_(file_name),
+        sequence_(sequence),
+        begin_(begin),
+        stride_(end < 0 ? 0 : stride),
+        end_(end),
+        claimed_end_(begin) {}
+
+  /**
+   * Claim the next records for the reader.
+   * @param record the next record to read, it must be claimed_end.
+   * @param claimed_end the end of the records claimed is passed out.
+   * @return false if the range is finished, i.e. record is its end.
+   */
+  bool claim(long long record, long long* claimed_end) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (end_ >= 0 && record >= end_) {
+      return false;
+    }
+    claimed_end_ = record + RECORD_RANGE_CLAIM_SIZE;
+    if (end_ >= 0) {
+      claimed_end_ = std::min(claimed_end_, end_);
+    }
+    *claimed_end = claimed_end_;
+    return true;
+  }
+
+  /**
+   * Take about a half of the records not claimed yet.
+   * @param begin the first record taken is passed out, the range ends there.
+   * @param end the end of the records taken is passed out.
+   * @return false if there aren't two strides of records to share.
+   */
+  bool split(long long* begin, long long* end) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (stride_ <= 0) {
+      return false;
+    }
+    long long middle = claimed_end_ + (end_ - claimed_end_) / 2;
+    middle = (middle + stride_ - 1) / stride_ * stride_;
+    if (middle - claimed_end_ < stride_ || end_ - middle < stride_) {
+      return false;
+    }
+    *begin = middle;
+    *end = end_;
+    end_ = middle;
+    return true;
+  }
+
+  /**
+   * The number of records not claimed yet, -1 if it isn't known.
+   */
+  long long get_unclaimed() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return end_ < 0 ? -1 : end_ - claimed_end_;
+  }
+
+  const std::string& get_file_name() const { return file_name_; }
+  long long get_sequence() const { return sequence_; }
+  long long get_begin() const { return begin_; }
+  long long get_stride() const { return stride_; }
+};
+
+}  // namespace HugeCTR
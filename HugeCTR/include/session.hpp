@@ -34,21 +34,39 @@ namespace HugeCTR {
  */
 class Session {
  private:
-  typedef long long TypeKey;               /**< type of input key in dataset. */
-  std::vector<Network*> networks_;         /**< networks (dense) used in training. */
-  Embedding<TypeKey>* embedding_{nullptr}; /**< embedding */
-  DataReader<TypeKey>* data_reader_; /**< data reader to reading data from data set to embedding. */
-  DataReader<TypeKey>* data_reader_eval_; /**< data reader for evaluation. */
-  Parser* parser_;                        /***< model parser */
-  GPUResourceGroup gpu_resource_group_;   /**< GPU resources include handles and streams etc.*/
+  std::vector<Network*> networks_;  /**< networks (dense) used in training. */
+  IEmbedding* embedding_{nullptr};  /**< embedding, of the key type of the configure file */
+  IDataReader* data_reader_; /**< data reader to reading data from data set to embedding. */
+  IDataReader* data_reader_eval_;       /**< data reader for evaluation. */
+  Parser* parser_;                      /***< model parser */
+  GPUResourceGroup gpu_resource_group_; /**< GPU resources include handles and streams etc.*/
+  int batch_size_per_gpu_; /**< samples of a GPU, the batch size is rounded up to the GPUs */
+  int current_num_samples_{0}; /**< the number of samples of the last batch trained or evaluated */
+
+  /**
+   * Create the data readers, embedding and networks with the keys of type TypeKey.
+   */
+  template <typename TypeKey>
+  void create_pipeline(const ReaderPosition& reader_position);
+
+  /**
+   * Set the valid samples of the batch read to the embedding and the networks, so that the
+   * rows after them are skipped and the loss is normalised by the valid samples only.
+   * @param num_samples the number of samples of the batch, returned by the data reader.
+   */
+  void set_num_samples(int num_samples);
+
  public:
   /**
    * Ctor of Session.
    * @param batch_size will be used in the following training.
    * @param json_name the json file of configuration.
    * @param device_map a index list of the devices which be used in this training.
+   * @param reader_position_file the position of the training data saved with a snapshot,
+   *        the reading resumes from it if the file exists.
    */
-  Session(int batch_size, const std::string& json_name, const DeviceMap& device_map);
+  Session(int batch_size, const std::string& json_name, const DeviceMap& device_map,
+          const std::string& reader_position_file = std::string());
 
   /**
    * A method loading trained parameters of both dense and sparse model.
@@ -59,6 +77,7 @@ class Session {
 
   /**
    * Ctor of Session, which construct and load parameters.
+   * If model_file is a snapshot, the training data is read from the position saved with it.
    * @param batch_size will be used in the following training.
    * @param model_file dense model generated by training
    * @param embedding_file sparse model generated by training
@@ -67,7 +86,7 @@ class Session {
    */
   Session(int batch_size, const std::string& model_file, const std::string& embedding_file,
           const std::string& json_name, const DeviceMap& device_map)
-      : Session(batch_size, json_name, device_map) {
+      : Session(batch_size, json_name, device_map, get_reader_position_file_name(model_file)) {
     load_params(model_file, embedding_file);
   }
   /**
@@ -81,11 +100,15 @@ class Session {
    * The all in one training method.
    * This method processes one iteration of a training, including one forward, one backward and
    * parameter update
+   * @return Error_t::EndOfFile at the end of an epoch (epoch mode), no iteration is processed
+   *         then and the next call starts the next epoch.
    */
   Error_t train();
   /**
    * The all in one evaluation method.
    * This method processes one forward of evaluation.
+   * @return Error_t::EndOfFile at the end of the evaluation set, no batch is processed then
+   *         and the next call starts from the beginning of the evaluation set.
    */
   Error_t eval();
   /**
@@ -93,8 +116,33 @@ class Session {
    * @return loss in float
    */
   Error_t get_current_loss(float* loss);
+  /**
+   * Get the number of valid samples of the last batch trained or evaluated, which the current
+   * loss is the mean over.
+   */
+  int get_current_num_samples() const { return current_num_samples_; }
+  /**
+   * Get the counters and latencies of the stages of the training data reader, since it's
+   * created. Subtract an earlier one with DataReaderStats::since() to get those in between.
+   * @param stats the stats of the data reader of this process.
+   */
+  Error_t get_data_reader_stats(DataReaderStats* stats) {
+    *stats = data_reader_->get_stats();
+    return Error_t::Success;
+  }
+  /**
+   * Get the statistics of the admission filter of the embedding, since it's created.
+   * Subtract an earlier one with AdmissionStats::since() to get those in between.
+   * @param stats the stats, all 0 if the filter is disabled.
+   */
+  Error_t get_admission_stats(nv::AdmissionStats* stats) {
+    *stats = embedding_->get_admission_stats();
+    return Error_t::Success;
+  }
   /**
    * Download trained parameters to file.
+   * The position of the training data reader is saved along with them, to
+   * get_reader_position_file_name(weights_file).
    * @param weights_file file name of output dense model
    * @param embedding_file file name of output sparse model
    */
@@ -114,6 +162,11 @@ class Session {
    * @param model_file dense model initilized
    */
   Error_t init_params(std::string model_file);
+  /**
+   * The file of the reader position saved with a dense model, <weights_file>.reader
+   * (followed by .<rank> in multi-node training, as each node has its own data reader).
+   */
+  static std::string get_reader_position_file_name(const std::string& weights_file);
   /**
    * get the number of parameters (reserved for debug)
    */
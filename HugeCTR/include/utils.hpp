@@ -18,6 +18,7 @@
 
 #include <cuda_runtime_api.h>
 #include <sys/stat.h>
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <ctime>
@@ -113,6 +114,16 @@ inline size_t get_size_from_dims(std::vector<int> dims) {
   return matrix_size;
 }
 
+/**
+ * The number of valid samples of a device in a batch of num_samples samples, where the
+ * samples are split in order among the devices, batchsize_per_device per device.
+ * @param global_id the global id of the device.
+ */
+inline int get_device_num_samples(int num_samples, int batchsize_per_device, int global_id) {
+  const int rest = num_samples - global_id * batchsize_per_device;
+  return std::max(0, std::min(batchsize_per_device, rest));
+}
+
 /**
  * Check if file exist.
  */
@@ -48,11 +48,15 @@ BatchNormLayer::BatchNormLayer(GeneralBuffer<float>& weight_buff, GeneralBuffer<
   assert(in_tensor_dim[1] == out_tensor_dim[1]);
 
   CK_CUDNN_THROW_(cudnnCreateTensorDescriptor(&in_out_desc_));
+  CK_CUDNN_THROW_(cudnnCreateTensorDescriptor(&valid_desc_));
 
   bool is_column_major = (in_format == TensorFormat_t::WH);
 
   int num_feature = is_column_major ? in_tensor_dim[0] : in_tensor_dim[1];
   int batch_size = is_column_major ? in_tensor_dim[1] : in_tensor_dim[0];
+  batch_size_ = batch_size;
+  num_feature_ = num_feature;
+  is_column_major_ = is_column_major;
 
   cudnnDataType_t data_type = CUDNN_DATA_FLOAT;
   int n_stride = is_column_major ? 1 : num_feature;
@@ -104,6 +108,7 @@ BatchNormLayer::~BatchNormLayer() {
   try {
     CK_CUDNN_THROW_(cudnnDestroyTensorDescriptor(in_out_desc_));
     CK_CUDNN_THROW_(cudnnDestroyTensorDescriptor(gamma_beta_desc_));
+    CK_CUDNN_THROW_(cudnnDestroyTensorDescriptor(valid_desc_));
     delete h_result_running_mean_;
     delete h_result_running_var_;
   } catch (const std::runtime_error& rt_err) {
@@ -111,6 +116,30 @@ BatchNormLayer::~BatchNormLayer() {
   }
 }
 
+void BatchNormLayer::set_valid_desc_(int num_samples) {
+  // the strides of in_out_desc_, the valid samples are the first rows in both formats
+  int n_stride = is_column_major_ ? 1 : num_feature_;
+  int w_stride = is_column_major_ ? batch_size_ : 1;
+  CK_CUDNN_THROW_(cudnnSetTensor4dDescriptorEx(valid_desc_, CUDNN_DATA_FLOAT, num_samples, 1, 1,
+                                               num_feature_, n_stride, 1, 1, w_stride));
+}
+
+void BatchNormLayer::zero_padded_rows_(float* data, int num_samples, cudaStream_t stream) {
+  if (num_samples >= batch_size_) {
+    return;
+  }
+  if (is_column_major_) {
+    CK_CUDA_THROW_(cudaMemset2DAsync(data + num_samples, batch_size_ * sizeof(float), 0,
+                                     (batch_size_ - num_samples) * sizeof(float), num_feature_,
+                                     stream));
+  } else {
+    CK_CUDA_THROW_(cudaMemsetAsync(data + (size_t)num_samples * num_feature_, 0,
+                                   (size_t)(batch_size_ - num_samples) * num_feature_ *
+                                       sizeof(float),
+                                   stream));
+  }
+}
+
 void BatchNormLayer::fprop(cudaStream_t stream) {
   int o_device = -1;
   CK_CUDA_THROW_(get_set_device(get_device_id(), &o_device));
@@ -132,12 +161,30 @@ void BatchNormLayer::fprop(cudaStream_t stream) {
   float* result_save_mean = result_save_mean_->get_ptr();
   float* result_save_inv_var = result_save_inv_var_->get_ptr();
 
-  if (params_.is_training) {
+  const int num_samples = get_num_samples();
+  if (params_.is_training && num_samples == batch_size_) {
     CK_CUDNN_THROW_(cudnnBatchNormalizationForwardTraining(
         cudnn_handle_, mode_, &one, &zero, in_out_desc_, in, in_out_desc_, out, gamma_beta_desc_,
         gamma, beta, params_.factor, result_running_mean, result_running_var, params_.eps,
         result_save_mean, result_save_inv_var));
 
+  } else if (params_.is_training) {
+    // the padded rows of a short batch stay out of the statistics. A variance needs two
+    // samples, fewer are normalized by the running mean & var and get no gradient (bprop())
+    if (num_samples >= 2) {
+      set_valid_desc_(num_samples);
+      CK_CUDNN_THROW_(cudnnBatchNormalizationForwardTraining(
+          cudnn_handle_, mode_, &one, &zero, valid_desc_, in, valid_desc_, out, gamma_beta_desc_,
+          gamma, beta, params_.factor, result_running_mean, result_running_var, params_.eps,
+          result_save_mean, result_save_inv_var));
+    } else if (num_samples == 1) {
+      set_valid_desc_(num_samples);
+      CK_CUDNN_THROW_(cudnnBatchNormalizationForwardInference(
+          cudnn_handle_, mode_, &one, &zero, valid_desc_, in, valid_desc_, out, gamma_beta_desc_,
+          gamma, beta, result_running_mean, result_running_var, params_.eps));
+    }
+    zero_padded_rows_(out, num_samples, stream);
+
   } else {
     CK_CUDNN_THROW_(cudnnBatchNormalizationForwardInference(
         cudnn_handle_, mode_, &one, &zero, in_out_desc_, in, in_out_desc_, out, gamma_beta_desc_,
@@ -170,12 +217,30 @@ void BatchNormLayer::bprop(cudaStream_t stream) {
 
   float* temp_in = temp_in_tensor_->get_ptr();
   size_t n_byte = temp_in_tensor_->get_size();
+
+  // the rows of a batch are coupled by its statistics, so the gradient of the padded rows of a
+  // short batch is zeroed rather than left to leak into the layers below
+  const int num_samples = get_num_samples();
+  if (num_samples < 2) {
+    CK_CUDA_THROW_(cudaMemsetAsync(gamma_grad, 0, gamma_grad_->get_size(), stream));
+    CK_CUDA_THROW_(cudaMemsetAsync(beta_grad, 0, beta_grad_->get_size(), stream));
+    CK_CUDA_THROW_(cudaMemsetAsync(in, 0, n_byte, stream));
+    CK_CUDA_THROW_(get_set_device(o_device));
+    return;
+  }
+
   CK_CUDA_THROW_(cudaMemcpy(temp_in, in, n_byte, cudaMemcpyDeviceToDevice));
 
+  cudnnTensorDescriptor_t desc = in_out_desc_;
+  if (num_samples < batch_size_) {
+    set_valid_desc_(num_samples);
+    desc = valid_desc_;
+  }
   CK_CUDNN_THROW_(cudnnBatchNormalizationBackward(
-      cudnn_handle_, mode_, &one, &zero, &one, &zero, in_out_desc_, temp_in, in_out_desc_, out,
-      in_out_desc_, in, gamma_beta_desc_, gamma, gamma_grad, beta_grad, params_.eps,
-      result_save_mean, result_save_inv_var));
+      cudnn_handle_, mode_, &one, &zero, &one, &zero, desc, temp_in, desc, out, desc, in,
+      gamma_beta_desc_, gamma, gamma_grad, beta_grad, params_.eps, result_save_mean,
+      result_save_inv_var));
+  zero_padded_rows_(in, num_samples, stream);
 
   CK_CUDA_THROW_(get_set_device(o_device));
 }
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/layers/dense_concat_layer.hpp"
+
+#include "HugeCTR/include/common.hpp"
+#include "HugeCTR/include/tensor.hpp"
+
+#ifndef NDEBUG
+#include <iostream>
+#endif
+
+namespace HugeCTR {
+
+DenseConcatLayer::DenseConcatLayer(Tensor<float>& in_tensor, Tensor<float>& dense_tensor,
+                                   Tensor<float>& out_tensor, int device_id)
+    : Layer(device_id), n_batch_(0), in_width_(0), dense_width_(0) {
+  try {
+    if (in_tensor.get_format() != TensorFormat_t::HW ||
+        dense_tensor.get_format() != TensorFormat_t::HW ||
+        out_tensor.get_format() != TensorFormat_t::HW)
+      CK_THROW_(Error_t::WrongInput, "Input or output format is invalid");
+
+    auto in_dims = in_tensor.get_dims();
+    auto dense_dims = dense_tensor.get_dims();
+    auto out_dims = out_tensor.get_dims();
+    if (in_dims.size() != 2 || dense_dims.size() != 2 || out_dims.size() != 2)
+      CK_THROW_(Error_t::WrongInput, "Input and output tensors must be 2D");
+    if (in_dims[0] != dense_dims[0] || in_dims[0] != out_dims[0])
+      CK_THROW_(Error_t::WrongInput, "The batch sizes of input/output are mismatched");
+    if (in_dims[1] + dense_dims[1] != out_dims[1])
+      CK_THROW_(Error_t::WrongInput, "The lowest dims of input/output is not compatible");
+
+    n_batch_ = in_dims[0];
+    in_width_ = in_dims[1];
+    dense_width_ = dense_dims[1];
+    in_tensors_.push_back(std::ref(in_tensor));
+    in_tensors_.push_back(std::ref(dense_tensor));
+    out_tensors_.push_back(std::ref(out_tensor));
+  } catch (const std::runtime_error& rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    throw;
+  }
+}
+
+void DenseConcatLayer::fprop(cudaStream_t stream) {
+  int o_device = -1;
+  CK_CUDA_THROW_(get_set_device(get_device_id(), &o_device));
+
+  Tensor<float>& in_tensor = in_tensors_[0];
+  Tensor<float>& dense_tensor = in_tensors_[1];
+  Tensor<float>& out_tensor = out_tensors_[0];
+  const size_t out_pitch = (in_width_ + dense_width_) * sizeof(float);
+  CK_CUDA_THROW_(cudaMemcpy2DAsync(out_tensor.get_ptr(), out_pitch, in_tensor.get_ptr(),
+                                   in_width_ * sizeof(float), in_width_ * sizeof(float), n_batch_,
+                                   cudaMemcpyDeviceToDevice, stream));
+  CK_CUDA_THROW_(cudaMemcpy2DAsync(out_tensor.get_ptr() + in_width_, out_pitch,
+                                   dense_tensor.get_ptr(), dense_width_ * sizeof(float),
+                                   dense_width_ * sizeof(float), n_batch_,
+                                   cudaMemcpyDeviceToDevice, stream));
+
+#ifndef NDEBUG
+  cudaDeviceSynchronize();
+  CK_CUDA_THROW_(cudaGetLastError());
+#endif
+
+  CK_CUDA_THROW_(get_set_device(o_device));
+}
+
+void DenseConcatLayer::bprop(cudaStream_t stream) {
+  int o_device = -1;
+  CK_CUDA_THROW_(get_set_device(get_device_id(), &o_device));
+
+  // the gradients overwrite the input in place, as in the other layers
+  Tensor<float>& in_tensor = in_tensors_[0];
+  Tensor<float>& out_tensor = out_tensors_[0];
+  const size_t out_pitch = (in_width_ + dense_width_) * sizeof(float);
+  CK_CUDA_THROW_(cudaMemcpy2DAsync(in_tensor.get_ptr(), in_width_ * sizeof(float),
+                                   out_tensor.get_ptr(), out_pitch, in_width_ * sizeof(float),
+                                   n_batch_, cudaMemcpyDeviceToDevice, stream));
+
+#ifndef NDEBUG
+  cudaDeviceSynchronize();
+  CK_CUDA_THROW_(cudaGetLastError());
+#endif
+
+  CK_CUDA_THROW_(get_set_device(o_device));
+}
+
+}  // namespace HugeCTR
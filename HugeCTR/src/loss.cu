@@ -31,7 +31,8 @@ CrossEntropyLoss::CrossEntropyLoss(Tensor<float> &label_tensors, Tensor<float> &
 
 // Suppose we use one thread to calculate one sample
 __global__ void CrossEntropy_Kernel(float *input, float *label, float *cel_loss, int batch_size,
-                                    int feature_dim, bool row_major, int scaler) {
+                                    int num_samples, float grad_normalizer, int feature_dim,
+                                    bool row_major, int scaler) {
   int tid = threadIdx.x;
   extern __shared__ float loss_s[];
 
@@ -43,6 +44,11 @@ __global__ void CrossEntropy_Kernel(float *input, float *label, float *cel_loss,
   for (int i = tid; i < batch_size; i += blockDim.x) {
     id1 = row_major ? i * feature_dim : i;
     id2 = row_major ? i * feature_dim + 1 : i + batch_size;
+    if (i >= num_samples) {
+      input[id1] = 0.0f;
+      input[id2] = 0.0f;
+      continue;
+    }
     z0_exp = exp((double)input[id1]);
     z1_exp = exp((double)input[id2]);
 
@@ -52,8 +58,8 @@ __global__ void CrossEntropy_Kernel(float *input, float *label, float *cel_loss,
     bool no_click = label[i] < 0.5f;
 
     // calculate the grad
-    input[id1] = (a0 - (no_click ? 1.0f : 0.0f)) / batch_size * scaler;
-    input[id2] = (a1 - (!no_click ? 1.0f : 0.0f)) / batch_size * scaler;
+    input[id1] = (a0 - (no_click ? 1.0f : 0.0f)) / grad_normalizer * scaler;
+    input[id2] = (a1 - (!no_click ? 1.0f : 0.0f)) / grad_normalizer * scaler;
     ;
 
     loss_s[tid] += -1 * log(no_click ? a0 : a1);
@@ -64,7 +70,7 @@ __global__ void CrossEntropy_Kernel(float *input, float *label, float *cel_loss,
 
   if (tid == 0) {
     for (int i = 0; i < blockDim.x; ++i) loss_tmp += loss_s[i];
-    cel_loss[0] = loss_tmp / batch_size;
+    cel_loss[0] = loss_tmp / grad_normalizer;
   }
 }
 
@@ -115,7 +121,8 @@ void CrossEntropyLoss::fused_loss_computation(cudaStream_t stream) {
   //    printf("Cross Entropy scaler %d\n", scaler);
 
   CrossEntropy_Kernel<<<1, block_size, block_size * sizeof(float), stream>>>(
-      input, label, cel_loss, batch_size, feature_dim, row_major, scaler);
+      input, label, cel_loss, batch_size, get_num_samples(batch_size),
+      get_grad_normalizer(batch_size), feature_dim, row_major, scaler);
 
 #ifndef NDEBUG
   cudaDeviceSynchronize();
@@ -135,7 +142,8 @@ BinaryCrossEntropyLoss::BinaryCrossEntropyLoss(Tensor<float> &label_tensors,
 }
 // Suppose we use one thread to calculate one sample
 __global__ void BinaryCrossEntropy_Kernel(float *input, float *label, float *bce_loss, int scaler,
-                                          int batch_size) {
+                                          int batch_size, int num_samples,
+                                          float grad_normalizer) {
   const float MIN_ = 1e-6;
   const float MIN_X = -707.f;
   int tid = threadIdx.x;
@@ -146,6 +154,10 @@ __global__ void BinaryCrossEntropy_Kernel(float *input, float *label, float *bce
   double val;
 
   for (int i = tid; i < batch_size; i += blockDim.x) {
+    if (i >= num_samples) {
+      input[i] = 0.0f;
+      continue;
+    }
     x = input[i] < MIN_X ? MIN_X : input[i];
     double exp_neg_x = exp((double)-x);
     val = 1.0f / (1.0f + exp_neg_x);
@@ -154,14 +166,14 @@ __global__ void BinaryCrossEntropy_Kernel(float *input, float *label, float *bce
     loss_s[tid] += y * log(val + MIN_) + (1.0f - y) * log(1.0f - val + MIN_);
 
     // grad
-    input[i] = -1.0f * val * (y - val) * exp_neg_x / (1.0f - val + MIN_) / batch_size * scaler;
+    input[i] = -1.0f * val * (y - val) * exp_neg_x / (1.0f - val + MIN_) / grad_normalizer * scaler;
   }
   __syncthreads();
 
   float loss_tmp = 0.0f;
   if (tid == 0) {
     for (int i = 0; i < blockDim.x; ++i) loss_tmp += loss_s[i];
-    bce_loss[0] = -loss_tmp / batch_size;
+    bce_loss[0] = -loss_tmp / grad_normalizer;
   }
 }
 
@@ -208,7 +220,8 @@ void BinaryCrossEntropyLoss::fused_loss_computation(cudaStream_t stream) {
   //   printf("scaler %d\n", scaler);
 
   BinaryCrossEntropy_Kernel<<<1, block_size, block_size * sizeof(float), stream>>>(
-      input, label, bce_loss, scaler, batch_size);
+      input, label, bce_loss, scaler, batch_size, get_num_samples(batch_size),
+      get_grad_normalizer(batch_size));
 
 #ifndef NDEBUG
   cudaDeviceSynchronize();
@@ -238,12 +251,19 @@ __forceinline__ __device__ __host__ float cross_entropy_loss_backward(float x, f
 
 __global__ void MultiCrossEntropy_Kernel(float *input, const float *label,
                                          const float *target_weight, float *bce_loss, int batchsize,
+                                         int num_samples, float grad_normalizer,
                                          int labels_per_sample, int scaler) {
   int tid = threadIdx.x + blockDim.x * blockIdx.x;
   int num_threads = blockDim.x * gridDim.x;
   float loss_s = 0.f;
   const int size = batchsize * labels_per_sample;
+  const int valid_size = num_samples * labels_per_sample;
+  const float div = grad_normalizer * labels_per_sample;
   for (int i = tid; i < size; i += num_threads) {
+    if (i >= valid_size) {
+      input[i] = 0.f;
+      continue;
+    }
     int target_weight_idx = i % labels_per_sample;
     const float x = input[i];
     const float y = label[i];
@@ -252,14 +272,14 @@ __global__ void MultiCrossEntropy_Kernel(float *input, const float *label,
     loss_s += loss;
     input[i] = (label[i] < -0.5) ? 0.f
                                  : (target_weight[target_weight_idx] *
-                                    cross_entropy_loss_backward(x, y) / size * scaler);
+                                    cross_entropy_loss_backward(x, y) / div * scaler);
     // if(i == 0){
     //   printf("i=%d, x=%f, y=%f, target_weight[target_weight_idx]=%f, loss=%f, input=%f\n", i, x,
     //   y, target_weight[target_weight_idx], loss, input[i]);
     // }
   }
 
-  atomic_global_sum_div(-loss_s, bce_loss, size);
+  atomic_global_sum_div(-loss_s, bce_loss, div);
   return;
 }
 
@@ -291,7 +311,8 @@ void MultiCrossEntropyLoss::fused_loss_computation(cudaStream_t stream) {
 #endif
   //  printf("MultiCrossEntropy scaler %d\n", scaler);
   MultiCrossEntropy_Kernel<<<GRID_SIZE, BLOCK_SIZE, 0, stream>>>(
-      input, label, target_weight, loss, batchsize, labels_per_sample, scaler);
+      input, label, target_weight, loss, batchsize, get_num_samples(batchsize),
+      get_grad_normalizer(batchsize), labels_per_sample, scaler);
 
 #ifndef NDEBUG
   cudaDeviceSynchronize();
@@ -114,13 +114,38 @@ int main(int argc, char* argv[]) {
                                           *solver_config.device_map);
 
         HugeCTR::Timer timer;
+        HugeCTR::DataReaderStats last_reader_stats;
+        nv::AdmissionStats last_admission_stats;
         timer.start();
         // train
         if (pid == 0) {
           std::cout << "HugeCTR training start:" << std::endl;
         }
+        int epoch = 0;
         for (int i = 0; i < solver_config.max_iter; i++) {
-          session_instance.train();
+          HugeCTR::Error_t train_error = session_instance.train();
+          if (train_error == HugeCTR::Error_t::EndOfFile) {
+            // a pass over the training set is finished
+            epoch++;
+            if (pid == 0) {
+              MESSAGE_("Epoch " + std::to_string(epoch) + " finished at iter " +
+                       std::to_string(i));
+            }
+            if (epoch == solver_config.num_epochs) {
+              break;
+            }
+            // iter i trains the first batch of the next pass, which can't be empty
+            train_error = session_instance.train();
+            if (train_error == HugeCTR::Error_t::EndOfFile) {
+              throw HugeCTR::internal_runtime_error(
+                  HugeCTR::Error_t::WrongInput,
+                  "Runtime error: no batch in epoch " + std::to_string(epoch + 1));
+            }
+          }
+          if (train_error != HugeCTR::Error_t::Success) {
+            throw HugeCTR::internal_runtime_error(
+                train_error, "Runtime error: training failed at iter " + std::to_string(i));
+          }
           if (i % solver_config.display == 0 && i != 0) {
             timer.stop();
             // display
@@ -131,6 +156,20 @@ int main(int argc, char* argv[]) {
                        std::to_string(solver_config.display) + " iters): " +
                        std::to_string(timer.elapsedSeconds()) + "s Loss: " + std::to_string(loss));
             }
+            HugeCTR::DataReaderStats reader_stats;
+            session_instance.get_data_reader_stats(&reader_stats);
+            if (pid == 0) {
+              MESSAGE_("Data reader: " +
+                       reader_stats.since(last_reader_stats).to_string(timer.elapsedSeconds()));
+            }
+            last_reader_stats = reader_stats;
+            nv::AdmissionStats admission_stats;
+            session_instance.get_admission_stats(&admission_stats);
+            if (pid == 0 && admission_stats.keys > 0) {
+              MESSAGE_("Key admission: " +
+                       admission_stats.since(last_admission_stats).to_string());
+            }
+            last_admission_stats = admission_stats;
             timer.start();
           }
           if (i % solver_config.snapshot == 0 && i != 0) {
@@ -142,16 +181,24 @@ int main(int argc, char* argv[]) {
             session_instance.download_params_to_file(snapshot_dense_name, snapshot_sparse_name);
           }
           if (solver_config.eval_interval > 0 && i % solver_config.eval_interval == 0 && i != 0) {
-            float avg_loss = 0.f;
-            for (int j = 0; j < solver_config.eval_batches; ++j) {
-              session_instance.eval();
+            // at most eval_batches batches, or a whole pass if eval_batches is 0
+            double loss_sum = 0.0;
+            long long num_samples = 0;
+            int num_batches = 0;
+            while (solver_config.eval_batches <= 0 || num_batches < solver_config.eval_batches) {
+              if (session_instance.eval() != HugeCTR::Error_t::Success) {
+                break;
+              }
               float tmp_loss = 0.f;
               session_instance.get_current_loss(&tmp_loss);
-              avg_loss += tmp_loss;
-            }
-            if (solver_config.eval_batches > 0) {
-              avg_loss /= solver_config.eval_batches;
+              // the loss of a batch is the mean over its samples, a short batch weighs less
+              const int batch_samples = session_instance.get_current_num_samples();
+              loss_sum += static_cast<double>(tmp_loss) * batch_samples;
+              num_samples += batch_samples;
+              num_batches++;
             }
+            const float avg_loss =
+                num_samples > 0 ? static_cast<float>(loss_sum / num_samples) : 0.f;
             if (pid == 0) {
               MESSAGE_("Evaluation, average loss: " + std::to_string(avg_loss));
             }
@@ -20,6 +20,7 @@
 #include "HugeCTR/include/layer.hpp"
 #include "HugeCTR/include/layers/batch_norm_layer.hpp"
 #include "HugeCTR/include/layers/concat_layer.hpp"
+#include "HugeCTR/include/layers/dense_concat_layer.hpp"
 #include "HugeCTR/include/layers/elu_layer.hpp"
 #include "HugeCTR/include/layers/fully_connected_layer.hpp"
 #include "HugeCTR/include/layers/relu_layer.hpp"
@@ -189,16 +190,18 @@ OptParams get_optimizer_param(const nlohmann::json& j_optimizer) {
 }
 /*
  * Create single network
- *
+ * dense_tensor is the dense features from data reader, nullptr if there's none.
  */
 Network* create_network(const nlohmann::json& j_array, const nlohmann::json& j_optimizer,
-                        Tensor<float>& in_tensor, const Tensor<float>& label_tensor, int batch_size,
-                        int device_id, const GPUResource* gpu_resource) {
+                        Tensor<float>& in_tensor, const Tensor<float>& label_tensor,
+                        Tensor<float>* dense_tensor, int batch_size, int device_id,
+                        const GPUResource* gpu_resource) {
   const std::map<std::string, Layer_t> LAYER_TYPE_MAP = {
       {"BatchNorm", Layer_t::BatchNorm},
       {"BinaryCrossEntropyLoss", Layer_t::BinaryCrossEntropyLoss},
       {"Concat", Layer_t::Concat},
       {"CrossEntropyLoss", Layer_t::CrossEntropyLoss},
+      {"DenseConcat", Layer_t::DenseConcat},
       {"ELU", Layer_t::ELU},
       {"InnerProduct", Layer_t::InnerProduct},
       {"MultiCrossEntropyLoss", Layer_t::MultiCrossEntropyLoss},
@@ -302,6 +305,21 @@ Network* create_network(const nlohmann::json& j_array, const nlohmann::json& j_o
                                     *cross_entropy_loss_in_tensor, *loss_tensor, device_id);
         break;
       }
+      case Layer_t::DenseConcat: {
+        auto dc_in_tensor = input_output_info.input;
+        if (dense_tensor == nullptr) {
+          CK_THROW_(Error_t::WrongInput, "DenseConcat needs dense_dim > 0 in data");
+        }
+        // establish out tensor
+        std::vector<int> tmp_dim;
+        Tensor<float>* dc_out_tensor = new Tensor<float>(
+            tmp_dim = {batch_size, (dc_in_tensor->get_dims())[1] + (dense_tensor->get_dims())[1]},
+            blobs_buff, TensorFormat_t::HW);
+        output_tensor_pair.tensor = dc_out_tensor;
+        layers.push_back(
+            new DenseConcatLayer(*dc_in_tensor, *dense_tensor, *dc_out_tensor, device_id));
+        break;
+      }
       case Layer_t::ELU: {
         auto elu_in_tensor = input_output_info.input;
 
@@ -414,7 +432,7 @@ template <typename TypeKey>
 static void create_pipeline_internal(DataReader<TypeKey>** data_reader,
                                      Embedding<TypeKey>** embedding, std::vector<Network*>* network,
                                      GPUResourceGroup& gpu_resource_group, nlohmann::json config,
-                                     int batch_size) {
+                                     int batch_size, const ReaderPosition& reader_position) {
   try {
     int num_procs = 1, pid = 0;
 #ifdef ENABLE_MPI
@@ -445,8 +463,80 @@ static void create_pipeline_internal(DataReader<TypeKey>** data_reader,
       max_feature_num_per_sample = get_value_from_json<int>(j, "max_feature_num_per_sample");
       auto label_dim = get_value_from_json<int>(j, "label_dim");
       auto slot_num = get_value_from_json<int>(j, "slot_num");
-      data_reader[0] = new DataReader<TypeKey>(source_data, batch_size, label_dim, slot_num,
-                                               max_feature_num_per_sample, gpu_resource_group);
+      const std::map<std::string, ReaderMode_t> READER_MODE_MAP = {
+          {"stream", ReaderMode_t::Stream},
+          {"mmap", ReaderMode_t::Mmap},
+          {"direct", ReaderMode_t::Direct}};
+      DataReaderParams reader_params;
+      if (has_key_(j, "reader_mode")) {
+        auto reader_mode_name = get_value_from_json<std::string>(j, "reader_mode");
+        if (!find_item_in_map(&reader_params.reader_mode, reader_mode_name, READER_MODE_MAP)) {
+          CK_THROW_(Error_t::WrongInput, "No such reader_mode: " + reader_mode_name);
+        }
+      }
+      if (has_key_(j, "io_queue_depth")) {
+        reader_params.io_queue_depth = get_value_from_json<int>(j, "io_queue_depth");
+      }
+      if (has_key_(j, "records_per_range")) {
+        reader_params.records_per_range = get_value_from_json<long long>(j, "records_per_range");
+      }
+      if (has_key_(j, "shuffle_files")) {
+        reader_params.shuffle_files = get_value_from_json<bool>(j, "shuffle_files");
+      }
+      if (has_key_(j, "shuffle_buffer_size")) {
+        reader_params.shuffle_buffer_size = get_value_from_json<int>(j, "shuffle_buffer_size");
+      }
+      if (has_key_(j, "seed")) {
+        reader_params.seed = get_value_from_json<unsigned int>(j, "seed");
+      }
+      const std::map<std::string, HostAllocator_t> HOST_ALLOCATOR_MAP = {
+          {"pinned", HostAllocator_t::Pinned},
+          {"aligned", HostAllocator_t::Aligned},
+          {"hugepage", HostAllocator_t::HugePage},
+          {"numa", HostAllocator_t::Numa}};
+      if (has_key_(j, "host_allocator")) {
+        auto host_allocator_name = get_value_from_json<std::string>(j, "host_allocator");
+        if (!find_item_in_map(&reader_params.host_allocator, host_allocator_name,
+                              HOST_ALLOCATOR_MAP)) {
+          CK_THROW_(Error_t::WrongInput, "No such host_allocator: " + host_allocator_name);
+        }
+      }
+      if (has_key_(j, "numa_node")) {
+        reader_params.numa_node = get_value_from_json<int>(j, "numa_node");
+      }
+      if (has_key_(j, "dense_dim")) {
+        reader_params.dense_dim = get_value_from_json<int>(j, "dense_dim");
+      }
+      const std::map<std::string, KeyPartitioner_t> KEY_PARTITIONER_MAP = {
+          {"modulo", KeyPartitioner_t::Modulo},
+          {"hash", KeyPartitioner_t::Hash},
+          {"slot_aware", KeyPartitioner_t::SlotAware},
+          {"frequency", KeyPartitioner_t::Frequency}};
+      if (has_key_(j, "key_partitioner")) {
+        auto key_partitioner_name = get_value_from_json<std::string>(j, "key_partitioner");
+        if (!find_item_in_map(&reader_params.key_partitioner, key_partitioner_name,
+                              KEY_PARTITIONER_MAP)) {
+          CK_THROW_(Error_t::WrongInput, "No such key_partitioner: " + key_partitioner_name);
+        }
+      }
+      if (has_key_(j, "partition_table")) {
+        reader_params.partition_table = get_value_from_json<std::string>(j, "partition_table");
+      }
+      reader_params.start_position = reader_position;
+      // the training data is read in epoch mode if the number of epochs is limited
+      auto j_solver = get_json(config, "solver");
+      int num_epochs;
+      FIND_AND_ASSIGN_INT_KEY(num_epochs, j_solver);
+      if (num_epochs > 0) {
+        if (num_procs > 1) {
+          CK_THROW_(Error_t::WrongInput, "num_epochs is not supported in multi-node training");
+        }
+        reader_params.repeat = false;
+      }
+      data_reader[0] =
+          new DataReader<TypeKey>(source_data, batch_size, label_dim, slot_num,
+                                  max_feature_num_per_sample, gpu_resource_group, 31, 20,
+                                  reader_params);
       data_reader[1] = nullptr;
       std::string eval_source;
       FIND_AND_ASSIGN_STRING_KEY(eval_source, j);
@@ -483,18 +573,45 @@ static void create_pipeline_internal(DataReader<TypeKey>** data_reader,
       switch (embedding_type) {
         case Embedding_t::SparseEmbeddingHash: {
           auto load_factor = get_value_from_json<float>(j_hparam, "load_factor");
+          int admit_threshold = 0;
+          if (has_key_(j_hparam, "admit_threshold")) {
+            admit_threshold = get_value_from_json<int>(j_hparam, "admit_threshold");
+            if (admit_threshold < 0) {
+              CK_THROW_(Error_t::WrongInput, "admit_threshold < 0");
+            }
+          }
+          int admit_sketch_width = 0;
+          if (has_key_(j_hparam, "admit_sketch_width")) {
+            admit_sketch_width = get_value_from_json<int>(j_hparam, "admit_sketch_width");
+            if (admit_sketch_width < 0) {
+              CK_THROW_(Error_t::WrongInput, "admit_sketch_width < 0");
+            }
+          }
+          int admit_decay_interval = 0;
+          if (has_key_(j_hparam, "admit_decay_interval")) {
+            admit_decay_interval = get_value_from_json<int>(j_hparam, "admit_decay_interval");
+            if (admit_decay_interval < 0) {
+              CK_THROW_(Error_t::WrongInput, "admit_decay_interval < 0");
+            }
+          }
+          // the batch is rounded up to a multiple of the GPUs like the data reader does
+          int total_gpu_count = gpu_resource_group.get_total_gpu_count();
           const SparseEmbeddingHashParams embedding_params = {
-              batch_size,
+              (batch_size + total_gpu_count - 1) / total_gpu_count * total_gpu_count,
               vocabulary_size,
               load_factor,
               embedding_vec_size,
               max_feature_num_per_sample,
               slot_num,
               combiner,  // combiner: 0-sum, 1-mean, 2-sqrtn
-              opt_params};
+              opt_params,
+              admit_threshold,
+              admit_sketch_width,
+              admit_decay_interval};
           *embedding = EmbeddingCreator::create_sparse_embedding_hash(
               (*data_reader)->get_row_offsets_tensors(), (*data_reader)->get_value_tensors(),
               embedding_params, gpu_resource_group);
+          (*embedding)->set_key_partitioner((*data_reader)->get_key_partitioner());
           break;
         }
         default: { assert(!"Error: no such option && should never get here!"); }
@@ -511,17 +628,18 @@ static void create_pipeline_internal(DataReader<TypeKey>** data_reader,
 
       std::vector<Tensor<float>*>& embedding_tensors = (*embedding)->get_output_tensors();
       const std::vector<Tensor<float>*>& label_tensors = (*data_reader)->get_label_tensors();
+      const std::vector<Tensor<float>*>& dense_tensors = (*data_reader)->get_dense_tensors();
 
       int i = 0;
       int total_gpu_count = gpu_resource_group.get_total_gpu_count();
-      if (0 != batch_size % total_gpu_count) {
-        CK_THROW_(Error_t::WrongInput, "0 != batch_size\%total_gpu_count");
-      }
+      int batch_size_per_gpu = (batch_size + total_gpu_count - 1) / total_gpu_count;
       std::vector<int> device_list = gpu_resource_group.get_device_list();
       for (auto device_id : device_list) {
+        Tensor<float>* dense_tensor = dense_tensors.empty() ? nullptr : dense_tensors[i];
         network->push_back(create_network(j_layers_array, j_optimizer, *(embedding_tensors[i]),
-                                          *(label_tensors[i]), batch_size / total_gpu_count,
-                                          device_id, gpu_resource_group[i]));
+                                          *(label_tensors[i]), dense_tensor,
+                                          batch_size_per_gpu, device_id,
+                                          gpu_resource_group[i]));
         i++;
       }
     }
@@ -532,16 +650,32 @@ static void create_pipeline_internal(DataReader<TypeKey>** data_reader,
   }
 }
 
+KeyType_t Parser::get_key_type() const {
+  const std::map<std::string, KeyType_t> KEY_TYPE_MAP = {{"long", KeyType_t::LongLong},
+                                                          {"uint", KeyType_t::UnsignedInt}};
+  KeyType_t key_type = KeyType_t::LongLong;
+  auto j = get_json(config_, "data");
+  if (has_key_(j, "key_type")) {
+    auto key_type_name = get_value_from_json<std::string>(j, "key_type");
+    if (!find_item_in_map(&key_type, key_type_name, KEY_TYPE_MAP)) {
+      CK_THROW_(Error_t::WrongInput, "No such key_type: " + key_type_name);
+    }
+  }
+  return key_type;
+}
+
 void Parser::create_pipeline(DataReader<TYPE_1>** data_reader, Embedding<TYPE_1>** embedding,
-                             std::vector<Network*>* network, GPUResourceGroup& gpu_resource_group) {
+                             std::vector<Network*>* network, GPUResourceGroup& gpu_resource_group,
+                             const ReaderPosition& reader_position) {
   create_pipeline_internal<TYPE_1>(data_reader, embedding, network, gpu_resource_group, config_,
-                                   batch_size_);
+                                   batch_size_, reader_position);
 }
 
 void Parser::create_pipeline(DataReader<TYPE_2>** data_reader, Embedding<TYPE_2>** embedding,
-                             std::vector<Network*>* network, GPUResourceGroup& gpu_resource_group) {
+                             std::vector<Network*>* network, GPUResourceGroup& gpu_resource_group,
+                             const ReaderPosition& reader_position) {
   create_pipeline_internal<TYPE_2>(data_reader, embedding, network, gpu_resource_group, config_,
-                                   batch_size_);
+                                   batch_size_, reader_position);
 }
 
 SolverParser::SolverParser(std::string configure_file) {
@@ -580,6 +714,7 @@ SolverParser::SolverParser(std::string configure_file) {
 
     FIND_AND_ASSIGN_INT_KEY(eval_interval, j);
     FIND_AND_ASSIGN_INT_KEY(eval_batches, j);
+    FIND_AND_ASSIGN_INT_KEY(num_epochs, j);
     FIND_AND_ASSIGN_STRING_KEY(embedding_file, j);
 
     auto gpu_array = get_json(j, "gpu");
@@ -54,17 +54,42 @@ static void check_device(int device_id, int min_major, int min_minor) {
   return;
 }
 
-Session::Session(int batch_size, const std::string& json_name, const DeviceMap& device_map)
-    : gpu_resource_group_(device_map) {
+template <typename TypeKey>
+void Session::create_pipeline(const ReaderPosition& reader_position) {
+  DataReader<TypeKey>* data_reader_array[2];
+  Embedding<TypeKey>* embedding = nullptr;
+  parser_->create_pipeline(data_reader_array, &embedding, &networks_, gpu_resource_group_,
+                           reader_position);
+  embedding_ = embedding;
+  data_reader_ = data_reader_array[0];
+  data_reader_eval_ = data_reader_array[1];
+}
+
+Session::Session(int batch_size, const std::string& json_name, const DeviceMap& device_map,
+                 const std::string& reader_position_file)
+    : gpu_resource_group_(device_map),
+      batch_size_per_gpu_((batch_size + gpu_resource_group_.get_total_gpu_count() - 1) /
+                          gpu_resource_group_.get_total_gpu_count()) {
   try {
     for (auto dev : gpu_resource_group_.get_device_list()) {
       check_device(dev, 6, 0);  // lowest supported device is CC=60
     }
+    ReaderPosition reader_position;
+    if (!reader_position_file.empty() && std::ifstream(reader_position_file).is_open()) {
+      reader_position.load(reader_position_file);
+      MESSAGE_("Resume data reading from " + reader_position_file + " (epoch " +
+               std::to_string(reader_position.get_epoch()) + ")");
+    }
     parser_ = new Parser(json_name, batch_size);
-    DataReader<TypeKey>* data_reader_array[2];
-    parser_->create_pipeline(data_reader_array, &embedding_, &networks_, gpu_resource_group_);
-    data_reader_ = data_reader_array[0];
-    data_reader_eval_ = data_reader_array[1];
+    switch (parser_->get_key_type()) {
+      case KeyType_t::LongLong:
+        create_pipeline<Parser::TYPE_1>(reader_position);
+        break;
+      case KeyType_t::UnsignedInt:
+        create_pipeline<Parser::TYPE_2>(reader_position);
+        break;
+      default: { assert(!"Error: no such option && should never get here!"); }
+    }
   } catch (const internal_runtime_error& rt_err) {
     std::cerr << rt_err.what() << std::endl;
   } catch (const std::exception& err) {
@@ -139,9 +164,26 @@ void network_train_helper(int id, Network* n) {
   return;
 }
 
+void Session::set_num_samples(int num_samples) {
+  current_num_samples_ = num_samples;
+  embedding_->set_num_samples(num_samples);
+  const auto& device_list = gpu_resource_group_.get_device_list();
+  const float grad_normalizer =
+      static_cast<float>(num_samples) / gpu_resource_group_.get_total_gpu_count();
+  for (unsigned int i = 0; i < networks_.size(); i++) {
+    int global_id = gpu_resource_group_.get_global_id(device_list[i]);
+    networks_[i]->set_num_samples(
+        get_device_num_samples(num_samples, batch_size_per_gpu_, global_id), grad_normalizer);
+  }
+}
+
 Error_t Session::train() {
   try {
-    data_reader_->read_a_batch_to_device();
+    int num_samples = data_reader_->read_a_batch_to_device();
+    if (num_samples == 0) {
+      return Error_t::EndOfFile;
+    }
+    set_num_samples(num_samples);
     embedding_->forward();
 
     if (networks_.size() > 1) {
@@ -195,7 +237,11 @@ void network_eval_helper(int id, Network* n) {
 Error_t Session::eval() {
   try {
     if (data_reader_eval_ == nullptr) return Error_t::NotInitialized;
-    data_reader_eval_->read_a_batch_to_device();
+    int num_samples = data_reader_eval_->read_a_batch_to_device();
+    if (num_samples == 0) {
+      return Error_t::EndOfFile;
+    }
+    set_num_samples(num_samples);
     embedding_->forward();
 
     if (networks_.size() > 1) {
@@ -231,6 +277,7 @@ Error_t Session::download_params_to_file(std::string weights_file, std::string e
     CK_MPI_THROW_(MPI_Comm_rank(MPI_COMM_WORLD, &pid));
     CK_MPI_THROW_(MPI_Comm_size(MPI_COMM_WORLD, &numprocs));
 #endif
+    data_reader_->get_position().save(get_reader_position_file_name(weights_file));
     if (pid == 0) {
       std::ofstream out_stream_weight(weights_file, std::ofstream::binary);
       networks_[0]->download_params_to_host(out_stream_weight);
@@ -254,6 +301,19 @@ Error_t Session::download_params_to_file(std::string weights_file, std::string e
   return Error_t::Success;
 }
 
+std::string Session::get_reader_position_file_name(const std::string& weights_file) {
+  int numprocs = 1, pid = 0;
+#ifdef ENABLE_MPI
+  CK_MPI_THROW_(MPI_Comm_rank(MPI_COMM_WORLD, &pid));
+  CK_MPI_THROW_(MPI_Comm_size(MPI_COMM_WORLD, &numprocs));
+#endif
+  std::string file_name = weights_file + ".reader";
+  if (numprocs > 1) {
+    file_name += "." + std::to_string(pid);
+  }
+  return file_name;
+}
+
 Error_t Session::get_current_loss(float* loss) {
   try {
     float loss_sum = 0.f;
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * CPU microbenchmark of nv::batch_murmur_hash3_32 against the per-key MurmurHash3_32 functor,
+ * for 32-bit and 64-bit keys and each instruction set the CPU supports. num_keys random keys
+ * are hashed num_iters times, in batches of 4096 keys, and every hash is checked against the
+ * functor. It reports million keys per second.
+ * usage: ./bench_batch_hash [num_keys] [num_iters]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "HugeCTR/include/hashtable/batch_hash_functions.hpp"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t batch = 4096;
+
+/**
+ * Run func(begin, len) on the batches of [0, num_keys), num_iters times.
+ * @return million keys per second.
+ */
+template <typename Func>
+double run(size_t num_keys, int num_iters, Func func) {
+  auto start = Clock::now();
+  for (int iter = 0; iter < num_iters; iter++) {
+    for (size_t i = 0; i < num_keys; i += batch) {
+      func(i, std::min(batch, num_keys - i));
+    }
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return num_keys * num_iters / seconds / 1e6;
+}
+
+const char* isa_name(nv::HashIsa isa) {
+  switch (isa) {
+    case nv::HashIsa::AVX2:
+      return "AVX2";
+    case nv::HashIsa::AVX512:
+      return "AVX512";
+    default:
+      return "Scalar";
+  }
+}
+
+/**
+ * Benchmark the keys of type Key.
+ * @return false if a hash differs from the functor.
+ */
+template <typename Key>
+bool bench(const char* name, size_t num_keys, int num_iters) {
+  std::mt19937_64 generator(0);
+  std::vector<Key> keys(num_keys);
+  for (auto& key : keys) {
+    key = static_cast<Key>(generator());
+  }
+  std::vector<hash_value_type> expected(num_keys);
+  std::vector<hash_value_type> hashes(num_keys);
+
+  const MurmurHash3_32<Key> hasher;
+  double functor_rate = run(num_keys, num_iters, [&](size_t begin, size_t len) {
+    for (size_t i = begin; i < begin + len; i++) {
+      expected[i] = hasher(keys[i]);
+    }
+  });
+  printf("%-10s %-10s %10.1f %8s\n", name, "functor", functor_rate, "1.00");
+  for (auto isa : {nv::HashIsa::Scalar, nv::HashIsa::AVX2, nv::HashIsa::AVX512}) {
+    if (!nv::is_hash_isa_supported(isa)) {
+      printf("%-10s %-10s %10s\n", name, isa_name(isa), "-");
+      continue;
+    }
+    double rate = run(num_keys, num_iters, [&](size_t begin, size_t len) {
+      nv::batch_murmur_hash3_32(keys.data() + begin, hashes.data() + begin, len, isa);
+    });
+    if (hashes != expected) {
+      printf("%s: wrong hashes of %s keys\n", isa_name(isa), name);
+      return false;
+    }
+    printf("%-10s %-10s %10.1f %8.2f\n", name, isa_name(isa), rate, rate / functor_rate);
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_keys = 1 << 22;
+  int num_iters = 10;
+  if (argc > 1) {
+    num_keys = std::atoll(argv[1]);
+  }
+  if (argc > 2) {
+    num_iters = std::atoi(argv[2]);
+  }
+  if (num_keys == 0 || num_iters <= 0) {
+    printf("usage: %s [num_keys] [num_iters]\n", argv[0]);
+    return -1;
+  }
+
+  printf("%d keys x %d, best isa %s, Mkeys/s\n", static_cast<int>(num_keys), num_iters,
+         isa_name(nv::get_hash_isa()));
+  printf("%-10s %-10s %10s %8s\n", "key", "hash", "rate", "speedup");
+  if (!bench<unsigned int>("uint32", num_keys, num_iters) ||
+      !bench<long long>("int64", num_keys, num_iters)) {
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * CPU microbenchmark of the chunk handoff between reading threads (producers)
+ * and the collector (single consumer): Heap vs. ChunkRing.
+ * For each number of producers it reports the handoff rate, the latency from
+ * checkin by a producer to checkout by the consumer, and the CPU time burnt
+ * per wall second (cores) by all the threads.
+ * usage: ./bench_chunk_ring [num_handoffs]
+ */
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HugeCTR/include/chunk_ring.hpp"
+#include "HugeCTR/include/heap.hpp"
+
+using namespace HugeCTR;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchChunk {
+  Clock::time_point checkin_time;
+};
+
+double cpu_seconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
+
+template <typename Queue>
+void run(const std::string& name, int num_producers, int num_handoffs) {
+  const int num_chunks = 31;
+  Queue queue(num_chunks, BenchChunk());
+  std::atomic<bool> stop{false};
+  std::vector<double> latency_us;
+  latency_us.reserve(num_handoffs);
+
+  double cpu_start = cpu_seconds();
+  auto wall_start = Clock::now();
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; p++) {
+    producers.emplace_back([&queue, &stop]() {
+      while (!stop) {
+        BenchChunk* chunk = nullptr;
+        unsigned int key = 0;
+        queue.free_chunk_checkout(&chunk, &key);
+        if (chunk == nullptr) {
+          break;
+        }
+        chunk->checkin_time = Clock::now();
+        queue.chunk_write_and_checkin(key);
+      }
+    });
+  }
+  for (int i = 0; i < num_handoffs; i++) {
+    BenchChunk* chunk = nullptr;
+    unsigned int key = 0;
+    queue.data_chunk_checkout(&chunk, &key);
+    latency_us.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - chunk->checkin_time).count());
+    queue.chunk_free_and_checkin(key);
+  }
+  stop = true;
+  queue.break_and_return();
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  double wall = std::chrono::duration<double>(Clock::now() - wall_start).count();
+  double cpu = cpu_seconds() - cpu_start;
+
+  std::sort(latency_us.begin(), latency_us.end());
+  double sum = 0.0;
+  for (auto l : latency_us) {
+    sum += l;
+  }
+  printf("%-10s %9d %14.0f %12.2f %12.2f %12.2f\n", name.c_str(), num_producers,
+         num_handoffs / wall, sum / latency_us.size(),
+         latency_us[static_cast<size_t>(latency_us.size() * 0.99)], cpu / wall);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int num_handoffs = 200000;
+  if (argc > 1) {
+    num_handoffs = std::atoi(argv[1]);
+  }
+  if (num_handoffs <= 0) {
+    printf("usage: %s [num_handoffs]\n", argv[0]);
+    return -1;
+  }
+  printf("%-10s %9s %14s %12s %12s %12s\n", "queue", "producers", "handoffs/s", "avg_lat(us)",
+         "p99_lat(us)", "cpu(cores)");
+  const int producer_counts[] = {1, 4, 20, 64};
+  for (int num_producers : producer_counts) {
+    run<Heap<BenchChunk>>("Heap", num_producers, num_handoffs);
+    run<ChunkRing<BenchChunk>>("ChunkRing", num_producers, num_handoffs);
+  }
+  return 0;
+}
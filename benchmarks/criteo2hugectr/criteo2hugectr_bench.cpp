@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Throughput of the criteo text to HugeCTR conversion on synthetic text.
+ * "legacy" is the line by line conversion (std::stringstream splitting, std::stoi and
+ * a write per key), the others are the pipeline of criteo2hugectr.hpp with different
+ * numbers of workers. The data files are written to ./bench_criteo2hugectr_data/.
+ * usage: ./bench_criteo2hugectr [num_lines] [slot_num]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include "samples/criteo/criteo2hugectr.hpp"
+
+using namespace criteo2hugectr;
+
+namespace {
+
+const char* prefix = "./bench_criteo2hugectr_data/bench_";
+const char* file_list_name = "./bench_criteo2hugectr_data/file_list.txt";
+
+std::string generate_text(int num_lines, int keys_per_sample) {
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> key_dist(0, 1603615);
+  std::string text;
+  for (int i = 0; i < num_lines; i++) {
+    text += std::to_string(generator() % 2);
+    for (int j = 0; j < keys_per_sample; j++) {
+      text += ' ';
+      text += std::to_string(key_dist(generator));
+    }
+    text += '\n';
+  }
+  return text;
+}
+
+/**
+ * The conversion of the former criteo2hugectr, into a single data file.
+ */
+long long legacy_convert(const Options& options, std::istream& in) {
+  std::ofstream data_file(std::string(prefix) + "legacy.data", std::ofstream::binary);
+  DataSetHeader header = {0, label_dim, options.slot_num, 0};
+  data_file.write(reinterpret_cast<char*>(&header), sizeof(DataSetHeader));
+  long long samples = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::vector<std::string> vec_string;
+    std::stringstream ss(line);
+    std::string item;
+    while (std::getline(ss, item, ' ')) {
+      vec_string.push_back(item);
+    }
+    int label = std::stoi(vec_string[0]);
+    data_file.write(reinterpret_cast<char*>(&label), sizeof(int));
+    std::vector<std::vector<T>> slots(options.slot_num);
+    for (int j = 0; j < options.keys_per_sample; j++) {
+      T key = static_cast<T>(std::stoi(vec_string[j + 1]));
+      slots[key % options.slot_num].push_back(key);
+    }
+    for (auto& slot : slots) {
+      int nnz = slot.size();
+      data_file.write(reinterpret_cast<char*>(&nnz), sizeof(int));
+      for (T key : slot) {
+        data_file.write(reinterpret_cast<char*>(&key), sizeof(T));
+      }
+    }
+    samples++;
+  }
+  return samples;
+}
+
+void report(const char* name, int num_threads, long long samples, size_t text_bytes,
+            double seconds) {
+  printf("%-10s %8d %14.0f %12.1f %10.3f\n", name, num_threads, samples / seconds,
+         text_bytes / seconds / 1e6, seconds);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int num_lines = 500000;
+  Options options;
+  if (argc > 1) {
+    num_lines = std::atoi(argv[1]);
+  }
+  if (argc > 2) {
+    options.slot_num = std::atoi(argv[2]);
+  }
+  if (num_lines <= 0 || options.slot_num <= 0) {
+    printf("usage: %s [num_lines] [slot_num]\n", argv[0]);
+    return -1;
+  }
+  check_make_dir("./bench_criteo2hugectr_data");
+  const std::string text = generate_text(num_lines, options.keys_per_sample);
+  printf("%d lines, %.1f MB of text, slot_num %d\n", num_lines, text.size() / 1e6,
+         options.slot_num);
+  printf("%-10s %8s %14s %12s %10s\n", "converter", "threads", "samples/s", "text(MB/s)",
+         "time(s)");
+
+  typedef std::chrono::steady_clock Clock;
+  {
+    std::istringstream in(text);
+    auto start = Clock::now();
+    long long samples = legacy_convert(options, in);
+    report("legacy", 1, samples, text.size(),
+           std::chrono::duration<double>(Clock::now() - start).count());
+  }
+  std::vector<int> thread_counts = {1, 2, 4, 8};
+  int hardware_threads = static_cast<int>(std::thread::hardware_concurrency());
+  if (hardware_threads > 8) {
+    thread_counts.push_back(hardware_threads);
+  }
+  for (int num_threads : thread_counts) {
+    options.num_threads = num_threads;
+    std::istringstream in(text);
+    auto start = Clock::now();
+    long long samples = convert(options, in, prefix, file_list_name);
+    report("pipeline", num_threads, samples, text.size(),
+           std::chrono::duration<double>(Clock::now() - start).count());
+  }
+  return 0;
+}
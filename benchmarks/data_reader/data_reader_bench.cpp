@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * CPU only throughput benchmark of the reader stack:
+ * FileList -> DataReaderMultiThreads (num_threads) -> ChunkRing<CSRChunk> (num_chunks)
+ * -> a consumer draining the ring in place of DataCollector.
+ * The data sets are made by data_generation() under ./bench_data_reader_data/ and kept
+ * for the next runs. For each point of the sweep it reports:
+ * - samples/s and MB/s (bytes of data file) seen by the consumer;
+ * - utilisation of the reading threads: time spent on reading and decoding per wall
+ *   second (avg / min / max over the threads), low values mean the threads wait for
+ *   free chunks, i.e. the consumer is the bottleneck;
+ * - ring occupancy: average number of ready chunks when the consumer checks out one,
+ *   and the fraction of the time the consumer waits for a chunk (the readers are the
+ *   bottleneck).
+ * usage: ./bench_data_reader [--slot-num 1,10,26] [--max-nnz 2,10,30] [--batchsize 1024,16384]
+ *                            [--threads 20] [--chunks 31] [--batches N] [--mmap | --direct]
+ *                            [--io-queue-depth 8] [--records-per-range N]
+ *                            [--allocator aligned|hugepage|numa] [--codec lz4|zstd]
+ *                            [--levels 1,3,9]
+ * The chunks are allocated without CUDA (aligned by default).
+ * --direct reads the files with O_DIRECT and io_queue_depth blocks read ahead (see
+ * AsyncFileReader). Run it on a cold page cache to see the effect of the read-ahead.
+ * --records-per-range splits the files to ranges read by several threads (see FileList),
+ * which matters when there are fewer files than threads.
+ * --codec reads compressed copies of the files (see convert_data_set_to_v2()), made once for
+ * each of --levels; ratio is the size of the v1 files over the compressed ones. The samples/s
+ * of the levels tell whether the decompression or the disk is the bottleneck.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HugeCTR/include/chunk_ring.hpp"
+#include "HugeCTR/include/csr_chunk.hpp"
+#include "HugeCTR/include/data_reader_multi_threads.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
+#include "HugeCTR/include/file_list.hpp"
+#include "HugeCTR/include/host_allocator.hpp"
+#include "HugeCTR/include/utils.hpp"
+
+using namespace HugeCTR;
+
+namespace {
+
+typedef long long T;
+typedef std::chrono::steady_clock Clock;
+
+const int label_dim = 1;
+const int num_files = 4;
+const int num_records_per_file = 16384;
+const int vocabulary_size = 1603616;
+
+struct Config {
+  int slot_num;
+  int max_nnz;
+  int batchsize;
+  int num_threads;
+  int num_chunks;
+  int level;
+};
+
+long long get_file_size(const std::string& file_name) {
+  std::ifstream stream(file_name, std::ifstream::binary | std::ifstream::ate);
+  return stream ? static_cast<long long>(stream.tellg()) : -1;
+}
+
+std::vector<int> parse_list(const std::string& str) {
+  std::vector<int> list;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    list.push_back(std::atoi(item.c_str()));
+  }
+  return list;
+}
+
+/**
+ * Make (once) the data set of slot_num and max_nnz, and its copy compressed with codec
+ * at level unless codec is DATA_SET_CODEC_NONE.
+ * @param ratio the size of the v1 files over the size of the files read is passed out.
+ * @return the name of its file list.
+ */
+std::string prepare_data_set(int slot_num, int max_nnz, bool indexed, int codec, int level,
+                             double* ratio) {
+  const std::string name = "s" + std::to_string(slot_num) + "_n" + std::to_string(max_nnz);
+  const std::string file_list_name = "./bench_data_reader_data/" + name + "_file_list.txt";
+  data_generation<T>(file_list_name, "./bench_data_reader_data/" + name + "/", num_files,
+                     num_records_per_file, slot_num, vocabulary_size, label_dim, max_nnz);
+  *ratio = 1.0;
+  if (!indexed && codec == DATA_SET_CODEC_NONE) {
+    return file_list_name;
+  }
+  const std::string suffix = std::string(".") + get_codec_name(codec) + std::to_string(level);
+  const std::string compressed_file_list_name =
+      "./bench_data_reader_data/" + name + suffix + "_file_list.txt";
+  std::ifstream list_stream(file_list_name);
+  std::ofstream compressed_list_stream;
+  if (codec != DATA_SET_CODEC_NONE) {
+    compressed_list_stream.open(compressed_file_list_name);
+  }
+  std::string file_name;
+  std::getline(list_stream, file_name);
+  compressed_list_stream << file_name << std::endl;
+  long long v1_bytes = 0;
+  long long compressed_bytes = 0;
+  while (std::getline(list_stream, file_name)) {
+    if (codec != DATA_SET_CODEC_NONE) {
+      // v2 files have the block index, no record index is needed to split them
+      const std::string compressed_file_name = file_name + suffix;
+      if (get_file_size(compressed_file_name) < 0) {
+        convert_data_set_to_v2<T>(file_name, compressed_file_name,
+                                  DATA_SET_DEFAULT_RECORDS_PER_BLOCK, codec, level);
+      }
+      compressed_list_stream << compressed_file_name << std::endl;
+      v1_bytes += get_file_size(file_name);
+      compressed_bytes += get_file_size(compressed_file_name);
+      continue;
+    }
+    // the v1 files need a record index to be split
+    std::ifstream in_stream(file_name, std::ifstream::binary);
+    DataSetHeader header;
+    in_stream.read(reinterpret_cast<char*>(&header), sizeof(DataSetHeader));
+    if (in_stream && get_record_stride(file_name, header) == 0) {
+      build_record_index<T>(file_name);
+    }
+  }
+  if (codec == DATA_SET_CODEC_NONE) {
+    return file_list_name;
+  }
+  *ratio = static_cast<double>(v1_bytes) / compressed_bytes;
+  return compressed_file_list_name;
+}
+
+void run(const Config& config, int num_batches, ReaderMode_t mode, int io_queue_depth,
+         long long records_per_range, int codec,
+         const std::shared_ptr<HostAllocator>& allocator) {
+  double ratio = 1.0;
+  const std::string file_list_name = prepare_data_set(
+      config.slot_num, config.max_nnz, records_per_range > 0, codec, config.level, &ratio);
+  // nnz of a slot is in [0, max_nnz - 1]
+  const int max_feature_num_per_sample = config.slot_num * config.max_nnz;
+  FileList file_list(file_list_name, false, 0, true, records_per_range);
+  CSRChunk<T> chunk(1, config.batchsize, label_dim, config.slot_num,
+                    std::max(max_feature_num_per_sample, 2) * config.batchsize, allocator);
+  ChunkRing<CSRChunk<T>> ring(config.num_chunks, chunk);
+  std::vector<DataReaderMultiThreads<T>*> readers;
+  std::vector<std::thread> threads;
+  std::atomic<bool> loop_flag{true};
+  for (int i = 0; i < config.num_threads; i++) {
+    readers.push_back(new DataReaderMultiThreads<T>(ring, file_list, max_feature_num_per_sample,
+                                                    mode, 0, 0, io_queue_depth));
+  }
+
+  // warm up: let the readers fill the ring once
+  auto wall_start = Clock::now();
+  for (auto reader : readers) {
+    threads.emplace_back([reader, &loop_flag]() {
+      while (loop_flag) {
+        reader->read_a_batch();
+      }
+    });
+  }
+  double wait_seconds = 0.0;
+  double occupancy_sum = 0.0;
+  long long samples = 0;
+  long long bytes_start = 0;
+  std::vector<double> busy_start(readers.size(), 0.0);
+  const int num_warmup_batches = config.num_chunks;
+  for (int i = 0; i < num_warmup_batches + num_batches; i++) {
+    if (i == num_warmup_batches) {
+      for (size_t t = 0; t < readers.size(); t++) {
+        bytes_start += readers[t]->get_bytes_read();
+        busy_start[t] = readers[t]->get_busy_seconds();
+      }
+      wall_start = Clock::now();
+    }
+    const bool measured = i >= num_warmup_batches;
+    if (measured) {
+      occupancy_sum += ring.get_num_ready_chunks();
+    }
+    CSRChunk<T>* chunk_tmp = nullptr;
+    unsigned int key = 0;
+    auto wait_start = Clock::now();
+    ring.data_chunk_checkout(&chunk_tmp, &key);
+    if (measured) {
+      wait_seconds += std::chrono::duration<double>(Clock::now() - wait_start).count();
+      samples += chunk_tmp->get_num_samples();
+    }
+    ring.chunk_free_and_checkin(key);
+  }
+  double wall = std::chrono::duration<double>(Clock::now() - wall_start).count();
+  long long bytes = -bytes_start;
+  std::vector<double> utilisation;
+  for (size_t t = 0; t < readers.size(); t++) {
+    bytes += readers[t]->get_bytes_read();
+    utilisation.push_back((readers[t]->get_busy_seconds() - busy_start[t]) / wall);
+  }
+
+  for (auto reader : readers) {
+    reader->skip_read();
+  }
+  ring.break_and_return();
+  loop_flag = false;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto reader : readers) {
+    delete reader;
+  }
+
+  double utilisation_sum = 0.0;
+  for (double u : utilisation) {
+    utilisation_sum += u;
+  }
+  printf("%6d %6d %8d %7d %6d %6d %6.2f %12.0f %10.1f %6.2f %6.2f %6.2f %9.2f %8.1f\n",
+         config.slot_num, config.max_nnz, config.batchsize, config.num_threads, config.num_chunks,
+         config.level, ratio, samples / wall, bytes / wall / 1e6,
+         utilisation_sum / utilisation.size(),
+         *std::min_element(utilisation.begin(), utilisation.end()),
+         *std::max_element(utilisation.begin(), utilisation.end()), occupancy_sum / num_batches,
+         wait_seconds / wall * 100);
+}
+
+}  // namespace
+
+static std::string usage_str =
+    "usage: ./bench_data_reader [--slot-num 1,10,26] [--max-nnz 2,10,30] [--batchsize "
+    "1024,16384] [--threads 20] [--chunks 31] [--batches N] [--mmap | --direct] "
+    "[--io-queue-depth 8] [--records-per-range N] [--allocator aligned|hugepage|numa] "
+    "[--codec lz4|zstd] [--levels 1,3,9]";
+
+int main(int argc, char* argv[]) {
+  std::vector<int> slot_nums = {1, 10, 26};
+  std::vector<int> max_nnzs = {2, 10, 30};
+  std::vector<int> batchsizes = {1024, 16384};
+  std::vector<int> thread_counts = {20};
+  std::vector<int> chunk_counts = {31};
+  std::vector<int> levels = {1};
+  int codec = DATA_SET_CODEC_NONE;
+  int num_batches = 200;
+  int io_queue_depth = ASYNC_READ_DEFAULT_QUEUE_DEPTH;
+  long long records_per_range = 0;
+  ReaderMode_t mode = ReaderMode_t::Stream;
+  HostAllocator_t allocator_type = HostAllocator_t::Aligned;
+  for (int i = 1; i < argc; i++) {
+    std::string option(argv[i]);
+    if (option == "--mmap") {
+      mode = ReaderMode_t::Mmap;
+      continue;
+    }
+    if (option == "--direct") {
+      mode = ReaderMode_t::Direct;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      printf("%s\n", usage_str.c_str());
+      return -1;
+    }
+    std::string value(argv[++i]);
+    if (option == "--slot-num") {
+      slot_nums = parse_list(value);
+    } else if (option == "--max-nnz") {
+      max_nnzs = parse_list(value);
+    } else if (option == "--batchsize") {
+      batchsizes = parse_list(value);
+    } else if (option == "--threads") {
+      thread_counts = parse_list(value);
+    } else if (option == "--chunks") {
+      chunk_counts = parse_list(value);
+    } else if (option == "--batches") {
+      num_batches = std::atoi(value.c_str());
+    } else if (option == "--io-queue-depth") {
+      io_queue_depth = std::atoi(value.c_str());
+    } else if (option == "--records-per-range") {
+      records_per_range = std::atoll(value.c_str());
+    } else if (option == "--codec") {
+      codec = find_codec(value);
+      if (codec < 0 || !is_codec_available(codec)) {
+        printf("codec is not available: %s\n", value.c_str());
+        return -1;
+      }
+    } else if (option == "--levels") {
+      levels = parse_list(value);
+    } else if (option == "--allocator" && value == "aligned") {
+      allocator_type = HostAllocator_t::Aligned;
+    } else if (option == "--allocator" && value == "hugepage") {
+      allocator_type = HostAllocator_t::HugePage;
+    } else if (option == "--allocator" && value == "numa") {
+      allocator_type = HostAllocator_t::Numa;
+    } else {
+      printf("%s\n", usage_str.c_str());
+      return -1;
+    }
+  }
+  for (auto list : {&slot_nums, &max_nnzs, &batchsizes, &thread_counts, &chunk_counts, &levels}) {
+    if (list->empty() || *std::min_element(list->begin(), list->end()) <= 0) {
+      printf("%s\n", usage_str.c_str());
+      return -1;
+    }
+  }
+  if (num_batches <= 0 || io_queue_depth <= 0 || records_per_range < 0) {
+    printf("%s\n", usage_str.c_str());
+    return -1;
+  }
+
+  printf("%6s %6s %8s %7s %6s %6s %6s %12s %10s %6s %6s %6s %9s %8s\n", "slots", "nnz", "batch",
+         "threads", "chunks", "level", "ratio", "samples/s", "MB/s", "util", "min", "max",
+         "ring_occ", "wait(%)");
+  try {
+    check_make_dir("./bench_data_reader_data");
+    std::shared_ptr<HostAllocator> allocator = create_host_allocator(allocator_type);
+    for (int slot_num : slot_nums) {
+      for (int max_nnz : max_nnzs) {
+        for (int batchsize : batchsizes) {
+          for (int num_threads : thread_counts) {
+            for (int num_chunks : chunk_counts) {
+              for (int level : levels) {
+                run({slot_num, max_nnz, batchsize, num_threads, num_chunks, level}, num_batches,
+                    mode, io_queue_depth, records_per_range, codec, allocator);
+              }
+            }
+          }
+        }
+      }
+    }
+  } catch (const std::runtime_error& rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * CPU microbenchmark of nv::CpuHashTable against HashTableCpu, the std::unordered_map
+ * wrapper of the embedding tests, which is single threaded.
+ * num_keys distinct keys (scattered over 40 bits) are inserted with the values of their
+ * index, then looked up in a random order, then a stream of get_insert (twice as many keys,
+ * half of them new) runs on an empty table, as the embedding does with new keys. Each
+ * thread works on its own slice in batches of 4096 keys. It reports million keys per second.
+ * usage: ./bench_hashtable_cpu [num_keys] [max_threads]
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+#include "HugeCTR/include/hashtable/nv_hashtable_cpu.hpp"
+#include "utest/embedding/cpu_hashtable.hpp"
+
+namespace {
+
+typedef long long T;
+typedef unsigned long long V;
+typedef std::chrono::steady_clock Clock;
+typedef nv::CpuHashTable<T, V, std::numeric_limits<T>::max()> Table;
+
+const size_t batch = 4096;
+
+/**
+ * Run func(begin, len) on the batches of [0, num_keys) split among num_threads threads.
+ * @return million keys per second.
+ */
+double run_threads(int num_threads, size_t num_keys,
+                   const std::function<void(size_t, size_t)>& func) {
+  auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&func, t, num_threads, num_keys]() {
+      const size_t slice_begin = num_keys * t / num_threads;
+      const size_t slice_end = num_keys * (t + 1) / num_threads;
+      for (size_t i = slice_begin; i < slice_end; i += batch) {
+        func(i, std::min(batch, slice_end - i));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return num_keys / seconds / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_keys = 1 << 22;
+  int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  if (argc > 1) {
+    num_keys = std::atoll(argv[1]);
+  }
+  if (argc > 2) {
+    max_threads = std::atoi(argv[2]);
+  }
+  if (num_keys == 0 || max_threads <= 0) {
+    printf("usage: %s [num_keys] [max_threads]\n", argv[0]);
+    return -1;
+  }
+
+  std::mt19937_64 generator(0);
+  std::vector<T> keys(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    keys[i] = (static_cast<T>(i) * 0x9E3779B97F4A7C15LL) & ((1LL << 40) - 1);
+  }
+  std::vector<V> vals(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    vals[i] = i;
+  }
+  std::vector<T> queries(keys);
+  std::shuffle(queries.begin(), queries.end(), generator);
+  // each key twice, in a random order
+  std::vector<T> stream(keys);
+  stream.insert(stream.end(), keys.begin(), keys.end());
+  std::shuffle(stream.begin(), stream.end(), generator);
+  std::vector<V> results(stream.size());
+
+  printf("%d keys, load factor 0.5, Mkeys/s\n", static_cast<int>(num_keys));
+  printf("%-14s %8s %10s %10s %12s\n", "table", "threads", "insert", "get", "get_insert");
+  {
+    HashTableCpu<T, V> baseline;
+    double insert_rate = run_threads(1, num_keys, [&](size_t begin, size_t len) {
+      baseline.insert(keys.data() + begin, vals.data() + begin, len);
+    });
+    double get_rate = run_threads(1, num_keys, [&](size_t begin, size_t len) {
+      baseline.get(queries.data() + begin, results.data() + begin, len);
+    });
+    printf("%-14s %8d %10.1f %10.1f %12s\n", "HashTableCpu", 1, insert_rate, get_rate, "-");
+  }
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    Table table(num_keys * 2);
+    double insert_rate = run_threads(num_threads, num_keys, [&](size_t begin, size_t len) {
+      table.insert(keys.data() + begin, vals.data() + begin, len);
+    });
+    double get_rate = run_threads(num_threads, num_keys, [&](size_t begin, size_t len) {
+      table.get(queries.data() + begin, results.data() + begin, len);
+    });
+    for (size_t i = 0; i < num_keys; i += num_keys / 16 + 1) {
+      if (keys[results[i]] != queries[i]) {
+        printf("wrong value of key %lld\n", queries[i]);
+        return -1;
+      }
+    }
+    Table get_insert_table(num_keys * 2);
+    double get_insert_rate = run_threads(num_threads, stream.size(), [&](size_t begin, size_t len) {
+      get_insert_table.get_insert(stream.data() + begin, results.data() + begin, len);
+    });
+    if (get_insert_table.get_value_head() != num_keys) {
+      printf("wrong counter %llu\n", get_insert_table.get_value_head());
+      return -1;
+    }
+    printf("%-14s %8d %10.1f %10.1f %12.1f\n", "CpuHashTable", num_threads, insert_rate,
+           get_rate, get_insert_rate);
+  }
+  return 0;
+}
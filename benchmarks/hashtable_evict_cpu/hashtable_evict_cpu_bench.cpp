@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * CPU microbenchmark of nv::EvictingCpuHashTable on a stream of Zipf-distributed keys, as the
+ * keys of click logs: the key of rank k (scattered over 40 bits) has a probability in
+ * 1 / (k + 1)^alpha among vocabulary_size keys. The stream runs in batches of 4096 keys
+ * through tables of 1%, 5% and 20% of the vocabulary, with each policy and sample size. The
+ * first 10% of the stream warms the table up, then it reports the hit rate, the evictions
+ * per batch and million keys per second of get_insert().
+ * usage: ./bench_hashtable_evict_cpu [vocabulary_size] [stream_length] [alpha]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+#include "HugeCTR/include/hashtable/nv_hashtable_evict_cpu.hpp"
+
+namespace {
+
+typedef long long T;
+typedef long long V;
+typedef std::chrono::steady_clock Clock;
+typedef nv::EvictingCpuHashTable<T, V, std::numeric_limits<T>::max()> Table;
+
+const size_t batch = 4096;
+
+std::vector<T> zipf_stream(size_t vocabulary_size, size_t stream_length, double alpha) {
+  std::vector<double> cdf(vocabulary_size);
+  double sum = 0;
+  for (size_t k = 0; k < vocabulary_size; k++) {
+    sum += 1.0 / std::pow(static_cast<double>(k + 1), alpha);
+    cdf[k] = sum;
+  }
+  std::mt19937_64 generator(0);
+  std::uniform_real_distribution<double> distribution(0, sum);
+  std::vector<T> stream(stream_length);
+  for (auto& key : stream) {
+    const size_t rank =
+        std::min<size_t>(std::upper_bound(cdf.begin(), cdf.end(), distribution(generator)) -
+                             cdf.begin(),
+                         vocabulary_size - 1);
+    key = (static_cast<T>(rank) * 0x9E3779B97F4A7C15LL) & ((1LL << 40) - 1);
+  }
+  return stream;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t vocabulary_size = 1 << 20;
+  size_t stream_length = 1 << 24;
+  double alpha = 1.05;
+  if (argc > 1) {
+    vocabulary_size = std::atoll(argv[1]);
+  }
+  if (argc > 2) {
+    stream_length = std::atoll(argv[2]);
+  }
+  if (argc > 3) {
+    alpha = std::atof(argv[3]);
+  }
+  if (vocabulary_size < 100 || stream_length < batch * 10 || alpha <= 0) {
+    printf("usage: %s [vocabulary_size] [stream_length] [alpha]\n", argv[0]);
+    return -1;
+  }
+
+  const std::vector<T> stream = zipf_stream(vocabulary_size, stream_length, alpha);
+  const size_t warm_up = stream_length / 10 / batch * batch;
+  std::vector<V> rows(batch);
+  printf("%d keys, Zipf alpha %.2f, stream of %d keys\n", static_cast<int>(vocabulary_size),
+         alpha, static_cast<int>(stream_length));
+  printf("%-10s %8s %8s %10s %16s %10s\n", "capacity", "policy", "sample", "hit rate",
+         "evictions/batch", "Mkeys/s");
+  for (double fraction : {0.01, 0.05, 0.2}) {
+    const size_t capacity = static_cast<size_t>(vocabulary_size * fraction);
+    for (auto policy : {nv::EvictionPolicy::LRU, nv::EvictionPolicy::LFU}) {
+      for (size_t sample_size : {4, 8, 16}) {
+        Table table(capacity, policy, sample_size);
+        std::vector<V> recycled;
+        size_t i = 0;
+        for (; i < warm_up; i += batch) {
+          table.get_insert(stream.data() + i, rows.data(), batch);
+        }
+        table.reset_stats();
+        size_t num_batches = 0;
+        auto start = Clock::now();
+        for (; i < stream_length; i += batch, num_batches++) {
+          const size_t len = std::min(batch, stream_length - i);
+          recycled.clear();
+          table.get_insert(stream.data() + i, rows.data(), len, &recycled);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        const nv::EvictionStats& stats = table.get_stats();
+        printf("%-10d %8s %8d %9.2f%% %16.1f %10.1f\n", static_cast<int>(capacity),
+               policy == nv::EvictionPolicy::LRU ? "LRU" : "LFU", static_cast<int>(sample_size),
+               100.0 * stats.hits / (stats.hits + stats.misses),
+               static_cast<double>(stats.evictions) / num_batches,
+               (stream_length - warm_up) / seconds / 1e6);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * CPU microbenchmark of the per-batch key deduplication done by the reading threads
+ * (KeyDedup), against the reduction of the lookup volume it brings.
+ * The keys of a batch (batchsize * slot_num, one key per slot as in criteo) are drawn
+ * from a Zipf distribution over the vocabulary: exponent 0 is uniform, criteo-like
+ * categorical features are around 1.0 - 1.2. For each point it reports the unique keys
+ * per batch, the reduction of the number of keys to look up (keys / unique keys), and
+ * the cost per key of KeyDedup and of a sort based unique (std::sort + std::unique) as
+ * a reference.
+ * usage: ./bench_key_dedup [num_batches] [vocabulary_size]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "HugeCTR/include/key_dedup.hpp"
+
+using namespace HugeCTR;
+
+namespace {
+
+typedef long long T;
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Keys of Zipf distributed ranks, the ranks are scattered over the key space.
+ */
+class ZipfKeys {
+ private:
+  std::vector<double> cdf_;
+  std::mt19937_64 generator_;
+  std::uniform_real_distribution<double> dist_;
+
+ public:
+  ZipfKeys(int vocabulary_size, double exponent) : cdf_(vocabulary_size), generator_(0) {
+    double sum = 0.0;
+    for (int i = 0; i < vocabulary_size; i++) {
+      sum += 1.0 / std::pow(i + 1.0, exponent);
+      cdf_[i] = sum;
+    }
+    dist_ = std::uniform_real_distribution<double>(0.0, sum);
+  }
+
+  T next() {
+    T rank = std::upper_bound(cdf_.begin(), cdf_.end(), dist_(generator_)) - cdf_.begin();
+    rank = std::min(rank, static_cast<T>(cdf_.size()) - 1);
+    return (rank * 0x9E3779B97F4A7C15LL) & ((1LL << 40) - 1);
+  }
+};
+
+void run(double exponent, int batchsize, int slot_num, int num_batches, int vocabulary_size) {
+  ZipfKeys zipf(vocabulary_size, exponent);
+  const int num_keys = batchsize * slot_num;
+  std::vector<std::vector<T>> batches(num_batches, std::vector<T>(num_keys));
+  for (auto& batch : batches) {
+    for (auto& key : batch) {
+      key = zipf.next();
+    }
+  }
+
+  KeyDedup<T> dedup;
+  std::vector<T> unique_keys;
+  std::vector<int> inverse_index;
+  long long num_unique = 0;
+  auto start = Clock::now();
+  for (auto& batch : batches) {
+    dedup.dedup(batch.data(), num_keys, &unique_keys, &inverse_index);
+    num_unique += unique_keys.size();
+  }
+  double hash_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<T> sorted;
+  long long num_unique_sorted = 0;
+  start = Clock::now();
+  for (auto& batch : batches) {
+    sorted.assign(batch.begin(), batch.end());
+    std::sort(sorted.begin(), sorted.end());
+    num_unique_sorted += std::unique(sorted.begin(), sorted.end()) - sorted.begin();
+  }
+  double sort_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  if (num_unique != num_unique_sorted) {
+    printf("mismatch: %lld vs %lld unique keys\n", num_unique, num_unique_sorted);
+  }
+
+  const double total_keys = static_cast<double>(num_keys) * num_batches;
+  printf("%8.2f %8d %10d %12.0f %10.2f %12.2f %12.2f %12.1f\n", exponent, batchsize, num_keys,
+         static_cast<double>(num_unique) / num_batches, total_keys / num_unique,
+         hash_seconds / total_keys * 1e9, sort_seconds / total_keys * 1e9,
+         hash_seconds / num_batches * 1e6);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int num_batches = 20;
+  int vocabulary_size = 1 << 22;
+  if (argc > 1) {
+    num_batches = std::atoi(argv[1]);
+  }
+  if (argc > 2) {
+    vocabulary_size = std::atoi(argv[2]);
+  }
+  if (num_batches <= 0 || vocabulary_size <= 0) {
+    printf("usage: %s [num_batches] [vocabulary_size]\n", argv[0]);
+    return -1;
+  }
+  const int slot_num = 26;
+  printf("%8s %8s %10s %12s %10s %12s %12s %12s\n", "zipf", "batch", "keys", "unique",
+         "reduction", "hash(ns/key)", "sort(ns/key)", "hash(us)");
+  const double exponents[] = {0.0, 0.8, 1.05, 1.2};
+  const int batchsizes[] = {1024, 16384};
+  for (double exponent : exponents) {
+    for (int batchsize : batchsizes) {
+      run(exponent, batchsize, slot_num, num_batches, vocabulary_size);
+    }
+  }
+  return 0;
+}
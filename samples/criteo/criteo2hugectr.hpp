@@ -0,0 +1,516 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * A parallel converter from the preprocessed criteo text (one sample per line:
+ * "label [dense_0 ... dense_{dense_dim-1}] key_0 key_1 ... key_{keys_per_sample-1}")
+ * to HugeCTR data files.
+ *
+ * The conversion is a pipeline:
+ * 1. the reader (calling thread) reads the text in chunks of about chunk_size bytes,
+ *    which are cut at line boundaries and numbered;
+ * 2. a pool of workers parses the chunks into binary samples;
+ * 3. the writer writes the parsed chunks in their original order, and starts a new
+ *    data file every samples_per_file samples.
+ * The number of chunks in flight is bounded, so is the memory usage.
+ */
+
+#pragma once
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace criteo2hugectr {
+
+typedef long long T;
+static const long long label_dim = 1;
+
+typedef struct DataSetHeader_ {
+  long long number_of_records;  // the number of samples in this data file
+  long long label_dim;          // dimension of label
+  long long slot_num;
+  long long reserved;  // version and flags, 0 for v1 without dense features
+} DataSetHeader;
+
+/**
+ * DataSetHeader::reserved of a v1 file, dense_dim goes to bits 16-31 of the flags
+ * (see HugeCTR/include/data_set_format.hpp).
+ */
+inline long long make_reserved(int dense_dim) {
+  return dense_dim > 0 ? 1LL | (static_cast<long long>(dense_dim) << 32) : 0;
+}
+
+/**
+ * Options of the conversion.
+ */
+struct Options {
+  int slot_num{1};                   /**< a key goes to slot key % slot_num */
+  int keys_per_sample{39};           /**< the number of keys in a line */
+  int dense_dim{0};                  /**< the number of dense features after the label */
+  int samples_per_file{40960};       /**< the number of samples per data file */
+  int num_threads{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+  size_t chunk_size{4 << 20};        /**< bytes of text per chunk */
+};
+
+/**
+ * A chunk of text and its parsing result.
+ */
+struct Chunk {
+  long long seq{0};                /**< order of the chunk in the input */
+  std::vector<char> text;          /**< complete lines */
+  std::vector<char> data;          /**< binary samples */
+  std::vector<size_t> sample_ends; /**< end offset of each sample in data */
+  std::string error;               /**< not empty if the parsing failed */
+};
+
+/**
+ * A blocking FIFO, close() wakes up all the poppers.
+ */
+template <typename Item>
+class BlockingQueue {
+ private:
+  std::queue<Item> queue_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool closed_{false};
+
+ public:
+  void push(Item item) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      queue_.push(std::move(item));
+    }
+    cv_.notify_one();
+  }
+
+  /**
+   * @return false if the queue is closed and empty.
+   */
+  bool pop(Item* item) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this]() { return !queue_.empty() || closed_; });
+    if (queue_.empty()) {
+      return false;
+    }
+    *item = std::move(queue_.front());
+    queue_.pop();
+    return true;
+  }
+
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      closed_ = true;
+    }
+    cv_.notify_all();
+  }
+};
+
+inline void check_make_dir(const std::string& finalpath) {
+  if (mkdir(finalpath.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) == -1) {
+    if (errno == EEXIST) {
+      std::cout << (finalpath + " exist") << std::endl;
+    } else {
+      std::cerr << ("cannot create" + finalpath + ": unexpected error") << std::endl;
+    }
+  }
+}
+
+inline void append(std::vector<char>* buffer, const void* src, size_t length) {
+  const char* ptr = static_cast<const char*>(src);
+  buffer->insert(buffer->end(), ptr, ptr + length);
+}
+
+/**
+ * Scan a decimal integer at p, leading spaces are skipped.
+ * @return false if there's no integer or it's not followed by a space or end.
+ */
+inline bool scan_int(const char*& p, const char* end, long long* value) {
+  while (p < end && (*p == ' ' || *p == '\t')) {
+    p++;
+  }
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+  const char* digits = p;
+  long long v = 0;
+  while (p < end && static_cast<unsigned>(*p - '0') < 10u) {
+    v = v * 10 + (*p - '0');
+    p++;
+  }
+  if (p == digits || (p < end && *p != ' ' && *p != '\t' && *p != '\r')) {
+    return false;
+  }
+  *value = negative ? -v : v;
+  return true;
+}
+
+/**
+ * Scan a decimal float at p, leading spaces are skipped.
+ * @return false if there's no number or it's not followed by a space or end.
+ */
+inline bool scan_float(const char*& p, const char* end, float* value) {
+  while (p < end && (*p == ' ' || *p == '\t')) {
+    p++;
+  }
+  // strtof needs a terminated string, a number is copied to a local buffer
+  char buffer[64];
+  size_t length = 0;
+  while (p + length < end && p[length] != ' ' && p[length] != '\t' && p[length] != '\r' &&
+         length < sizeof(buffer) - 1) {
+    buffer[length] = p[length];
+    length++;
+  }
+  buffer[length] = '\0';
+  char* number_end = nullptr;
+  *value = std::strtof(buffer, &number_end);
+  if (length == 0 || number_end != buffer + length) {
+    return false;
+  }
+  p += length;
+  return p == end || *p == ' ' || *p == '\t' || *p == '\r';
+}
+
+/**
+ * Parse the lines in [begin, end) into binary samples in chunk->data.
+ * Blank lines are skipped.
+ * @return false if a line is malformed, and chunk->error tells which.
+ */
+inline bool parse_chunk(const Options& options, const char* begin, const char* end, Chunk* chunk) {
+  std::vector<std::vector<T>> slots(options.slot_num);
+  std::vector<float> dense(options.dense_dim);
+  chunk->data.clear();
+  chunk->sample_ends.clear();
+  const char* line = begin;
+  while (line < end) {
+    const char* line_end = static_cast<const char*>(memchr(line, '\n', end - line));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+    const char* p = line;
+    while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+      p++;
+    }
+    if (p == line_end) {
+      line = line_end + 1;
+      continue;
+    }
+    bool ok = true;
+    long long label = 0;
+    ok = scan_int(p, line_end, &label);
+    for (int j = 0; ok && j < options.dense_dim; j++) {
+      ok = scan_float(p, line_end, &dense[j]);
+    }
+    for (auto& slot : slots) {
+      slot.clear();
+    }
+    for (int j = 0; ok && j < options.keys_per_sample; j++) {
+      long long key = 0;
+      ok = scan_int(p, line_end, &key) && key >= 0;
+      if (ok) {
+        slots[key % options.slot_num].push_back(static_cast<T>(key));
+      }
+    }
+    while (ok && p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+      p++;
+    }
+    if (!ok || p != line_end) {
+      chunk->error = "expect a label, " + std::to_string(options.dense_dim) +
+                     " dense features and " + std::to_string(options.keys_per_sample) +
+                     " non-negative keys: " + std::string(line, line_end);
+      return false;
+    }
+    int label_int = static_cast<int>(label);
+    append(&chunk->data, &label_int, sizeof(int));
+    append(&chunk->data, dense.data(), sizeof(float) * options.dense_dim);
+    for (auto& slot : slots) {
+      int nnz = static_cast<int>(slot.size());
+      append(&chunk->data, &nnz, sizeof(int));
+      append(&chunk->data, slot.data(), sizeof(T) * nnz);
+    }
+    chunk->sample_ends.push_back(chunk->data.size());
+    line = line_end + 1;
+  }
+  return true;
+}
+
+/**
+ * Writes the samples into data files of samples_per_file samples.
+ */
+class DataFileWriter {
+ private:
+  const Options& options_;
+  const std::string prefix_;
+  std::ofstream data_file_;
+  long long samples_in_file_{0};
+  long long total_samples_{0};
+  std::vector<std::string> file_names_;
+
+  void close_file_() {
+    if (!data_file_.is_open()) {
+      return;
+    }
+    DataSetHeader header = {samples_in_file_, label_dim, options_.slot_num,
+                            make_reserved(options_.dense_dim)};
+    data_file_.seekp(0, std::ios_base::beg);
+    data_file_.write(reinterpret_cast<char*>(&header), sizeof(DataSetHeader));
+    data_file_.close();
+    samples_in_file_ = 0;
+  }
+
+  void open_file_() {
+    std::string data_file_name(prefix_ + std::to_string(file_names_.size()) + ".data");
+    data_file_.open(data_file_name, std::ofstream::binary);
+    if (!data_file_.is_open()) {
+      throw std::runtime_error("Cannot open " + data_file_name);
+    }
+    std::cout << data_file_name << std::endl;
+    file_names_.push_back(data_file_name);
+    DataSetHeader header = {0, label_dim, options_.slot_num, make_reserved(options_.dense_dim)};
+    data_file_.write(reinterpret_cast<char*>(&header), sizeof(DataSetHeader));
+  }
+
+ public:
+  DataFileWriter(const Options& options, const std::string& prefix)
+      : options_(options), prefix_(prefix) {}
+
+  void write(const Chunk& chunk) {
+    size_t i = 0;
+    size_t offset = 0;
+    while (i < chunk.sample_ends.size()) {
+      if (!data_file_.is_open()) {
+        open_file_();
+      }
+      // as many samples as the current file can take in one write
+      size_t n = std::min(chunk.sample_ends.size() - i,
+                          static_cast<size_t>(options_.samples_per_file - samples_in_file_));
+      size_t next_offset = chunk.sample_ends[i + n - 1];
+      data_file_.write(chunk.data.data() + offset, next_offset - offset);
+      samples_in_file_ += n;
+      total_samples_ += n;
+      i += n;
+      offset = next_offset;
+      if (samples_in_file_ == options_.samples_per_file) {
+        close_file_();
+      }
+    }
+  }
+
+  /**
+   * Finish the last data file and write the file list.
+   */
+  void finish(const std::string& file_list_name) {
+    close_file_();
+    std::ofstream file_list(file_list_name, std::ofstream::out);
+    if (!file_list.is_open()) {
+      throw std::runtime_error("Cannot open " + file_list_name);
+    }
+    file_list << file_names_.size() << "\n";
+    for (auto& file_name : file_names_) {
+      file_list << file_name << "\n";
+    }
+  }
+
+  long long get_total_samples() const { return total_samples_; }
+};
+
+/**
+ * Convert the text from in to data files prefix0.data, prefix1.data, ... and a file list.
+ * @return the number of samples converted.
+ */
+inline long long convert(const Options& options, std::istream& in, const std::string& prefix,
+                         const std::string& file_list_name) {
+  if (options.slot_num <= 0 || options.keys_per_sample <= 0 || options.samples_per_file <= 0 ||
+      options.num_threads <= 0 || options.chunk_size == 0 || options.dense_dim < 0 ||
+      options.dense_dim > 0xffff) {
+    throw std::runtime_error("invalid options");
+  }
+  // the chunks in flight are recycled through free_chunks
+  const int num_chunks = 2 * options.num_threads + 2;
+  BlockingQueue<std::unique_ptr<Chunk>> free_chunks;
+  BlockingQueue<std::unique_ptr<Chunk>> text_chunks;
+  BlockingQueue<std::unique_ptr<Chunk>> parsed_chunks;
+  for (int i = 0; i < num_chunks; i++) {
+    free_chunks.push(std::unique_ptr<Chunk>(new Chunk()));
+  }
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < options.num_threads; i++) {
+    workers.emplace_back([&]() {
+      std::unique_ptr<Chunk> chunk;
+      while (text_chunks.pop(&chunk)) {
+        parse_chunk(options, chunk->text.data(), chunk->text.data() + chunk->text.size(),
+                    chunk.get());
+        parsed_chunks.push(std::move(chunk));
+      }
+    });
+  }
+
+  DataFileWriter writer(options, prefix);
+  std::string error;
+  std::atomic<bool> failed{false};
+  std::thread writer_thread([&]() {
+    std::map<long long, std::unique_ptr<Chunk>> pending;
+    long long next_seq = 0;
+    std::unique_ptr<Chunk> chunk;
+    while (parsed_chunks.pop(&chunk)) {
+      long long seq = chunk->seq;
+      pending[seq] = std::move(chunk);
+      for (auto it = pending.find(next_seq); it != pending.end(); it = pending.find(next_seq)) {
+        try {
+          if (!it->second->error.empty()) {
+            throw std::runtime_error(it->second->error);
+          }
+          if (error.empty()) {
+            writer.write(*it->second);
+          }
+        } catch (const std::runtime_error& rt_err) {
+          if (error.empty()) {
+            error = rt_err.what();
+            failed = true;
+          }
+        }
+        it->second->error.clear();
+        free_chunks.push(std::move(it->second));
+        pending.erase(it);
+        next_seq++;
+      }
+    }
+  });
+
+  // read the text in chunks cut at line boundaries
+  std::vector<char> carry;
+  long long seq = 0;
+  std::unique_ptr<Chunk> chunk;
+  while (in && !failed && free_chunks.pop(&chunk)) {
+    chunk->seq = seq++;
+    chunk->text.swap(carry);
+    size_t offset = chunk->text.size();
+    chunk->text.resize(offset + options.chunk_size);
+    in.read(chunk->text.data() + offset, options.chunk_size);
+    chunk->text.resize(offset + in.gcount());
+    carry.clear();
+    if (in) {
+      auto rit = std::find(chunk->text.rbegin(), chunk->text.rend(), '\n');
+      size_t line_end = chunk->text.rend() - rit;
+      carry.assign(chunk->text.begin() + line_end, chunk->text.end());
+      chunk->text.resize(line_end);
+    }
+    text_chunks.push(std::move(chunk));
+  }
+  text_chunks.close();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  parsed_chunks.close();
+  writer_thread.join();
+  if (!error.empty()) {
+    throw std::runtime_error(error);
+  }
+  writer.finish(file_list_name);
+  return writer.get_total_samples();
+}
+
+/**
+ * Parse the command line: [options] in.txt dir/prefix file_list.txt.
+ * @return false if the command line is invalid.
+ */
+inline bool parse_args(int argc, char* argv[], Options* options, std::vector<std::string>* args) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg.compare(0, 2, "--") != 0) {
+      args->push_back(arg);
+      continue;
+    }
+    if (i + 1 == argc) {
+      return false;
+    }
+    long long value = std::atoll(argv[++i]);
+    if (value <= 0) {
+      return false;
+    }
+    if (arg == "--slot-num") {
+      options->slot_num = static_cast<int>(value);
+    } else if (arg == "--keys-per-sample") {
+      options->keys_per_sample = static_cast<int>(value);
+    } else if (arg == "--dense-dim") {
+      options->dense_dim = static_cast<int>(value);
+    } else if (arg == "--samples-per-file") {
+      options->samples_per_file = static_cast<int>(value);
+    } else if (arg == "--threads") {
+      options->num_threads = static_cast<int>(value);
+    } else if (arg == "--chunk-size") {
+      options->chunk_size = static_cast<size_t>(value) << 20;
+    } else {
+      return false;
+    }
+  }
+  return args->size() == 3;
+}
+
+/**
+ * The main of the converter tools.
+ * @param options the default options.
+ * @param name name of the tool.
+ */
+inline int run(int argc, char* argv[], Options options, const std::string& name) {
+  const std::string usage_str = "usage: ./" + name +
+                                " [--slot-num N] [--keys-per-sample N] [--dense-dim N]"
+                                " [--samples-per-file N] [--threads N] [--chunk-size MB]"
+                                " in.txt dir/prefix file_list.txt";
+  std::vector<std::string> args;
+  if (!parse_args(argc, argv, &options, &args)) {
+    std::cout << usage_str << std::endl;
+    return -1;
+  }
+  std::ifstream txt_file(args[0], std::ifstream::binary);
+  if (!txt_file.is_open()) {
+    std::cerr << "Cannot open " << args[0] << std::endl;
+    return -1;
+  }
+  // create a data file under prefix
+  const std::string& data_prefix = args[1];
+  const size_t last_slash_idx = data_prefix.rfind('/');
+  if (std::string::npos != last_slash_idx) {
+    check_make_dir(data_prefix.substr(0, last_slash_idx));
+  }
+  try {
+    long long samples = convert(options, txt_file, data_prefix, args[2]);
+    std::cout << samples << " samples converted" << std::endl;
+  } catch (const std::runtime_error& rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+}  // namespace criteo2hugectr
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * A parallel replacement of tools/criteo_script/preprocess.pl, with the same output.
+ * usage: ./criteo_preprocess [--min-count N] [--threads N] [--chunk-size MB] train [val test ...]
+ *
+ * 1. The features of each of the 39 columns of train are counted. The text is read in
+ *    blocks, every thread counts a part of a block into its own per-column tables, and
+ *    the tables are then merged into the global ones, one column per thread at a time.
+ * 2. The features seen less than min-count times are dropped, the rest are sorted by
+ *    count (descending) then by value, and numbered from 1 column after column. The
+ *    empty feature of each column is always kept and stands for the dropped ones.
+ * 3. Each input file is mapped to "<file>.out" ("label id_1 ... id_39" per line, the
+ *    input of samples/criteo/criteo2hugectr), all the threads mapping a part of a block.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const int NCOL = 40;
+const char* EMPTY_FEA = "-";
+
+typedef std::unordered_map<std::string, long long> FeatureMap;
+
+struct Options {
+  long long min_count{6};
+  int num_threads{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+  size_t chunk_size{16 << 20}; /**< bytes of text per thread in a block */
+};
+
+/**
+ * Run func(i) for i in [0, n) on n threads, the first exception is rethrown.
+ */
+template <typename Func>
+void parallel_for(int n, const Func& func) {
+  std::vector<std::thread> threads;
+  std::vector<std::string> errors(n);
+  for (int i = 0; i < n; i++) {
+    threads.emplace_back([&, i]() {
+      try {
+        func(i);
+      } catch (const std::exception& e) {
+        errors[i] = e.what();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (auto& e : errors) {
+    if (!e.empty()) {
+      throw std::runtime_error(e);
+    }
+  }
+}
+
+/**
+ * Split [begin, end) into n parts at line boundaries, part i is [bounds[i], bounds[i+1]).
+ */
+std::vector<const char*> split_lines(const char* begin, const char* end, int n) {
+  std::vector<const char*> bounds(1, begin);
+  for (int i = 1; i < n; i++) {
+    const char* p = std::max(bounds.back(), begin + (end - begin) * i / n);
+    if (p > begin && p < end && *(p - 1) != '\n') {
+      p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+      p = p ? p + 1 : end;
+    }
+    bounds.push_back(p);
+  }
+  bounds.push_back(end);
+  return bounds;
+}
+
+/**
+ * Read a file in blocks of complete lines and call func(begin, end) for each block.
+ * The last line may have no '\n'.
+ */
+template <typename Func>
+void for_each_block(const std::string& file_name, size_t block_size, const Func& func) {
+  std::ifstream in(file_name, std::ifstream::binary);
+  if (!in.is_open()) {
+    throw std::runtime_error("Cannot open " + file_name);
+  }
+  std::vector<char> buffer(block_size);
+  size_t carry = 0;
+  while (true) {
+    in.read(buffer.data() + carry, buffer.size() - carry);
+    size_t length = carry + in.gcount();
+    if (length == 0) {
+      break;
+    }
+    if (!in) {
+      func(buffer.data(), buffer.data() + length);
+      break;
+    }
+    const char* last = buffer.data() + length;
+    while (last > buffer.data() && *(last - 1) != '\n') {
+      last--;
+    }
+    if (last == buffer.data()) {
+      // a line longer than the block
+      carry = length;
+      buffer.resize(buffer.size() * 2);
+      continue;
+    }
+    func(static_cast<const char*>(buffer.data()), last);
+    carry = buffer.data() + length - last;
+    std::memmove(buffer.data(), last, carry);
+  }
+}
+
+/**
+ * Call func(col, field_begin, field_end) for the 40 tab separated fields of each line.
+ */
+template <typename Func>
+void for_each_field(const char* begin, const char* end, const Func& func) {
+  const char* p = begin;
+  while (p < end) {
+    const char* line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+    int col = 0;
+    while (true) {
+      const char* field_end = static_cast<const char*>(std::memchr(p, '\t', line_end - p));
+      if (field_end == nullptr) {
+        field_end = line_end;
+      }
+      if (col < NCOL) {
+        func(col, p, field_end);
+      }
+      col++;
+      p = field_end + 1;
+      if (field_end == line_end) {
+        break;
+      }
+    }
+    if (col != NCOL) {
+      throw std::runtime_error("#fields = " + std::to_string(col));
+    }
+  }
+}
+
+inline void append_id(std::string* out, long long id) {
+  char digits[24];
+  int n = 0;
+  do {
+    digits[n++] = '0' + id % 10;
+    id /= 10;
+  } while (id > 0);
+  while (n > 0) {
+    out->push_back(digits[--n]);
+  }
+}
+
+/**
+ * Count the features of the train file.
+ * @return the global tables, columns 1 to NCOL-1 are used.
+ */
+std::vector<FeatureMap> count_features(const Options& options, const std::string& file_name) {
+  const int n = options.num_threads;
+  std::vector<FeatureMap> features(NCOL);
+  for (int col = 1; col < NCOL; col++) {
+    features[col][EMPTY_FEA] = options.min_count;
+  }
+  std::vector<std::vector<FeatureMap>> local(n, std::vector<FeatureMap>(NCOL));
+  for_each_block(file_name, options.chunk_size * n, [&](const char* begin, const char* end) {
+    std::vector<const char*> bounds = split_lines(begin, end, n);
+    parallel_for(n, [&](int t) {
+      std::vector<FeatureMap>& counts = local[t];
+      std::string key;
+      for_each_field(bounds[t], bounds[t + 1], [&](int col, const char* b, const char* e) {
+        if (col == 0) {
+          return;
+        }
+        if (b == e) {
+          key = EMPTY_FEA;
+        } else {
+          key.assign(b, e);
+        }
+        ++counts[col][key];
+      });
+    });
+    // merge, thread t owns the columns t, t+n, ...
+    parallel_for(n, [&](int t) {
+      for (int col = 1 + t; col < NCOL; col += n) {
+        for (int i = 0; i < n; i++) {
+          for (auto& kv : local[i][col]) {
+            features[col][kv.first] += kv.second;
+          }
+          local[i][col].clear();
+        }
+      }
+    });
+  });
+  return features;
+}
+
+/**
+ * Turn the counts into ids in place, the rare features are dropped.
+ * @return the number of ids.
+ */
+long long generate_mapping(const Options& options, std::vector<FeatureMap>* features) {
+  std::vector<std::vector<FeatureMap::value_type*>> orders(NCOL);
+  parallel_for(options.num_threads, [&](int t) {
+    for (int col = 1 + t; col < NCOL; col += options.num_threads) {
+      FeatureMap& feature = (*features)[col];
+      if (options.min_count > 1) {
+        for (auto it = feature.begin(); it != feature.end();) {
+          it = it->second < options.min_count ? feature.erase(it) : std::next(it);
+        }
+      }
+      std::vector<FeatureMap::value_type*>& order = orders[col];
+      for (auto& kv : feature) {
+        order.push_back(&kv);
+      }
+      std::sort(order.begin(), order.end(),
+                [](const FeatureMap::value_type* a, const FeatureMap::value_type* b) {
+                  return a->second != b->second ? a->second > b->second : a->first < b->first;
+                });
+    }
+  });
+  long long id = 1;
+  for (int col = 1; col < NCOL; col++) {
+    for (auto* kv : orders[col]) {
+      kv->second = id++;
+    }
+  }
+  return id - 1;
+}
+
+/**
+ * Map a file to file_name.out.
+ * @return the number of lines.
+ */
+long long do_mapping(const Options& options, const std::vector<FeatureMap>& fea2id,
+                     const std::string& file_name) {
+  const int n = options.num_threads;
+  std::vector<long long> empty_ids(NCOL, 0);
+  for (int col = 1; col < NCOL; col++) {
+    empty_ids[col] = fea2id[col].at(EMPTY_FEA);
+  }
+  std::ofstream out_stream(file_name + ".out", std::ofstream::binary);
+  if (!out_stream.is_open()) {
+    throw std::runtime_error("Cannot open " + file_name + ".out");
+  }
+  std::vector<std::string> outs(n);
+  std::vector<long long> lines(n, 0);
+  for_each_block(file_name, options.chunk_size * n, [&](const char* begin, const char* end) {
+    std::vector<const char*> bounds = split_lines(begin, end, n);
+    parallel_for(n, [&](int t) {
+      std::string& out = outs[t];
+      out.clear();
+      out.reserve(bounds[t + 1] - bounds[t]);
+      std::string key;
+      for_each_field(bounds[t], bounds[t + 1], [&](int col, const char* b, const char* e) {
+        if (col == 0) {
+          out.append(b, e);
+          return;
+        }
+        long long id = empty_ids[col];
+        if (b != e) {
+          key.assign(b, e);
+          auto it = fea2id[col].find(key);
+          if (it != fea2id[col].end()) {
+            id = it->second;
+          }
+        }
+        out.push_back(' ');
+        append_id(&out, id);
+        if (col == NCOL - 1) {
+          out.push_back('\n');
+          lines[t]++;
+        }
+      });
+    });
+    for (auto& out : outs) {
+      out_stream.write(out.data(), out.size());
+    }
+  });
+  if (!out_stream.good()) {
+    throw std::runtime_error("Cannot write " + file_name + ".out");
+  }
+  long long total = 0;
+  for (long long l : lines) {
+    total += l;
+  }
+  return total;
+}
+
+}  // namespace
+
+static std::string usage_str =
+    "usage: ./criteo_preprocess [--min-count N] [--threads N] [--chunk-size MB] train [val test "
+    "...]";
+
+int main(int argc, char* argv[]) {
+  Options options;
+  int i = 1;
+  for (; i + 1 < argc && std::string(argv[i]).compare(0, 2, "--") == 0; i += 2) {
+    std::string option(argv[i]);
+    if (option == "--min-count") {
+      options.min_count = std::atoll(argv[i + 1]);
+    } else if (option == "--threads") {
+      options.num_threads = std::atoi(argv[i + 1]);
+    } else if (option == "--chunk-size") {
+      options.chunk_size = static_cast<size_t>(std::atoll(argv[i + 1])) << 20;
+    } else {
+      std::cerr << usage_str << std::endl;
+      return -1;
+    }
+  }
+  if (i >= argc || options.num_threads <= 0 || options.chunk_size == 0) {
+    std::cerr << usage_str << std::endl;
+    return -1;
+  }
+  try {
+    std::vector<FeatureMap> features = count_features(options, argv[i]);
+    long long num_ids = generate_mapping(options, &features);
+    std::cout << argv[i] << ": " << num_ids << " ids (min count " << options.min_count << ")"
+              << std::endl;
+    for (; i < argc; i++) {
+      long long lines = do_mapping(options, features, argv[i]);
+      std::cout << argv[i] << " -> " << argv[i] << ".out: " << lines << " lines" << std::endl;
+    }
+  } catch (const std::runtime_error& rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
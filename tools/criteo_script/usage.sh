@@ -9,7 +9,12 @@ head -n 4584062 valtest > val
 tail -n 4584062 valtest > test
 
 # will produce train.out val.out test.out
-./preprocess.pl train val test
+# build/bin/criteo_preprocess (tools/criteo_preprocess) gives the same output in parallel
+if [ -x ../../build/bin/criteo_preprocess ]; then
+  ../../build/bin/criteo_preprocess --min-count 6 train val test
+else
+  ./preprocess.pl train val test
+fi
 
 
 # may need to shuffle train.out & val.out
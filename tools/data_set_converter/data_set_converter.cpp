@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Convert a data file (v1) to the block-indexed v2 format, or write the sidecar record
+ * index (<data file>.idx) of data files with --index-stride, which lets a reader seek to a
+ * record when it resumes from a snapshot. With --codec the blocks of the v2 file are
+ * compressed, and --level is the compression level of the codec.
+ * usage: ./data_set_converter [--key-type long|uint] [--records-per-block N]
+ *                             [--codec none|lz4|zstd] [--level N] in.data out.data
+ *        ./data_set_converter [--key-type long|uint] --index-stride N a.data [b.data ...]
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "HugeCTR/include/data_set_format.hpp"
+
+using namespace HugeCTR;
+
+static std::string usage_str =
+    "usage: ./data_set_converter [--key-type long|uint] [--records-per-block N]\n"
+    "                            [--codec none|lz4|zstd] [--level N] in.data out.data\n"
+    "       ./data_set_converter [--key-type long|uint] --index-stride N a.data [b.data ...]";
+
+int main(int argc, char* argv[]) {
+  std::string key_type = "long";
+  long long records_per_block = DATA_SET_DEFAULT_RECORDS_PER_BLOCK;
+  long long index_stride = 0;
+  int codec = DATA_SET_CODEC_NONE;
+  int level = 1;
+  int i = 1;
+  for (; i + 1 < argc && std::string(argv[i]).compare(0, 2, "--") == 0; i += 2) {
+    std::string option(argv[i]);
+    if (option == "--key-type") {
+      key_type = argv[i + 1];
+    } else if (option == "--records-per-block") {
+      records_per_block = std::atoll(argv[i + 1]);
+    } else if (option == "--codec") {
+      codec = find_codec(argv[i + 1]);
+      if (codec < 0 || !is_codec_available(codec)) {
+        std::cerr << "codec is not available: " << argv[i + 1] << std::endl;
+        return -1;
+      }
+    } else if (option == "--level") {
+      level = std::atoi(argv[i + 1]);
+    } else if (option == "--index-stride") {
+      index_stride = std::atoll(argv[i + 1]);
+      if (index_stride <= 0) {
+        std::cerr << usage_str << std::endl;
+        return -1;
+      }
+    } else {
+      std::cerr << usage_str << std::endl;
+      return -1;
+    }
+  }
+  if ((key_type != "long" && key_type != "uint") || records_per_block <= 0 ||
+      (index_stride > 0 ? argc - i < 1 : argc - i != 2)) {
+    std::cerr << usage_str << std::endl;
+    return -1;
+  }
+  try {
+    if (index_stride > 0) {
+      for (; i < argc; i++) {
+        long long number_of_records =
+            key_type == "long" ? build_record_index<long long>(argv[i], index_stride)
+                               : build_record_index<unsigned int>(argv[i], index_stride);
+        std::cout << get_record_index_file_name(argv[i]) << ": " << number_of_records
+                  << " records" << std::endl;
+      }
+      return 0;
+    }
+    long long number_of_records =
+        key_type == "long" ? convert_data_set_to_v2<long long>(argv[i], argv[i + 1],
+                                                               records_per_block, codec, level)
+                           : convert_data_set_to_v2<unsigned int>(argv[i], argv[i + 1],
+                                                                  records_per_block, codec, level);
+    std::cout << argv[i] << " -> " << argv[i + 1] << ": " << number_of_records << " records"
+              << std::endl;
+  } catch (const std::runtime_error& rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
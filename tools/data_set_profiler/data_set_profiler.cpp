@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Scan the data files of a data set and report what the config needs to know about them
+ * (see DataSetProfile):
+ * - the nnz of each slot and of a sample: mean, percentiles, max and histograms;
+ * - the approximate number of distinct keys, of all the slots and of each slot;
+ * - the skew of the key frequencies, from the keys sampled by --key-sample-rate;
+ * - the recommended label_dim, slot_num, max_feature_num_per_sample, vocabulary_size and
+ *   load_factor, and the size of the hash table with --embedding-vec-size.
+ * The files are given by a file list (the "source" of the config) or one by one, and are
+ * scanned by --threads threads.
+ * usage: ./data_set_profiler [--key-type long|uint] [--threads N] [--key-sample-rate 16]
+ *                            [--load-factor 0.75] [--embedding-vec-size N]
+ *                            --file-list file_list.txt | a.data [b.data ...]
+ */
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HugeCTR/include/data_set_profile.hpp"
+#include "HugeCTR/include/file_list.hpp"
+
+using namespace HugeCTR;
+
+static std::string usage_str =
+    "usage: ./data_set_profiler [--key-type long|uint] [--threads N] [--key-sample-rate 16]\n"
+    "                           [--load-factor 0.75] [--embedding-vec-size N]\n"
+    "                           --file-list file_list.txt | a.data [b.data ...]";
+
+namespace {
+
+double get_mean(const std::vector<long long>& histogram) {
+  double sum = 0.0;
+  long long total = 0;
+  for (size_t nnz = 0; nnz < histogram.size(); nnz++) {
+    sum += static_cast<double>(nnz) * histogram[nnz];
+    total += histogram[nnz];
+  }
+  return total > 0 ? sum / total : 0.0;
+}
+
+/**
+ * "nnz:count" of each nnz, or of the ranges [2^i, 2^(i+1)) of nnz if there are many.
+ */
+std::string format_histogram(const std::vector<long long>& histogram) {
+  std::string str;
+  if (histogram.size() <= 16) {
+    for (size_t nnz = 0; nnz < histogram.size(); nnz++) {
+      if (histogram[nnz] > 0) {
+        str += " " + std::to_string(nnz) + ":" + std::to_string(histogram[nnz]);
+      }
+    }
+    return str;
+  }
+  if (histogram[0] > 0) {
+    str = " 0:" + std::to_string(histogram[0]);
+  }
+  for (size_t low = 1; low < histogram.size(); low *= 2) {
+    const size_t high = std::min(low * 2, histogram.size());
+    long long count = 0;
+    for (size_t nnz = low; nnz < high; nnz++) {
+      count += histogram[nnz];
+    }
+    if (count > 0) {
+      str += " " + std::to_string(low) + "-" + std::to_string(high - 1) + ":" +
+             std::to_string(count);
+    }
+  }
+  return str;
+}
+
+template <typename T>
+void print_report(const DataSetProfile<T>& profile, size_t num_files, float load_factor,
+                  int embedding_vec_size) {
+  typedef DataSetProfile<T> Profile;
+  printf("%zu files, %lld samples, %lld keys, label_dim %lld, slot_num %lld, dense_dim %d\n",
+         num_files, profile.get_number_of_records(), profile.get_number_of_keys(),
+         profile.get_label_dim(), profile.get_slot_num(), profile.get_dense_dim());
+  const std::vector<long long>& sample_histogram = profile.get_sample_nnz_histogram();
+  printf("\nnnz of a sample: mean %.2f, p50 %lld, p99 %lld, p99.9 %lld, max %lld\n",
+         get_mean(sample_histogram), Profile::get_percentile(sample_histogram, 0.5),
+         Profile::get_percentile(sample_histogram, 0.99),
+         Profile::get_percentile(sample_histogram, 0.999), profile.get_max_sample_nnz());
+  printf("  histogram:%s\n", format_histogram(sample_histogram).c_str());
+
+  printf("\n%6s %8s %6s %6s %6s %14s  %s\n", "slot", "mean", "p50", "p99", "max", "distinct_keys",
+         "nnz histogram");
+  for (int k = 0; k < profile.get_slot_num(); k++) {
+    const std::vector<long long>& histogram = profile.get_slot_nnz_histogram(k);
+    printf("%6d %8.2f %6lld %6lld %6zu %14.0f %s\n", k, get_mean(histogram),
+           Profile::get_percentile(histogram, 0.5), Profile::get_percentile(histogram, 0.99),
+           histogram.empty() ? 0 : histogram.size() - 1, profile.estimate_distinct_keys(k),
+           format_histogram(histogram).c_str());
+  }
+
+  printf("\ndistinct keys: %.0f (HyperLogLog, +-%.1f%%)\n", profile.estimate_distinct_keys(),
+         HyperLogLog().get_relative_error() * 100);
+  printf("key skew (%lld keys sampled, 1 in %lld):\n", profile.get_number_of_sampled_keys(),
+         profile.get_key_sample_rate());
+  printf("  the top 0.1%% / 1%% / 10%% keys take %.1f%% / %.1f%% / %.1f%% of the occurrences\n",
+         profile.get_top_keys_share(0.001) * 100, profile.get_top_keys_share(0.01) * 100,
+         profile.get_top_keys_share(0.1) * 100);
+  printf("  keys seen once: %.1f%%, Zipf exponent: %.2f\n",
+         profile.get_singleton_fraction() * 100, profile.estimate_zipf_exponent());
+
+  DataSetRecommendation recommendation = profile.recommend(load_factor);
+  printf("\nrecommended config:\n");
+  printf("  \"label_dim\": %lld,\n", recommendation.label_dim);
+  printf("  \"slot_num\": %lld,\n", recommendation.slot_num);
+  if (recommendation.dense_dim > 0) {
+    printf("  \"dense_dim\": %d,\n", recommendation.dense_dim);
+  }
+  printf("  \"max_feature_num_per_sample\": %d,\n", recommendation.max_feature_num_per_sample);
+  printf("  \"vocabulary_size\": %lld,\n", recommendation.vocabulary_size);
+  printf("  \"load_factor\": %.2f\n", recommendation.load_factor);
+  if (recommendation.vocabulary_size > INT_MAX) {
+    printf("warning: vocabulary_size > INT_MAX\n");
+  }
+  if (embedding_vec_size > 0) {
+    printf("hash table values: %.2f GB in total\n",
+           recommendation.vocabulary_size / recommendation.load_factor * embedding_vec_size *
+               sizeof(float) / (1 << 30));
+  }
+}
+
+template <typename T>
+void profile(const std::vector<std::string>& file_names, int num_threads,
+             long long key_sample_rate, float load_factor, int embedding_vec_size) {
+  DataSetProfile<T> data_set_profile =
+      profile_data_set<T>(file_names, num_threads, key_sample_rate);
+  print_report(data_set_profile, file_names.size(), load_factor, embedding_vec_size);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string key_type = "long";
+  int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  long long key_sample_rate = 16;
+  float load_factor = 0.75f;
+  int embedding_vec_size = 0;
+  std::string file_list_name;
+  int i = 1;
+  for (; i + 1 < argc && std::string(argv[i]).compare(0, 2, "--") == 0; i += 2) {
+    std::string option(argv[i]);
+    if (option == "--key-type") {
+      key_type = argv[i + 1];
+    } else if (option == "--threads") {
+      num_threads = std::atoi(argv[i + 1]);
+    } else if (option == "--key-sample-rate") {
+      key_sample_rate = std::atoll(argv[i + 1]);
+    } else if (option == "--load-factor") {
+      load_factor = std::atof(argv[i + 1]);
+    } else if (option == "--embedding-vec-size") {
+      embedding_vec_size = std::atoi(argv[i + 1]);
+    } else if (option == "--file-list") {
+      file_list_name = argv[i + 1];
+    } else {
+      std::cerr << usage_str << std::endl;
+      return -1;
+    }
+  }
+  if ((key_type != "long" && key_type != "uint") || num_threads <= 0 || key_sample_rate <= 0 ||
+      load_factor <= 0.f || load_factor > 1.f || embedding_vec_size < 0 ||
+      (file_list_name.empty() ? argc - i < 1 : argc - i != 0)) {
+    std::cerr << usage_str << std::endl;
+    return -1;
+  }
+  try {
+    std::vector<std::string> file_names =
+        file_list_name.empty() ? std::vector<std::string>(argv + i, argv + argc)
+                               : read_file_list(file_list_name);
+    if (key_type == "long") {
+      profile<long long>(file_names, num_threads, key_sample_rate, load_factor,
+                         embedding_vec_size);
+    } else {
+      profile<unsigned int>(file_names, num_threads, key_sample_rate, load_factor,
+                            embedding_vec_size);
+    }
+  } catch (const std::runtime_error& rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
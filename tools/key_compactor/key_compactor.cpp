@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Compact the long long keys of a data set to unsigned int ones through a dense remapping
+ * dictionary (see key_dictionary.hpp), to train with "key_type": "uint".
+ * - data files: the keys of the files which aren't in the dictionary yet are added to it
+ *   (it's created if it doesn't exist), then each file is rewritten to <file><suffix>, and
+ *   a file list to <file list><suffix> with the names of the rewritten files. Compact the
+ *   training and evaluation sets in one run, or one after another with the same dictionary.
+ * - embedding files: --compact-embedding rewrites a model trained with long long keys for
+ *   the compacted data set, --expand-embedding one trained on it back to the original keys.
+ * usage: ./key_compactor --dict dict.bin [--suffix .u32] --file-list list [--file-list list]
+ *        ./key_compactor --dict dict.bin [--suffix .u32] a.data [b.data ...]
+ *        ./key_compactor --dict dict.bin --embedding-vec-size N
+ *                        --compact-embedding | --expand-embedding in.bin out.bin
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "HugeCTR/include/file_list.hpp"
+#include "HugeCTR/include/key_dictionary.hpp"
+
+using namespace HugeCTR;
+
+static std::string usage_str =
+    "usage: ./key_compactor --dict dict.bin [--suffix .u32] --file-list list [--file-list list]\n"
+    "       ./key_compactor --dict dict.bin [--suffix .u32] a.data [b.data ...]\n"
+    "       ./key_compactor --dict dict.bin --embedding-vec-size N\n"
+    "                       --compact-embedding | --expand-embedding in.bin out.bin";
+
+namespace {
+
+void write_file_list(const std::string& file_list_name,
+                     const std::vector<std::string>& file_names) {
+  std::ofstream stream(file_list_name);
+  if (!stream.is_open()) {
+    CK_THROW_(Error_t::FileCannotOpen, "stream.is_open() failed: " + file_list_name);
+  }
+  stream << file_names.size() << std::endl;
+  for (auto& file_name : file_names) {
+    stream << file_name << std::endl;
+  }
+}
+
+long long get_file_size(const std::string& file_name) {
+  std::ifstream stream(file_name, std::ifstream::binary | std::ifstream::ate);
+  return stream.is_open() ? static_cast<long long>(stream.tellg()) : 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string dict_name;
+  std::string suffix = ".u32";
+  std::vector<std::string> file_list_names;
+  int embedding_vec_size = 0;
+  std::string embedding_option;
+  std::string embedding_in_name;
+  int i = 1;
+  for (; i + 1 < argc && std::string(argv[i]).compare(0, 2, "--") == 0; i += 2) {
+    std::string option(argv[i]);
+    if (option == "--dict") {
+      dict_name = argv[i + 1];
+    } else if (option == "--suffix") {
+      suffix = argv[i + 1];
+    } else if (option == "--file-list") {
+      file_list_names.push_back(argv[i + 1]);
+    } else if (option == "--embedding-vec-size") {
+      embedding_vec_size = std::atoi(argv[i + 1]);
+    } else if ((option == "--compact-embedding" || option == "--expand-embedding") &&
+               embedding_option.empty()) {
+      embedding_option = option;
+      embedding_in_name = argv[i + 1];
+    } else {
+      std::cerr << usage_str << std::endl;
+      return -1;
+    }
+  }
+  bool embedding_mode = !embedding_option.empty();
+  if (dict_name.empty() || suffix.empty() ||
+      (embedding_mode ? embedding_vec_size <= 0 || !file_list_names.empty() || argc - i != 1
+                      : file_list_names.empty() ? argc - i < 1 : argc - i != 0)) {
+    std::cerr << usage_str << std::endl;
+    return -1;
+  }
+  try {
+    if (embedding_mode) {
+      KeyDictionary dictionary(dict_name);
+      if (embedding_option == "--compact-embedding") {
+        auto written_dropped =
+            compact_embedding_file(dictionary, embedding_in_name, argv[i], embedding_vec_size);
+        std::cout << embedding_in_name << " -> " << argv[i] << ": " << written_dropped.first
+                  << " keys, " << written_dropped.second
+                  << " keys which aren't in the dictionary are dropped" << std::endl;
+      } else {
+        long long written =
+            expand_embedding_file(dictionary, embedding_in_name, argv[i], embedding_vec_size);
+        std::cout << embedding_in_name << " -> " << argv[i] << ": " << written << " keys"
+                  << std::endl;
+      }
+      return 0;
+    }
+
+    std::vector<std::vector<std::string>> file_lists;
+    std::vector<std::string> file_names;
+    for (auto& file_list_name : file_list_names) {
+      file_lists.push_back(read_file_list(file_list_name));
+      file_names.insert(file_names.end(), file_lists.back().begin(), file_lists.back().end());
+    }
+    if (file_list_names.empty()) {
+      file_names.assign(argv + i, argv + argc);
+    }
+
+    KeyDictionary dictionary;
+    if (std::ifstream(dict_name).is_open()) {
+      dictionary = KeyDictionary(dict_name);
+    }
+    size_t old_size = dictionary.size();
+    size_t added = dictionary.add_keys(file_names);
+    dictionary.save(dict_name);
+    std::cout << dict_name << ": " << dictionary.size() << " keys (" << old_size << " + "
+              << added << ")" << std::endl;
+
+    long long in_bytes = 0;
+    long long out_bytes = 0;
+    for (auto& file_name : file_names) {
+      long long records = compact_data_file(dictionary, file_name, file_name + suffix);
+      in_bytes += get_file_size(file_name);
+      out_bytes += get_file_size(file_name + suffix);
+      std::cout << file_name << " -> " << file_name << suffix << ": " << records << " records"
+                << std::endl;
+    }
+    for (size_t l = 0; l < file_list_names.size(); l++) {
+      std::vector<std::string> out_file_names;
+      for (auto& file_name : file_lists[l]) {
+        out_file_names.push_back(file_name + suffix);
+      }
+      write_file_list(file_list_names[l] + suffix, out_file_names);
+      std::cout << file_list_names[l] << " -> " << file_list_names[l] << suffix << std::endl;
+    }
+    std::cout << "data: " << in_bytes << " -> " << out_bytes << " bytes, set \"key_type\": "
+              << "\"uint\" in data, and a vocabulary_size of at least " << dictionary.size()
+              << std::endl;
+  } catch (const std::runtime_error& rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Report the per-device load imbalance of the key partitioners on a data set (see
+ * key_partitioner.hpp), and build the table of the frequency partitioner:
+ * - lookups: max / mean of the key occurrences routed to a device over the data set;
+ * - keys: max / mean of the distinct keys of a device, i.e. of its hash table;
+ * - batch: the mean of max / mean of the lookups in a batch, the slowdown of a step.
+ * The frequency table is built from the key counts of the data set, with the
+ * --table-keys most frequent keys, and written with --write-table, or read by --table.
+ * usage: ./key_partitioner [--key-type long|uint] [--devices 8] [--batch-size 16384]
+ *                          [--table-keys 100000] [--table t.bin | --write-table t.bin]
+ *                          --file-list file_list.txt | a.data [b.data ...]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "HugeCTR/include/file_list.hpp"
+#include "HugeCTR/include/key_partitioner.hpp"
+
+using namespace HugeCTR;
+
+static std::string usage_str =
+    "usage: ./key_partitioner [--key-type long|uint] [--devices 8] [--batch-size 16384]\n"
+    "                         [--table-keys 100000] [--table t.bin | --write-table t.bin]\n"
+    "                         --file-list file_list.txt | a.data [b.data ...]";
+
+namespace {
+
+void print_load(const std::string& name, const KeyLoad& load) {
+  printf("%-12s %8.3f %8.3f %8.3f  ", name.c_str(), load.get_lookup_imbalance(),
+         load.get_key_imbalance(), load.get_batch_imbalance());
+  long long total = 0;
+  for (long long lookups : load.lookups) {
+    total += lookups;
+  }
+  for (long long lookups : load.lookups) {
+    printf(" %5.1f", total > 0 ? 100.0 * lookups / total : 0.0);
+  }
+  printf("\n");
+}
+
+template <typename T>
+void report(const std::vector<std::string>& file_names, int num_devices, int batch_size,
+            size_t table_keys, const std::string& table_name, bool write_table) {
+  const int slot_num = DataSetRecordReader<T>(file_names[0]).get_header().slot_num;
+  std::vector<std::shared_ptr<const KeyPartitioner<T>>> partitioners = {
+      create_key_partitioner<T>(KeyPartitioner_t::Modulo, num_devices, slot_num),
+      create_key_partitioner<T>(KeyPartitioner_t::Hash, num_devices, slot_num),
+      create_key_partitioner<T>(KeyPartitioner_t::SlotAware, num_devices, slot_num)};
+  const std::vector<std::string> names = {"modulo", "hash", "slot_aware", "frequency"};
+  std::unordered_map<T, long long> key_counts;
+  std::vector<KeyLoad> loads = measure_key_load(partitioners, file_names, batch_size, &key_counts);
+
+  // the frequency partitioner is measured in a second pass, with the table of the first one
+  std::vector<std::pair<T, int>> table =
+      table_name.empty() || write_table
+          ? build_key_partition_table(key_counts, num_devices, table_keys)
+          : read_key_partition_table<T>(table_name, num_devices);
+  if (write_table) {
+    write_key_partition_table(table_name, num_devices, table);
+  }
+  std::vector<std::shared_ptr<const KeyPartitioner<T>>> frequency = {
+      std::make_shared<FrequencyKeyPartitioner<T>>(num_devices, table)};
+  loads.push_back(measure_key_load(frequency, file_names, batch_size)[0]);
+
+  printf("%zu files, %zu distinct keys, %d devices, batch size %d, %zu keys in the table\n",
+         file_names.size(), key_counts.size(), num_devices, batch_size, table.size());
+  printf("\n%-12s %8s %8s %8s   %s\n", "partitioner", "lookups", "keys", "batch",
+         "lookups of each device (%)");
+  for (size_t p = 0; p < loads.size(); p++) {
+    print_load(names[p], loads[p]);
+  }
+  printf("(max / mean of the devices, 1 is balanced)\n");
+  if (write_table) {
+    printf("\nthe table is written to %s, set \"key_partitioner\": \"frequency\" and "
+           "\"partition_table\": \"%s\" in data\n",
+           table_name.c_str(), table_name.c_str());
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string key_type = "long";
+  int num_devices = 8;
+  int batch_size = 16384;
+  long long table_keys = 100000;
+  std::string table_name;
+  bool write_table = false;
+  std::string file_list_name;
+  int i = 1;
+  for (; i + 1 < argc && std::string(argv[i]).compare(0, 2, "--") == 0; i += 2) {
+    std::string option(argv[i]);
+    if (option == "--key-type") {
+      key_type = argv[i + 1];
+    } else if (option == "--devices") {
+      num_devices = std::atoi(argv[i + 1]);
+    } else if (option == "--batch-size") {
+      batch_size = std::atoi(argv[i + 1]);
+    } else if (option == "--table-keys") {
+      table_keys = std::atoll(argv[i + 1]);
+    } else if (option == "--table" || option == "--write-table") {
+      if (!table_name.empty()) {
+        std::cerr << usage_str << std::endl;
+        return -1;
+      }
+      table_name = argv[i + 1];
+      write_table = (option == "--write-table");
+    } else if (option == "--file-list") {
+      file_list_name = argv[i + 1];
+    } else {
+      std::cerr << usage_str << std::endl;
+      return -1;
+    }
+  }
+  if ((key_type != "long" && key_type != "uint") || num_devices <= 0 || batch_size <= 0 ||
+      table_keys < 0 || (file_list_name.empty() ? argc - i < 1 : argc - i != 0)) {
+    std::cerr << usage_str << std::endl;
+    return -1;
+  }
+  try {
+    std::vector<std::string> file_names =
+        file_list_name.empty() ? std::vector<std::string>(argv + i, argv + argc)
+                               : read_file_list(file_list_name);
+    if (key_type == "long") {
+      report<long long>(file_names, num_devices, batch_size, table_keys, table_name,
+                        write_table);
+    } else {
+      report<unsigned int>(file_names, num_devices, batch_size, table_keys, table_name,
+                           write_table);
+    }
+  } catch (const std::runtime_error& rt_err) {
+    std::cerr << rt_err.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}
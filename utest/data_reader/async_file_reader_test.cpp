@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/async_file_reader.hpp"
+#include <fstream>
+#include <random>
+#include "gtest/gtest.h"
+
+using namespace HugeCTR;
+
+namespace {
+
+const std::string file_name("async_file_reader_test.bin");
+
+/**
+ * Write a file of size bytes, whose content is a function of the offset.
+ */
+std::vector<char> write_test_file(size_t size) {
+  std::vector<char> content(size);
+  std::mt19937 generator(size);
+  for (auto& c : content) {
+    c = static_cast<char>(generator());
+  }
+  std::ofstream out_stream(file_name, std::ofstream::binary);
+  out_stream.write(content.data(), size);
+  return content;
+}
+
+/**
+ * Read a file with random lengths, skips and seeks, and compare with its content.
+ */
+void read_randomly(AsyncFileReader* reader, const std::vector<char>& content) {
+  std::mt19937 generator(0);
+  const long long size = content.size();
+  std::vector<char> scratch(100000);
+  reader->open(file_name);
+  EXPECT_EQ(reader->get_file_size(), size);
+  long long offset = 0;
+  for (int i = 0; i < 2000; i++) {
+    int action = generator() % 10;
+    if (action == 0) {
+      offset = generator() % (size + 1);
+      reader->seek(offset);
+    } else if (action == 1) {
+      long long length = std::min<long long>(generator() % 20000, size - offset);
+      reader->skip(length);
+      offset += length;
+    } else {
+      long long length = std::min<long long>(generator() % 30000, size - offset);
+      const char* bytes = reader->read(length, scratch.data());
+      ASSERT_EQ(memcmp(bytes, content.data() + offset, length), 0) << "offset " << offset;
+      offset += length;
+    }
+    ASSERT_EQ(reader->tell(), offset);
+    if (offset == size) {
+      EXPECT_THROW(reader->read(1, scratch.data()), internal_runtime_error);
+      EXPECT_THROW(reader->skip(1), internal_runtime_error);
+      offset = 0;
+      reader->seek(0);
+    }
+  }
+  reader->close();
+  EXPECT_FALSE(reader->is_open());
+}
+
+}  // namespace
+
+TEST(async_file_reader, read_test) {
+  // the last block of the files is partial
+  for (size_t size : {1, 4096, 100000, 1234567}) {
+    std::vector<char> content = write_test_file(size);
+    for (bool use_io_uring : {true, false}) {
+      for (int queue_depth : {1, 3, 16}) {
+        AsyncFileReader reader(queue_depth, 16384, use_io_uring);
+        std::cout << "size " << size << ", " << reader.get_backend_name() << ", queue_depth "
+                  << queue_depth << std::endl;
+        read_randomly(&reader, content);
+      }
+    }
+  }
+}
+
+TEST(async_file_reader, wrong_input_test) {
+  EXPECT_THROW(AsyncFileReader(0), internal_runtime_error);
+  EXPECT_THROW(AsyncFileReader(4, 1000), internal_runtime_error);
+  AsyncFileReader reader;
+  EXPECT_THROW(reader.open("async_file_reader_test_not_exist.bin"), internal_runtime_error);
+  EXPECT_FALSE(reader.is_open());
+}
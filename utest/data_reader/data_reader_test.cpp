@@ -16,10 +16,12 @@
 
 
 #include "HugeCTR/include/data_reader.hpp"
+#include <algorithm>
 #include <fstream>
 #include <thread>
 #include "HugeCTR/include/data_parser.hpp"
 #include "HugeCTR/include/data_reader_multi_threads.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
 #include "HugeCTR/include/file_list.hpp"
 #include "gtest/gtest.h"
 #include "utest/test_utils.h"
@@ -54,7 +56,7 @@ TEST(data_reader_multi_threads, data_reader_single_thread_test) {
 
   constexpr size_t buffer_length = max_nnz;
   CSRChunk<T> chunk(num_devices, batchsize, label_dim, slot_num, max_value_size);
-  Heap<CSRChunk<T>> csr_heap(32, chunk);
+  ChunkRing<CSRChunk<T>> csr_heap(32, chunk);
   // setup a data reader
   DataReaderMultiThreads<T> data_reader(csr_heap, file_list, buffer_length);
   // call read a batch
@@ -62,7 +64,7 @@ TEST(data_reader_multi_threads, data_reader_single_thread_test) {
 }
 
 template <typename T>
-void threadFunc(Heap<CSRChunk<T>>* csr_heap, FileList* file_list, size_t buffer_length) {
+void threadFunc(ChunkRing<CSRChunk<T>>* csr_heap, FileList* file_list, size_t buffer_length) {
   DataReaderMultiThreads<T> data_reader(*csr_heap, *file_list, buffer_length);
   data_reader.read_a_batch();
 }
@@ -79,7 +81,7 @@ TEST(data_reader_multi_threads, data_reader_multi_threads_test) {
 
   constexpr size_t buffer_length = max_nnz;
   CSRChunk<T> chunk(num_devices, batchsize, label_dim, slot_num, max_value_size);
-  Heap<CSRChunk<T>> csr_heap(32, chunk);
+  ChunkRing<CSRChunk<T>> csr_heap(32, chunk);
 
   // setup several data readers
   const int num_threads = 5;
@@ -96,6 +98,294 @@ TEST(data_reader_multi_threads, data_reader_multi_threads_test) {
   }
 }
 
+template <typename T>
+void compare_with_stream(ReaderMode_t reader_mode, int num_devices) {
+  // setup two file lists, so that both readers start from the first file
+  FileList file_list_stream(file_list_name);
+  FileList file_list_other(file_list_name);
+  const int batchsize = 2048;
+  const int max_value_size = max_nnz * batchsize * slot_num;
+  constexpr size_t buffer_length = max_nnz;
+  CSRChunk<T> chunk(num_devices, batchsize, label_dim, slot_num, max_value_size);
+  ChunkRing<CSRChunk<T>> heap_stream(2, chunk);
+  ChunkRing<CSRChunk<T>> heap_other(2, chunk);
+  DataReaderMultiThreads<T> reader_stream(heap_stream, file_list_stream, buffer_length,
+                                          ReaderMode_t::Stream);
+  DataReaderMultiThreads<T> reader_other(heap_other, file_list_other, buffer_length, reader_mode);
+  // go across the file boundary (num_records = 2 batches)
+  for (int iter = 0; iter < 3; iter++) {
+    reader_stream.read_a_batch();
+    reader_other.read_a_batch();
+    unsigned int key_stream = 0, key_other = 0;
+    CSRChunk<T>* chunk_stream = nullptr;
+    CSRChunk<T>* chunk_other = nullptr;
+    heap_stream.data_chunk_checkout(&chunk_stream, &key_stream);
+    heap_other.data_chunk_checkout(&chunk_other, &key_other);
+    for (int i = 0; i < num_devices; i++) {
+      const CSR<T>* csr_stream = chunk_stream->get_csr_buffers()[i];
+      const CSR<T>* csr_other = chunk_other->get_csr_buffers()[i];
+      ASSERT_EQ(csr_stream->get_sizeof_value(), csr_other->get_sizeof_value());
+      for (int j = 0; j < csr_stream->get_num_rows() + 1; j++) {
+        ASSERT_EQ(csr_stream->get_row_offset()[j], csr_other->get_row_offset()[j]);
+      }
+      for (int j = 0; j < csr_stream->get_sizeof_value(); j++) {
+        ASSERT_EQ(csr_stream->get_value()[j], csr_other->get_value()[j]);
+      }
+      for (int j = 0; j < batchsize / num_devices * label_dim; j++) {
+        ASSERT_EQ(chunk_stream->get_label_buffers()[i][j],
+                  chunk_other->get_label_buffers()[i][j]);
+      }
+    }
+    heap_stream.chunk_free_and_checkin(key_stream);
+    heap_other.chunk_free_and_checkin(key_other);
+  }
+  EXPECT_EQ(reader_stream.get_bytes_read(), reader_other.get_bytes_read());
+  std::cout << "stream: " << reader_stream.get_throughput_mbps()
+            << " MB/s, the other: " << reader_other.get_throughput_mbps() << " MB/s" << std::endl;
+}
+
+TEST(data_reader_multi_threads, data_reader_mmap_test) {
+  test::mpi_init();
+  compare_with_stream<T>(ReaderMode_t::Mmap, 1);
+  compare_with_stream<T>(ReaderMode_t::Mmap, 2);
+}
+
+TEST(data_reader_multi_threads, data_reader_direct_test) {
+  test::mpi_init();
+  compare_with_stream<T>(ReaderMode_t::Direct, 1);
+  compare_with_stream<T>(ReaderMode_t::Direct, 2);
+}
+
+TEST(data_reader_multi_threads, file_list_shuffle_test) {
+  test::mpi_init();
+  std::vector<std::string> files;
+  FileList file_list_in_order(file_list_name);
+  for (int i = 0; i < num_files; i++) {
+    files.push_back(file_list_in_order.get_a_file());
+  }
+  EXPECT_EQ(file_list_in_order.get_epoch(), 1);
+
+  // each epoch is a permutation, which only depends on the seed and the epoch
+  FileList file_list_0(file_list_name, true, 1234);
+  FileList file_list_1(file_list_name, true, 1234);
+  std::vector<std::vector<std::string>> epochs;
+  for (int epoch = 0; epoch < 3; epoch++) {
+    std::vector<std::string> order;
+    for (int i = 0; i < num_files; i++) {
+      order.push_back(file_list_0.get_a_file());
+      EXPECT_EQ(order.back(), file_list_1.get_a_file());
+    }
+    std::vector<std::string> sorted_order(order);
+    std::sort(sorted_order.begin(), sorted_order.end());
+    std::vector<std::string> sorted_files(files);
+    std::sort(sorted_files.begin(), sorted_files.end());
+    EXPECT_EQ(sorted_order, sorted_files);
+    epochs.push_back(order);
+  }
+  EXPECT_EQ(file_list_0.get_epoch(), 3);
+  EXPECT_NE(epochs[0], files);
+  EXPECT_NE(epochs[0], epochs[1]);
+  EXPECT_NE(epochs[1], epochs[2]);
+}
+
+TEST(data_reader_multi_threads, data_reader_shuffle_buffer_test) {
+  test::mpi_init();
+  // a file whose first label is the index of the sample, and keys are the index too
+  const std::string shuffle_file_name("./data_reader_shuffle_test.data");
+  const std::string shuffle_file_list_name("./data_reader_shuffle_test_file_list.txt");
+  const int records = 100;
+  {
+    DataSetWriter<T> writer(shuffle_file_name, label_dim, slot_num, DATA_SET_V1);
+    for (int i = 0; i < records; i++) {
+      int label[label_dim] = {i, 0};
+      std::vector<int> nnz(slot_num, 1);
+      std::vector<T> keys(slot_num, i);
+      writer.write_record(label, nnz.data(), keys.data());
+    }
+    std::ofstream file_list_stream(shuffle_file_list_name);
+    file_list_stream << "1\n" << shuffle_file_name << "\n";
+  }
+  const int batchsize = 32;
+  const int shuffle_buffer_size = 16;
+  auto read_labels = [&](unsigned int seed) {
+    FileList file_list(shuffle_file_list_name);
+    CSRChunk<T> chunk(1, batchsize, label_dim, slot_num, batchsize * slot_num);
+    ChunkRing<CSRChunk<T>> csr_heap(1, chunk);
+    DataReaderMultiThreads<T> data_reader(csr_heap, file_list, 1, ReaderMode_t::Mmap,
+                                          shuffle_buffer_size, seed);
+    std::vector<int> labels;
+    // go across the file boundary
+    for (int iter = 0; iter < 4; iter++) {
+      data_reader.read_a_batch();
+      unsigned int key = 0;
+      CSRChunk<T>* chunk_tmp = nullptr;
+      csr_heap.data_chunk_checkout(&chunk_tmp, &key);
+      const CSR<T>* csr = chunk_tmp->get_csr_buffers()[0];
+      for (int i = 0; i < batchsize; i++) {
+        int label = static_cast<int>(chunk_tmp->get_label_buffers()[0][i * label_dim]);
+        for (int k = 0; k < slot_num; k++) {
+          EXPECT_EQ(csr->get_value()[i * slot_num + k], label);
+        }
+        labels.push_back(label);
+      }
+      csr_heap.chunk_free_and_checkin(key);
+    }
+    return labels;
+  };
+  std::vector<int> labels = read_labels(1);
+  EXPECT_EQ(labels, read_labels(1));
+  EXPECT_NE(labels, read_labels(2));
+
+  // every sample of the first pass is read once within the window of the buffer
+  std::vector<int> first_pass;
+  for (int i = 0; i < static_cast<int>(labels.size()); i++) {
+    EXPECT_LT(labels[i], i + shuffle_buffer_size);
+    if (i < records - shuffle_buffer_size) {
+      first_pass.push_back(labels[i]);
+    }
+  }
+  std::sort(first_pass.begin(), first_pass.end());
+  EXPECT_EQ(std::unique(first_pass.begin(), first_pass.end()), first_pass.end());
+  std::vector<int> in_order(labels.begin(), labels.begin() + records);
+  EXPECT_FALSE(std::is_sorted(in_order.begin(), in_order.end()));
+}
+
+TEST(data_reader_multi_threads, file_list_epoch_mode_test) {
+  test::mpi_init();
+  FileList file_list(file_list_name, true, 1, false);
+  EXPECT_TRUE(file_list.is_epoch_mode());
+  for (int epoch = 0; epoch < 2; epoch++) {
+    for (int i = 0; i < num_files; i++) {
+      EXPECT_FALSE(file_list.get_a_file().empty());
+    }
+    EXPECT_TRUE(file_list.get_a_file().empty());
+    EXPECT_TRUE(file_list.get_a_file().empty());
+    EXPECT_EQ(file_list.get_epoch(), epoch);
+    std::thread waiter([&file_list, epoch]() { EXPECT_TRUE(file_list.wait_for_epoch(epoch + 1)); });
+    file_list.next_epoch();
+    waiter.join();
+  }
+  std::thread waiter([&file_list]() { EXPECT_FALSE(file_list.wait_for_epoch(100)); });
+  file_list.break_waiting();
+  waiter.join();
+}
+
+/**
+ * Read epochs with several threads in epoch mode, every sample is read exactly once in each epoch.
+ * The batch size doesn't have to be a multiple of the devices.
+ */
+void read_epochs(int shuffle_buffer_size, int batchsize = 32, int num_devices = 2) {
+  const std::string epoch_file_list_name("./data_reader_epoch_test_file_list.txt");
+  const int epoch_num_files = 3;
+  const int records = 100;
+  {
+    std::ofstream file_list_stream(epoch_file_list_name);
+    file_list_stream << epoch_num_files << "\n";
+    for (int f = 0; f < epoch_num_files; f++) {
+      std::string file_name("./data_reader_epoch_test_" + std::to_string(f) + ".data");
+      DataSetWriter<T> writer(file_name, label_dim, slot_num, DATA_SET_V1);
+      for (int i = 0; i < records; i++) {
+        int label[label_dim] = {f * records + i, 1};
+        std::vector<int> nnz(slot_num, 1);
+        std::vector<T> keys(slot_num, f * records + i);
+        writer.write_record(label, nnz.data(), keys.data());
+      }
+      file_list_stream << file_name << "\n";
+    }
+  }
+  const int num_threads = 2;
+  const int batchsize_per_device = (batchsize + num_devices - 1) / num_devices;
+  const int num_rows = batchsize_per_device * num_devices;
+  FileList file_list(epoch_file_list_name, false, 0, false);
+  CSRChunk<T> chunk(num_devices, batchsize, label_dim, slot_num, batchsize * slot_num);
+  ASSERT_EQ(chunk.get_batchsize_per_buffer(), batchsize_per_device);
+  ChunkRing<CSRChunk<T>> csr_heap(4, chunk);
+  std::vector<DataReaderMultiThreads<T>*> data_readers;
+  std::vector<std::thread> threads;
+  std::atomic<bool> loop_flag{true};
+  for (int i = 0; i < num_threads; i++) {
+    data_readers.push_back(new DataReaderMultiThreads<T>(csr_heap, file_list, 1, ReaderMode_t::Mmap,
+                                                         shuffle_buffer_size, i));
+    threads.emplace_back([&loop_flag](DataReaderMultiThreads<T>* data_reader) {
+      while (loop_flag) {
+        data_reader->read_a_batch();
+      }
+    }, data_readers.back());
+  }
+  for (int epoch = 0; epoch < 2; epoch++) {
+    std::vector<int> count(epoch_num_files * records, 0);
+    int finished = 0;
+    while (finished < num_threads) {
+      unsigned int key = 0;
+      CSRChunk<T>* chunk_tmp = nullptr;
+      csr_heap.data_chunk_checkout(&chunk_tmp, &key);
+      int num_samples = chunk_tmp->get_num_samples();
+      ASSERT_LE(num_samples, batchsize);
+      if (num_samples == 0) {
+        finished++;
+      }
+      std::vector<int> device_num_samples(num_devices, 0);
+      for (int sample = 0; sample < num_rows; sample++) {
+        int label = static_cast<int>(
+            chunk_tmp->get_label_buffers()[sample / batchsize_per_device]
+                                          [sample % batchsize_per_device * label_dim]);
+        // keys are distributed to the CSR buffers, each of which has all the rows
+        int nnz = 0;
+        for (auto csr : chunk_tmp->get_csr_buffers()) {
+          ASSERT_EQ(csr->get_num_rows(), num_rows * slot_num);
+          nnz += csr->get_row_offset()[(sample + 1) * slot_num] -
+                 csr->get_row_offset()[sample * slot_num];
+        }
+        if (sample < num_samples) {
+          count[label]++;
+          device_num_samples[sample / batchsize_per_device]++;
+          EXPECT_EQ(nnz, slot_num);
+        } else {
+          // padding
+          EXPECT_EQ(label, 0);
+          EXPECT_EQ(nnz, 0);
+        }
+      }
+      for (int d = 0; d < num_devices; d++) {
+        EXPECT_EQ(device_num_samples[d],
+                  get_device_num_samples(num_samples, batchsize_per_device, d));
+      }
+      csr_heap.chunk_free_and_checkin(key);
+    }
+    for (auto c : count) {
+      EXPECT_EQ(c, 1);
+    }
+    file_list.next_epoch();
+  }
+  loop_flag = false;
+  for (auto data_reader : data_readers) {
+    data_reader->skip_read();
+  }
+  csr_heap.break_and_return();
+  file_list.break_waiting();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto data_reader : data_readers) {
+    delete data_reader;
+  }
+}
+
+TEST(data_reader_multi_threads, data_reader_epoch_test) {
+  test::mpi_init();
+  read_epochs(0);
+  read_epochs(40);
+}
+
+TEST(data_reader_multi_threads, data_reader_ragged_batch_test) {
+  test::mpi_init();
+  // 30 samples on 4 devices: 8 rows per device, the last one has 6 samples of a full batch
+  read_epochs(0, 30, 4);
+  read_epochs(0, 7, 3);
+  EXPECT_EQ(get_device_num_samples(30, 8, 3), 6);
+  EXPECT_EQ(get_device_num_samples(13, 8, 1), 5);
+  EXPECT_EQ(get_device_num_samples(13, 8, 2), 0);
+}
 
 #if 0
 TEST(data_reader_test, data_reader_simple_test) {
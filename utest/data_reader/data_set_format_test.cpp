@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/data_set_format.hpp"
+#include <fstream>
+#include "HugeCTR/include/data_reader_multi_threads.hpp"
+#include "HugeCTR/include/file_list.hpp"
+#include "HugeCTR/include/utils.hpp"
+#include "gtest/gtest.h"
+#include "utest/test_utils.h"
+
+using namespace HugeCTR;
+
+namespace {
+
+// configuration
+const std::string v1_file_list_name("data_set_format_v1_file_list.txt");
+const std::string v2_file_list_name("data_set_format_v2_file_list.txt");
+const std::string prefix("./data_set_format_test_data/temp_dataset_");
+const int num_files = 4;
+const long long label_dim = 2;
+const long long slot_num = 10;
+const long long num_records = 2048 * 2;
+const int max_nnz = 30;
+const int vocabulary_size = 511;
+typedef long long T;
+
+/**
+ * The nnz of slot k in record i is (i + k) % 4, the keys are i * 100 + k.
+ */
+void write_test_file(const std::string& file_name, long long version, long long records,
+                     long long records_per_block) {
+  DataSetWriter<T> writer(file_name, label_dim, slot_num, version, records_per_block);
+  for (long long i = 0; i < records; i++) {
+    int label[label_dim] = {static_cast<int>(i), 1};
+    int nnz[slot_num];
+    std::vector<T> keys;
+    for (int k = 0; k < slot_num; k++) {
+      nnz[k] = (i + k) % 4;
+      keys.insert(keys.end(), nnz[k], i * 100 + k);
+    }
+    writer.write_record(label, nnz, keys.data());
+  }
+}
+
+}  // namespace
+
+TEST(data_set_format, index_test) {
+  const std::string file_name("./data_set_format_index_test.data");
+  const long long records = 1000;
+  const long long records_per_block = 128;
+  write_test_file(file_name, DATA_SET_V2, records, records_per_block);
+
+  DataSetIndex index(file_name);
+  const DataSetHeader& header = index.get_header();
+  EXPECT_EQ(header.number_of_records, records);
+  EXPECT_EQ(header.label_dim, label_dim);
+  EXPECT_EQ(header.slot_num, slot_num);
+  EXPECT_EQ(get_data_set_version(header), DATA_SET_V2);
+  EXPECT_EQ(get_data_set_flags(header), 0);
+  EXPECT_EQ(index.get_records_per_block(), records_per_block);
+  ASSERT_EQ(index.get_num_blocks(), (records + records_per_block - 1) / records_per_block);
+
+  std::ifstream in_stream(file_name, std::ifstream::binary);
+  long long offset = sizeof(DataSetHeader);
+  long long max_nnz_of_blocks = 0;
+  for (int b = 0; b < index.get_num_blocks(); b++) {
+    const DataSetBlock& block = index.get_block(b);
+    long long first = b * records_per_block;
+    long long last = std::min(first + records_per_block, records);
+    EXPECT_EQ(block.offset, offset);
+    EXPECT_EQ(block.number_of_records, last - first);
+    long long total_nnz = 0;
+    for (int k = 0; k < slot_num; k++) {
+      long long nnz = 0;
+      for (long long i = first; i < last; i++) {
+        nnz += (i + k) % 4;
+      }
+      EXPECT_EQ(index.get_block_nnz(b, k), nnz);
+      total_nnz += nnz;
+    }
+    EXPECT_EQ(index.get_block_nnz(b), total_nnz);
+    EXPECT_EQ(block.size, static_cast<long long>(sizeof(int) * (label_dim + slot_num) *
+                                                     block.number_of_records +
+                                                 sizeof(T) * total_nnz));
+    max_nnz_of_blocks = std::max(max_nnz_of_blocks, total_nnz);
+    offset += block.size;
+
+    // random access to the first record of the block
+    EXPECT_EQ(index.find_block(first), b);
+    EXPECT_EQ(index.find_block(last - 1), b);
+    int label[label_dim];
+    in_stream.seekg(block.offset, std::ios_base::beg);
+    in_stream.read(reinterpret_cast<char*>(label), sizeof(label));
+    EXPECT_EQ(label[0], first);
+  }
+  EXPECT_EQ(index.get_max_block_nnz(), max_nnz_of_blocks);
+}
+
+TEST(data_set_format, version_test) {
+  const std::string file_name("./data_set_format_version_test.data");
+  write_test_file(file_name, DATA_SET_V1, 10, 1);
+  // v1 files have no index
+  EXPECT_THROW(DataSetIndex index(file_name), internal_runtime_error);
+
+  DataSetHeader header = {10, label_dim, slot_num, 0};
+  EXPECT_EQ(get_data_set_version(header), DATA_SET_V1);
+  EXPECT_NO_THROW(check_data_set_version(header, file_name));
+  header.reserved = make_data_set_reserved(DATA_SET_V2, 1);
+  EXPECT_EQ(get_data_set_version(header), DATA_SET_V2);
+  EXPECT_EQ(get_data_set_flags(header), 1);
+  EXPECT_NO_THROW(check_data_set_version(header, file_name));
+  header.reserved = make_data_set_reserved(3);
+  EXPECT_THROW(check_data_set_version(header, file_name), internal_runtime_error);
+
+  // the reader rejects unknown versions
+  {
+    std::fstream stream(file_name, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    stream.write(reinterpret_cast<char*>(&header), sizeof(DataSetHeader));
+  }
+  const std::string file_list_name("./data_set_format_version_test_file_list.txt");
+  {
+    std::ofstream file_list_stream(file_list_name);
+    file_list_stream << "1\n" << file_name << "\n";
+  }
+  FileList file_list(file_list_name);
+  CSRChunk<T> chunk(1, 8, label_dim, slot_num, 8 * slot_num * 4);
+  ChunkRing<CSRChunk<T>> csr_heap(1, chunk);
+  DataReaderMultiThreads<T> data_reader(csr_heap, file_list, 4);
+  EXPECT_THROW(data_reader.read_a_batch(), internal_runtime_error);
+}
+
+TEST(data_set_format, convert_and_read_test) {
+  test::mpi_init();
+  HugeCTR::data_generation<T>(v1_file_list_name, prefix, num_files, num_records, slot_num,
+                              vocabulary_size, label_dim, max_nnz);
+  {
+    std::ifstream v1_file_list_stream(v1_file_list_name);
+    std::ofstream v2_file_list_stream(v2_file_list_name);
+    int files = 0;
+    v1_file_list_stream >> files;
+    v2_file_list_stream << files << "\n";
+    for (int i = 0; i < files; i++) {
+      std::string v1_file_name;
+      v1_file_list_stream >> v1_file_name;
+      std::string v2_file_name = v1_file_name + ".v2";
+      EXPECT_EQ(convert_data_set_to_v2<T>(v1_file_name, v2_file_name, 1000), num_records);
+      v2_file_list_stream << v2_file_name << "\n";
+    }
+  }
+
+  // the v2 files are read the same as the v1 ones
+  const int num_devices = 2;
+  FileList file_list_v1(v1_file_list_name);
+  FileList file_list_v2(v2_file_list_name);
+  const int batchsize = 2048;
+  const int max_value_size = max_nnz * batchsize * slot_num;
+  constexpr size_t buffer_length = max_nnz;
+  CSRChunk<T> chunk(num_devices, batchsize, label_dim, slot_num, max_value_size);
+  ChunkRing<CSRChunk<T>> heap_v1(1, chunk);
+  ChunkRing<CSRChunk<T>> heap_v2(1, chunk);
+  DataReaderMultiThreads<T> reader_v1(heap_v1, file_list_v1, buffer_length);
+  DataReaderMultiThreads<T> reader_v2(heap_v2, file_list_v2, buffer_length, ReaderMode_t::Mmap);
+  for (int iter = 0; iter < 3; iter++) {
+    reader_v1.read_a_batch();
+    reader_v2.read_a_batch();
+    unsigned int key_v1 = 0, key_v2 = 0;
+    CSRChunk<T>* chunk_v1 = nullptr;
+    CSRChunk<T>* chunk_v2 = nullptr;
+    heap_v1.data_chunk_checkout(&chunk_v1, &key_v1);
+    heap_v2.data_chunk_checkout(&chunk_v2, &key_v2);
+    for (int i = 0; i < num_devices; i++) {
+      const CSR<T>* csr_v1 = chunk_v1->get_csr_buffers()[i];
+      const CSR<T>* csr_v2 = chunk_v2->get_csr_buffers()[i];
+      ASSERT_EQ(csr_v1->get_sizeof_value(), csr_v2->get_sizeof_value());
+      for (int j = 0; j < csr_v1->get_num_rows() + 1; j++) {
+        ASSERT_EQ(csr_v1->get_row_offset()[j], csr_v2->get_row_offset()[j]);
+      }
+      for (int j = 0; j < csr_v1->get_sizeof_value(); j++) {
+        ASSERT_EQ(csr_v1->get_value()[j], csr_v2->get_value()[j]);
+      }
+      for (int j = 0; j < batchsize / num_devices * label_dim; j++) {
+        ASSERT_EQ(chunk_v1->get_label_buffers()[i][j], chunk_v2->get_label_buffers()[i][j]);
+      }
+    }
+    heap_v1.chunk_free_and_checkin(key_v1);
+    heap_v2.chunk_free_and_checkin(key_v2);
+  }
+}
+
+TEST(data_set_format, compressed_read_test) {
+  test::mpi_init();
+  HugeCTR::data_generation<T>(v1_file_list_name, prefix, num_files, num_records, slot_num,
+                              vocabulary_size, label_dim, max_nnz);
+  for (int codec : {DATA_SET_CODEC_LZ4, DATA_SET_CODEC_ZSTD}) {
+    if (!is_codec_available(codec)) {
+      EXPECT_THROW(DataSetWriter<T>("./data_set_format_test_data/unavailable.data", label_dim,
+                                    slot_num, DATA_SET_V2, 1000, codec),
+                   internal_runtime_error);
+      continue;
+    }
+    const std::string compressed_file_list_name =
+        std::string("data_set_format_") + get_codec_name(codec) + "_file_list.txt";
+    {
+      std::ifstream v1_file_list_stream(v1_file_list_name);
+      std::ofstream compressed_file_list_stream(compressed_file_list_name);
+      int files = 0;
+      v1_file_list_stream >> files;
+      compressed_file_list_stream << files << "\n";
+      for (int i = 0; i < files; i++) {
+        std::string v1_file_name;
+        v1_file_list_stream >> v1_file_name;
+        std::string compressed_file_name = v1_file_name + "." + get_codec_name(codec);
+        EXPECT_EQ(convert_data_set_to_v2<T>(v1_file_name, compressed_file_name, 1000, codec, 3),
+                  num_records);
+        compressed_file_list_stream << compressed_file_name << "\n";
+        std::ifstream v1_stream(v1_file_name, std::ifstream::binary | std::ifstream::ate);
+        std::ifstream compressed_stream(compressed_file_name,
+                                        std::ifstream::binary | std::ifstream::ate);
+        EXPECT_LT(compressed_stream.tellg(), v1_stream.tellg());
+        DataSetIndex index(compressed_file_name);
+        EXPECT_EQ(get_data_set_codec(index.get_header()), codec);
+        EXPECT_EQ(index.get_num_blocks(), (num_records + 999) / 1000);
+        // compressed files can't be compressed again, nor have a record index
+        EXPECT_THROW(convert_data_set_to_v2<T>(compressed_file_name, compressed_file_name + ".2"),
+                     internal_runtime_error);
+        EXPECT_THROW(build_record_index<T>(compressed_file_name), internal_runtime_error);
+      }
+    }
+
+    // the samples are decompressed the same as the v1 ones in all the modes
+    for (ReaderMode_t reader_mode :
+         {ReaderMode_t::Stream, ReaderMode_t::Mmap, ReaderMode_t::Direct}) {
+      FileList file_list_v1(v1_file_list_name);
+      FileList file_list_compressed(compressed_file_list_name);
+      const int batchsize = 1000;
+      CSRChunk<T> chunk(1, batchsize, label_dim, slot_num, max_nnz * batchsize * slot_num);
+      ChunkRing<CSRChunk<T>> heap_v1(1, chunk);
+      ChunkRing<CSRChunk<T>> heap_compressed(1, chunk);
+      DataReaderMultiThreads<T> reader_v1(heap_v1, file_list_v1, max_nnz);
+      DataReaderMultiThreads<T> reader_compressed(heap_compressed, file_list_compressed, max_nnz,
+                                                  reader_mode);
+      for (int iter = 0; iter < 10; iter++) {
+        reader_v1.read_a_batch();
+        reader_compressed.read_a_batch();
+        unsigned int key_v1 = 0, key_compressed = 0;
+        CSRChunk<T>* chunk_v1 = nullptr;
+        CSRChunk<T>* chunk_compressed = nullptr;
+        heap_v1.data_chunk_checkout(&chunk_v1, &key_v1);
+        heap_compressed.data_chunk_checkout(&chunk_compressed, &key_compressed);
+        const CSR<T>* csr_v1 = chunk_v1->get_csr_buffers()[0];
+        const CSR<T>* csr_compressed = chunk_compressed->get_csr_buffers()[0];
+        ASSERT_EQ(csr_v1->get_sizeof_value(), csr_compressed->get_sizeof_value());
+        for (int j = 0; j < csr_v1->get_num_rows() + 1; j++) {
+          ASSERT_EQ(csr_v1->get_row_offset()[j], csr_compressed->get_row_offset()[j]);
+        }
+        for (int j = 0; j < csr_v1->get_sizeof_value(); j++) {
+          ASSERT_EQ(csr_v1->get_value()[j], csr_compressed->get_value()[j]);
+        }
+        for (int j = 0; j < batchsize * label_dim; j++) {
+          ASSERT_EQ(chunk_v1->get_label_buffers()[0][j],
+                    chunk_compressed->get_label_buffers()[0][j]);
+        }
+        heap_v1.chunk_free_and_checkin(key_v1);
+        heap_compressed.chunk_free_and_checkin(key_compressed);
+      }
+      // only the compressed bytes are read
+      EXPECT_LT(reader_compressed.get_bytes_read(), reader_v1.get_bytes_read());
+    }
+  }
+}
+
+TEST(data_set_format, dense_read_test) {
+  check_make_dir("./data_set_format_test_data");
+  // dense feature j of record i is i + j / 4
+  const int dense_dim = 13;
+  const long long records = 1000;
+  std::vector<std::pair<long long, int>> formats = {{DATA_SET_V1, DATA_SET_CODEC_NONE},
+                                                     {DATA_SET_V2, DATA_SET_CODEC_NONE}};
+  if (is_codec_available(DATA_SET_CODEC_LZ4)) {
+    formats.push_back({DATA_SET_V2, DATA_SET_CODEC_LZ4});
+  }
+  for (auto& format : formats) {
+    const std::string file_name = prefix + "dense_" + std::to_string(format.first) + "_" +
+                                  get_codec_name(format.second) + ".data";
+    const std::string file_list_name("data_set_format_dense_file_list.txt");
+    {
+      DataSetWriter<T> writer(file_name, label_dim, slot_num, format.first, 300, format.second,
+                              1, dense_dim);
+      EXPECT_THROW(writer.write_record(nullptr, nullptr, nullptr), internal_runtime_error);
+      for (long long i = 0; i < records; i++) {
+        int label[label_dim] = {static_cast<int>(i), 1};
+        float dense[dense_dim];
+        for (int j = 0; j < dense_dim; j++) {
+          dense[j] = i + j / 4.f;
+        }
+        int nnz[slot_num];
+        std::vector<T> keys;
+        for (int k = 0; k < slot_num; k++) {
+          nnz[k] = (i + k) % 4;
+          keys.insert(keys.end(), nnz[k], i * 100 + k);
+        }
+        writer.write_record(label, nnz, keys.data(), dense);
+      }
+      std::ofstream file_list_stream(file_list_name);
+      file_list_stream << 1 << "\n" << file_name << "\n";
+    }
+
+    DataSetRecordReader<T> record_reader(file_name);
+    EXPECT_EQ(get_data_set_dense_dim(record_reader.get_header()), dense_dim);
+    for (long long i = 0; record_reader.next(); i++) {
+      ASSERT_EQ(record_reader.get_label()[0], i);
+      for (int j = 0; j < dense_dim; j++) {
+        ASSERT_EQ(record_reader.get_dense()[j], i + j / 4.f);
+      }
+      ASSERT_EQ(record_reader.get_keys()[0], i * 100 + (i % 4 == 0 ? 1 : 0));
+    }
+
+    // the dense features of a sample land in the same row as its label
+    for (ReaderMode_t reader_mode :
+         {ReaderMode_t::Stream, ReaderMode_t::Mmap, ReaderMode_t::Direct}) {
+      FileList file_list(file_list_name);
+      const int num_devices = 2;
+      const int batchsize = 128;
+      CSRChunk<T> chunk(num_devices, batchsize, label_dim, slot_num,
+                        max_nnz * batchsize * slot_num, default_host_allocator(), false,
+                        dense_dim);
+      ChunkRing<CSRChunk<T>> heap(1, chunk);
+      DataReaderMultiThreads<T> reader(heap, file_list, max_nnz, reader_mode, 64);
+      // less than an epoch, there's no padded sample
+      for (int iter = 0; iter < 7; iter++) {
+        reader.read_a_batch();
+        unsigned int key = 0;
+        CSRChunk<T>* chunk_tmp = nullptr;
+        heap.data_chunk_checkout(&chunk_tmp, &key);
+        ASSERT_EQ(chunk_tmp->get_dense_dim(), dense_dim);
+        for (int i = 0; i < num_devices; i++) {
+          const float* label_buffer = chunk_tmp->get_label_buffers()[i];
+          const float* dense_buffer = chunk_tmp->get_dense_buffers()[i];
+          for (int row = 0; row < batchsize / num_devices; row++) {
+            for (int j = 0; j < dense_dim; j++) {
+              ASSERT_EQ(dense_buffer[row * dense_dim + j],
+                        label_buffer[row * label_dim] + j / 4.f);
+            }
+          }
+        }
+        heap.chunk_free_and_checkin(key);
+      }
+    }
+  }
+}
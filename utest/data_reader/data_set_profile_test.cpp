@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/data_set_profile.hpp"
+#include <cmath>
+#include <set>
+#include "HugeCTR/include/utils.hpp"
+#include "gtest/gtest.h"
+
+using namespace HugeCTR;
+
+namespace {
+
+typedef long long T;
+const std::string prefix("./data_set_profile_test_data/temp_dataset_");
+const int slot_num = 3;
+const int num_files = 3;
+const int records_per_file = 5000;
+
+/**
+ * The nnz of slot k of record i is (i + k) % 5, except that record 7 of each file has 40
+ * keys in slot 0. Key j of a slot is (i * 31 + j * 7) % (1000 * (k + 1)) + k * 100000.
+ * File 0 is v1, file 1 is v2 and file 2 is compressed if a codec is available.
+ */
+std::vector<std::string> write_test_files(std::set<T>* distinct_keys,
+                                          std::vector<std::vector<long long>>* histograms) {
+  check_make_dir("./data_set_profile_test_data");
+  int codec = DATA_SET_CODEC_NONE;
+  for (int c : {DATA_SET_CODEC_LZ4, DATA_SET_CODEC_ZSTD}) {
+    if (is_codec_available(c)) {
+      codec = c;
+    }
+  }
+  histograms->assign(slot_num, std::vector<long long>(41, 0));
+  std::vector<std::string> file_names;
+  for (int f = 0; f < num_files; f++) {
+    file_names.push_back(prefix + std::to_string(f) + ".data");
+    DataSetWriter<T> writer(file_names.back(), 1, slot_num, f == 0 ? DATA_SET_V1 : DATA_SET_V2,
+                            1000, f == 2 ? codec : DATA_SET_CODEC_NONE);
+    for (int i = 0; i < records_per_file; i++) {
+      int label = i;
+      int nnz[slot_num];
+      std::vector<T> keys;
+      for (int k = 0; k < slot_num; k++) {
+        nnz[k] = i == 7 && k == 0 ? 40 : (i + k) % 5;
+        (*histograms)[k][nnz[k]]++;
+        for (int j = 0; j < nnz[k]; j++) {
+          T key = (i * 31 + j * 7) % (1000 * (k + 1)) + k * 100000;
+          keys.push_back(key);
+          distinct_keys->insert(key);
+        }
+      }
+      writer.write_record(&label, nnz, keys.data());
+    }
+  }
+  return file_names;
+}
+
+}  // namespace
+
+TEST(data_set_profile, hyperloglog_test) {
+  for (long long n : {100, 5000, 200000}) {
+    HyperLogLog all, first_half, second_half;
+    for (long long key = 0; key < n; key++) {
+      uint64_t hash = mix_key_hash(key);
+      // duplicates don't count
+      all.add(hash);
+      all.add(hash);
+      (key < n / 2 ? first_half : second_half).add(hash);
+    }
+    EXPECT_NEAR(all.estimate(), n, n * 3 * all.get_relative_error()) << n;
+    // merging is exact
+    first_half.merge(second_half);
+    EXPECT_EQ(first_half.estimate(), all.estimate());
+  }
+  EXPECT_EQ(HyperLogLog().estimate(), 0.0);
+  EXPECT_THROW(HyperLogLog(20), internal_runtime_error);
+  EXPECT_THROW(HyperLogLog(10).merge(HyperLogLog(12)), internal_runtime_error);
+}
+
+TEST(data_set_profile, profile_test) {
+  std::set<T> distinct_keys;
+  std::vector<std::vector<long long>> histograms;
+  std::vector<std::string> file_names = write_test_files(&distinct_keys, &histograms);
+
+  DataSetProfile<T> profile = profile_data_set<T>(file_names, 2);
+  EXPECT_EQ(profile.get_number_of_records(), num_files * records_per_file);
+  for (int k = 0; k < slot_num; k++) {
+    std::vector<long long> histogram = profile.get_slot_nnz_histogram(k);
+    histogram.resize(histograms[k].size(), 0);
+    EXPECT_EQ(histogram, histograms[k]);
+  }
+  long long number_of_keys = 0;
+  for (int k = 0; k < slot_num; k++) {
+    for (size_t nnz = 0; nnz < histograms[k].size(); nnz++) {
+      number_of_keys += nnz * histograms[k][nnz];
+    }
+  }
+  EXPECT_EQ(profile.get_number_of_keys(), number_of_keys);
+  // record 7: 40 + 3 + 4
+  EXPECT_EQ(profile.get_max_sample_nnz(), 47);
+  EXPECT_EQ(DataSetProfile<T>::get_percentile(profile.get_slot_nnz_histogram(1), 0.5), 2);
+  EXPECT_EQ(DataSetProfile<T>::get_percentile(profile.get_slot_nnz_histogram(0), 1.0), 40);
+  const double n = distinct_keys.size();
+  EXPECT_NEAR(profile.estimate_distinct_keys(), n, n * 0.03);
+  EXPECT_NEAR(profile.estimate_distinct_keys(2), 3000, 3000 * 0.1);
+
+  // all the keys are counted, the keys of slot 0 are the most frequent ones
+  EXPECT_EQ(profile.get_number_of_sampled_keys(), static_cast<long long>(distinct_keys.size()));
+  EXPECT_GT(profile.get_top_keys_share(0.1), 0.1);
+  EXPECT_NEAR(profile.get_top_keys_share(1.0), 1.0, 1e-9);
+  // a sample of the keys tells the same
+  DataSetProfile<T> sampled_profile = profile_data_set<T>(file_names, 3, 4);
+  EXPECT_LT(sampled_profile.get_number_of_sampled_keys(), profile.get_number_of_sampled_keys());
+  EXPECT_GT(sampled_profile.get_number_of_sampled_keys(), 0);
+  EXPECT_NEAR(sampled_profile.get_top_keys_share(0.1), profile.get_top_keys_share(0.1), 0.05);
+  EXPECT_EQ(sampled_profile.get_slot_nnz_histogram(0), profile.get_slot_nnz_histogram(0));
+
+  DataSetRecommendation recommendation = profile.recommend(0.5f);
+  EXPECT_EQ(recommendation.label_dim, 1);
+  EXPECT_EQ(recommendation.slot_num, slot_num);
+  EXPECT_EQ(recommendation.max_feature_num_per_sample, 47);
+  EXPECT_GE(recommendation.vocabulary_size, static_cast<long long>(n));
+  EXPECT_LT(recommendation.vocabulary_size, static_cast<long long>(n * 1.1));
+  EXPECT_EQ(recommendation.load_factor, 0.5f);
+
+  // a file of another data set
+  DataSetWriter<T>(prefix + "other.data", 1, slot_num + 1).close();
+  file_names.push_back(prefix + "other.data");
+  EXPECT_THROW(profile_data_set<T>(file_names, 2), internal_runtime_error);
+}
+
+TEST(data_set_profile, zipf_test) {
+  // frequency of the key of rank r is 100000 / r
+  DataSetProfile<T> profile(1, 1);
+  for (T key = 1; key <= 1000; key++) {
+    int nnz = static_cast<int>(100000 / key);
+    std::vector<T> keys(nnz, key);
+    profile.add_sample(&nnz, keys.data());
+  }
+  EXPECT_NEAR(profile.estimate_zipf_exponent(), 1.0, 0.01);
+  EXPECT_EQ(profile.get_singleton_fraction(), 0.0);
+}
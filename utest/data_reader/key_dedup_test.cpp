@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/key_dedup.hpp"
+#include <random>
+#include <unordered_set>
+#include "HugeCTR/include/data_reader_multi_threads.hpp"
+#include "HugeCTR/include/file_list.hpp"
+#include "HugeCTR/include/utils.hpp"
+#include "gtest/gtest.h"
+#include "utest/test_utils.h"
+
+using namespace HugeCTR;
+
+namespace {
+
+/**
+ * keys[j] == unique_keys[inverse_index[j]], and unique_keys are the distinct keys
+ * in the order of first appearance.
+ */
+template <typename T>
+void check_unique_keys(const T* keys, int num_keys, const std::vector<T>& unique_keys,
+                       const std::vector<int>& inverse_index) {
+  ASSERT_EQ(inverse_index.size(), static_cast<size_t>(num_keys));
+  std::vector<T> expected;
+  std::unordered_set<T> seen;
+  for (int j = 0; j < num_keys; j++) {
+    if (seen.insert(keys[j]).second) {
+      expected.push_back(keys[j]);
+    }
+    ASSERT_GE(inverse_index[j], 0);
+    ASSERT_LT(inverse_index[j], static_cast<int>(unique_keys.size()));
+    ASSERT_EQ(unique_keys[inverse_index[j]], keys[j]);
+  }
+  ASSERT_EQ(unique_keys, expected);
+}
+
+}  // namespace
+
+TEST(key_dedup, dedup_test) {
+  std::mt19937 generator(0);
+  KeyDedup<long long> dedup;
+  std::vector<long long> unique_keys;
+  std::vector<int> inverse_index;
+  // the table is reused by the calls and grows with the number of keys
+  for (int num_keys : {0, 1, 100, 10000, 7, 50000, 300}) {
+    std::uniform_int_distribution<long long> dist(0, num_keys / 4 + 1);
+    std::vector<long long> keys(num_keys);
+    for (auto& key : keys) {
+      key = dist(generator) * 1000003;  // keys sharing low bits
+    }
+    dedup.dedup(keys.data(), num_keys, &unique_keys, &inverse_index);
+    check_unique_keys(keys.data(), num_keys, unique_keys, inverse_index);
+  }
+
+  KeyDedup<unsigned int> dedup_uint;
+  std::vector<unsigned int> keys_uint = {7, 3, 7, 9, 3, 7};
+  std::vector<unsigned int> unique_keys_uint;
+  dedup_uint.dedup(keys_uint.data(), keys_uint.size(), &unique_keys_uint, &inverse_index);
+  EXPECT_EQ(unique_keys_uint, std::vector<unsigned int>({7, 3, 9}));
+  EXPECT_EQ(inverse_index, std::vector<int>({0, 1, 0, 2, 1, 0}));
+}
+
+TEST(key_dedup, reader_unique_keys_test) {
+  typedef long long T;
+  const std::string file_list_name("key_dedup_file_list.txt");
+  const int label_dim = 1;
+  const int slot_num = 26;
+  const int max_nnz = 4;
+  test::mpi_init();
+  HugeCTR::data_generation<T>(file_list_name, "./key_dedup_test_data/temp_dataset_", 2, 4096,
+                              slot_num, 1000, label_dim, max_nnz);
+
+  FileList file_list(file_list_name);
+  const int num_devices = 2;
+  const int batchsize = 1024;
+  const int max_value_size = max_nnz * batchsize * slot_num;
+  CSRChunk<T> chunk(num_devices, batchsize, label_dim, slot_num, max_value_size,
+                    default_host_allocator(), true);
+  ChunkRing<CSRChunk<T>> csr_heap(2, chunk);
+  DataReaderMultiThreads<T> data_reader(csr_heap, file_list, max_nnz);
+  for (int iter = 0; iter < 3; iter++) {
+    data_reader.read_a_batch();
+    unsigned int key = 0;
+    CSRChunk<T>* chunk_tmp = nullptr;
+    csr_heap.data_chunk_checkout(&chunk_tmp, &key);
+    ASSERT_TRUE(chunk_tmp->has_unique_keys());
+    for (int i = 0; i < num_devices; i++) {
+      const CSR<T>* csr = chunk_tmp->get_csr_buffers()[i];
+      check_unique_keys(csr->get_value(), csr->get_sizeof_value(), chunk_tmp->get_unique_keys(i),
+                        chunk_tmp->get_inverse_index(i));
+      // a vocabulary of 1001 keys in a batch of about 40000 keys
+      EXPECT_LE(chunk_tmp->get_unique_keys(i).size(), 1001u);
+    }
+    csr_heap.chunk_free_and_checkin(key);
+  }
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/key_dictionary.hpp"
+#include <fstream>
+#include <map>
+#include "gtest/gtest.h"
+
+using namespace HugeCTR;
+
+namespace {
+
+const int label_dim = 1;
+const int slot_num = 4;
+const int dense_dim = 2;
+const int embedding_vec_size = 4;
+
+/**
+ * Key j of slot k in record i is base + (i * j + k) % 50, far above 2^32, so the small
+ * offsets are the most frequent ones.
+ */
+void write_test_file(const std::string& file_name, long long base, long long records,
+                     long long version, long long records_per_block) {
+  DataSetWriter<long long> writer(file_name, label_dim, slot_num, version, records_per_block,
+                                  DATA_SET_CODEC_NONE, 1, dense_dim);
+  for (long long i = 0; i < records; i++) {
+    int label[label_dim] = {static_cast<int>(i % 2)};
+    float dense[dense_dim] = {static_cast<float>(i), 0.5f};
+    int nnz[slot_num];
+    std::vector<long long> keys;
+    for (int k = 0; k < slot_num; k++) {
+      nnz[k] = (i + k) % 3;
+      for (int j = 0; j < nnz[k]; j++) {
+        keys.push_back(base + (i * j + k) % 50);
+      }
+    }
+    writer.write_record(label, nnz, keys.data(), dense);
+  }
+}
+
+}  // namespace
+
+TEST(key_dictionary, compact_data_test) {
+  const long long base = 1LL << 40;
+  const long long records = 500;
+  write_test_file("./key_dictionary_test_0.data", base, records, DATA_SET_V2, 64);
+  write_test_file("./key_dictionary_test_1.data", base, records / 2, DATA_SET_V1, 1);
+
+  // the expected keys by frequency
+  std::map<long long, long long> counts;
+  for (int f = 0; f < 2; f++) {
+    DataSetRecordReader<long long> reader("./key_dictionary_test_" + std::to_string(f) + ".data");
+    while (reader.next()) {
+      long long nnz = 0;
+      for (int k = 0; k < slot_num; k++) {
+        nnz += reader.get_nnz()[k];
+      }
+      for (long long j = 0; j < nnz; j++) {
+        counts[reader.get_keys()[j]]++;
+      }
+    }
+  }
+  KeyDictionary dictionary;
+  EXPECT_EQ(dictionary.add_keys({"./key_dictionary_test_0.data", "./key_dictionary_test_1.data"}),
+            counts.size());
+  ASSERT_EQ(dictionary.size(), counts.size());
+  for (unsigned int c = 0; c < dictionary.size(); c++) {
+    long long key = dictionary.get_key(c);
+    ASSERT_NE(dictionary.find(key), nullptr);
+    EXPECT_EQ(*dictionary.find(key), c);
+    if (c > 0) {
+      long long prev = dictionary.get_key(c - 1);
+      EXPECT_TRUE(counts[prev] > counts[key] || (counts[prev] == counts[key] && prev < key));
+    }
+  }
+  EXPECT_EQ(dictionary.find(base - 1), nullptr);
+
+  // the compacted files have the same samples and format, with the compact keys
+  for (int f = 0; f < 2; f++) {
+    std::string file_name = "./key_dictionary_test_" + std::to_string(f) + ".data";
+    EXPECT_EQ(compact_data_file(dictionary, file_name, file_name + ".u32"),
+              f == 0 ? records : records / 2);
+    DataSetRecordReader<long long> reader(file_name);
+    DataSetRecordReader<unsigned int> compact_reader(file_name + ".u32");
+    EXPECT_EQ(compact_reader.get_header().number_of_records,
+              reader.get_header().number_of_records);
+    EXPECT_EQ(compact_reader.get_header().reserved, reader.get_header().reserved);
+    if (f == 0) {
+      EXPECT_EQ(DataSetIndex(file_name + ".u32").get_records_per_block(), 64);
+    }
+    while (reader.next()) {
+      ASSERT_TRUE(compact_reader.next());
+      EXPECT_EQ(compact_reader.get_label()[0], reader.get_label()[0]);
+      EXPECT_EQ(compact_reader.get_dense()[0], reader.get_dense()[0]);
+      long long nnz = 0;
+      for (int k = 0; k < slot_num; k++) {
+        ASSERT_EQ(compact_reader.get_nnz()[k], reader.get_nnz()[k]);
+        nnz += reader.get_nnz()[k];
+      }
+      for (long long j = 0; j < nnz; j++) {
+        EXPECT_EQ(dictionary.get_key(compact_reader.get_keys()[j]), reader.get_keys()[j]);
+      }
+    }
+    EXPECT_FALSE(compact_reader.next());
+  }
+
+  // the keys of a new file are appended, the old ones keep their compact keys
+  dictionary.save("./key_dictionary_test.dict");
+  KeyDictionary loaded("./key_dictionary_test.dict");
+  ASSERT_EQ(loaded.size(), dictionary.size());
+  write_test_file("./key_dictionary_test_2.data", base + 10, records, DATA_SET_V2, 64);
+  EXPECT_EQ(loaded.add_keys({"./key_dictionary_test_2.data"}), 10u);
+  for (unsigned int c = 0; c < dictionary.size(); c++) {
+    EXPECT_EQ(loaded.get_key(c), dictionary.get_key(c));
+  }
+  EXPECT_THROW(compact_data_file(dictionary, "./key_dictionary_test_2.data",
+                                 "./key_dictionary_test_2.data.u32"),
+               internal_runtime_error);
+
+  // the two largest compact keys are the empty key of the hash table and the admission's
+  // default key, so a dictionary with more keys is rejected before its keys are read
+  std::ofstream out_stream("./key_dictionary_test_3.dict", std::ofstream::binary);
+  KeyDictionaryHeader header = {KEY_DICTIONARY_MAGIC,
+                                static_cast<long long>(KEY_DICTIONARY_MAX_KEYS) + 1, 0};
+  out_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out_stream.close();
+  EXPECT_THROW(KeyDictionary("./key_dictionary_test_3.dict"), internal_runtime_error);
+}
+
+TEST(key_dictionary, embedding_file_test) {
+  KeyDictionary dictionary;
+  const long long keys[] = {1LL << 50, 7, -3, 1LL << 33};
+  for (long long key : keys) {
+    dictionary.add(key);
+  }
+
+  // a model trained with long long keys, with a key which isn't in the data set
+  {
+    std::ofstream out_stream("./key_dictionary_test_embedding.bin", std::ofstream::binary);
+    for (long long key : {keys[2], 12345LL, keys[0], keys[3], keys[1]}) {
+      float value[embedding_vec_size] = {static_cast<float>(key % 100), 1.f, 2.f, 3.f};
+      out_stream.write(reinterpret_cast<const char*>(&key), sizeof(key));
+      out_stream.write(reinterpret_cast<const char*>(value), sizeof(value));
+    }
+  }
+  auto written_dropped =
+      compact_embedding_file(dictionary, "./key_dictionary_test_embedding.bin",
+                             "./key_dictionary_test_embedding.u32", embedding_vec_size);
+  EXPECT_EQ(written_dropped.first, 4);
+  EXPECT_EQ(written_dropped.second, 1);
+  {
+    std::ifstream in_stream("./key_dictionary_test_embedding.u32", std::ifstream::binary);
+    const unsigned int expected[] = {2, 0, 3, 1};
+    for (unsigned int compact_key : expected) {
+      unsigned int key;
+      float value[embedding_vec_size];
+      in_stream.read(reinterpret_cast<char*>(&key), sizeof(key));
+      in_stream.read(reinterpret_cast<char*>(value), sizeof(value));
+      ASSERT_TRUE(in_stream);
+      EXPECT_EQ(key, compact_key);
+      EXPECT_EQ(value[0], static_cast<float>(dictionary.get_key(key) % 100));
+      EXPECT_EQ(value[3], 3.f);
+    }
+    EXPECT_EQ(in_stream.peek(), EOF);
+  }
+
+  // and back to the original keys
+  EXPECT_EQ(expand_embedding_file(dictionary, "./key_dictionary_test_embedding.u32",
+                                  "./key_dictionary_test_embedding.i64", embedding_vec_size),
+            4);
+  {
+    std::ifstream in_stream("./key_dictionary_test_embedding.i64", std::ifstream::binary);
+    for (long long expected : {keys[2], keys[0], keys[3], keys[1]}) {
+      long long key;
+      float value[embedding_vec_size];
+      in_stream.read(reinterpret_cast<char*>(&key), sizeof(key));
+      in_stream.read(reinterpret_cast<char*>(value), sizeof(value));
+      ASSERT_TRUE(in_stream);
+      EXPECT_EQ(key, expected);
+      EXPECT_EQ(value[0], static_cast<float>(expected % 100));
+    }
+    EXPECT_EQ(in_stream.peek(), EOF);
+  }
+
+  // the size of the file must be a multiple of a pair
+  EXPECT_THROW(compact_embedding_file(dictionary, "./key_dictionary_test_embedding.bin",
+                                      "./key_dictionary_test_embedding.u32", 5),
+               internal_runtime_error);
+}
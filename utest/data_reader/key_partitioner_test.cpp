@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/key_partitioner.hpp"
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#include "HugeCTR/include/data_reader_multi_threads.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
+#include "HugeCTR/include/file_list.hpp"
+#include "HugeCTR/include/utils.hpp"
+#include "gtest/gtest.h"
+#include "utest/test_utils.h"
+
+using namespace HugeCTR;
+
+namespace {
+
+typedef long long T;
+const std::string file_list_name("key_partitioner_file_list.txt");
+const std::string prefix("./key_partitioner_test_data/temp_dataset_");
+const std::string table_name("./key_partitioner_test_data/table.bin");
+const int num_devices = 4;
+const int slot_num = 8;
+
+std::vector<long long> get_device_counts(const KeyPartitioner<T>& partitioner,
+                                         const std::vector<T>& keys) {
+  std::vector<long long> counts(partitioner.get_num_devices(), 0);
+  for (T key : keys) {
+    int device = partitioner.get_device(key);
+    EXPECT_GE(device, 0);
+    EXPECT_LT(device, partitioner.get_num_devices());
+    counts[device]++;
+  }
+  return counts;
+}
+
+}  // namespace
+
+TEST(key_partitioner, partitioners_test) {
+  ModuloKeyPartitioner<T> modulo(num_devices);
+  HashKeyPartitioner<T> hash(num_devices);
+  SlotAwareKeyPartitioner<T> slot_aware(num_devices, slot_num);
+  for (T key = 0; key < 1000; key++) {
+    EXPECT_EQ(modulo.get_device(key), key % num_devices);
+  }
+  EXPECT_THROW(ModuloKeyPartitioner<T>(0), internal_runtime_error);
+  EXPECT_THROW(SlotAwareKeyPartitioner<T>(num_devices, 0), internal_runtime_error);
+
+  // the keys of slot 0 are multiples of slot_num, all on device 0 with the modulo
+  std::vector<T> slot_keys;
+  for (T rank = 0; rank < 10000; rank++) {
+    slot_keys.push_back(rank * slot_num);
+  }
+  EXPECT_EQ(get_device_counts(modulo, slot_keys)[0], 10000);
+  EXPECT_DOUBLE_EQ(KeyLoad::get_imbalance(get_device_counts(slot_aware, slot_keys)), 1.0);
+  EXPECT_LT(KeyLoad::get_imbalance(get_device_counts(hash, slot_keys)), 1.05);
+  // each slot starts from a different device
+  EXPECT_NE(slot_aware.get_device(0), slot_aware.get_device(1));
+}
+
+TEST(key_partitioner, frequency_table_test) {
+  check_make_dir("./key_partitioner_test_data");
+  // key k occurs 1000 / (k + 1) times, the hot keys are all on device 0 with the modulo
+  std::unordered_map<T, long long> key_counts;
+  std::vector<T> keys;
+  for (T k = 0; k < 1000; k++) {
+    T key = k * num_devices;
+    key_counts[key] = 1000 / (k + 1);
+    keys.insert(keys.end(), key_counts[key], key);
+  }
+  std::vector<std::pair<T, int>> table = build_key_partition_table(key_counts, num_devices, 100);
+  ASSERT_EQ(table.size(), 100u);
+  // the most frequent key goes first
+  EXPECT_EQ(table[0].first, 0);
+  FrequencyKeyPartitioner<T> frequency(num_devices, table);
+  EXPECT_EQ(frequency.get_table_size(), 100u);
+  const double frequency_imbalance = KeyLoad::get_imbalance(get_device_counts(frequency, keys));
+  EXPECT_LT(frequency_imbalance, 1.25);
+  EXPECT_LT(frequency_imbalance,
+            KeyLoad::get_imbalance(get_device_counts(HashKeyPartitioner<T>(num_devices), keys)));
+  EXPECT_DOUBLE_EQ(
+      KeyLoad::get_imbalance(get_device_counts(ModuloKeyPartitioner<T>(num_devices), keys)),
+      num_devices);
+
+  // the table is read back the same, for the same number of devices only
+  write_key_partition_table(table_name, num_devices, table);
+  auto read_partitioner =
+      create_key_partitioner<T>(KeyPartitioner_t::Frequency, num_devices, slot_num, table_name);
+  for (T key : keys) {
+    ASSERT_EQ(read_partitioner->get_device(key), frequency.get_device(key));
+  }
+  EXPECT_THROW(read_key_partition_table<T>(table_name, num_devices + 1), internal_runtime_error);
+  EXPECT_THROW(create_key_partitioner<T>(KeyPartitioner_t::Frequency, num_devices, slot_num),
+               internal_runtime_error);
+  EXPECT_THROW(FrequencyKeyPartitioner<T>(num_devices, {{1, num_devices}}),
+               internal_runtime_error);
+}
+
+TEST(key_partitioner, reader_routing_test) {
+  check_make_dir("./key_partitioner_test_data");
+  const int num_records = 1024;
+  {
+    std::ofstream file_list_stream(file_list_name);
+    file_list_stream << 1 << "\n" << prefix << "0.data\n";
+    DataSetWriter<T> writer(prefix + "0.data", 1, slot_num);
+    for (int i = 0; i < num_records; i++) {
+      int label = i;
+      int nnz[slot_num];
+      std::vector<T> keys;
+      for (int k = 0; k < slot_num; k++) {
+        nnz[k] = 1 + (i + k) % 3;
+        for (int j = 0; j < nnz[k]; j++) {
+          keys.push_back((i * 3 + j) * slot_num + k);
+        }
+      }
+      writer.write_record(&label, nnz, keys.data());
+    }
+  }
+
+  auto partitioner =
+      create_key_partitioner<T>(KeyPartitioner_t::SlotAware, num_devices, slot_num);
+  FileList file_list(file_list_name);
+  const int batchsize = 256;
+  CSRChunk<T> chunk(num_devices, batchsize, 1, slot_num, 3 * batchsize * slot_num);
+  ChunkRing<CSRChunk<T>> heap(1, chunk);
+  DataReaderMultiThreads<T> reader(heap, file_list, 3, ReaderMode_t::Stream, 0, 0,
+                                   ASYNC_READ_DEFAULT_QUEUE_DEPTH, partitioner);
+  std::vector<long long> lookups(num_devices, 0);
+  for (int iter = 0; iter < num_records / batchsize; iter++) {
+    reader.read_a_batch();
+    unsigned int key = 0;
+    CSRChunk<T>* chunk_tmp = nullptr;
+    heap.data_chunk_checkout(&chunk_tmp, &key);
+    for (int i = 0; i < num_devices; i++) {
+      const CSR<T>* csr = chunk_tmp->get_csr_buffers()[i];
+      for (int j = 0; j < csr->get_sizeof_value(); j++) {
+        ASSERT_EQ(partitioner->get_device(csr->get_value()[j]), i);
+      }
+      lookups[i] += csr->get_sizeof_value();
+    }
+    heap.chunk_free_and_checkin(key);
+  }
+
+  // the lookups measured are the same as the reader's
+  std::vector<std::shared_ptr<const KeyPartitioner<T>>> partitioners = {partitioner};
+  std::vector<KeyLoad> loads = measure_key_load(partitioners, {prefix + "0.data"}, batchsize);
+  ASSERT_EQ(loads.size(), 1u);
+  EXPECT_EQ(loads[0].batches, num_records / batchsize);
+  for (int i = 0; i < num_devices; i++) {
+    EXPECT_EQ(loads[0].lookups[i], lookups[i]);
+  }
+  EXPECT_LT(loads[0].get_lookup_imbalance(), 1.05);
+}
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/reader_position.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include "HugeCTR/include/data_reader_multi_threads.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
+#include "HugeCTR/include/file_list.hpp"
+#include "HugeCTR/include/utils.hpp"
+#include "gtest/gtest.h"
+#include "utest/test_utils.h"
+
+using namespace HugeCTR;
+
+namespace {
+
+typedef long long T;
+const std::string file_list_name("reader_position_file_list.txt");
+const std::string prefix("./reader_position_test_data/temp_dataset_");
+const int num_files = 5;
+const int slot_num = 3;
+const int batchsize = 64;
+const int max_nnz = 4;
+
+/**
+ * The label of record i of file f is f * 10000 + i, the nnz of slot k is (i + k) % 3 + 1,
+ * so that a sample read can be told by its label. Files have different sizes, the odd ones
+ * are v2, and file 3 is compressed if a codec is available.
+ */
+void write_test_files() {
+  check_make_dir("./reader_position_test_data");
+  std::ofstream file_list_stream(file_list_name);
+  file_list_stream << num_files << std::endl;
+  int codec = DATA_SET_CODEC_NONE;
+  for (int c : {DATA_SET_CODEC_ZSTD, DATA_SET_CODEC_LZ4}) {
+    if (is_codec_available(c)) {
+      codec = c;
+    }
+  }
+  for (int f = 0; f < num_files; f++) {
+    std::string file_name = prefix + std::to_string(f) + ".data";
+    file_list_stream << file_name << std::endl;
+    DataSetWriter<T> writer(file_name, 1, slot_num, f % 2 ? DATA_SET_V2 : DATA_SET_V1, 50,
+                            f == 3 ? codec : DATA_SET_CODEC_NONE);
+    for (int i = 0; i < 300 + f * 37; i++) {
+      int label = f * 10000 + i;
+      int nnz[slot_num];
+      std::vector<T> keys;
+      for (int k = 0; k < slot_num; k++) {
+        nnz[k] = (i + k) % 3 + 1;
+        keys.insert(keys.end(), nnz[k], label * 10 + k);
+      }
+      writer.write_record(&label, nnz, keys.data());
+    }
+  }
+}
+
+/**
+ * Check the keys of the samples in a chunk, and collect their labels.
+ */
+void collect_samples(CSRChunk<T>& chunk, std::vector<int>* labels) {
+  const CSR<T>* csr = chunk.get_csr_buffers()[0];
+  const float* label_buffer = chunk.get_label_buffers()[0];
+  for (int i = 0; i < chunk.get_num_samples(); i++) {
+    int label = static_cast<int>(label_buffer[i]);
+    int record = label % 10000;
+    for (int k = 0; k < slot_num; k++) {
+      int row = i * slot_num + k;
+      const T* row_offset = csr->get_row_offset();
+      ASSERT_EQ(row_offset[row + 1] - row_offset[row], (record + k) % 3 + 1);
+      ASSERT_EQ(csr->get_value()[row_offset[row]], static_cast<T>(label) * 10 + k);
+    }
+    labels->push_back(label);
+  }
+}
+
+/**
+ * Read an epoch with two reading threads, and stop after max_batches batches are consumed,
+ * while the threads may have read some batches ahead.
+ * @param labels the labels of the samples consumed are appended.
+ * @param shuffle_buffer_size the shuffle buffer of each thread.
+ * @return the position after the batches consumed.
+ */
+ReaderPosition read_epoch(ReaderMode_t reader_mode, long long records_per_range,
+                          const ReaderPosition* start_position, int max_batches,
+                          std::vector<int>* labels, int shuffle_buffer_size = 0) {
+  FileList file_list(file_list_name, true, 7, false, records_per_range);
+  ReaderPosition position(num_files);
+  if (start_position != nullptr) {
+    position = *start_position;
+    file_list.set_position(position);
+  }
+  CSRChunk<T> chunk(1, batchsize, 1, slot_num, max_nnz * batchsize * slot_num);
+  ChunkRing<CSRChunk<T>> csr_heap(4, chunk);
+  const int num_threads = 2;
+  std::vector<DataReaderMultiThreads<T>*> data_readers;
+  std::vector<std::thread> threads;
+  std::atomic<bool> loop_flag{true};
+  for (int i = 0; i < num_threads; i++) {
+    data_readers.push_back(new DataReaderMultiThreads<T>(csr_heap, file_list, max_nnz,
+                                                         reader_mode, shuffle_buffer_size, i));
+    threads.emplace_back([&loop_flag](DataReaderMultiThreads<T>* data_reader) {
+      while (loop_flag) {
+        data_reader->read_a_batch();
+      }
+    }, data_readers.back());
+  }
+  int finished = 0;
+  int num_batches = 0;
+  while (finished < num_threads && num_batches < max_batches) {
+    unsigned int key = 0;
+    CSRChunk<T>* chunk_tmp = nullptr;
+    csr_heap.data_chunk_checkout(&chunk_tmp, &key);
+    for (auto& progress : chunk_tmp->get_progress()) {
+      position.update(progress);
+    }
+    if (chunk_tmp->get_num_samples() == 0) {
+      finished++;
+    } else {
+      collect_samples(*chunk_tmp, labels);
+      num_batches++;
+    }
+    csr_heap.chunk_free_and_checkin(key);
+  }
+  loop_flag = false;
+  for (auto data_reader : data_readers) {
+    data_reader->skip_read();
+  }
+  csr_heap.break_and_return();
+  file_list.break_waiting();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto data_reader : data_readers) {
+    delete data_reader;
+  }
+  return position;
+}
+
+}  // namespace
+
+TEST(reader_position, update_test) {
+  ReaderPosition position(4);
+  EXPECT_TRUE(position.empty());
+  position.update({1, 100, false});
+  position.update({0, 50, false});
+  EXPECT_EQ(position.get_start_record(0), 50);
+  EXPECT_EQ(position.get_start_record(1), 100);
+  EXPECT_EQ(position.get_start_record(2), 0);
+  position.update({2, 300, true});
+  EXPECT_EQ(position.get_first_sequence(), 0);
+  EXPECT_EQ(position.get_start_record(2), READER_POSITION_FINISHED);
+  position.update({0, 200, true});
+  EXPECT_EQ(position.get_first_sequence(), 1);
+  position.update({1, 300, true});
+  EXPECT_EQ(position.get_first_sequence(), 3);
+  EXPECT_EQ(position.get_start_record(1), READER_POSITION_FINISHED);
+  position.update({5, 10, false});
+  position.update({3, 400, true});
+  EXPECT_EQ(position.get_first_sequence(), 4);
+  EXPECT_EQ(position.get_epoch(), 1);
+
+  position.save("reader_position_update_test.reader");
+  ReaderPosition loaded;
+  loaded.load("reader_position_update_test.reader");
+  EXPECT_EQ(loaded.get_num_files(), 4);
+  EXPECT_EQ(loaded.get_first_sequence(), 4);
+  for (long long sequence = 0; sequence < 8; sequence++) {
+    EXPECT_EQ(loaded.get_start_record(sequence), position.get_start_record(sequence));
+  }
+}
+
+TEST(reader_position, ranges_test) {
+  typedef std::vector<std::pair<long long, long long>> Ranges;
+  ReaderPosition position(4);
+  position.update({0, 200, false, 100});
+  position.update({0, 50, false, 0});
+  EXPECT_EQ(position.get_start_record(0), 50);
+  EXPECT_EQ(position.get_unread_ranges(0), Ranges({{50, 100}, {200, -1}}));
+  // the end of the file is known once a range reaches it
+  position.update({0, 400, true, 300});
+  EXPECT_EQ(position.get_unread_ranges(0), Ranges({{50, 100}, {200, 300}}));
+  position.update({0, 300, false, 200});
+  position.update({0, 100, false, 50});
+  EXPECT_TRUE(position.get_unread_ranges(0).empty());
+  EXPECT_EQ(position.get_first_sequence(), 1);
+
+  position.update({1, 64, false, 0});
+  position.update({1, 500, false, 128});
+  position.save("reader_position_ranges_test.reader");
+  ReaderPosition loaded;
+  loaded.load("reader_position_ranges_test.reader");
+  EXPECT_EQ(loaded.get_first_sequence(), 1);
+  EXPECT_EQ(loaded.get_unread_ranges(1), Ranges({{64, 128}, {500, -1}}));
+  EXPECT_EQ(loaded.get_unread_ranges(2), Ranges({{0, -1}}));
+
+  // the files of version 1
+  {
+    std::ofstream out_stream("reader_position_v1_test.reader");
+    out_stream << "hugectr_reader_position 1\nnum_files 4\nfirst_sequence 2\nfiles 2\n"
+               << "2 4096\n4 -1\n";
+  }
+  loaded.load("reader_position_v1_test.reader");
+  EXPECT_EQ(loaded.get_unread_ranges(1), Ranges());
+  EXPECT_EQ(loaded.get_unread_ranges(2), Ranges({{4096, -1}}));
+  EXPECT_EQ(loaded.get_unread_ranges(3), Ranges({{0, -1}}));
+  EXPECT_EQ(loaded.get_start_record(4), READER_POSITION_FINISHED);
+}
+
+TEST(reader_position, file_list_test) {
+  write_test_files();
+  FileList reference(file_list_name, true, 3);
+  std::vector<std::string> names;
+  for (int i = 0; i < 3 * num_files; i++) {
+    long long sequence = -1;
+    names.push_back(reference.get_a_file(&sequence));
+    EXPECT_EQ(sequence, i);
+  }
+
+  ReaderPosition position(num_files);
+  for (long long sequence = 0; sequence < 7; sequence++) {
+    position.update({sequence, 1, true});
+  }
+  position.update({7, 25, false});
+  position.update({9, 1, true});
+  FileList file_list(file_list_name, true, 3);
+  file_list.set_position(position);
+  EXPECT_EQ(file_list.get_epoch(), 1);
+  long long sequence = -1;
+  long long start_record = -1;
+  EXPECT_EQ(file_list.get_a_file(&sequence, &start_record), names[7]);
+  EXPECT_EQ(sequence, 7);
+  EXPECT_EQ(start_record, 25);
+  EXPECT_EQ(file_list.get_a_file(&sequence, &start_record), names[8]);
+  EXPECT_EQ(start_record, 0);
+  // 9 is finished
+  EXPECT_EQ(file_list.get_a_file(&sequence, &start_record), names[10]);
+  EXPECT_EQ(sequence, 10);
+
+  EXPECT_THROW(FileList(file_list_name).set_position(ReaderPosition(num_files + 1)),
+               internal_runtime_error);
+}
+
+TEST(reader_position, record_index_test) {
+  write_test_files();
+  const std::string file_name = prefix + "0.data";
+  std::ifstream in_stream(file_name, std::ifstream::binary);
+  DataSetHeader header;
+  in_stream.read(reinterpret_cast<char*>(&header), sizeof(DataSetHeader));
+  // offsets of all the records
+  std::vector<long long> offsets;
+  long long offset = sizeof(DataSetHeader);
+  for (long long i = 0; i < header.number_of_records; i++) {
+    offsets.push_back(offset);
+    offset += sizeof(int);
+    for (int k = 0; k < slot_num; k++) {
+      offset += sizeof(int) + sizeof(T) * ((i + k) % 3 + 1);
+    }
+  }
+
+  std::remove(get_record_index_file_name(file_name).c_str());
+  long long found_offset = 0, records_to_skip = 0;
+  find_record_offset(file_name, header, 123, &found_offset, &records_to_skip);
+  EXPECT_EQ(found_offset, static_cast<long long>(sizeof(DataSetHeader)));
+  EXPECT_EQ(records_to_skip, 123);
+
+  EXPECT_EQ(build_record_index<T>(file_name, 16), header.number_of_records);
+  RecordIndex index(file_name);
+  EXPECT_EQ(index.get_header().stride, 16);
+  for (long long i = 0; i < header.number_of_records; i++) {
+    find_record_offset(file_name, header, i, &found_offset, &records_to_skip);
+    EXPECT_EQ(found_offset, offsets[i - i % 16]);
+    EXPECT_EQ(records_to_skip, i % 16);
+  }
+  EXPECT_THROW(index.find(header.number_of_records, &found_offset, &records_to_skip),
+               internal_runtime_error);
+
+  // v2 files are found with the block index
+  const std::string v2_file_name = prefix + "1.data";
+  DataSetIndex v2_index(v2_file_name);
+  find_record_offset(v2_file_name, v2_index.get_header(), 123, &found_offset, &records_to_skip);
+  EXPECT_EQ(found_offset, v2_index.get_block(2).offset);
+  EXPECT_EQ(records_to_skip, 23);
+}
+
+TEST(reader_position, resume_test) {
+  test::mpi_init();
+  write_test_files();
+  for (int f = 0; f < num_files; f += 2) {
+    build_record_index<T>(prefix + std::to_string(f) + ".data", 32);
+  }
+  std::vector<int> expected;
+  read_epoch(ReaderMode_t::Stream, 0, nullptr, 1 << 30, &expected);
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(expected.size(), 5u * 300 + 37 * 10);
+
+  for (ReaderMode_t reader_mode :
+       {ReaderMode_t::Stream, ReaderMode_t::Mmap, ReaderMode_t::Direct}) {
+    // the files are split to ranges read in parallel with 64
+    for (long long records_per_range : {0, 64}) {
+      for (int stop_at : {0, 1, 5, 13, 20}) {
+        std::vector<int> labels;
+        ReaderPosition position =
+            read_epoch(reader_mode, records_per_range, nullptr, stop_at, &labels);
+        // as if the training is restarted from a snapshot
+        position.save("reader_position_resume_test.reader");
+        ReaderPosition loaded;
+        loaded.load("reader_position_resume_test.reader");
+        read_epoch(reader_mode, records_per_range, &loaded, 1 << 30, &labels);
+        // each sample is read exactly once
+        std::sort(labels.begin(), labels.end());
+        EXPECT_EQ(labels, expected) << "records_per_range " << records_per_range << ", stop_at "
+                                    << stop_at;
+      }
+    }
+  }
+}
+
+TEST(reader_position, shuffle_buffer_resume_test) {
+  test::mpi_init();
+  write_test_files();
+  std::vector<int> expected;
+  read_epoch(ReaderMode_t::Stream, 0, nullptr, 1 << 30, &expected);
+  std::sort(expected.begin(), expected.end());
+
+  const int shuffle_buffer_size = 100;
+  for (long long records_per_range : {0, 64}) {
+    for (int stop_at : {0, 1, 5, 13, 20}) {
+      std::vector<int> labels;
+      ReaderPosition position = read_epoch(ReaderMode_t::Stream, records_per_range, nullptr,
+                                           stop_at, &labels, shuffle_buffer_size);
+      read_epoch(ReaderMode_t::Stream, records_per_range, &position, 1 << 30, &labels,
+                 shuffle_buffer_size);
+      // the samples left in the buffers are read again, and each sample is read exactly once
+      std::sort(labels.begin(), labels.end());
+      EXPECT_EQ(labels, expected) << "records_per_range " << records_per_range << ", stop_at "
+                                  << stop_at;
+    }
+  }
+}
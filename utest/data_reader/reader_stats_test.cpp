@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/reader_stats.hpp"
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "HugeCTR/include/data_reader_multi_threads.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
+#include "HugeCTR/include/file_list.hpp"
+#include "HugeCTR/include/utils.hpp"
+#include "gtest/gtest.h"
+#include "utest/test_utils.h"
+
+using namespace HugeCTR;
+
+namespace {
+
+typedef long long T;
+const std::string file_list_name("reader_stats_file_list.txt");
+const std::string prefix("./reader_stats_test_data/temp_dataset_");
+const int num_files = 3;
+const int num_records = 500;
+const int slot_num = 2;
+const int batchsize = 32;
+
+}  // namespace
+
+TEST(reader_stats, latency_histogram_test) {
+  EXPECT_EQ(LatencyHistogram::get_bucket(0), 0);
+  EXPECT_EQ(LatencyHistogram::get_bucket(1), 1);
+  EXPECT_EQ(LatencyHistogram::get_bucket(3), 2);
+  EXPECT_EQ(LatencyHistogram::get_bucket(4), 3);
+  EXPECT_EQ(LatencyHistogram::get_bucket(1LL << 40), LATENCY_HISTOGRAM_BUCKETS - 1);
+
+  LatencyHistogram histogram;
+  LatencyStats empty;
+  histogram.add_to(&empty);
+  EXPECT_EQ(empty.count, 0);
+  EXPECT_EQ(empty.get_percentile_us(0.5), 0);
+  EXPECT_EQ(empty.get_mean_us(), 0.0);
+
+  // 90 latencies of 10us and 10 of 1000us
+  for (int i = 0; i < 90; i++) {
+    histogram.record(10);
+  }
+  LatencyStats first;
+  histogram.add_to(&first);
+  for (int i = 0; i < 10; i++) {
+    histogram.record(1000);
+  }
+  LatencyStats second;
+  histogram.add_to(&second);
+  EXPECT_EQ(second.count, 100);
+  EXPECT_EQ(second.total_us, 90 * 10 + 10 * 1000);
+  EXPECT_DOUBLE_EQ(second.get_mean_us(), 109.0);
+  EXPECT_EQ(second.get_percentile_us(0.5), 16);
+  EXPECT_EQ(second.get_percentile_us(0.9), 16);
+  EXPECT_EQ(second.get_percentile_us(0.99), 1024);
+
+  LatencyStats between = second.since(first);
+  EXPECT_EQ(between.count, 10);
+  EXPECT_EQ(between.total_us, 10000);
+  EXPECT_EQ(between.get_percentile_us(0.5), 1024);
+
+  between.merge(first);
+  EXPECT_EQ(between.count, second.count);
+  EXPECT_EQ(between.total_us, second.total_us);
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    EXPECT_EQ(between.buckets[i], second.buckets[i]);
+  }
+}
+
+TEST(reader_stats, concurrent_record_test) {
+  LatencyHistogram histogram;
+  const int num_threads = 4;
+  const int num_records_per_thread = 100000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&histogram, t]() {
+      for (int i = 0; i < num_records_per_thread; i++) {
+        histogram.record(t + 1);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LatencyStats stats;
+  histogram.add_to(&stats);
+  EXPECT_EQ(stats.count, num_threads * num_records_per_thread);
+  EXPECT_EQ(stats.total_us, (1 + 2 + 3 + 4) * num_records_per_thread);
+  EXPECT_EQ(stats.buckets[1], num_records_per_thread);
+  EXPECT_EQ(stats.buckets[2], 2 * num_records_per_thread);
+  EXPECT_EQ(stats.buckets[3], num_records_per_thread);
+}
+
+TEST(reader_stats, reader_counters_test) {
+  check_make_dir("./reader_stats_test_data");
+  long long file_bytes = 0;
+  {
+    std::ofstream file_list_stream(file_list_name);
+    file_list_stream << num_files << std::endl;
+    for (int f = 0; f < num_files; f++) {
+      std::string file_name = prefix + std::to_string(f) + ".data";
+      file_list_stream << file_name << std::endl;
+      {
+        DataSetWriter<T> writer(file_name, 1, slot_num);
+        for (int i = 0; i < num_records; i++) {
+          int label = i;
+          int nnz[slot_num] = {1, 2};
+          T keys[3] = {i, i + 1, i + 2};
+          writer.write_record(&label, nnz, keys);
+        }
+      }
+      std::ifstream stream(file_name, std::ifstream::binary | std::ifstream::ate);
+      file_bytes += stream.tellg();
+    }
+  }
+
+  FileList file_list(file_list_name, false, 0, false);
+  CSRChunk<T> chunk(1, batchsize, 1, slot_num, 2 * batchsize * slot_num);
+  ChunkRing<CSRChunk<T>> csr_heap(2, chunk);
+  DataReaderMultiThreads<T> data_reader(csr_heap, file_list, 2);
+  std::atomic<bool> loop_flag{true};
+  std::thread thread([&data_reader, &loop_flag]() {
+    while (loop_flag) {
+      data_reader.read_a_batch();
+    }
+  });
+  long long num_samples = 0;
+  int num_chunks = 0;
+  for (;;) {
+    unsigned int key = 0;
+    CSRChunk<T>* chunk_tmp = nullptr;
+    csr_heap.data_chunk_checkout(&chunk_tmp, &key);
+    num_chunks++;
+    num_samples += chunk_tmp->get_num_samples();
+    bool end = chunk_tmp->get_num_samples() == 0;
+    csr_heap.chunk_free_and_checkin(key);
+    if (end) {
+      break;
+    }
+  }
+  // the thread is waiting for the next epoch
+  loop_flag = false;
+  data_reader.skip_read();
+  csr_heap.break_and_return();
+  file_list.break_waiting();
+  thread.join();
+
+  DataReaderStats stats;
+  data_reader.add_stats_to(&stats);
+  EXPECT_EQ(num_samples, num_files * num_records);
+  EXPECT_EQ(stats.records_decoded, num_samples);
+  EXPECT_GT(stats.bytes_read, 0);
+  EXPECT_LE(stats.bytes_read, file_bytes);
+  EXPECT_EQ(stats.free_chunk_wait.count, num_chunks);
+  EXPECT_EQ(stats.bytes_read, data_reader.get_bytes_read());
+
+  DataReaderStats later = stats;
+  later.records_decoded += 100;
+  later.bytes_read += 1000000;
+  DataReaderStats between = later.since(stats);
+  EXPECT_EQ(between.records_decoded, 100);
+  EXPECT_EQ(between.bytes_read, 1000000);
+  EXPECT_EQ(between.free_chunk_wait.count, 0);
+  EXPECT_NE(between.to_string(1.0).find("1.0 MB/s, 100 records/s"), std::string::npos);
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/record_range.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include "HugeCTR/include/data_reader_multi_threads.hpp"
+#include "HugeCTR/include/data_set_format.hpp"
+#include "HugeCTR/include/file_list.hpp"
+#include "HugeCTR/include/utils.hpp"
+#include "gtest/gtest.h"
+#include "utest/test_utils.h"
+
+using namespace HugeCTR;
+
+namespace {
+
+typedef long long T;
+const std::string file_list_name("record_range_file_list.txt");
+const std::string large_file_list_name("record_range_large_file_list.txt");
+const std::string prefix("./record_range_test_data/temp_dataset_");
+const int slot_num = 2;
+const int max_nnz = 2;
+const int records_per_block = 100;
+/**
+ * A large v2 file, a v1 file with a record index, a v1 file without, and a small v2 file.
+ */
+const int num_records[] = {20000, 3000, 1000, 150};
+const int num_files = 4;
+
+void write_test_files() {
+  check_make_dir("./record_range_test_data");
+  std::ofstream file_list_stream(file_list_name);
+  file_list_stream << num_files << std::endl;
+  for (int f = 0; f < num_files; f++) {
+    std::string file_name = prefix + std::to_string(f) + ".data";
+    file_list_stream << file_name << std::endl;
+    DataSetWriter<T> writer(file_name, 1, slot_num, f == 1 || f == 2 ? DATA_SET_V1 : DATA_SET_V2,
+                            records_per_block);
+    for (int i = 0; i < num_records[f]; i++) {
+      int label = f * 100000 + i;
+      int nnz[slot_num] = {1, 2};
+      T keys[3] = {label, label, label};
+      writer.write_record(&label, nnz, keys);
+    }
+  }
+  std::ofstream large_file_list_stream(large_file_list_name);
+  large_file_list_stream << 1 << std::endl << prefix + "0.data" << std::endl;
+  build_record_index<T>(prefix + "1.data", 64);
+  std::remove(get_record_index_file_name(prefix + "2.data").c_str());
+}
+
+/**
+ * Read an epoch with 4 threads, without splitting the files beforehand.
+ * @param labels the labels of the samples read are appended.
+ * @param bytes_read the bytes read by each thread are passed out.
+ */
+void read_epoch(const std::string& list_name, std::vector<int>* labels,
+                std::vector<long long>* bytes_read) {
+  FileList file_list(list_name, false, 0, false, 1LL << 40);
+  const int batchsize = 64;
+  CSRChunk<T> chunk(1, batchsize, 1, slot_num, max_nnz * batchsize * slot_num);
+  ChunkRing<CSRChunk<T>> csr_heap(4, chunk);
+  const int num_threads = 4;
+  std::vector<DataReaderMultiThreads<T>*> data_readers;
+  std::vector<std::thread> threads;
+  std::atomic<bool> loop_flag{true};
+  for (int i = 0; i < num_threads; i++) {
+    data_readers.push_back(new DataReaderMultiThreads<T>(csr_heap, file_list, max_nnz));
+    threads.emplace_back([&loop_flag](DataReaderMultiThreads<T>* data_reader) {
+      while (loop_flag) {
+        data_reader->read_a_batch();
+      }
+    }, data_readers.back());
+  }
+  ReaderPosition position(file_list.get_num_files());
+  int finished = 0;
+  while (finished < num_threads) {
+    unsigned int key = 0;
+    CSRChunk<T>* chunk_tmp = nullptr;
+    csr_heap.data_chunk_checkout(&chunk_tmp, &key);
+    for (auto& progress : chunk_tmp->get_progress()) {
+      position.update(progress);
+    }
+    if (chunk_tmp->get_num_samples() == 0) {
+      finished++;
+    }
+    const float* label_buffer = chunk_tmp->get_label_buffers()[0];
+    for (int i = 0; i < chunk_tmp->get_num_samples(); i++) {
+      labels->push_back(static_cast<int>(label_buffer[i]));
+    }
+    csr_heap.chunk_free_and_checkin(key);
+  }
+  loop_flag = false;
+  for (auto data_reader : data_readers) {
+    data_reader->skip_read();
+  }
+  csr_heap.break_and_return();
+  file_list.break_waiting();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // the ranges read cover the files
+  EXPECT_EQ(position.get_first_sequence(), file_list.get_num_files());
+  bytes_read->clear();
+  for (auto data_reader : data_readers) {
+    bytes_read->push_back(data_reader->get_bytes_read());
+    delete data_reader;
+  }
+}
+
+}  // namespace
+
+TEST(record_range, read_file_list_test) {
+  const std::string list_name("record_range_read_file_list.txt");
+  {
+    std::ofstream list_stream(list_name);
+    list_stream << 2 << std::endl << "a.data" << std::endl << "b.data" << std::endl;
+  }
+  std::vector<std::string> file_names = read_file_list(list_name);
+  ASSERT_EQ(file_names.size(), 2u);
+  EXPECT_EQ(file_names[0], "a.data");
+  EXPECT_EQ(file_names[1], "b.data");
+  {
+    std::ofstream list_stream(list_name);
+    list_stream << 3 << std::endl << "a.data" << std::endl;
+  }
+  EXPECT_THROW(read_file_list(list_name), internal_runtime_error);
+  {
+    std::ofstream list_stream(list_name);
+    list_stream << 0 << std::endl;
+  }
+  EXPECT_THROW(read_file_list(list_name), internal_runtime_error);
+  EXPECT_THROW(read_file_list("record_range_no_such_list.txt"), internal_runtime_error);
+}
+
+TEST(record_range, claim_split_test) {
+  RecordRange range("a.data", 3, 100, 1124, 32);
+  long long claimed_end = 0;
+  ASSERT_TRUE(range.claim(100, &claimed_end));
+  EXPECT_EQ(claimed_end, 100 + RECORD_RANGE_CLAIM_SIZE);
+  EXPECT_EQ(range.get_unclaimed(), 1124 - claimed_end);
+  // the records claimed are kept, the split point is a multiple of the stride
+  long long begin = 0, end = 0;
+  ASSERT_TRUE(range.split(&begin, &end));
+  EXPECT_EQ(begin % 32, 0);
+  EXPECT_GE(begin, claimed_end + 32);
+  EXPECT_EQ(end, 1124);
+  long long record = claimed_end;
+  while (range.claim(record, &claimed_end)) {
+    EXPECT_LE(claimed_end, begin);
+    record = claimed_end;
+  }
+  EXPECT_EQ(record, begin);
+
+  // too small to share
+  RecordRange small_range("a.data", 3, 0, 100, 32);
+  ASSERT_TRUE(small_range.claim(0, &claimed_end));
+  EXPECT_FALSE(small_range.split(&begin, &end));
+  // the end of the file isn't known
+  RecordRange open_range("a.data", 3, 0, -1, 32);
+  EXPECT_FALSE(open_range.split(&begin, &end));
+  EXPECT_TRUE(open_range.claim(1000000, &claimed_end));
+}
+
+TEST(record_range, file_list_split_test) {
+  write_test_files();
+  const long long records_per_range = 1000;
+  FileList file_list(file_list_name, false, 0, false, records_per_range);
+  std::vector<std::vector<std::pair<long long, long long>>> ranges(num_files);
+  std::shared_ptr<RecordRange> range;
+  while (file_list.get_a_range(&range)) {
+    // claim all the records, so that nothing is left to steal
+    long long end = range->get_begin();
+    while (range->claim(end, &end)) {
+    }
+    ranges[range->get_sequence()].emplace_back(range->get_begin(), end);
+  }
+  // the files are partitioned, the ones which can't be seeked are not split
+  const long long expected_stride[] = {records_per_block, 64, 0, records_per_block};
+  for (int f = 0; f < num_files; f++) {
+    long long begin = 0;
+    for (auto& r : ranges[f]) {
+      EXPECT_EQ(r.first, begin);
+      EXPECT_LE(r.second - r.first, records_per_range + expected_stride[f]);
+      begin = r.second;
+    }
+    EXPECT_EQ(begin, num_records[f]);
+  }
+  EXPECT_EQ(ranges[0].size(), 20u);
+  EXPECT_EQ(ranges[2].size(), 1u);
+  EXPECT_EQ(ranges[3].size(), 1u);
+}
+
+TEST(record_range, active_ranges_test) {
+  write_test_files();
+  // the ranges finished by their readers are dropped
+  for (bool repeat : {false, true}) {
+    FileList file_list(file_list_name, false, 0, repeat, 1000);
+    std::shared_ptr<RecordRange> range;
+    for (int i = 0; i < 100 && file_list.get_a_range(&range); i++) {
+      EXPECT_LE(file_list.get_num_active_ranges(), 1u);
+    }
+  }
+  // the ranges are only stolen from in epoch mode
+  FileList repeat_list(file_list_name, false, 0, true, 1000);
+  std::vector<std::shared_ptr<RecordRange>> ranges(10);
+  for (auto& range : ranges) {
+    ASSERT_TRUE(repeat_list.get_a_range(&range));
+  }
+  EXPECT_EQ(repeat_list.get_num_active_ranges(), 0u);
+}
+
+TEST(record_range, work_stealing_test) {
+  test::mpi_init();
+  write_test_files();
+  std::vector<int> expected;
+  for (int f = 0; f < num_files; f++) {
+    for (int i = 0; i < num_records[f]; i++) {
+      expected.push_back(f * 100000 + i);
+    }
+  }
+  std::vector<int> labels;
+  std::vector<long long> bytes_read;
+  // the files are handed out as a whole, the idle threads steal from the large one
+  read_epoch(file_list_name, &labels, &bytes_read);
+  std::sort(labels.begin(), labels.end());
+  EXPECT_EQ(labels, expected);
+
+  // a single file is read by all the threads
+  labels.clear();
+  read_epoch(large_file_list_name, &labels, &bytes_read);
+  std::sort(labels.begin(), labels.end());
+  EXPECT_EQ(labels, std::vector<int>(expected.begin(), expected.begin() + num_records[0]));
+  for (long long bytes : bytes_read) {
+    EXPECT_GT(bytes, 0);
+  }
+}
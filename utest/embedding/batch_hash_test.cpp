@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/hashtable/batch_hash_functions.hpp"
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+/**
+ * Every instruction set supported by the CPU gives the hashes of MurmurHash3_32, for lengths
+ * which aren't multiples of the SIMD width.
+ */
+template <typename Key>
+void batch_hash_test() {
+  std::mt19937_64 generator(0);
+  std::vector<Key> keys(1000);
+  for (auto& key : keys) {
+    key = static_cast<Key>(generator());
+  }
+  keys[0] = 0;
+  keys[1] = static_cast<Key>(-1);
+  const MurmurHash3_32<Key> hasher;
+  for (auto isa : {nv::HashIsa::Scalar, nv::HashIsa::AVX2, nv::HashIsa::AVX512}) {
+    if (!nv::is_hash_isa_supported(isa)) {
+      continue;
+    }
+    for (size_t len : {0, 1, 7, 15, 16, 17, 33, 1000}) {
+      std::vector<hash_value_type> hashes(len + 1, 12345);
+      nv::batch_murmur_hash3_32(keys.data(), hashes.data(), len, isa);
+      for (size_t i = 0; i < len; i++) {
+        ASSERT_EQ(hashes[i], hasher(keys[i]))
+            << "isa " << static_cast<int>(isa) << " len " << len << " i " << i;
+      }
+      EXPECT_EQ(hashes[len], 12345u);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(batch_hash, murmur_hash3_32_test) {
+  batch_hash_test<long long>();
+  batch_hash_test<unsigned int>();
+  batch_hash_test<int>();
+}
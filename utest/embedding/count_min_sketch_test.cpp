@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/hashtable/count_min_sketch.hpp"
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+typedef long long T;
+const T default_key = std::numeric_limits<T>::max() - 1;
+
+}  // namespace
+
+TEST(count_min_sketch, admit_test) {
+  nv::CountMinAdmission<T> filter(1024, 3, default_key);
+  const T keys[] = {7, 8, 7};
+  T admitted[3];
+  // the keys of a batch are counted after it's admitted
+  for (int iter = 0; iter < 2; iter++) {
+    filter.admit(keys, admitted, 3);
+    EXPECT_EQ(admitted[0], default_key);
+    EXPECT_EQ(admitted[1], default_key);
+    EXPECT_EQ(admitted[2], default_key);
+    filter.count(keys, 3);
+  }
+  EXPECT_EQ(filter.estimate(7), 3u);
+  EXPECT_EQ(filter.estimate(8), 2u);
+  filter.admit(keys, admitted, 3);
+  EXPECT_EQ(admitted[0], 7);
+  EXPECT_EQ(admitted[1], default_key);
+  EXPECT_EQ(admitted[2], 7);
+
+  EXPECT_EQ(filter.get_stats().keys, 9);
+  EXPECT_EQ(filter.get_stats().rejected, 7);
+  nv::AdmissionStats earlier = filter.get_stats();
+  filter.admit(keys, admitted, 1);
+  EXPECT_EQ(filter.get_stats().since(earlier).keys, 1);
+  EXPECT_EQ(filter.get_stats().since(earlier).rejected, 0);
+}
+
+TEST(count_min_sketch, estimate_test) {
+  const uint32_t threshold = 5;
+  nv::CountMinAdmission<T> filter(1 << 16, threshold, default_key);
+  std::mt19937_64 generator(0);
+  std::unordered_map<T, uint32_t> counts;
+  std::vector<T> keys(20000);
+  for (auto& key : keys) {
+    // most keys once or twice, a few hot ones
+    key = generator() % 4 == 0 ? static_cast<T>(generator() % 100)
+                               : static_cast<T>(generator() % 1000000);
+    counts[key]++;
+  }
+  filter.count(keys.data(), keys.size());
+
+  // a count-min estimate never underestimates, and is mostly exact at this load
+  size_t exact = 0;
+  for (auto& kv : counts) {
+    const uint32_t expected = std::min(kv.second, threshold);
+    const uint32_t estimate = filter.estimate(kv.first);
+    ASSERT_GE(estimate, expected);
+    exact += estimate == expected;
+  }
+  EXPECT_GT(exact, counts.size() * 9 / 10);
+
+  std::vector<T> admitted(keys.size());
+  filter.admit(keys.data(), admitted.data(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (counts[keys[i]] >= threshold) {
+      EXPECT_EQ(admitted[i], keys[i]);
+    } else if (admitted[i] != default_key) {
+      EXPECT_EQ(admitted[i], keys[i]);
+    }
+  }
+}
+
+TEST(count_min_sketch, in_table_test) {
+  nv::CountMinAdmission<T> filter(1024, 3, default_key);
+  // e.g. the keys of a loaded model, which the sketch has never counted
+  const T keys[] = {7, 8, 9};
+  const bool in_table[] = {true, false, true};
+  T admitted[3];
+  filter.admit(keys, admitted, 3, in_table);
+  EXPECT_EQ(admitted[0], 7);
+  EXPECT_EQ(admitted[1], default_key);
+  EXPECT_EQ(admitted[2], 9);
+  EXPECT_EQ(filter.get_stats().keys, 3);
+  EXPECT_EQ(filter.get_stats().rejected, 1);
+}
+
+TEST(count_min_sketch, reserved_key_test) {
+  nv::CountMinAdmission<T> filter(1024, 3, default_key);
+  // a real key equal to the default key would share the row of the rare keys
+  const T keys[] = {7, default_key};
+  T admitted[2];
+  EXPECT_THROW(filter.admit(keys, admitted, 2), std::invalid_argument);
+  EXPECT_EQ(filter.get_stats().keys, 0);
+}
+
+TEST(count_min_sketch, decay_test) {
+  nv::CountMinAdmission<T> filter(1024, 8, default_key);
+  const T keys[] = {7, 7, 7, 7, 7, 8};
+  filter.count(keys, 6);
+  EXPECT_EQ(filter.estimate(7), 5u);
+  EXPECT_EQ(filter.estimate(8), 1u);
+  filter.decay();
+  EXPECT_EQ(filter.estimate(7), 2u);
+  EXPECT_EQ(filter.estimate(8), 0u);
+}
+
+namespace {
+
+/**
+ * Train a small sketch on batches of keys seen once and of hot keys seen twice per batch, and
+ * return the share of the keys seen once admitted in the last batches.
+ */
+double false_admit_rate(bool decay) {
+  const size_t width = 4096;
+  const uint32_t threshold = 3;
+  const int batches = 50;
+  const int unique_per_batch = 2000;
+  const int hot_keys = 20;
+  nv::CountMinAdmission<T> filter(width, threshold, default_key);
+  T next_unique_key = 1000;
+  long long unique_admitted = 0;
+  long long unique_checked = 0;
+  for (int batch = 0; batch < batches; batch++) {
+    std::vector<T> keys;
+    for (int i = 0; i < unique_per_batch; i++) {
+      keys.push_back(next_unique_key++);
+    }
+    for (int i = 0; i < 2 * hot_keys; i++) {
+      keys.push_back(i % hot_keys);
+    }
+    std::vector<T> admitted(keys.size());
+    filter.admit(keys.data(), admitted.data(), keys.size());
+    if (batch >= batches - 10) {
+      for (int i = 0; i < unique_per_batch; i++) {
+        unique_admitted += admitted[i] != default_key;
+      }
+      unique_checked += unique_per_batch;
+      // the hot keys still reach the threshold between two halvings
+      for (size_t i = unique_per_batch; i < keys.size(); i++) {
+        EXPECT_EQ(admitted[i], keys[i]);
+      }
+    }
+    if (decay && batch > 0) {
+      filter.decay();
+    }
+    filter.count(keys.data(), keys.size());
+  }
+  return static_cast<double>(unique_admitted) / unique_checked;
+}
+
+}  // namespace
+
+TEST(count_min_sketch, false_admit_rate_test) {
+  // without decay the counters of a narrow sketch fill up and admit every key
+  EXPECT_GT(false_admit_rate(false), 0.5);
+  // halved every batch, a counter holds about two batches of counts and few keys pass
+  EXPECT_LT(false_admit_rate(true), 0.01);
+}
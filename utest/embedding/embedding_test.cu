@@ -694,6 +694,225 @@ TEST(sparse_embedding_hash_test, training_correctness) {
 }
 #endif
 
+#if 1
+// sparse_embedding_hash short batch testing: only the first num_samples rows are looked up
+TEST(sparse_embedding_hash_test, short_batch) {
+  test::mpi_init();
+
+  constexpr int batchsize = 1024;
+  constexpr int num_samples = 777;
+  constexpr int slot_num = 2;
+  constexpr int max_feature_num = 10 * slot_num;
+  constexpr long long vocabulary_size = 55000;
+  constexpr int embedding_vec_size = 16;
+  constexpr long long label_dim = 1;
+  std::vector<int> device_list = {0};
+  typedef long long T;
+
+  OptHyperParams hyper_params;
+  hyper_params.adam.beta1 = 0.9f;
+  hyper_params.adam.beta2 = 0.999f;
+  hyper_params.adam.epsilon = 1e-8f;
+  OptParams opt_params = {0, 0.01f, hyper_params};
+  const SparseEmbeddingHashParams embedding_params = {
+      batchsize, vocabulary_size, 0.75f, embedding_vec_size, max_feature_num, slot_num,
+      0,  // combiner: 0-sum, 1-mean
+      opt_params};
+
+  // generate input data
+  const std::string tmp_file_name("temp_dataset_embedding_short_batch.data");
+  const std::string file_list_name("file_list_embedding_short_batch.txt");
+  {
+    std::ofstream out_stream(tmp_file_name, std::ofstream::binary);
+    DataSetHeader header = {batchsize, label_dim, slot_num, 0};
+    out_stream.write(reinterpret_cast<char *>(&header), sizeof(DataSetHeader));
+    UnifiedDataSimulator<T> ldata_sim(0, vocabulary_size - 1);
+    for (int i = 0; i < batchsize; i++) {
+      int label = i % 2;
+      out_stream.write(reinterpret_cast<char *>(&label), sizeof(int));
+      for (int k = 0; k < slot_num; k++) {
+        int nnz = max_feature_num / slot_num;
+        out_stream.write(reinterpret_cast<char *>(&nnz), sizeof(int));
+        for (int j = 0; j < nnz; j++) {
+          T value = ldata_sim.get_num();
+          out_stream.write(reinterpret_cast<char *>(&value), sizeof(T));
+        }
+      }
+    }
+    out_stream.close();
+    std::ofstream file_list_stream(file_list_name, std::ofstream::out);
+    file_list_stream << (std::to_string(1) + "\n");
+    file_list_stream << (tmp_file_name + "\n");
+    file_list_stream.close();
+  }
+
+  std::vector<std::vector<int>> vvgpu;
+  vvgpu.push_back(device_list);
+  DeviceMap device_map(vvgpu, 0);
+  GPUResourceGroup gpu_resource_group(device_map);
+  DataReader<T> *data_reader = new DataReader<T>(file_list_name, batchsize, label_dim, slot_num,
+                                                 max_feature_num, gpu_resource_group, 1, 1);
+  Embedding<T> *embedding = new SparseEmbeddingHash<T>(data_reader->get_row_offsets_tensors(),
+                                                       data_reader->get_value_tensors(),
+                                                       embedding_params, gpu_resource_group);
+  data_reader->read_a_batch_to_device();
+
+  // the full batch, then the same input with only the first num_samples rows valid
+  const size_t feature_size_per_sample = slot_num * embedding_vec_size;
+  std::vector<float> full_feature(batchsize * feature_size_per_sample);
+  std::vector<float> short_feature(batchsize * feature_size_per_sample, 1.f);
+  embedding->forward();
+  embedding->get_embedding_feature_ptr(full_feature.data());
+  embedding->set_num_samples(num_samples);
+  embedding->forward();
+  embedding->get_embedding_feature_ptr(short_feature.data());
+
+  const size_t valid_size = num_samples * feature_size_per_sample;
+  ASSERT_EQ(true, compare_embedding_feature(valid_size, short_feature.data(), full_feature.data()));
+  for (size_t i = valid_size; i < short_feature.size(); i++) {
+    ASSERT_EQ(0.f, short_feature[i]) << "at " << i;
+  }
+
+  // a batch without a valid sample is all 0
+  embedding->set_num_samples(0);
+  embedding->forward();
+  embedding->get_embedding_feature_ptr(short_feature.data());
+  for (size_t i = 0; i < short_feature.size(); i++) {
+    ASSERT_EQ(0.f, short_feature[i]) << "at " << i;
+  }
+  EXPECT_THROW(embedding->set_num_samples(batchsize + 1), internal_runtime_error);
+
+  delete embedding;
+  delete data_reader;
+}
+#endif
+
+#if 1
+// sparse_embedding_hash admission testing: the keys of a loaded model keep their rows although
+// the sketch has never counted them, and only the training batches are in the admission stats
+TEST(sparse_embedding_hash_test, admission_after_upload) {
+  test::mpi_init();
+
+  constexpr int batchsize = 1024;
+  constexpr int slot_num = 2;
+  constexpr int max_feature_num = 10 * slot_num;
+  constexpr long long vocabulary_size = 55000;
+  constexpr int embedding_vec_size = 16;
+  constexpr int combiner = 0;   // 0-sum, 1-mean
+  constexpr int optimizer = 0;  // 0-adam, 1-momentum_sgd, 2-nesterov
+  constexpr float lr = 0.01f;
+  constexpr long long label_dim = 1;
+  std::vector<int> device_list = {0};
+  typedef long long T;
+
+  OptHyperParams hyper_params;
+  hyper_params.adam.beta1 = 0.9f;
+  hyper_params.adam.beta2 = 0.999f;
+  hyper_params.adam.epsilon = 1e-8f;
+  OptParams opt_params = {optimizer, lr, hyper_params};
+  const SparseEmbeddingHashParams embedding_params = {
+      batchsize, vocabulary_size, 0.75f, embedding_vec_size, max_feature_num, slot_num, combiner,
+      opt_params,
+      3,     // admit_threshold
+      4096,  // admit_sketch_width
+      1};    // admit_decay_interval
+
+  // generate input data, all its keys are in the hash table file
+  const char *hash_table_file_name = "hash_table_admission.bin";
+  const std::string tmp_file_name("temp_dataset_embedding_admission.data");
+  const std::string file_list_name("file_list_embedding_admission.txt");
+  {
+    std::ofstream out_stream(tmp_file_name, std::ofstream::binary);
+    DataSetHeader header = {batchsize, label_dim, slot_num, 0};
+    out_stream.write(reinterpret_cast<char *>(&header), sizeof(DataSetHeader));
+    UnifiedDataSimulator<T> ldata_sim(0, vocabulary_size - 1);
+    for (int i = 0; i < batchsize; i++) {
+      int label = i % 2;
+      out_stream.write(reinterpret_cast<char *>(&label), sizeof(int));
+      for (int k = 0; k < slot_num; k++) {
+        int nnz = max_feature_num / slot_num;
+        out_stream.write(reinterpret_cast<char *>(&nnz), sizeof(int));
+        for (int j = 0; j < nnz; j++) {
+          T value = ldata_sim.get_num();
+          out_stream.write(reinterpret_cast<char *>(&value), sizeof(T));
+        }
+      }
+    }
+    out_stream.close();
+    std::ofstream file_list_stream(file_list_name, std::ofstream::out);
+    file_list_stream << (std::to_string(1) + "\n");
+    file_list_stream << (tmp_file_name + "\n");
+    file_list_stream.close();
+
+    std::ofstream weight_stream(hash_table_file_name);
+    UnifiedDataSimulator<float> fdata_sim(-0.1f, 0.1f);
+    for (long long i = 0; i < vocabulary_size; i++) {
+      T key = (T)i;
+      weight_stream.write((char *)&key, sizeof(T));
+      float val = fdata_sim.get_num();
+      for (int j = 0; j < embedding_vec_size; j++) {
+        weight_stream.write((char *)&val, sizeof(float));
+      }
+    }
+    weight_stream.close();
+  }
+
+  std::vector<std::vector<int>> vvgpu;
+  vvgpu.push_back(device_list);
+  DeviceMap device_map(vvgpu, 0);
+  GPUResourceGroup gpu_resource_group(device_map);
+  DataReader<T> *data_reader = new DataReader<T>(file_list_name, batchsize, label_dim, slot_num,
+                                                 max_feature_num, gpu_resource_group, 1, 1);
+  Embedding<T> *embedding = new SparseEmbeddingHash<T>(data_reader->get_row_offsets_tensors(),
+                                                       data_reader->get_value_tensors(),
+                                                       embedding_params, gpu_resource_group);
+  std::ifstream i_weight_stream(hash_table_file_name);
+  embedding->upload_params_to_device(i_weight_stream);
+  i_weight_stream.close();
+
+  // the reference has no admission: every key gets its own row
+  std::ifstream weight_stream_cpu(hash_table_file_name);
+  std::ifstream csr_stream_cpu(tmp_file_name);
+  SparseEmbeddingHashCpu<T> *embedding_cpu = new SparseEmbeddingHashCpu<T>(
+      batchsize, max_feature_num, vocabulary_size, embedding_vec_size, slot_num, combiner,
+      optimizer, lr, weight_stream_cpu, csr_stream_cpu, label_dim);
+
+  data_reader->read_a_batch_to_device();
+  embedding->forward();
+  embedding_cpu->forward();
+  std::vector<float> embedding_feature_from_gpu(batchsize * slot_num * embedding_vec_size);
+  embedding->get_embedding_feature_ptr(embedding_feature_from_gpu.data());
+  ASSERT_EQ(true, compare_embedding_feature(batchsize * slot_num * embedding_vec_size,
+                                            embedding_feature_from_gpu.data(),
+                                            embedding_cpu->get_embedding_feature_ptr()));
+
+  // a forward is counted once its params are updated, so an evaluation one never is
+  EXPECT_EQ(embedding->get_admission_stats().keys, 0);
+  embedding->backward();
+  embedding->update_params();
+  EXPECT_EQ(embedding->get_admission_stats().keys, (long long)batchsize * max_feature_num);
+  EXPECT_EQ(embedding->get_admission_stats().rejected, 0);
+  embedding->forward();
+  EXPECT_EQ(embedding->get_admission_stats().keys, (long long)batchsize * max_feature_num);
+
+  // without the model, the same keys are below the threshold and share the default row
+  Embedding<T> *embedding_empty = new SparseEmbeddingHash<T>(
+      data_reader->get_row_offsets_tensors(), data_reader->get_value_tensors(), embedding_params,
+      gpu_resource_group);
+  embedding_empty->forward();
+  embedding_empty->backward();
+  embedding_empty->update_params();
+  EXPECT_EQ(embedding_empty->get_admission_stats().keys, (long long)batchsize * max_feature_num);
+  EXPECT_EQ(embedding_empty->get_admission_stats().rejected,
+            (long long)batchsize * max_feature_num);
+
+  delete embedding_empty;
+  delete embedding_cpu;
+  delete embedding;
+  delete data_reader;
+}
+#endif
+
 #if 1
 // sparse_embedding_hash performance profiling: forward()/backward()/update_params()
 // 1. complie this app as release version
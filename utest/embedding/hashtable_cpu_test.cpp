@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/hashtable/nv_hashtable_cpu.hpp"
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+typedef long long T;
+typedef unsigned long long V;
+typedef nv::CpuHashTable<T, V, std::numeric_limits<T>::max()> Table;
+
+}  // namespace
+
+TEST(hashtable_cpu, insert_get_test) {
+  const size_t capacity = 1000;
+  const size_t len = 700;
+  Table table(capacity);
+  std::mt19937_64 generator(0);
+  std::vector<T> keys(len);
+  std::vector<V> vals(len);
+  std::unordered_map<T, V> expected;
+  for (size_t i = 0; i < len; i++) {
+    keys[i] = static_cast<T>(generator() % 5000) - 2500;
+    vals[i] = i;
+    expected[keys[i]] = i;  // the last value of a key wins
+  }
+  table.insert(keys.data(), vals.data(), len);
+  EXPECT_EQ(table.get_size(), expected.size());
+  EXPECT_EQ(table.get_capacity(), capacity);
+
+  std::vector<T> query;
+  for (auto& kv : expected) {
+    query.push_back(kv.first);
+  }
+  query.push_back(100000);
+  std::vector<V> result(query.size());
+  EXPECT_EQ(table.get(query.data(), result.data(), query.size()), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(result[i], expected[query[i]]);
+  }
+  EXPECT_EQ(result.back(), std::numeric_limits<V>::max());
+
+  // accum adds to the existing keys only
+  std::vector<V> ones(query.size(), 1);
+  EXPECT_EQ(table.accum(query.data(), ones.data(), query.size()), expected.size());
+  EXPECT_EQ(table.get_size(), expected.size());
+
+  // dump in two parts
+  std::vector<T> dump_keys(capacity);
+  std::vector<V> dump_vals(capacity);
+  size_t count = table.dump(dump_keys.data(), dump_vals.data(), 0, capacity / 2);
+  count += table.dump(dump_keys.data() + count, dump_vals.data() + count, capacity / 2, capacity);
+  ASSERT_EQ(count, expected.size());
+  for (size_t i = 0; i < count; i++) {
+    ASSERT_EQ(expected.count(dump_keys[i]), 1u);
+    EXPECT_EQ(dump_vals[i], expected[dump_keys[i]] + 1);
+  }
+}
+
+TEST(hashtable_cpu, get_insert_multi_threads_test) {
+  const int num_threads = 8;
+  const size_t num_keys = 20000;
+  const size_t len = 30000;
+  Table table(num_keys * 2, 10);
+  // each thread looks up the same keys in its own order
+  std::vector<std::vector<T>> keys(num_threads);
+  std::vector<std::vector<V>> vals(num_threads, std::vector<V>(len));
+  for (int t = 0; t < num_threads; t++) {
+    std::mt19937_64 generator(t);
+    for (size_t i = 0; i < len; i++) {
+      keys[t].push_back(static_cast<T>(i < num_keys ? i : generator() % num_keys) * 7919);
+    }
+    std::shuffle(keys[t].begin(), keys[t].end(), generator);
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&table, &keys, &vals, t]() {
+      for (size_t i = 0; i < len; i += 1000) {
+        table.get_insert(keys[t].data() + i, vals[t].data() + i, std::min<size_t>(1000, len - i));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // every key gets one value, and the values are the counter from 10 on
+  EXPECT_EQ(table.get_size(), num_keys);
+  EXPECT_EQ(table.get_value_head(), 10 + num_keys);
+  std::unordered_map<T, V> values;
+  for (int t = 0; t < num_threads; t++) {
+    for (size_t i = 0; i < len; i++) {
+      auto it = values.insert(std::make_pair(keys[t][i], vals[t][i])).first;
+      EXPECT_EQ(it->second, vals[t][i]);
+    }
+  }
+  std::vector<bool> used(num_keys, false);
+  for (auto& kv : values) {
+    ASSERT_GE(kv.second, 10u);
+    ASSERT_LT(kv.second, 10 + num_keys);
+    EXPECT_FALSE(used[kv.second - 10]);
+    used[kv.second - 10] = true;
+  }
+}
+
+TEST(hashtable_cpu, full_test) {
+  Table table(4);
+  const T keys[] = {1, 2, 3, 4, 5};
+  V vals[5];
+  table.get_insert(keys, vals, 4);
+  table.get_insert(keys, vals, 4);
+  EXPECT_EQ(table.get_value_head(), 4u);
+  EXPECT_THROW(table.get_insert(keys + 4, vals + 4, 1), std::runtime_error);
+  EXPECT_THROW(table.insert(keys + 4, vals, 1), std::runtime_error);
+  EXPECT_EQ(table.get(keys + 4, vals + 4, 1), 0u);
+  EXPECT_EQ(table.add_value_head(6), 10u);
+}
+
+TEST(hashtable_cpu, grow_test) {
+  const size_t capacity = 1000;
+  const int num_threads = 4;
+  const size_t new_keys = 100;
+  Table table(capacity);
+  EXPECT_THROW(table.set_growth(1.0), std::invalid_argument);
+  EXPECT_THROW(table.set_growth(0.5, 1.0), std::invalid_argument);
+  table.set_growth(0.5);
+  std::mt19937_64 generator(0);
+  std::unordered_map<T, V> expected;
+  std::vector<T> seen;
+  bool rehashed = false;
+  for (int iter = 0; iter < 50; iter++) {
+    // each thread looks up the new keys of the iteration and as many seen ones
+    std::vector<std::vector<T>> keys(num_threads);
+    std::vector<std::vector<V>> vals(num_threads, std::vector<V>(new_keys * 2));
+    for (int t = 0; t < num_threads; t++) {
+      for (size_t i = 0; i < new_keys; i++) {
+        keys[t].push_back(static_cast<T>(iter * new_keys + i) * 7919);
+        keys[t].push_back(seen.empty() ? 0 : seen[generator() % seen.size()]);
+      }
+      std::shuffle(keys[t].begin(), keys[t].end(), generator);
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&table, &keys, &vals, t]() {
+        table.get_insert(keys[t].data(), vals[t].data(), keys[t].size());
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    // the value of a key never changes, whether it's migrated or not
+    for (int t = 0; t < num_threads; t++) {
+      for (size_t i = 0; i < keys[t].size(); i++) {
+        auto it = expected.insert(std::make_pair(keys[t][i], vals[t][i]));
+        ASSERT_EQ(it.first->second, vals[t][i]) << "iteration " << iter;
+        if (it.second) {
+          seen.push_back(keys[t][i]);
+        }
+      }
+    }
+    ASSERT_EQ(table.get_size(), expected.size());
+    ASSERT_EQ(table.get_value_head(), expected.size());
+    rehashed |= table.is_rehashing();
+    table.rehash_step(300);
+  }
+  EXPECT_TRUE(rehashed);
+  EXPECT_GE(table.get_capacity(), expected.size() * 2);
+
+  std::vector<V> result(seen.size());
+  EXPECT_EQ(table.get(seen.data(), result.data(), seen.size()), seen.size());
+  for (size_t i = 0; i < seen.size(); i++) {
+    EXPECT_EQ(result[i], expected[seen[i]]);
+  }
+  table.finish_rehash();
+  EXPECT_FALSE(table.is_rehashing());
+  std::vector<T> dump_keys(table.get_capacity());
+  std::vector<V> dump_vals(table.get_capacity());
+  size_t count = table.dump(dump_keys.data(), dump_vals.data(), 0, table.get_capacity());
+  ASSERT_EQ(count, expected.size());
+  for (size_t i = 0; i < count; i++) {
+    EXPECT_EQ(dump_vals[i], expected[dump_keys[i]]);
+  }
+}
+
+TEST(hashtable_cpu, full_during_rehash_test) {
+  const size_t capacity = 16;
+  Table table(capacity);
+  table.set_growth(0.5);
+  std::vector<T> old_keys;
+  std::vector<V> old_vals;
+  for (T key = 0; key < 9; key++) {
+    old_keys.push_back(key);
+    old_vals.push_back(static_cast<V>(key) + 100);
+  }
+  table.insert(old_keys.data(), old_vals.data(), old_keys.size());
+  // start a rehash without migrating anything, then fill the new slots with new keys
+  EXPECT_TRUE(table.rehash_step(0));
+  const size_t new_capacity = table.get_capacity();
+  std::vector<T> new_keys;
+  std::vector<V> new_vals;
+  for (size_t i = 0; i < new_capacity; i++) {
+    new_keys.push_back(static_cast<T>(i) + 1000);
+    new_vals.push_back(i);
+  }
+  table.insert(new_keys.data(), new_vals.data(), new_keys.size());
+  const T one_more = 5000;
+  const V one_more_val = 0;
+  EXPECT_THROW(table.insert(&one_more, &one_more_val, 1), std::runtime_error);
+  EXPECT_THROW(table.rehash_step(capacity), std::runtime_error);
+  EXPECT_THROW(table.finish_rehash(), std::runtime_error);
+
+  // the keys not migrated are still in the old slots
+  EXPECT_TRUE(table.is_rehashing());
+  std::vector<V> result(old_keys.size());
+  EXPECT_EQ(table.get(old_keys.data(), result.data(), old_keys.size()), old_keys.size());
+  EXPECT_EQ(result, old_vals);
+  result.resize(new_keys.size());
+  EXPECT_EQ(table.get(new_keys.data(), result.data(), new_keys.size()), new_keys.size());
+  EXPECT_EQ(result, new_vals);
+}
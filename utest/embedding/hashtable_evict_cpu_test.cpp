@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/hashtable/nv_hashtable_evict_cpu.hpp"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace {
+
+typedef long long T;
+typedef long long V;
+typedef nv::EvictingCpuHashTable<T, V, std::numeric_limits<T>::max()> Table;
+
+const V empty = std::numeric_limits<V>::max();
+
+/**
+ * Run the batches of keys, the recycled rows are appended to recycled.
+ * @return the rows of the last batch.
+ */
+std::vector<V> run_batches(Table& table, const std::vector<std::vector<T>>& batches,
+                           std::vector<V>* recycled) {
+  std::vector<V> vals;
+  for (auto& batch : batches) {
+    vals.resize(batch.size());
+    table.get_insert(batch.data(), vals.data(), batch.size(), recycled);
+  }
+  return vals;
+}
+
+}  // namespace
+
+TEST(hashtable_evict_cpu, lru_test) {
+  Table table(4, nv::EvictionPolicy::LRU, 4);
+  std::vector<V> recycled;
+  run_batches(table, {{1}, {2}, {3}, {4}, {1}}, &recycled);
+  EXPECT_TRUE(recycled.empty());
+  EXPECT_EQ(table.get_size(), 4u);
+
+  // 2 is the least recently used
+  const T two = 2;
+  V row_of_two;
+  EXPECT_EQ(table.get(&two, &row_of_two, 1), 1u);
+  std::vector<V> vals = run_batches(table, {{5}}, &recycled);
+  ASSERT_EQ(recycled.size(), 1u);
+  EXPECT_EQ(recycled[0], row_of_two);
+  EXPECT_EQ(vals[0], row_of_two);
+  V row;
+  EXPECT_EQ(table.get(&two, &row, 1), 0u);
+  EXPECT_EQ(row, empty);
+
+  EXPECT_EQ(table.get_stats().hits, 1u);
+  EXPECT_EQ(table.get_stats().misses, 5u);
+  EXPECT_EQ(table.get_stats().evictions, 1u);
+  table.reset_stats();
+  EXPECT_EQ(table.get_stats().misses, 0u);
+}
+
+TEST(hashtable_evict_cpu, lfu_test) {
+  Table table(4, nv::EvictionPolicy::LFU, 4);
+  std::vector<V> recycled;
+  run_batches(table, {{1, 2, 3, 4}, {1, 2, 3}, {1, 2}, {4}}, &recycled);
+
+  // 3 and 4 are used twice, 3 less recently
+  const T three = 3;
+  V row_of_three;
+  EXPECT_EQ(table.get(&three, &row_of_three, 1), 1u);
+  run_batches(table, {{5}}, &recycled);
+  ASSERT_EQ(recycled.size(), 1u);
+  EXPECT_EQ(recycled[0], row_of_three);
+
+  // the keys used twice in a batch count twice
+  run_batches(table, {{5, 5, 5}, {6}}, &recycled);
+  ASSERT_EQ(recycled.size(), 2u);
+  const T four = 4;
+  V row;
+  EXPECT_EQ(table.get(&four, &row, 1), 0u);
+}
+
+TEST(hashtable_evict_cpu, batch_test) {
+  Table table(2, nv::EvictionPolicy::LRU);
+  std::vector<V> recycled;
+  // a key never evicts another key of its batch
+  std::vector<V> vals = run_batches(table, {{1, 2}, {3, 1}}, &recycled);
+  EXPECT_NE(vals[0], vals[1]);
+  EXPECT_EQ(recycled.size(), 2u);
+  std::vector<T> keys = {3, 1};
+  std::vector<V> rows(2);
+  EXPECT_EQ(table.get(keys.data(), rows.data(), 2), 2u);
+  EXPECT_EQ(rows, vals);
+
+  const T too_many[] = {4, 5, 6};
+  V too_many_vals[3];
+  EXPECT_THROW(table.get_insert(too_many, too_many_vals, 3), std::runtime_error);
+}
+
+TEST(hashtable_evict_cpu, random_test) {
+  const size_t capacity = 500;
+  for (auto policy : {nv::EvictionPolicy::LRU, nv::EvictionPolicy::LFU}) {
+    Table table(capacity, policy);
+    std::mt19937_64 generator(0);
+    // the key of each row, by the rows given out
+    std::unordered_map<V, T> row_keys;
+    for (int iter = 0; iter < 200; iter++) {
+      std::vector<T> keys(100);
+      for (auto& key : keys) {
+        key = static_cast<T>(generator() % 2000) - 1000;
+      }
+      std::vector<V> vals(keys.size());
+      std::vector<V> recycled;
+      table.get_insert(keys.data(), vals.data(), keys.size(), &recycled);
+
+      // the rows of the batch are distinct for distinct keys, and stay with their keys
+      std::unordered_map<T, V> batch_rows;
+      for (size_t i = 0; i < keys.size(); i++) {
+        ASSERT_LT(vals[i], static_cast<V>(capacity));
+        auto it = batch_rows.insert(std::make_pair(keys[i], vals[i])).first;
+        ASSERT_EQ(it->second, vals[i]);
+      }
+      std::set<V> recycled_set(recycled.begin(), recycled.end());
+      ASSERT_EQ(recycled_set.size(), recycled.size());
+      for (auto& kv : batch_rows) {
+        auto it = row_keys.find(kv.second);
+        if (it != row_keys.end() && it->second != kv.first) {
+          ASSERT_EQ(recycled_set.count(kv.second), 1u) << "row " << kv.second;
+        }
+        row_keys[kv.second] = kv.first;
+      }
+
+      // the index has every key of the rows
+      ASSERT_EQ(table.get_size(), row_keys.size());
+      std::vector<T> all_keys;
+      std::vector<V> all_rows;
+      for (auto& kv : row_keys) {
+        all_rows.push_back(kv.first);
+        all_keys.push_back(kv.second);
+      }
+      std::vector<V> result(all_keys.size());
+      ASSERT_EQ(table.get(all_keys.data(), result.data(), all_keys.size()), all_keys.size());
+      ASSERT_EQ(result, all_rows);
+    }
+    const nv::EvictionStats& stats = table.get_stats();
+    EXPECT_EQ(stats.hits + stats.misses, 200u * 100u);
+    EXPECT_EQ(stats.misses, capacity + stats.evictions);
+  }
+}
+
+TEST(hashtable_evict_cpu, recycle_rows_test) {
+  const size_t embedding_vec_size = 8;
+  const size_t num_rows = 4;
+  std::vector<float> value(num_rows * embedding_vec_size, 100.f);
+  std::vector<float> opt_m(num_rows * embedding_vec_size, 1.f);
+  std::vector<float> opt_v(num_rows * embedding_vec_size, 2.f);
+  std::mt19937 generator(0);
+  const V rows[] = {1, 3};
+  nv::recycle_rows(rows, 2, embedding_vec_size, value.data(), {opt_m.data(), opt_v.data()},
+                   generator);
+  for (size_t row = 0; row < num_rows; row++) {
+    const bool recycled = row == 1 || row == 3;
+    for (size_t j = 0; j < embedding_vec_size; j++) {
+      const size_t i = row * embedding_vec_size + j;
+      if (recycled) {
+        EXPECT_LE(std::abs(value[i]), 1.f / embedding_vec_size);
+        EXPECT_EQ(opt_m[i], 0.f);
+        EXPECT_EQ(opt_v[i], 0.f);
+      } else {
+        EXPECT_EQ(value[i], 100.f);
+        EXPECT_EQ(opt_m[i], 1.f);
+        EXPECT_EQ(opt_v[i], 2.f);
+      }
+    }
+  }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/chunk_ring.hpp"
+#include <thread>
+#include "HugeCTR/include/csr_chunk.hpp"
+#include "gtest/gtest.h"
+
+using namespace HugeCTR;
+
+TEST(chunk_ring, chunk_ring_fifo_test) {
+  const int num_chunks = 64;  // more than Heap can hold
+  ChunkRing<int> ring(num_chunks, 0);
+  std::vector<unsigned int> keys(num_chunks);
+  for (int i = 0; i < num_chunks; i++) {
+    int* chunk = nullptr;
+    ring.free_chunk_checkout(&chunk, &keys[i]);
+    ASSERT_TRUE(chunk != nullptr);
+    *chunk = i;
+  }
+  // check in with reversed order, read out in the same order
+  for (int i = num_chunks - 1; i >= 0; i--) {
+    ring.chunk_write_and_checkin(keys[i]);
+  }
+  EXPECT_EQ(ring.get_num_ready_chunks(), num_chunks);
+  for (int i = num_chunks - 1; i >= 0; i--) {
+    int* chunk = nullptr;
+    unsigned int key = 0;
+    ring.data_chunk_checkout(&chunk, &key);
+    ASSERT_EQ(key, keys[i]);
+    ASSERT_EQ(*chunk, i);
+    ring.chunk_free_and_checkin(key);
+  }
+  EXPECT_EQ(ring.get_num_ready_chunks(), 0);
+}
+
+TEST(chunk_ring, chunk_ring_multi_producers_test) {
+  const int num_producers = 8;
+  const int num_items_per_producer = 10000;
+  ChunkRing<std::pair<int, int>> ring(31, std::make_pair(0, 0));
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; p++) {
+    producers.emplace_back([&ring, p]() {
+      for (int i = 0; i < num_items_per_producer; i++) {
+        std::pair<int, int>* chunk = nullptr;
+        unsigned int key = 0;
+        ring.free_chunk_checkout(&chunk, &key);
+        *chunk = std::make_pair(p, i);
+        ring.chunk_write_and_checkin(key);
+      }
+    });
+  }
+  // the items of a producer are read in the order they are written
+  std::vector<int> next_item(num_producers, 0);
+  for (int n = 0; n < num_producers * num_items_per_producer; n++) {
+    std::pair<int, int>* chunk = nullptr;
+    unsigned int key = 0;
+    ring.data_chunk_checkout(&chunk, &key);
+    ASSERT_TRUE(chunk != nullptr);
+    ASSERT_EQ(chunk->second, next_item[chunk->first]);
+    next_item[chunk->first]++;
+    ring.chunk_free_and_checkin(key);
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+}
+
+TEST(chunk_ring, chunk_ring_break_test) {
+  ChunkRing<int> ring(2, 0);
+  std::thread consumer([&ring]() {
+    int* chunk = nullptr;
+    unsigned int key = 0;
+    ring.data_chunk_checkout(&chunk, &key);  // blocks, nothing is written
+    EXPECT_TRUE(chunk == nullptr);
+    EXPECT_EQ(key, ChunkRing<int>::INVALID_KEY);
+    ring.chunk_free_and_checkin(key);  // ignored
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ring.break_and_return();
+  consumer.join();
+}
+
+TEST(chunk_ring, chunk_ring_csr_chunk_test) {
+  const int num_devices = 4;
+  const int batchsize = 2048;
+  const int label_dim = 2;
+  const int slot_num = 10;
+  const int max_value_size = 2048 * 20;
+  CSRChunk<long long> chunk(num_devices, batchsize, label_dim, slot_num, max_value_size);
+  ChunkRing<CSRChunk<long long>> csr_ring(40, chunk);
+  unsigned int key = 0;
+  CSRChunk<long long>* chunk_tmp = nullptr;
+  csr_ring.free_chunk_checkout(&chunk_tmp, &key);
+  const std::vector<CSR<long long>*>& csr_buffers = chunk_tmp->get_csr_buffers();
+  csr_buffers[0]->reset();
+  csr_ring.chunk_write_and_checkin(key);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/host_allocator.hpp"
+#include <cstdint>
+#include <cstring>
+#include "HugeCTR/include/chunk_ring.hpp"
+#include "HugeCTR/include/csr_chunk.hpp"
+#include "gtest/gtest.h"
+
+using namespace HugeCTR;
+
+TEST(host_allocator, allocate_test) {
+  const HostAllocator_t types[] = {HostAllocator_t::Pinned, HostAllocator_t::Aligned,
+                                   HostAllocator_t::HugePage, HostAllocator_t::Numa};
+  const size_t sizes[] = {1, 4096, 3 << 20};
+  for (auto type : types) {
+    std::shared_ptr<HostAllocator> allocator = create_host_allocator(type);
+    EXPECT_EQ(allocator->get_type(), type);
+    for (size_t size : sizes) {
+      char* ptr = static_cast<char*>(allocator->allocate(size));
+      ASSERT_TRUE(ptr != nullptr);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 4096, 0u);
+      memset(ptr, 0x5a, size);
+      EXPECT_EQ(ptr[size - 1], 0x5a);
+      allocator->deallocate(ptr, size);
+    }
+  }
+  // node 0 exists on every machine
+  NumaHostAllocator numa_allocator(0);
+  EXPECT_EQ(numa_allocator.get_numa_node(), 0);
+  void* ptr = numa_allocator.allocate(1 << 20);
+  memset(ptr, 0, 1 << 20);
+  numa_allocator.deallocate(ptr, 1 << 20);
+  EXPECT_THROW(NumaHostAllocator(NumaHostAllocator::MAX_NUMA_NODES), internal_runtime_error);
+}
+
+TEST(host_allocator, csr_chunk_test) {
+  // the copies in the ring share the allocator of the prototype
+  std::shared_ptr<HostAllocator> allocator = create_host_allocator(HostAllocator_t::Aligned);
+  const int num_devices = 2;
+  const int batchsize = 256;
+  const int label_dim = 3;
+  CSRChunk<long long> chunk(num_devices, batchsize, label_dim, 4, batchsize * 8, allocator);
+  EXPECT_EQ(chunk.get_allocator(), allocator);
+  ChunkRing<CSRChunk<long long>> csr_ring(4, chunk);
+  unsigned int key = 0;
+  CSRChunk<long long>* chunk_tmp = nullptr;
+  csr_ring.free_chunk_checkout(&chunk_tmp, &key);
+  EXPECT_EQ(chunk_tmp->get_allocator(), allocator);
+  for (auto csr : chunk_tmp->get_csr_buffers()) {
+    EXPECT_EQ(csr->get_allocator(), allocator);
+  }
+  // the labels are initialized to 0
+  for (auto label_buffer : chunk_tmp->get_label_buffers()) {
+    for (int i = 0; i < batchsize / num_devices * label_dim; i++) {
+      ASSERT_EQ(label_buffer[i], 0.f);
+    }
+  }
+  csr_ring.chunk_write_and_checkin(key);
+  EXPECT_THROW(CSRChunk<long long>(num_devices, batchsize, label_dim, 4, batchsize * 8, nullptr),
+               internal_runtime_error);
+}
@@ -25,6 +25,7 @@
 #include <cudnn.h>
 
 #include <math.h>
+#include <string.h>
 #include <vector>
 
 using namespace std;
@@ -34,25 +35,26 @@ namespace {
 
 const float eps = 1e-5;
 
+// the statistics are of the first num_samples rows, the other rows are left as they are
 void batch_norm_fprop_cpu(const float* gamma, const float* beta, const float* in, float* out,
-                          bool row_major, int batch_size, int num_feature) {
+                          bool row_major, int batch_size, int num_samples, int num_feature) {
   for (int j = 0; j < num_feature; j++) {
     float mean = 0.0f;
-    for (int i = 0; i < batch_size; i++) {
+    for (int i = 0; i < num_samples; i++) {
       int idx = row_major ? i * num_feature + j : j * batch_size + i;
       mean += in[idx];
     }
-    mean /= batch_size;
+    mean /= num_samples;
 
     float var = 0.0f;
-    for (int i = 0; i < batch_size; i++) {
+    for (int i = 0; i < num_samples; i++) {
       int idx = row_major ? i * num_feature + j : j * batch_size + i;
       float diff = in[idx] - mean;
       var += (diff * diff);
     }
-    var /= batch_size;
+    var /= num_samples;
 
-    for (int i = 0; i < batch_size; i++) {
+    for (int i = 0; i < num_samples; i++) {
       int idx = row_major ? i * num_feature + j : j * batch_size + i;
       float in_norm = (in[idx] - mean) / sqrt(var + eps);
       out[idx] = gamma[j] * in_norm + beta[j];
@@ -61,27 +63,27 @@ void batch_norm_fprop_cpu(const float* gamma, const float* beta, const float* in
 }
 
 void batch_norm_bprop_cpu(const float* gamma, const float* out, float* in, bool row_major,
-                          int batch_size, int num_feature) {
+                          int batch_size, int num_samples, int num_feature) {
   for (int j = 0; j < num_feature; j++) {
     float mean = 0.0f;
-    for (int i = 0; i < batch_size; i++) {
+    for (int i = 0; i < num_samples; i++) {
       int idx = row_major ? i * num_feature + j : j * batch_size + i;
       mean += in[idx];
     }
-    mean /= batch_size;
+    mean /= num_samples;
 
     float var = 0.0f;
-    for (int i = 0; i < batch_size; i++) {
+    for (int i = 0; i < num_samples; i++) {
       int idx = row_major ? i * num_feature + j : j * batch_size + i;
       float diff = in[idx] - mean;
       var += (diff * diff);
     }
-    var /= batch_size;
+    var /= num_samples;
 
     float inv_std = 1.0f / sqrt(var + eps);
 
     float d_var = 0.0f;
-    for (int i = 0; i < batch_size; i++) {
+    for (int i = 0; i < num_samples; i++) {
       int idx = row_major ? i * num_feature + j : j * batch_size + i;
       float val = (out[idx] * gamma[j]) * (in[idx] - mean);
       d_var += val;
@@ -90,24 +92,26 @@ void batch_norm_bprop_cpu(const float* gamma, const float* out, float* in, bool
 
     float val1 = 0.0f;
     float val2 = 0.0f;
-    for (int i = 0; i < batch_size; i++) {
+    for (int i = 0; i < num_samples; i++) {
       int idx = row_major ? i * num_feature + j : j * batch_size + i;
       val1 += (out[idx] * gamma[j]);
       val2 += (in[idx] - mean);
     }
     val1 *= (-inv_std);
-    val2 *= (d_var / batch_size) * -2;
+    val2 *= (d_var / num_samples) * -2;
     float d_mean = (val1 + val2);
 
-    for (int i = 0; i < batch_size; i++) {
+    for (int i = 0; i < num_samples; i++) {
       int idx = row_major ? i * num_feature + j : j * batch_size + i;
-      in[idx] = (out[idx] * gamma[j]) * inv_std + d_var * (2.0 / batch_size) * (in[idx] - mean) +
-                d_mean / batch_size;
+      in[idx] = (out[idx] * gamma[j]) * inv_std + d_var * (2.0 / num_samples) * (in[idx] - mean) +
+                d_mean / num_samples;
     }
   }
 }
 
-void batch_norm_test(bool row_major, int batch_size, int num_feature) {
+// num_samples < batch_size: a short batch, whose padded rows are out of the statistics and get
+// zeros
+void batch_norm_test(bool row_major, int batch_size, int num_feature, int num_samples = -1) {
   GeneralBuffer<float> wbuff;
   GeneralBuffer<float> wgbuff;
   GeneralBuffer<float> blobs;
@@ -123,6 +127,8 @@ void batch_norm_test(bool row_major, int batch_size, int num_feature) {
 
   BatchNormLayer::Params params = {true, 1.0, eps};
   BatchNormLayer batch_norm_layer(wbuff, wgbuff, in_tensor, out_tensor, params, cudnn_handle, 0);
+  batch_norm_layer.set_num_samples(num_samples);
+  const int n = num_samples < 0 ? batch_size : num_samples;
 
   wbuff.init(0);
   wgbuff.init(0);
@@ -159,7 +165,8 @@ void batch_norm_test(bool row_major, int batch_size, int num_feature) {
     }
   }
 
-  batch_norm_fprop_cpu(h_gamma, h_beta, h_in, h_expected, row_major, batch_size, num_feature);
+  memset(h_expected, 0, len * sizeof(float));
+  batch_norm_fprop_cpu(h_gamma, h_beta, h_in, h_expected, row_major, batch_size, n, num_feature);
 
   cudaMemcpy(d_in, h_in, len * sizeof(float), cudaMemcpyHostToDevice);
   batch_norm_layer.fprop(cudaStreamDefault);
@@ -175,7 +182,12 @@ void batch_norm_test(bool row_major, int batch_size, int num_feature) {
   }
 
   cudaMemcpy(h_expected, d_in, len * sizeof(float), cudaMemcpyDeviceToHost);
-  batch_norm_bprop_cpu(h_gamma, h_out, h_expected, row_major, batch_size, num_feature);
+  batch_norm_bprop_cpu(h_gamma, h_out, h_expected, row_major, batch_size, n, num_feature);
+  for (int i = n; i < batch_size; i++) {
+    for (int j = 0; j < num_feature; j++) {
+      h_expected[row_major ? i * num_feature + j : j * batch_size + i] = 0.0f;
+    }
+  }
 
   cudaMemcpy(d_out, h_out, len * sizeof(float), cudaMemcpyHostToDevice);
   batch_norm_layer.bprop(cudaStreamDefault);
@@ -213,3 +225,13 @@ TEST(batch_norm_layer, fprop_and_bprop_HW) {
   batch_norm_test(true, 512, 1024);
   batch_norm_test(true, 511, 1024);
 }
+
+TEST(batch_norm_layer, short_batch) {
+  batch_norm_test(true, 1024, 16, 777);
+  batch_norm_test(false, 1024, 16, 777);
+  batch_norm_test(true, 1024, 16, 1024);
+  batch_norm_test(true, 8, 4, 2);
+  // a GPU without a valid sample outputs zeros and gets no gradient
+  batch_norm_test(true, 8, 4, 0);
+  batch_norm_test(false, 8, 4, 0);
+}
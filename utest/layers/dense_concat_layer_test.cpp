@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HugeCTR/include/layers/dense_concat_layer.hpp"
+
+#include "HugeCTR/include/data_parser.hpp"
+#include "HugeCTR/include/general_buffer.hpp"
+#include "gtest/gtest.h"
+#include "utest/test_utils.h"
+
+#include <math.h>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace HugeCTR;
+
+namespace {
+
+const float eps = 1e-5;
+
+void dense_concat_layer_test(int n_batch, int in_width, int dense_width) {
+  GeneralBuffer<float> buf;
+  std::vector<int> in_dims = {n_batch, in_width};
+  std::vector<int> dense_dims = {n_batch, dense_width};
+  std::vector<int> out_dims = {n_batch, in_width + dense_width};
+  std::unique_ptr<Tensor<float>> in_tensor(new Tensor<float>(in_dims, buf, TensorFormat_t::HW));
+  std::unique_ptr<Tensor<float>> dense_tensor(
+      new Tensor<float>(dense_dims, buf, TensorFormat_t::HW));
+  std::unique_ptr<Tensor<float>> out_tensor(new Tensor<float>(out_dims, buf, TensorFormat_t::HW));
+
+  DenseConcatLayer dense_concat_layer(*in_tensor, *dense_tensor, *out_tensor, 0);
+
+  buf.init(0);
+
+  GaussianDataSimulator<float> data_sim(0.0, 1.0, -10.0, 10.0);
+  std::vector<float> h_in(in_tensor->get_num_elements());
+  std::vector<float> h_dense(dense_tensor->get_num_elements());
+  for (auto& x : h_in) x = data_sim.get_num();
+  for (auto& x : h_dense) x = data_sim.get_num();
+
+  // fprop
+  std::vector<float> h_ref(out_tensor->get_num_elements());
+  for (int i = 0; i < n_batch; i++) {
+    for (int j = 0; j < in_width; j++) {
+      h_ref[i * (in_width + dense_width) + j] = h_in[i * in_width + j];
+    }
+    for (int j = 0; j < dense_width; j++) {
+      h_ref[i * (in_width + dense_width) + in_width + j] = h_dense[i * dense_width + j];
+    }
+  }
+
+  cudaMemcpy(in_tensor->get_ptr(), &h_in.front(), in_tensor->get_size(), cudaMemcpyHostToDevice);
+  cudaMemcpy(dense_tensor->get_ptr(), &h_dense.front(), dense_tensor->get_size(),
+             cudaMemcpyHostToDevice);
+
+  dense_concat_layer.fprop(cudaStreamDefault);
+  cudaStreamSynchronize(cudaStreamDefault);
+
+  std::vector<float> h_result(out_tensor->get_num_elements());
+  cudaMemcpy(&h_result.front(), out_tensor->get_ptr(), out_tensor->get_size(),
+             cudaMemcpyDeviceToHost);
+  ASSERT_TRUE(
+      test::compare_array_approx<float>(&h_result.front(), &h_ref.front(), h_result.size(), eps));
+
+  // bprop: the first in_width columns of the output gradient go back to in_tensor
+  cudaMemset(in_tensor->get_ptr(), 0, in_tensor->get_size());
+  dense_concat_layer.bprop(cudaStreamDefault);
+  cudaStreamSynchronize(cudaStreamDefault);
+
+  h_result.resize(in_tensor->get_num_elements());
+  cudaMemcpy(&h_result.front(), in_tensor->get_ptr(), in_tensor->get_size(),
+             cudaMemcpyDeviceToHost);
+  ASSERT_TRUE(
+      test::compare_array_approx<float>(&h_result.front(), &h_in.front(), h_result.size(), eps));
+}
+
+}  // namespace
+
+TEST(dense_concat_layer, fprop_and_bprop) {
+  dense_concat_layer_test(2, 80 * 48, 13);
+  dense_concat_layer_test(3, 81 * 49, 1);
+  dense_concat_layer_test(64, 26 * 16, 13);
+}
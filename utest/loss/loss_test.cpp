@@ -32,7 +32,11 @@ void transpose(float *a, int m, int n) {
   for (int i = 0; i < m * n; ++i) a[i] = tmp[i];
   free(tmp);
 }
-void cross_entropy_loss(int batch_size, bool row_major) {
+/**
+ * With num_samples >= 0, only the first num_samples rows are valid and the loss and gradients
+ * are normalised as if the batch were split across 2 GPUs.
+ */
+void cross_entropy_loss(int batch_size, bool row_major, int num_samples = -1) {
   int feature_dim = 2;
 
   GeneralBuffer<float> input_b;
@@ -79,6 +83,13 @@ void cross_entropy_loss(int batch_size, bool row_major) {
   if (!row_major) transpose(h_input, batch_size, feature_dim);
   cudaMemcpy(d_input, h_input, sizeof(float) * batch_size * feature_dim, cudaMemcpyHostToDevice);
   cudaMemcpy(d_label, h_label, sizeof(float) * batch_size, cudaMemcpyHostToDevice);
+  float normalizer = batch_size;
+  if (num_samples >= 0) {
+    normalizer = num_samples / 2.f;
+    cel.set_num_samples(num_samples, normalizer);
+  } else {
+    num_samples = batch_size;
+  }
   cel.fused_loss_computation(cudaStreamDefault);
 
   if (!row_major) transpose(h_input, feature_dim, batch_size);
@@ -97,18 +108,23 @@ void cross_entropy_loss(int batch_size, bool row_major) {
   scaler = 1024;
 #endif
   for (int i = 0; i < batch_size; ++i) {
+    if (i >= num_samples) {
+      h_input[i * feature_dim] = 0.f;
+      h_input[i * feature_dim + 1] = 0.f;
+      continue;
+    }
     z0_exp = exp(h_input[i * feature_dim]);
     z1_exp = exp(h_input[i * feature_dim + 1]);
 
     a0 = z0_exp / (z0_exp + z1_exp);
     a1 = z1_exp / (z0_exp + z1_exp);
 
-    h_input[i * feature_dim] = (a0 - (h_label[i] == 0.0f ? 1 : 0)) / batch_size * scaler;
-    h_input[i * feature_dim + 1] = (a1 - (h_label[i] == 1.0f ? 1 : 0)) / batch_size * scaler;
+    h_input[i * feature_dim] = (a0 - (h_label[i] == 0.0f ? 1 : 0)) / normalizer * scaler;
+    h_input[i * feature_dim + 1] = (a1 - (h_label[i] == 1.0f ? 1 : 0)) / normalizer * scaler;
 
     cpu_loss += -1 * log(h_label[i] == 0.0f ? a0 : a1);
   }
-  cpu_loss /= batch_size;
+  cpu_loss /= normalizer;
 
   ASSERT_EQ(true, cpu_gpu_cmp(&cpu_loss, d_loss, 1)) << " CSE Loss calulation failed" << endl;
   if (!row_major) transpose(h_input, batch_size, feature_dim);
@@ -123,8 +139,14 @@ TEST(loss_test, CrossEntropyLoss_2048_row_major) { cross_entropy_loss(2048, true
 TEST(loss_test, CrossEntropyLoss_2048_col_major) { cross_entropy_loss(2048, false); }
 TEST(loss_test, CrossEntropyLoss_64_row_major) { cross_entropy_loss(64, true); }
 TEST(loss_test, CrossEntropyLoss_64_col_major) { cross_entropy_loss(64, false); }
+TEST(loss_test, CrossEntropyLoss_64_row_major_num_samples) { cross_entropy_loss(64, true, 37); }
+TEST(loss_test, CrossEntropyLoss_64_col_major_num_samples) { cross_entropy_loss(64, false, 37); }
 
-void binary_cross_entropy_loss(int batch_size, bool row_major) {
+/**
+ * With num_samples >= 0, only the first num_samples rows are valid and the loss and gradients
+ * are normalised as if the batch were split across 2 GPUs.
+ */
+void binary_cross_entropy_loss(int batch_size, bool row_major, int num_samples = -1) {
   GeneralBuffer<float> input_b;
   GeneralBuffer<float> label_b;
   GeneralBuffer<float> loss_b;
@@ -167,6 +189,13 @@ void binary_cross_entropy_loss(int batch_size, bool row_major) {
   // GPU
   cudaMemcpy(d_input, h_input, sizeof(float) * batch_size, cudaMemcpyHostToDevice);
   cudaMemcpy(d_label, h_label, sizeof(float) * batch_size, cudaMemcpyHostToDevice);
+  float normalizer = batch_size;
+  if (num_samples >= 0) {
+    normalizer = num_samples / 2.f;
+    bce.set_num_samples(num_samples, normalizer);
+  } else {
+    num_samples = batch_size;
+  }
   bce.fused_loss_computation(cudaStreamDefault);
 
   float cpu_loss = 0.0f;
@@ -182,14 +211,18 @@ void binary_cross_entropy_loss(int batch_size, bool row_major) {
   scaler = 1024;
 #endif
   for (int i = 0; i < batch_size; ++i) {
+    if (i >= num_samples) {
+      h_input[i] = 0.f;
+      continue;
+    }
     x = h_input[i];
     val = 1 / (1 + exp(-h_input[i]));
     y = h_label[i];
 
-    h_input[i] = -1 * val * (y - val) * exp(-x) / (1 - val) / batch_size * scaler;
+    h_input[i] = -1 * val * (y - val) * exp(-x) / (1 - val) / normalizer * scaler;
     cpu_loss += y * log(val) + (1 - y) * log(1 - val);
   }
-  cpu_loss = -cpu_loss / batch_size;
+  cpu_loss = -cpu_loss / normalizer;
 
   ASSERT_EQ(true, cpu_gpu_cmp(&cpu_loss, d_loss, 1)) << " CSE Loss calulation failed" << endl;
   ASSERT_EQ(true, cpu_gpu_cmp(h_input, d_input, batch_size))
@@ -203,3 +236,4 @@ TEST(loss_test, BinaryCrossEntropyLoss_2048_row_major) { binary_cross_entropy_lo
 TEST(loss_test, BinaryCrossEntropyLoss_64_row_major) { binary_cross_entropy_loss(64, true); }
 TEST(loss_test, BinaryCrossEntropyLoss_2048_col_major) { binary_cross_entropy_loss(2048, false); }
 TEST(loss_test, BinaryCrossEntropyLoss_64_col_major) { binary_cross_entropy_loss(64, false); }
+TEST(loss_test, BinaryCrossEntropyLoss_64_num_samples) { binary_cross_entropy_loss(64, true, 37); }
@@ -25,7 +25,11 @@ using namespace std;
 using namespace HugeCTR;
 using namespace HugeCTR::test;
 
-void multi_cross_entropy_loss(int label_dim, int batch_size) {
+/**
+ * With num_samples >= 0, only the first num_samples rows are valid and the loss and gradients
+ * are normalised as if the batch were split across 2 GPUs.
+ */
+void multi_cross_entropy_loss(int label_dim, int batch_size, int num_samples = -1) {
   GeneralBuffer<float> input_b;
   GeneralBuffer<float> label_b;
   GeneralBuffer<float> loss_b;
@@ -56,6 +60,13 @@ void multi_cross_entropy_loss(int label_dim, int batch_size) {
   cudaMemcpy(d_input, h_input, sizeof(float) * batch_size * label_dim, cudaMemcpyHostToDevice);
   cudaMemcpy(d_label, h_label, sizeof(float) * batch_size * label_dim, cudaMemcpyHostToDevice);
 
+  float normalizer = batch_size;
+  if (num_samples >= 0) {
+    normalizer = num_samples / 2.f;
+    mel.set_num_samples(num_samples, normalizer);
+  } else {
+    num_samples = batch_size;
+  }
   mel.fused_loss_computation(cudaStreamDefault);
 
   int scaler = 1;
@@ -72,6 +83,10 @@ void multi_cross_entropy_loss(int label_dim, int batch_size) {
   const float MIN_ = 1e-6;
   float cpu_loss = 0.f;
   for (int i = 0; i < batch_size * label_dim; i++) {
+    if (i >= num_samples * label_dim) {
+      h_input[i] = 0.f;
+      continue;
+    }
     float x = h_input[i];
     float y = h_label[i];
     float val = 1.f / (1.f + exp(-x));
@@ -82,17 +97,20 @@ void multi_cross_entropy_loss(int label_dim, int batch_size) {
     h_input[i] =
         (h_label[i] < -0.5)
             ? 0.f
-            : (target_weight[target_weight_idx] * grad / (batch_size * label_dim) * scaler);
+            : (target_weight[target_weight_idx] * grad / (normalizer * label_dim) * scaler);
 
     // if(i == 0){
     //   printf("i=%d, x=%f, y=%f, target_weight[target_weight_idx]=%f, loss=%f, h_input=%f\n", i,
     //   x, y, target_weight[target_weight_idx], loss, h_input[i]);
     // }
   }
-  cpu_loss = -cpu_loss / (batch_size * label_dim);
+  cpu_loss = -cpu_loss / (normalizer * label_dim);
   ASSERT_EQ(true, cpu_gpu_cmp(h_input, d_input, batch_size * label_dim))
       << " CSE Gradient calulation failed" << endl;
   ASSERT_EQ(true, cpu_gpu_cmp(&cpu_loss, d_loss, 1)) << " CSE Loss calulation failed" << endl;
 }
 
 TEST(loss_test, MultiCrossEntropyLoss11_1024) { multi_cross_entropy_loss(11, 1024); }
+TEST(loss_test, MultiCrossEntropyLoss11_1024_num_samples) {
+  multi_cross_entropy_loss(11, 1024, 777);
+}